@@ -0,0 +1,239 @@
+/**
+ * \file components/gpp/phy/ChannelEmulator/ChannelEmulatorComponent.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Implementation of the ChannelEmulator component.
+ */
+
+#include "ChannelEmulatorComponent.h"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <sstream>
+#include <boost/random/uniform_01.hpp>
+#include <boost/random/uniform_int.hpp>
+#include <boost/random/variate_generator.hpp>
+
+using namespace std;
+
+namespace iris
+{
+namespace phy
+{
+
+// export library symbols - not from the static library, so that several
+// components can be linked into one test or benchmark
+#ifndef IRIS_STATIC_COMPONENT
+IRIS_COMPONENT_EXPORTS(PhyComponent, ChannelEmulatorComponent);
+#endif
+
+/// Samples between exact recalculations of the CFO phasor
+static const size_t CFO_RESYNC = 1024;
+
+ChannelEmulatorComponent::ChannelEmulatorComponent(string name)
+  : PhyComponent(name,
+                 "channelemulator",
+                 "A software radio channel (AWGN, CFO, multipath, frame loss)",
+                 "The Iris Project Developers",
+                 "0.1")
+  ,flat_(true)
+  ,gain_(1)
+  ,inBurst_(false)
+  ,phase_(0)
+  ,power_(0)
+  ,frames_(0)
+  ,lostFrames_(0)
+{
+  registerParameter(
+    "snr", "Signal to noise ratio in dB, relative to the mean power of each frame (inf for no noise)",
+    "30", true, snr_x);
+
+  registerParameter(
+    "cfo", "Carrier frequency offset in cycles per sample",
+    "0", true, cfo_x, Interval<float>(-0.5, 0.5));
+
+  registerParameter(
+    "timingoffset", "Max number of zero samples sent before each frame (chosen at random)",
+    "0", true, timingOffset_x, Interval<int>(0, 1000000));
+
+  registerParameter(
+    "taps", "Multipath channel taps as complex numbers, one per sample delay, e.g. \"(1,0) (0,0.3)\"",
+    "(1,0)", false, taps_x);
+
+  registerParameter(
+    "lossprob", "Probability that a burst of lost frames starts at a frame",
+    "0", true, lossProb_x, Interval<float>(0, 1));
+
+  registerParameter(
+    "burstlength", "Mean number of frames lost per burst",
+    "1", true, burstLength_x, Interval<float>(1, 1e9f));
+
+  registerParameter(
+    "gap", "Number of zero samples sent after each frame",
+    "0", true, gap_x, Interval<int>(0, 1000000));
+
+  registerParameter(
+    "seed", "Seed for noise, timing offsets and frame losses (0 means seed from the clock)",
+    "1", false, seed_x);
+}
+
+void ChannelEmulatorComponent::registerPorts()
+{
+  registerInputPort("input1", TypeInfo< complex<float> >::identifier);
+  registerOutputPort("output1", TypeInfo< complex<float> >::identifier);
+}
+
+void ChannelEmulatorComponent::calculateOutputTypes(
+  std::map<std::string,int>& inputTypes,
+  std::map<std::string,int>& outputTypes)
+{
+  outputTypes["output1"] = TypeInfo< complex<float> >::identifier;
+}
+
+void ChannelEmulatorComponent::initialize()
+{
+  vector<Cplx> taps;
+  istringstream in(taps_x);
+  Cplx tap;
+  while (in >> tap)
+    taps.push_back(tap);
+  if (!in.eof() || taps.empty())
+    throw IrisException("Invalid taps \"" + taps_x + "\" - expected complex numbers like \"(1,0) (0,0.3)\".");
+  flat_ = taps.size() == 1;
+  gain_ = taps.front();
+  if (!flat_)
+    multipath_.setCoeffs(taps.begin(), taps.end());
+
+  boost::uint32_t seed = seed_x != 0 ? seed_x : (boost::uint32_t)time(NULL);
+  noise_.setSeed(seed);
+  rng_.seed(seed ^ 0x5bd1e995u);
+  inBurst_ = false;
+  phase_ = 0;
+  power_ = 0;
+  frames_ = 0;
+  lostFrames_ = 0;
+}
+
+void ChannelEmulatorComponent::process()
+{
+  DataSet<Cplx>* readDataSet = NULL;
+  getInputDataSet("input1", readDataSet);
+  size_t size = readDataSet->data.size();
+  const Cplx* in = size > 0 ? &readDataSet->data[0] : NULL;
+
+  // The noise level follows the last frame that had any signal
+  float power = 0;
+  for (size_t i = 0; i < size; i++)
+    power += norm(in[i]);
+  if (power > 0)
+    power_ = power / size;
+  float sigma = sqrt(power_ / pow(10.0f, snr_x / 10));
+
+  size_t offset = 0;
+  if (timingOffset_x > 0)
+  {
+    boost::uniform_int<int> dist(0, timingOffset_x);
+    offset = dist(rng_);
+  }
+  bool lost = loseFrame();
+  size_t total = offset + size + gap_x;
+
+  DataSet<Cplx>* writeDataSet = NULL;
+  getOutputDataSet("output1", writeDataSet, total);
+  writeDataSet->timeStamp = readDataSet->timeStamp;
+  writeDataSet->sampleRate = readDataSet->sampleRate;
+
+  if (total > 0)
+  {
+    Cplx* out = &writeDataSet->data[0];
+    fill(out, out + offset, Cplx(0));
+    if (lost)
+      fill(out + offset, out + offset + size, Cplx(0));
+    else if (flat_)
+      for (size_t i = 0; i < size; i++)
+        out[offset + i] = in[i] * gain_;
+    else
+      copy(in, in + size, out + offset);
+    fill(out + offset + size, out + total, Cplx(0));
+
+    // The multipath filter runs over the whole stream, so the echo of a
+    // frame lands in the gap after it
+    if (!flat_)
+      multipath_.filter(out, out + total, out);
+    if (cfo_x != 0)
+      rotate(out, total);
+    if (sigma > 0)
+      noise_.add(out, total, sigma);
+  }
+
+  frames_++;
+  if (lost)
+  {
+    lostFrames_++;
+    LOG(LDEBUG) << "Lost frame " << frames_ << " (" << lostFrames_ << " so far)";
+  }
+
+  releaseOutputDataSet("output1", writeDataSet);
+  releaseInputDataSet("input1", readDataSet);
+}
+
+bool ChannelEmulatorComponent::loseFrame()
+{
+  if (lossProb_x <= 0 && !inBurst_)
+    return false;
+  boost::uniform_01<boost::mt19937&> u(rng_);
+  if (inBurst_)
+    inBurst_ = u() >= 1 / burstLength_x;
+  else
+    inBurst_ = u() < lossProb_x;
+  return inBurst_;
+}
+
+void ChannelEmulatorComponent::rotate(Cplx* data, size_t n)
+{
+  // Recurse on a unit phasor, recalculating it exactly now and then so
+  // rounding errors can't build up
+  const double twoPi = 6.283185307179586;
+  Cplx step = polar(1.0f, float(twoPi * cfo_x));
+  for (size_t i = 0; i < n; i += CFO_RESYNC)
+  {
+    Cplx p = polar(1.0f, float(twoPi * (phase_ + cfo_x * double(i))));
+    size_t end = min(n, i + CFO_RESYNC);
+    for (size_t k = i; k < end; k++)
+    {
+      data[k] *= p;
+      p *= step;
+    }
+  }
+  phase_ = fmod(phase_ + cfo_x * double(n), 1.0);
+}
+
+} // namespace phy
+} // namespace iris
@@ -0,0 +1,122 @@
+/**
+ * \file components/gpp/phy/ChannelEmulator/ChannelEmulatorComponent.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * The ChannelEmulatorComponent passes a complex signal through a
+ * software model of a radio channel, so that receivers can be tested
+ * and loaded without radio hardware.
+ */
+
+#ifndef PHY_CHANNELEMULATORCOMPONENT_H_
+#define PHY_CHANNELEMULATORCOMPONENT_H_
+
+#include <complex>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/random/mersenne_twister.hpp>
+
+#include <irisapi/PhyComponent.h>
+#include "utility/FirFilter.h"
+#include "utility/GaussianNoise.h"
+
+namespace iris
+{
+namespace phy
+{
+
+/** The ChannelEmulatorComponent applies channel impairments to a
+ *  complex signal.
+ *
+ *  Each input DataSet is treated as one frame. It is sent out after
+ *  a random number of zero samples (0 to timingoffset) and followed by
+ *  gap zero samples, like a burst on an otherwise idle channel. The
+ *  resulting stream then passes through:
+ *
+ *  - a multipath channel, given as FIR taps ("(1,0) (0,0.3)" gives a
+ *    direct path and a weaker second path one sample later),
+ *  - a carrier frequency offset, in cycles per sample, and
+ *  - additive white Gaussian noise. The SNR is relative to the mean
+ *    power of each input frame.
+ *
+ *  The multipath state and carrier phase carry over from one frame to
+ *  the next. Frames are lost in bursts following a Gilbert-Elliott
+ *  model: a burst starts at each frame with probability lossprob and
+ *  lasts burstlength frames on average. A lost frame is replaced by
+ *  silence of the same length, so the receiver only sees noise.
+ *
+ *  All random processes derive from seed, so a run can be repeated
+ *  exactly.
+ */
+class ChannelEmulatorComponent
+  : public PhyComponent
+{
+ public:
+  typedef std::complex<float> Cplx;
+
+  ChannelEmulatorComponent(std::string name);
+  virtual void calculateOutputTypes(
+    std::map<std::string, int>& inputTypes,
+    std::map<std::string, int>& outputTypes);
+  virtual void registerPorts();
+  virtual void initialize();
+  virtual void process();
+
+  /// Number of frames passed through and lost so far
+  boost::uint64_t getFrames() const { return frames_; }
+  boost::uint64_t getLostFrames() const { return lostFrames_; }
+
+ private:
+  bool loseFrame();
+  void rotate(Cplx* data, std::size_t n);
+
+  float snr_x;            ///< Signal to noise ratio in dB (inf for no noise)
+  float cfo_x;            ///< Carrier frequency offset in cycles per sample
+  int timingOffset_x;     ///< Max zero samples before each frame
+  std::string taps_x;     ///< Multipath channel taps
+  float lossProb_x;       ///< Probability that a loss burst starts at a frame
+  float burstLength_x;    ///< Mean number of frames per loss burst
+  int gap_x;              ///< Zero samples after each frame
+  int seed_x;             ///< Seed for all random processes (0 = seed from the clock)
+
+  FirFilter<Cplx> multipath_;
+  bool flat_;             ///< Single tap - multipath is a plain gain
+  Cplx gain_;             ///< The tap of a flat channel
+  GaussianNoise noise_;
+  boost::mt19937 rng_;    ///< Timing offsets and frame losses
+  bool inBurst_;          ///< Are frames being lost?
+  double phase_;          ///< Carrier phase of the next sample (cycles)
+  float power_;           ///< Mean power of the last frame with signal
+  boost::uint64_t frames_;
+  boost::uint64_t lostFrames_;
+};
+
+} // namespace phy
+} // namespace iris
+
+#endif // PHY_CHANNELEMULATORCOMPONENT_H_
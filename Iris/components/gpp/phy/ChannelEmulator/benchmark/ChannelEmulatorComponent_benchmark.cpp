@@ -0,0 +1,148 @@
+/**
+ * \file components/gpp/phy/ChannelEmulator/benchmark/ChannelEmulatorComponent_benchmark.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main benchmark file for ChannelEmulator component.
+ */
+
+#include "../ChannelEmulatorComponent.h"
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/variate_generator.hpp>
+#include "utility/DataBufferTrivial.h"
+
+using namespace std;
+using namespace iris;
+using namespace iris::phy;
+namespace bp = boost::posix_time;
+
+typedef complex<float> Cplx;
+
+static const int num = 10000;
+static const int numBlocks = 1000;
+
+/// Time numBlocks calls to process() for a given emulator configuration
+void runBenchmark(string description, ChannelEmulatorComponent& mod)
+{
+  mod.registerPorts();
+
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo<Cplx>::identifier;
+  mod.calculateOutputTypes(iTypes,oTypes);
+
+  // Ring buffers reuse their DataSets, so we measure the steady state
+  DataBufferTrivial<Cplx> in(2, true);
+  DataBufferTrivial<Cplx> out(2, true);
+  for(int b=0;b<2;b++)
+  {
+    DataSet<Cplx>* iSet = NULL;
+    in.getWriteData(iSet, num);
+    for(int i=0;i<num;i++)
+      iSet->data[i] = Cplx(i%7 - 3, i%5 - 2);
+    in.releaseWriteData(iSet);
+    in.getReadData(iSet);
+    in.releaseReadData(iSet);
+  }
+
+  mod.setBuffers(&in,&out);
+  mod.initialize();
+
+  bp::ptime t1(bp::microsec_clock::local_time());
+  for(int b=0;b<numBlocks;b++)
+  {
+    DataSet<Cplx>* iSet = NULL;
+    in.getWriteData(iSet, num);
+    in.releaseWriteData(iSet);
+
+    mod.process();
+
+    DataSet<Cplx>* oSet = NULL;
+    out.getReadData(oSet);
+    out.releaseReadData(oSet);
+  }
+  bp::ptime t2(bp::microsec_clock::local_time());
+
+  float megSampsPerSec = (num*numBlocks)*1.0e3/(t2-t1).total_nanoseconds();
+  cout << description << ": Rate = " << megSampsPerSec << " MS/sec" << endl;
+}
+
+/// Noise alone - GaussianNoise against boost::normal_distribution
+void runNoiseBenchmark()
+{
+  vector<Cplx> data(num);
+
+  boost::mt19937 rng(1);
+  boost::normal_distribution<float> normal(0, 1);
+  boost::variate_generator<boost::mt19937&, boost::normal_distribution<float> > gen(rng, normal);
+  bp::ptime t1(bp::microsec_clock::local_time());
+  for(int b=0;b<numBlocks;b++)
+    for(int i=0;i<num;i++)
+      data[i] += Cplx(gen(), gen());
+  bp::ptime t2(bp::microsec_clock::local_time());
+  cout << "Noise (boost::normal_distribution): Rate = "
+       << (num*numBlocks)*1.0e3/(t2-t1).total_nanoseconds() << " MS/sec" << endl;
+
+  GaussianNoise noise(1);
+  t1 = bp::microsec_clock::local_time();
+  for(int b=0;b<numBlocks;b++)
+    noise.add(&data[0], num, 1);
+  t2 = bp::microsec_clock::local_time();
+  cout << "Noise (GaussianNoise): Rate = "
+       << (num*numBlocks)*1.0e3/(t2-t1).total_nanoseconds() << " MS/sec" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+  runNoiseBenchmark();
+  {
+    ChannelEmulatorComponent mod("test");
+    runBenchmark("AWGN", mod);
+  }
+  {
+    ChannelEmulatorComponent mod("test");
+    mod.setValue("cfo", 0.001f);
+    runBenchmark("AWGN + CFO", mod);
+  }
+  {
+    ChannelEmulatorComponent mod("test");
+    mod.setValue("cfo", 0.001f);
+    mod.setValue("taps", "(1,0) (0,0.3) (0.1,0) (0,-0.05)");
+    runBenchmark("AWGN + CFO + 4 taps", mod);
+  }
+  {
+    ChannelEmulatorComponent mod("test");
+    mod.setValue("cfo", 0.001f);
+    mod.setValue("taps", "(1,0) (0,0.3) (0.1,0) (0,-0.05)");
+    mod.setValue("timingoffset", 100);
+    mod.setValue("gap", 1000);
+    mod.setValue("lossprob", 0.01f);
+    runBenchmark("All impairments", mod);
+  }
+}
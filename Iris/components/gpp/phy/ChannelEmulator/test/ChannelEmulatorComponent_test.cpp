@@ -0,0 +1,218 @@
+/**
+ * \file components/gpp/phy/ChannelEmulator/test/ChannelEmulatorComponent_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for ChannelEmulator component.
+ */
+
+#define BOOST_TEST_MODULE ChannelEmulatorComponent_Test
+
+#include <boost/test/unit_test.hpp>
+
+#include "../ChannelEmulatorComponent.h"
+#include "utility/DataBufferTrivial.h"
+
+using namespace std;
+using namespace iris;
+using namespace iris::phy;
+
+typedef complex<float> Cplx;
+
+/// Push one frame through the emulator and return what comes out
+vector<Cplx> runFrame(ChannelEmulatorComponent& mod, const vector<Cplx>& frame)
+{
+  DataBufferTrivial<Cplx> in;
+  DataBufferTrivial<Cplx> out;
+
+  DataSet<Cplx>* iSet = NULL;
+  in.getWriteData(iSet, frame.size());
+  copy(frame.begin(), frame.end(), iSet->data.begin());
+  in.releaseWriteData(iSet);
+
+  mod.setBuffers(&in,&out);
+  mod.process();
+
+  DataSet<Cplx>* oSet = NULL;
+  out.getReadData(oSet);
+  vector<Cplx> result(oSet->data.begin(), oSet->data.end());
+  out.releaseReadData(oSet);
+  return result;
+}
+
+ChannelEmulatorComponent* makeEmulator()
+{
+  ChannelEmulatorComponent* mod = new ChannelEmulatorComponent("test");
+  mod->registerPorts();
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo<Cplx>::identifier;
+  mod->calculateOutputTypes(iTypes,oTypes);
+  return mod;
+}
+
+BOOST_AUTO_TEST_SUITE (ChannelEmulatorComponent_Test)
+
+BOOST_AUTO_TEST_CASE(ChannelEmulatorComponent_Parm_Test)
+{
+  ChannelEmulatorComponent mod("test");
+  BOOST_CHECK(mod.getParameterDefaultValue("snr") == "30");
+  BOOST_CHECK(mod.getParameterDefaultValue("cfo") == "0");
+  BOOST_CHECK(mod.getParameterDefaultValue("taps") == "(1,0)");
+  BOOST_CHECK(mod.getParameterDefaultValue("lossprob") == "0");
+  BOOST_CHECK(mod.getParameterDefaultValue("seed") == "1");
+}
+
+BOOST_AUTO_TEST_CASE(ChannelEmulatorComponent_Ports_Test)
+{
+  ChannelEmulatorComponent mod("test");
+  BOOST_REQUIRE_NO_THROW(mod.registerPorts());
+
+  vector<Port> iPorts = mod.getInputPorts();
+  BOOST_REQUIRE(iPorts.size() == 1);
+  BOOST_REQUIRE(iPorts.front().portName == "input1");
+  vector<Port> oPorts = mod.getOutputPorts();
+  BOOST_REQUIRE(oPorts.size() == 1);
+  BOOST_REQUIRE(oPorts.front().portName == "output1");
+
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo<Cplx>::identifier;
+  mod.calculateOutputTypes(iTypes,oTypes);
+  BOOST_REQUIRE(oTypes["output1"] == TypeInfo<Cplx>::identifier);
+}
+
+BOOST_AUTO_TEST_CASE(ChannelEmulatorComponent_Taps_Test)
+{
+  boost::scoped_ptr<ChannelEmulatorComponent> mod(makeEmulator());
+  mod->setValue("taps", "(1,0) bad");
+  BOOST_CHECK_THROW(mod->initialize(), IrisException);
+  mod->setValue("taps", "");
+  BOOST_CHECK_THROW(mod->initialize(), IrisException);
+  mod->setValue("taps", "(1,0) 0.5 (0,0.25)");
+  BOOST_CHECK_NO_THROW(mod->initialize());
+}
+
+BOOST_AUTO_TEST_CASE(ChannelEmulatorComponent_Clean_Test)
+{
+  // No noise, an echo one sample later and a gap to catch its tail
+  boost::scoped_ptr<ChannelEmulatorComponent> mod(makeEmulator());
+  mod->setValue("snr", "inf");
+  mod->setValue("taps", "(1,0) (0,0.5)");
+  mod->setValue("gap", 2);
+  mod->initialize();
+
+  vector<Cplx> frame(4, Cplx(0));
+  frame[0] = Cplx(1, 0);
+  vector<Cplx> out = runFrame(*mod, frame);
+  BOOST_REQUIRE_EQUAL(out.size(), 6u);
+  BOOST_CHECK_CLOSE(out[0].real(), 1.0f, 1e-4);
+  BOOST_CHECK_CLOSE(out[1].imag(), 0.5f, 1e-4);
+  BOOST_CHECK_SMALL(abs(out[2]), 1e-6f);
+
+  // A frame ending on a sample - its echo lands at the start of the gap
+  frame.assign(4, Cplx(0));
+  frame[3] = Cplx(2, 0);
+  out = runFrame(*mod, frame);
+  BOOST_CHECK_CLOSE(out[3].real(), 2.0f, 1e-4);
+  BOOST_CHECK_CLOSE(out[4].imag(), 1.0f, 1e-4);
+}
+
+BOOST_AUTO_TEST_CASE(ChannelEmulatorComponent_Cfo_Test)
+{
+  boost::scoped_ptr<ChannelEmulatorComponent> mod(makeEmulator());
+  mod->setValue("snr", "inf");
+  mod->setValue("cfo", 0.01f);
+  mod->initialize();
+
+  // The phase keeps turning across frames
+  vector<Cplx> frame(3000, Cplx(1, 0));
+  vector<Cplx> out1 = runFrame(*mod, frame);
+  vector<Cplx> out2 = runFrame(*mod, frame);
+  for(size_t i=0; i<frame.size(); i+=499)
+  {
+    Cplx expected1 = polar(1.0f, float(2*M_PI*0.01*i));
+    Cplx expected2 = polar(1.0f, float(2*M_PI*0.01*(i + frame.size())));
+    BOOST_CHECK_SMALL(abs(out1[i] - expected1), 1e-4f);
+    BOOST_CHECK_SMALL(abs(out2[i] - expected2), 1e-4f);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(ChannelEmulatorComponent_Noise_Test)
+{
+  boost::scoped_ptr<ChannelEmulatorComponent> mod(makeEmulator());
+  mod->setValue("snr", 10.0f);
+  mod->setValue("gap", 100000);
+  mod->initialize();
+
+  // The gap holds only noise, 10 dB below the power of the frame (4)
+  vector<Cplx> frame(1000, Cplx(0, 2));
+  vector<Cplx> out = runFrame(*mod, frame);
+  BOOST_REQUIRE_EQUAL(out.size(), 101000u);
+  double power = 0;
+  for(size_t i=1000; i<out.size(); i++)
+    power += norm(out[i]);
+  BOOST_CHECK_CLOSE(power / 100000, 0.4, 2.0);
+
+  // The same seed gives the same noise
+  boost::scoped_ptr<ChannelEmulatorComponent> mod2(makeEmulator());
+  mod2->setValue("snr", 10.0f);
+  mod2->setValue("gap", 100000);
+  mod2->initialize();
+  BOOST_CHECK(runFrame(*mod2, frame) == out);
+}
+
+BOOST_AUTO_TEST_CASE(ChannelEmulatorComponent_Loss_Test)
+{
+  boost::scoped_ptr<ChannelEmulatorComponent> mod(makeEmulator());
+  mod->setValue("snr", "inf");
+  mod->setValue("lossprob", 0.2f);
+  mod->setValue("burstlength", 4.0f);
+  mod->setValue("timingoffset", 10);
+  mod->initialize();
+
+  vector<Cplx> frame(20, Cplx(1, 1));
+  size_t lost = 0, bursts = 0;
+  bool wasLost = false;
+  for(int f=0; f<5000; f++)
+  {
+    vector<Cplx> out = runFrame(*mod, frame);
+    BOOST_REQUIRE(out.size() >= 20u && out.size() <= 30u);
+    bool isLost = abs(out.back()) == 0;
+    if(isLost)
+      lost++;
+    if(isLost && !wasLost)
+      bursts++;
+    wasLost = isLost;
+  }
+  BOOST_CHECK_EQUAL(mod->getFrames(), 5000u);
+  BOOST_CHECK_EQUAL(mod->getLostFrames(), lost);
+  // Bursts last 4 frames on average; in the long run 0.2/(0.2+1/4) = 44% are lost
+  BOOST_CHECK_CLOSE(lost / double(bursts), 4.0, 10.0);
+  BOOST_CHECK_CLOSE(lost / 5000.0, 0.2/0.45, 10.0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
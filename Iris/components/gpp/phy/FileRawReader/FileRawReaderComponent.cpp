@@ -34,10 +34,20 @@
 #include "FileRawReaderComponent.h"
 
 #include <algorithm>
+#include <cstring>
 #include <boost/scoped_array.hpp>
 #include <boost/thread.hpp>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#endif
+
 #include "utility/EndianConversion.h"
+#include "utility/CaptureIndex.h"
 
 using namespace std;
 
@@ -46,6 +56,23 @@ namespace iris
 namespace phy
 {
 
+/// Size of the window we ask the kernel to read ahead in mmap mode
+static const size_t READ_AHEAD = 8*1024*1024;
+
+/// Current time in seconds from a clock which never jumps
+static double monotonicSeconds()
+{
+#ifndef _WIN32
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec*1e-9;
+#else
+  using namespace boost::posix_time;
+  static const ptime epoch(microsec_clock::universal_time());
+  return (microsec_clock::universal_time() - epoch).total_microseconds()*1e-6;
+#endif
+}
+
 // export library symbols
 IRIS_COMPONENT_EXPORTS(PhyComponent, FileRawReaderComponent);
 
@@ -54,7 +81,23 @@ FileRawReaderComponent::FileRawReaderComponent(string name)
                 "FileRawReader",
                 "A filereader",
                 "Paul Sutton",
-                "0.2")
+                "0.3"),
+    map_(NULL),
+    mapSize_(0),
+    mapOffset_(0),
+    aheadOffset_(0),
+    dataOffset_(0),
+    dataEnd_(0),
+    streamPos_(0),
+    samplesRead_(0),
+    anchorSamples_(0),
+    anchorTime_(0),
+    anchored_(false),
+    timeBase_(0),
+    quantised_(false),
+    iqFormat_(IQ_SC16),
+    iqBlockSize_(0),
+    decodedPos_(0)
 {
   list<string> allowedTypes;
   allowedTypes.push_back(TypeInfo< uint8_t >::name());
@@ -110,6 +153,47 @@ FileRawReaderComponent::FileRawReaderComponent(string name)
                     true,
                     delay_x,
                     Interval<uint32_t>(0,5000000));
+  registerParameter("mmap",
+                    "Memory-map the file instead of reading it as a stream",
+                    "false",
+                    false,
+                    mmap_x);
+  registerParameter("samplerate",
+                    "Sample rate of the data in the file",
+                    "1000000",
+                    false,
+                    sampleRate_x,
+                    Interval<double>(1e-3, 1e12));
+  registerParameter("speed",
+                    "Playback speed relative to real time (0 = as fast as possible)",
+                    "0",
+                    true,
+                    speed_x,
+                    Interval<double>(0, 1e6));
+  list<string> formats;
+  formats.push_back("raw");
+  formats.push_back("quantised");
+  registerParameter("format",
+                    "File format (raw|quantised) - quantised reads sc16/sc8 files as complex<float>",
+                    "raw",
+                    false,
+                    format_x,
+                    formats);
+  registerParameter("starttime",
+                    "Replay from this time, using the index file (-1 = start of file)",
+                    "-1",
+                    false,
+                    startTime_x);
+  registerParameter("stoptime",
+                    "Replay up to this time, using the index file (-1 = end of file)",
+                    "-1",
+                    false,
+                    stopTime_x);
+}
+
+FileRawReaderComponent::~FileRawReaderComponent()
+{
+  unmapFile();
 }
 
 void FileRawReaderComponent::registerPorts()
@@ -172,19 +256,107 @@ void FileRawReaderComponent::calculateOutputTypes(
 
 void FileRawReaderComponent::initialize()
 {
-  //Open the file and retrieve its size
-  hInFile_.open(fileName_x.c_str(), ios::in|ios::binary|ios::ate);
-  if(hInFile_.fail() || hInFile_.bad() || !hInFile_.is_open())
+  unmapFile();
+  if(hInFile_.is_open())
+    hInFile_.close();
+  samplesRead_ = 0;
+  anchored_ = false;
+
+  size_t fileSize = 0;
+  bool mapped = mmap_x && mapFile();
+  if(mmap_x && !mapped)
+    LOG(LWARNING) << "Could not memory-map file " << fileName_x
+                  << ", reading it as a stream instead.";
+
+  if(mapped)
+    fileSize = mapSize_;
+  else
   {
-    LOG(LFATAL) << "Could not open file " << fileName_x << " for reading.";
-    throw ResourceNotFoundException(
-        "Could not open file " + fileName_x + " for reading.");
+    //Open the file and retrieve its size
+    hInFile_.open(fileName_x.c_str(), ios::in|ios::binary|ios::ate);
+    if(hInFile_.fail() || hInFile_.bad() || !hInFile_.is_open())
+    {
+      LOG(LFATAL) << "Could not open file " << fileName_x << " for reading.";
+      throw ResourceNotFoundException(
+          "Could not open file " + fileName_x + " for reading.");
+    }
+    fileSize = hInFile_.tellg();
+    hInFile_.seekg(0, ios::beg);
   }
-  hInFile_.seekg(0, ios::beg);
+
+  dataOffset_ = 0;
+  dataEnd_ = fileSize;
+  streamPos_ = 0;
+  timeBase_ = 0;
+  quantised_ = format_x == "quantised";
+  decoded_.clear();
+  decodedPos_ = 0;
+  if(quantised_)
+    readIqHeader(fileSize);
+  if(startTime_x >= 0 || stopTime_x >= 0)
+    seekIndex();
+}
+
+void FileRawReaderComponent::seekIndex()
+{
+  CaptureIndex index;
+  if(!index.load(fileName_x + ".idx"))
+  {
+    LOG(LFATAL) << "Could not read index " << fileName_x << ".idx";
+    throw ResourceNotFoundException("Could not read index " + fileName_x + ".idx");
+  }
+  if(index.empty())
+    return;
+
+  CaptureRange r = index.range(max(startTime_x, 0.0), stopTime_x);
+  if(r.startByte < dataOffset_ || r.startByte >= dataEnd_ || r.stopByte > dataEnd_)
+    throw IrisException("Index " + fileName_x + ".idx does not match the file.");
+  dataOffset_ = r.startByte;
+  if(r.stopByte > 0)
+    dataEnd_ = r.stopByte;
+  timeBase_ = r.startTime;
+  if(index.sampleRate() > 0)
+    sampleRate_x = index.sampleRate();
+
+  if(map_ != NULL)
+    mapOffset_ = aheadOffset_ = dataOffset_;
+  else
+    hInFile_.seekg(dataOffset_, ios::beg);
+  streamPos_ = dataOffset_;
+  LOG(LDEBUG) << "Replaying bytes " << dataOffset_ << " to " << dataEnd_
+              << " of " << fileName_x << " from time " << timeBase_;
+}
+
+void FileRawReaderComponent::readIqHeader(size_t fileSize)
+{
+  if(dataType_x != "complex<float>")
+    throw InvalidDataTypeException("Quantised IQ files can only be read as complex<float>");
+
+  char header[quantisediq::HEADER_SIZE];
+  if(fileSize < quantisediq::HEADER_SIZE + quantisediq::BLOCK_HEADER_SIZE)
+    throw IrisException("File " + fileName_x + " is too short to be a quantised IQ file.");
+  readBytes(header, quantisediq::HEADER_SIZE);
+  if(!quantisediq::readHeader(header, iqFormat_, iqBlockSize_))
+    throw IrisException("File " + fileName_x + " is not a quantised IQ file.");
+
+  //Wrap around to the first block, not the header
+  dataOffset_ = quantisediq::HEADER_SIZE;
+  LOG(LDEBUG) << "Reading " << (iqFormat_ == IQ_SC16 ? "sc16" : "sc8")
+              << " file with " << iqBlockSize_ << " samples per block.";
+}
+
+void FileRawReaderComponent::parameterHasChanged(std::string name)
+{
+  //Restart pacing from the current position at the new speed
+  if(name == "speed")
+    anchored_ = false;
 }
 
 void FileRawReaderComponent::process()
 {
+  if(speed_x > 0)
+    pace();
+
   switch (outputBuffers[0]->getTypeIdentifier())
   {
     case TypeInfo<uint8_t>::identifier:
@@ -221,7 +393,10 @@ void FileRawReaderComponent::process()
       readBlock<long double> ();
       break;
     case TypeInfo<complex<float> >::identifier:
-      readBlock<complex<float> > ();
+      if(quantised_)
+        readQuantisedBlock();
+      else
+        readBlock<complex<float> > ();
       break;
     case TypeInfo<complex<double> >::identifier:
       readBlock<complex<double> > ();
@@ -232,7 +407,26 @@ void FileRawReaderComponent::process()
     default:
       break;
   }
-  boost::this_thread::sleep(boost::posix_time::microseconds(delay_x));
+  if(delay_x > 0)
+    boost::this_thread::sleep(boost::posix_time::microseconds(delay_x));
+}
+
+void FileRawReaderComponent::pace()
+{
+  double now = monotonicSeconds();
+  if(!anchored_)
+  {
+    anchorTime_ = now;
+    anchorSamples_ = samplesRead_;
+    anchored_ = true;
+  }
+
+  //A block is due when its last sample would have been received
+  double due = anchorTime_ +
+      (samplesRead_ + blockSize_x - anchorSamples_)/(sampleRate_x*speed_x);
+  if(due > now)
+    boost::this_thread::sleep(
+        boost::posix_time::microseconds((int64_t)((due - now)*1e6)));
 }
 
 template<typename T>
@@ -243,36 +437,194 @@ void FileRawReaderComponent::readBlock()
   DataSet<T>* writeDataSet = NULL;
   outBuf->getWriteData(writeDataSet, blockSize_x);
 
-  char *bytebuf = reinterpret_cast<char*>(&writeDataSet->data[0]);
-  ifstream::pos_type toread = blockSize_x * sizeof(T);
+  writeDataSet->sampleRate = sampleRate_x;
+  writeDataSet->timeStamp = timeBase_ + samplesRead_/sampleRate_x;
+  samplesRead_ += blockSize_x;
 
+  T* out = &writeDataSet->data[0];
+  bool convert = sizeof(T) > 1 && endian_x != "native";
+
+  if(map_ != NULL && convert && dataOffset_ % sizeof(T) == 0
+     && (dataEnd_ - dataOffset_) % sizeof(T) == 0)
+  {
+    //Convert endianess on the way out of the mapping - no extra copy
+    size_t done = 0;
+    while(done < (size_t)blockSize_x)
+    {
+      size_t n = min(blockSize_x - done, (dataEnd_ - mapOffset_)/sizeof(T));
+      const T* in = reinterpret_cast<const T*>(map_ + mapOffset_);
+      if (endian_x == "little")
+        lit2sys(in, in+n, out+done);
+      else if (endian_x == "big")
+        big2sys(in, in+n, out+done);
+      readMapped(NULL, n*sizeof(T));
+      done += n;
+    }
+  }
+  else
+  {
+    //Read a block of raw bytes
+    char *bytebuf = reinterpret_cast<char*>(out);
+    if(map_ != NULL)
+      readMapped(bytebuf, blockSize_x * sizeof(T));
+    else
+      readStream(bytebuf, blockSize_x * sizeof(T));
+
+    if (convert)
+    {
+      //Convert endianess in place
+      if (endian_x == "little")
+        lit2sys(out, out+blockSize_x, out);
+      else if (endian_x == "big")
+        big2sys(out, out+blockSize_x, out);
+    }
+  }
+
+  outBuf->releaseWriteData(writeDataSet);
+}
+
+void FileRawReaderComponent::readQuantisedBlock()
+{
+  WriteBuffer< complex<float> >* outBuf = castToType< complex<float> >(outputBuffers[0]);
+  DataSet< complex<float> >* writeDataSet = NULL;
+  outBuf->getWriteData(writeDataSet, blockSize_x);
+
+  writeDataSet->sampleRate = sampleRate_x;
+  writeDataSet->timeStamp = timeBase_ + samplesRead_/sampleRate_x;
+  samplesRead_ += blockSize_x;
+
+  //Expand blocks from the file until the DataSet is full
+  complex<float>* out = &writeDataSet->data[0];
+  size_t toread = blockSize_x;
+  while(toread > 0)
+  {
+    if(decodedPos_ == decoded_.size())
+    {
+      char header[quantisediq::BLOCK_HEADER_SIZE];
+      readBytes(header, quantisediq::BLOCK_HEADER_SIZE);
+      size_t num = quantisediq::getU32(header);
+      float scale = quantisediq::getF32(header + 4);
+      if(num == 0 || num > iqBlockSize_)
+        throw IrisException("Corrupt block in quantised IQ file " + fileName_x);
+
+      raw_.resize(num*quantisediq::bytesPerSample(iqFormat_));
+      readBytes(&raw_[0], raw_.size());
+      decoded_.resize(num);
+      quantisediq::decodeBlock(&raw_[0], num, scale, iqFormat_, &decoded_[0]);
+      decodedPos_ = 0;
+    }
+    size_t n = min(toread, decoded_.size() - decodedPos_);
+    copy(&decoded_[decodedPos_], &decoded_[decodedPos_] + n, out);
+    decodedPos_ += n;
+    out += n;
+    toread -= n;
+  }
+
+  outBuf->releaseWriteData(writeDataSet);
+}
+
+void FileRawReaderComponent::readBytes(char* out, size_t bytes)
+{
+  if(map_ != NULL)
+    readMapped(out, bytes);
+  else
+    readStream(out, bytes);
+}
+
+void FileRawReaderComponent::readStream(char* out, size_t bytes)
+{
   //Read a block (loop if necessary)
-  while( toread > 0 )
+  while( bytes > 0 )
   {
-    hInFile_.read(bytebuf, toread);
-    toread -= hInFile_.gcount();
-    bytebuf += hInFile_.gcount();
-    if( hInFile_.eof() )
+    hInFile_.read(out, min(bytes, dataEnd_ - streamPos_));
+    bytes -= hInFile_.gcount();
+    out += hInFile_.gcount();
+    streamPos_ += hInFile_.gcount();
+    if( hInFile_.eof() || streamPos_ >= dataEnd_ )
     {
       hInFile_.clear();
-      hInFile_.seekg(0, ios::beg);
+      hInFile_.seekg(dataOffset_, ios::beg);
+      streamPos_ = dataOffset_;
     }
   }
+}
 
-  if (sizeof(T) > 1)
+void FileRawReaderComponent::readMapped(char* out, size_t bytes)
+{
+#ifndef _WIN32
+  while( bytes > 0 )
   {
-    //Convert endianess
-    if (endian_x == "native")
-      ; // nothing to do
-    else if (endian_x == "little")
-      transform(writeDataSet->data.begin(), writeDataSet->data.end(),
-                writeDataSet->data.begin(), lit2sys<T> );
-    else if (endian_x == "big")
-      transform(writeDataSet->data.begin(), writeDataSet->data.end(),
-                writeDataSet->data.begin(), big2sys<T> );
+    //Ask for the next window once we are half way through the current one
+    if(aheadOffset_ < dataEnd_ && mapOffset_ + READ_AHEAD/2 >= aheadOffset_)
+    {
+      size_t len = min(READ_AHEAD, dataEnd_ - aheadOffset_);
+      madvise(const_cast<char*>(map_) + aheadOffset_, len, MADV_WILLNEED);
+      aheadOffset_ += len;
+    }
+
+    size_t n = min(bytes, dataEnd_ - mapOffset_);
+    if(out != NULL)
+    {
+      memcpy(out, map_ + mapOffset_, n);
+      out += n;
+    }
+    bytes -= n;
+    mapOffset_ += n;
+    if(mapOffset_ == dataEnd_)
+    {
+      //Wrap around to the start of the data
+      mapOffset_ = dataOffset_;
+      aheadOffset_ = dataOffset_;
+    }
   }
+#endif
+}
 
-  outBuf->releaseWriteData(writeDataSet);
+bool FileRawReaderComponent::mapFile()
+{
+#ifndef _WIN32
+  int fd = open(fileName_x.c_str(), O_RDONLY);
+  if(fd < 0)
+  {
+    LOG(LFATAL) << "Could not open file " << fileName_x << " for reading.";
+    throw ResourceNotFoundException(
+        "Could not open file " + fileName_x + " for reading.");
+  }
+
+  struct stat st;
+  if(fstat(fd, &st) != 0 || st.st_size <= 0)
+  {
+    close(fd);
+    return false;
+  }
+
+  void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  //The mapping stays valid after the descriptor is closed
+  close(fd);
+  if(p == MAP_FAILED)
+    return false;
+
+  madvise(p, st.st_size, MADV_SEQUENTIAL);
+  map_ = static_cast<const char*>(p);
+  mapSize_ = st.st_size;
+  mapOffset_ = 0;
+  aheadOffset_ = 0;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void FileRawReaderComponent::unmapFile()
+{
+#ifndef _WIN32
+  if(map_ != NULL)
+    munmap(const_cast<char*>(map_), mapSize_);
+#endif
+  map_ = NULL;
+  mapSize_ = 0;
+  mapOffset_ = 0;
+  aheadOffset_ = 0;
 }
 
 } // namespace phy
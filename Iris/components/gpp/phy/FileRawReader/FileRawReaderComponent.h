@@ -37,6 +37,7 @@
 #include <fstream>
 
 #include "irisapi/PhyComponent.h"
+#include "utility/QuantisedIq.h"
 
 namespace iris
 {
@@ -48,30 +49,112 @@ namespace phy
  * The FileRawReaderComponent reads raw data from a named file
  * and interprets it as a given data type. The size of blocks
  * to read and the data endianness can be specified using parameters.
+ * The file is read repeatedly, starting again at the beginning each
+ * time the end is reached.
+ *
+ * If the "mmap" parameter is set, the file is memory-mapped instead of
+ * being read through a stream. Each block is then copied (and byte-swapped
+ * if needed) straight from the mapping into the output DataSet and wrapping
+ * around to the start of the file is just an offset reset.
+ *
+ * Each DataSet carries the "samplerate" parameter as its sampleRate and
+ * the time of its first sample, counted from the start of the file in
+ * seconds, as its timeStamp. Timestamps keep increasing when the file
+ * wraps. The "speed" parameter paces output against a monotonic clock:
+ * 0 emits blocks as fast as possible, 1 emits them in real time (like
+ * a receiver would) and N emits them at N times real time. Block release
+ * times are computed from the sample count, so sleeps do not accumulate
+ * drift.
+ *
+ * With format "quantised" the file must be an sc16/sc8 file written by
+ * FileRawWriterComponent (see utility/QuantisedIq.h). The format is taken
+ * from the file header and samples are expanded to complex<float>.
+ *
+ * If starttime or stoptime is set, the index written alongside the file by
+ * FileRawWriterComponent (<filename>.idx, see utility/CaptureIndex.h) is
+ * used to find that part of the file, and only that part is replayed. The
+ * range starts at the index entry at or before starttime and stops at the
+ * entry at or after stoptime. Timestamps and the sample rate then come from
+ * the index. Several readers can replay different ranges of one file.
  */
 class FileRawReaderComponent
   : public PhyComponent
 {
  public:
   FileRawReaderComponent(std::string name);
+  virtual ~FileRawReaderComponent();
   virtual void calculateOutputTypes(
         std::map<std::string, int>& inputTypes,
         std::map<std::string, int>& outputTypes);
   virtual void registerPorts();
   virtual void initialize();
   virtual void process();
+  virtual void parameterHasChanged(std::string name);
 
  private:
   /// Template function used to read the data
   template<typename T> void readBlock();
 
+  /// Read a block from a quantised IQ file
+  void readQuantisedBlock();
+
+  /// Find the range to replay in the index file
+  void seekIndex();
+
+  /// Read and check the header of a quantised IQ file
+  void readIqHeader(std::size_t fileSize);
+
+  /// Copy a block of raw bytes from the file (either mode)
+  void readBytes(char* out, std::size_t bytes);
+
+  /// Copy a block of raw bytes from the file (stream mode)
+  void readStream(char* out, std::size_t bytes);
+
+  /// Copy a block of raw bytes from the file (mmap mode) - or skip it if out is NULL
+  void readMapped(char* out, std::size_t bytes);
+
+  /// Sleep until the current block is due (pacing mode)
+  void pace();
+
+  /// Map the file into memory, return false if not possible
+  bool mapFile();
+
+  /// Unmap the file
+  void unmapFile();
+
   int blockSize_x;          ///< Size of blocks to read from file
   std::string fileName_x;   ///< Name of file to read
   std::string dataType_x;   ///< Interpret the data as this data type
   std::string endian_x;     ///< Endianness of the data
   uint32_t delay_x;         ///< Time to wait between blocks.
+  bool mmap_x;              ///< Memory-map the file rather than streaming it
+  double sampleRate_x;      ///< Sample rate of the data in the file
+  double speed_x;           ///< Playback speed (0=as fast as possible, 1=real time)
+  std::string format_x;     ///< File format (raw|quantised)
+  double startTime_x;       ///< Replay from this time (-1 = start of file)
+  double stopTime_x;        ///< Replay up to this time (-1 = end of file)
 
   std::ifstream hInFile_;   ///< The file stream
+  const char* map_;         ///< Start of the mapped file (mmap mode)
+  std::size_t mapSize_;     ///< Size of the mapped file in bytes
+  std::size_t mapOffset_;   ///< Read position in the mapped file
+  std::size_t aheadOffset_; ///< End of the region we have asked the kernel to read ahead
+  std::size_t dataOffset_;  ///< Where the data starts (we wrap to here)
+  std::size_t dataEnd_;     ///< Where the data ends (we wrap from here)
+  std::size_t streamPos_;   ///< Position in the file (stream mode)
+
+  uint64_t samplesRead_;    ///< Number of samples output so far
+  uint64_t anchorSamples_;  ///< Sample count when pacing (re)started
+  double anchorTime_;       ///< Monotonic clock time when pacing (re)started
+  bool anchored_;           ///< Has pacing started?
+  double timeBase_;         ///< Timestamp of the first sample we replay
+
+  bool quantised_;          ///< Reading a quantised IQ file?
+  IqFormat iqFormat_;       ///< Format of the quantised file
+  uint32_t iqBlockSize_;    ///< Samples per block in the quantised file
+  std::vector<char> raw_;   ///< The current quantised block
+  std::vector< std::complex<float> > decoded_;  ///< The current block, expanded
+  std::size_t decodedPos_;  ///< Next sample to output from decoded_
 };
 
 } // namespace phy
@@ -0,0 +1,107 @@
+/**
+ * \file components/gpp/phy/FileRawReader/FileRawReaderComponent_benchmark.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main benchmark file for FileRawReader component.
+ */
+
+#include "../FileRawReaderComponent.h"
+#include <cstdio>
+#include <fstream>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "utility/DataBufferTrivial.h"
+
+using namespace std;
+using namespace iris;
+using namespace iris::phy;
+namespace bp = boost::posix_time;
+
+static const char* FILENAME = "FileRawReader_benchmark.bin";
+
+/// Time reading totalBytes from the file and print the rate in GB/s
+void runBenchmark(string description, bool useMmap, string endian,
+                  size_t totalBytes)
+{
+  typedef complex<float> Cplx;
+  int blockSize = 65536;
+
+  FileRawReaderComponent comp("test");
+  comp.setValue("filename", FILENAME);
+  comp.setValue("blocksize", blockSize);
+  comp.setValue("datatype", "complex<float>");
+  comp.setValue("endian", endian);
+  comp.setValue("mmap", useMmap);
+  comp.registerPorts();
+
+  map<string, int> iTypes,oTypes;
+  comp.calculateOutputTypes(iTypes,oTypes);
+
+  DataBufferTrivial< Cplx > out(2, true);
+  comp.setBuffers(NULL, &out);
+  comp.initialize();
+
+  size_t numBlocks = totalBytes/(blockSize*sizeof(Cplx));
+  size_t numWarmup = 10;
+  bp::ptime t1;
+  for(size_t b=0;b<numWarmup+numBlocks;b++)
+  {
+    if(b == numWarmup)
+      t1 = bp::microsec_clock::local_time();
+    comp.process();
+    DataSet< Cplx >* oSet = NULL;
+    out.getReadData(oSet);
+    out.releaseReadData(oSet);
+  }
+  bp::ptime t2(bp::microsec_clock::local_time());
+
+  bp::time_duration time = t2-t1;
+  float gigBytesPerSec = (numBlocks*blockSize*sizeof(Cplx))*1.0/time.total_nanoseconds();
+  cout << description << ": Rate = " << gigBytesPerSec << " GB/sec" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+  // A 64MB file, read 16 times over (so it is in the page cache)
+  size_t fileBytes = 64*1024*1024;
+  {
+    vector<char> buf(1024*1024);
+    for(size_t i=0;i<buf.size();i++)
+      buf[i] = i*7;
+    ofstream f(FILENAME, ios::binary | ios::trunc);
+    for(size_t i=0;i<fileBytes/buf.size();i++)
+      f.write(&buf[0], buf.size());
+  }
+
+  runBenchmark("ifstream, native", false, "native", 16*fileBytes);
+  runBenchmark("mmap, native", true, "native", 16*fileBytes);
+  runBenchmark("ifstream, byteswap", false, "big", 16*fileBytes);
+  runBenchmark("mmap, byteswap", true, "big", 16*fileBytes);
+
+  remove(FILENAME);
+}
@@ -0,0 +1,266 @@
+/**
+ * \file components/gpp/phy/FileRawReader/FileRawReaderComponent_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for FileRawReader component.
+ */
+
+#define BOOST_TEST_MODULE FileRawReaderComponent_Test
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <boost/test/unit_test.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "../FileRawReaderComponent.h"
+#include "utility/DataBufferTrivial.h"
+#include "utility/EndianConversion.h"
+#include "utility/QuantisedIq.h"
+#include "utility/CaptureIndex.h"
+
+using namespace std;
+using namespace iris;
+using namespace iris::phy;
+
+typedef complex<float> Cplx;
+
+static const char* FILENAME = "FileRawReaderComponent_test.bin";
+
+/// Writes a ramp of 20 samples to FILENAME and removes the file again
+struct TestFile
+{
+  TestFile()
+    :samples(20)
+  {
+    for(size_t i=0;i<samples.size();i++)
+      samples[i] = Cplx(i, -(float)i);
+    ofstream f(FILENAME, ios::binary);
+    f.write(reinterpret_cast<char*>(&samples[0]), samples.size()*sizeof(Cplx));
+  }
+
+  ~TestFile()
+  {
+    remove(FILENAME);
+  }
+
+  vector<Cplx> samples;
+};
+
+/// Set up comp to read blocks of complex<float> from fileName into out
+void startReader(FileRawReaderComponent& comp, DataBufferTrivial<Cplx>& out,
+                 string fileName, int blockSize)
+{
+  comp.setValue("filename", fileName);
+  comp.setValue("blocksize", blockSize);
+  comp.setValue("datatype", "complex<float>");
+  comp.registerPorts();
+  map<string, int> iTypes,oTypes;
+  comp.calculateOutputTypes(iTypes,oTypes);
+  comp.setBuffers(NULL, &out);
+  comp.initialize();
+}
+
+/// Run comp once and return the DataSet it wrote
+DataSet<Cplx> readBlock(FileRawReaderComponent& comp, DataBufferTrivial<Cplx>& out)
+{
+  comp.process();
+  DataSet<Cplx>* set = NULL;
+  out.getReadData(set);
+  DataSet<Cplx> copy = *set;
+  out.releaseReadData(set);
+  return copy;
+}
+
+BOOST_AUTO_TEST_SUITE (FileRawReaderComponent_Test)
+
+BOOST_AUTO_TEST_CASE(FileRawReaderComponent_Basic_Test)
+{
+  BOOST_REQUIRE_NO_THROW(FileRawReaderComponent comp("test"));
+}
+
+BOOST_AUTO_TEST_CASE(FileRawReaderComponent_Mmap_Test)
+{
+  // Blocks of 7 samples from a 20 sample file wrap in the middle of a
+  // block. The stream mode must give the same output.
+  TestFile file;
+  for(int m=0;m<2;m++)
+  {
+    for(int big=0;big<2;big++)
+    {
+      FileRawReaderComponent comp("test");
+      comp.setValue("mmap", m == 1);
+      comp.setValue("endian", big ? "big" : "native");
+      DataBufferTrivial<Cplx> out;
+      startReader(comp, out, FILENAME, 7);
+
+      size_t n = 0;
+      for(int b=0;b<10;b++)
+      {
+        DataSet<Cplx> set = readBlock(comp, out);
+        BOOST_REQUIRE_EQUAL(set.data.size(), 7u);
+        for(size_t i=0;i<set.data.size();i++,n++)
+        {
+          Cplx expected = file.samples[n % file.samples.size()];
+          BOOST_CHECK_EQUAL(set.data[i], big ? sys2big(expected) : expected);
+        }
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FileRawReaderComponent_Paced_Test)
+{
+  // 10 samples per block at 10kHz - in real time each block is due 1ms
+  // after the last, at speed 4 every 0.25ms
+  using namespace boost::posix_time;
+  TestFile file;
+  double speeds[] = {1, 4};
+  for(int s=0;s<2;s++)
+  {
+    FileRawReaderComponent comp("test");
+    comp.setValue("samplerate", 10000);
+    comp.setValue("speed", speeds[s]);
+    DataBufferTrivial<Cplx> out;
+    startReader(comp, out, FILENAME, 10);
+
+    ptime t1(microsec_clock::local_time());
+    for(int b=0;b<100;b++)
+    {
+      DataSet<Cplx> set = readBlock(comp, out);
+      BOOST_CHECK_EQUAL(set.sampleRate, 10000);
+      BOOST_CHECK_CLOSE(set.timeStamp + 1, 1 + b*1e-3, 1e-9);
+    }
+    // Never early - how late depends on the load of the machine
+    time_duration elapsed = microsec_clock::local_time() - t1;
+    BOOST_CHECK_GE(elapsed.total_microseconds(), 99000/speeds[s]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FileRawReaderComponent_Quantised_Test)
+{
+  // sc16 and sc8 files with blocks of 5 samples, read in blocks of 7
+  TestFile file;
+  const char* iqName = "FileRawReaderComponent_test.iq";
+  IqFormat formats[] = {IQ_SC16, IQ_SC8};
+  for(int f=0;f<2;f++)
+  {
+    {
+      ofstream iq(iqName, ios::binary);
+      vector<char> buf(quantisediq::blockBytes(formats[f], 5));
+      quantisediq::writeHeader(&buf[0], formats[f], 5);
+      iq.write(&buf[0], quantisediq::HEADER_SIZE);
+      for(size_t i=0;i<file.samples.size();i+=5)
+      {
+        quantisediq::encodeBlock(&file.samples[i], 5, formats[f], &buf[0]);
+        iq.write(&buf[0], buf.size());
+      }
+    }
+
+    for(int m=0;m<2;m++)
+    {
+      FileRawReaderComponent comp("test");
+      comp.setValue("format", "quantised");
+      comp.setValue("mmap", m == 1);
+      DataBufferTrivial<Cplx> out;
+      startReader(comp, out, iqName, 7);
+
+      // Each block is scaled to its own peak of up to 19*sqrt(2)
+      float tolerance = formats[f] == IQ_SC16 ? 1e-3 : 0.2;
+      size_t n = 0;
+      for(int b=0;b<10;b++)
+      {
+        DataSet<Cplx> set = readBlock(comp, out);
+        BOOST_REQUIRE_EQUAL(set.data.size(), 7u);
+        for(size_t i=0;i<set.data.size();i++,n++)
+          BOOST_CHECK_SMALL(abs(set.data[i] - file.samples[n % file.samples.size()]), tolerance);
+      }
+    }
+  }
+  remove(iqName);
+
+  // A raw file has no quantised IQ header
+  FileRawReaderComponent comp("test");
+  comp.setValue("format", "quantised");
+  DataBufferTrivial<Cplx> out;
+  BOOST_CHECK_THROW(startReader(comp, out, FILENAME, 7), IrisException);
+}
+
+BOOST_AUTO_TEST_CASE(FileRawReaderComponent_Range_Test)
+{
+  // Index every 5 samples of the 20 sample file, 1ms apart
+  TestFile file;
+  string indexName = string(FILENAME) + ".idx";
+  {
+    CaptureIndexWriter index;
+    BOOST_REQUIRE(index.open(indexName, 1000, 5));
+    for(size_t i=0;i<file.samples.size();i+=5)
+    {
+      CaptureIndexEntry e = {i, i*sizeof(Cplx), 1 + i*1e-3, 0, 0};
+      index.add(e);
+    }
+  }
+
+  // Both ranges start at the entry at or before 1.006 (sample 5). The first
+  // stops at the entry at or after 1.014 (sample 15), the second runs to the
+  // end of the file.
+  const char* stops[] = {"1.014", "-1"};
+  size_t counts[] = {10, 15};
+  for(int r=0;r<2;r++)
+  {
+    for(int m=0;m<2;m++)
+    {
+      FileRawReaderComponent comp("test");
+      comp.setValue("mmap", m == 1);
+      comp.setValue("starttime", "1.006");
+      comp.setValue("stoptime", stops[r]);
+      DataBufferTrivial<Cplx> out;
+      startReader(comp, out, FILENAME, 7);
+
+      vector<Cplx> samples;
+      for(int b=0;b<10;b++)
+      {
+        DataSet<Cplx> set = readBlock(comp, out);
+        BOOST_CHECK_EQUAL(set.sampleRate, 1000);
+        BOOST_CHECK_CLOSE(set.timeStamp, 1.005 + b*7e-3, 1e-9);
+        samples.insert(samples.end(), set.data.begin(), set.data.end());
+      }
+
+      // The range is replayed over and over
+      BOOST_CHECK_EQUAL(samples.front(), file.samples[5]);
+      size_t count = find(samples.begin() + 1, samples.end(), file.samples[5]) - samples.begin();
+      BOOST_CHECK_EQUAL(count, counts[r]);
+      for(size_t i=0;i<samples.size();i++)
+        BOOST_REQUIRE_EQUAL(samples[i], file.samples[5 + i % counts[r]]);
+    }
+  }
+  remove(indexName.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
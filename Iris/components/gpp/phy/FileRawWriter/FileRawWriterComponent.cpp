@@ -33,10 +33,18 @@
 
 #include "FileRawWriterComponent.h"
 
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
 #include "irisapi/LibraryDefs.h"
 #include "irisapi/Version.h"
 #include "irisapi/TypeVectors.h"
 #include "utility/RawFileUtility.h"
+#include "utility/QuantisedIq.h"
+#include "utility/CaptureIndex.h"
 
 using namespace std;
 
@@ -48,13 +56,70 @@ namespace phy
 // export library symbols
 IRIS_COMPONENT_EXPORTS(PhyComponent, FileRawWriterComponent);
 
+/// Alignment of buffers, file offsets and write sizes (needed for O_DIRECT)
+static const size_t ALIGN = 4096;
+
+/// Allocate an aligned buffer of the given size
+static char* allocAligned(size_t bytes)
+{
+  void* p = NULL;
+  if(posix_memalign(&p, ALIGN, bytes) != 0)
+    throw std::bad_alloc();
+  return static_cast<char*>(p);
+}
+
+/// Write all bytes to fd, return false on error
+static bool writeAll(int fd, const char* data, size_t bytes)
+{
+  while(bytes > 0)
+  {
+    ssize_t n = ::write(fd, data, bytes);
+    if(n < 0)
+    {
+      if(errno == EINTR)
+        continue;
+      return false;
+    }
+    data += n;
+    bytes -= n;
+  }
+  return true;
+}
+
+/// Time of the sample offset samples after the one at timeStamp
+static double sampleTime(double timeStamp, double sampleRate, double offset)
+{
+  return sampleRate > 0 ? timeStamp + offset/sampleRate : timeStamp;
+}
+
 FileRawWriterComponent::FileRawWriterComponent(string name)
   : PhyComponent(name,
                 "filerawwriter",
                 "A filewriter",
                 "Paul Sutton",
-                "0.1")
+                "0.2"),
+    fd_(-1),
+    swap_(false),
+    fill_(0),
+    fillSize_(0),
+    ioBusy_(false),
+    ioStop_(false),
+    ioIndex_(0),
+    ioSize_(0),
+    fileSize_(0),
+    ioError_(false),
+    writtenBlocks_(0),
+    droppedBlocks_(0),
+    quantise_(false),
+    iqFormat_(IQ_SC16),
+    bytesQueued_(0),
+    samplesQueued_(0),
+    nextIndexSample_(0),
+    indexing_(false)
 {
+  buffers_[0] = buffers_[1] = NULL;
+  capacity_[0] = capacity_[1] = 0;
+
   /*
    * format:
    * registerParameter(name,
@@ -74,6 +139,53 @@ FileRawWriterComponent::FileRawWriterComponent(string name)
                     "native",
                     false,
                     endian_x);
+  registerParameter("buffersize",
+                    "Size in bytes of each of the two write buffers",
+                    "4194304",
+                    false,
+                    bufferSize_x,
+                    Interval<uint32_t>(ALIGN, 1<<30));
+  registerParameter("direct",
+                    "Bypass the page cache (O_DIRECT) where supported",
+                    "false",
+                    false,
+                    direct_x);
+  registerParameter("preallocate",
+                    "Preallocate this many MB in the file (0 = off)",
+                    "0",
+                    false,
+                    preallocate_x);
+  list<string> formats;
+  formats.push_back("raw");
+  formats.push_back("sc16");
+  formats.push_back("sc8");
+  registerParameter("format",
+                    "File format (raw|sc16|sc8) - sc16/sc8 quantise complex<float> input",
+                    "raw",
+                    false,
+                    format_x,
+                    formats);
+  registerParameter("iqblocksize",
+                    "Samples per scale factor in the sc16/sc8 formats",
+                    "4096",
+                    false,
+                    iqBlockSize_x,
+                    Interval<uint32_t>(1, 1<<24));
+  registerParameter("index",
+                    "Write an index entry every this many samples (0 = no index)",
+                    "0",
+                    false,
+                    index_x);
+  registerParameter("frequency",
+                    "Centre frequency recorded in the index",
+                    "0",
+                    true,
+                    frequency_x);
+  registerParameter("gain",
+                    "Gain recorded in the index",
+                    "0",
+                    true,
+                    gain_x);
 }
 
 void FileRawWriterComponent::registerPorts()
@@ -97,12 +209,79 @@ void FileRawWriterComponent::calculateOutputTypes(
 
 void FileRawWriterComponent::initialize()
 {
-  hOutFile_.open(fileName_x.c_str(), ios::out|ios::binary);
-  if (hOutFile_.fail() || hOutFile_.bad() || !hOutFile_.is_open())
+  closeFile();
+
+  int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+  if(direct_x)
+    flags |= O_DIRECT;
+#else
+  if(direct_x)
+    LOG(LWARNING) << "O_DIRECT is not supported here, using buffered writes.";
+#endif
+  fd_ = open(fileName_x.c_str(), flags, 0644);
+#ifdef O_DIRECT
+  if(fd_ < 0 && direct_x)
+  {
+    //Some filesystems (e.g. tmpfs) refuse O_DIRECT
+    LOG(LWARNING) << "Could not open " << fileName_x
+                  << " with O_DIRECT, using buffered writes.";
+    fd_ = open(fileName_x.c_str(), flags & ~O_DIRECT, 0644);
+  }
+#endif
+  if(fd_ < 0)
   {
-    cout << "Could not open file " << fileName_x << " for writing." << endl;
-    //TODO: Throw an exception
+    LOG(LFATAL) << "Could not open file " << fileName_x << " for writing.";
+    throw ResourceNotFoundException(
+        "Could not open file " + fileName_x + " for writing.");
   }
+
+  if(preallocate_x > 0)
+  {
+    int ret = posix_fallocate(fd_, 0, off_t(preallocate_x) << 20);
+    if(ret != 0)
+      LOG(LWARNING) << "Could not preallocate " << preallocate_x << "MB in "
+                    << fileName_x << ": " << strerror(ret);
+  }
+
+  swap_ = RawFileUtility::needsSwap(endian_x);
+  quantise_ = quantisediq::parseFormat(format_x, iqFormat_);
+  if(quantise_ && inputBuffers[0]->getTypeIdentifier() != TypeInfo< complex<float> >::identifier)
+    throw InvalidDataTypeException("The " + format_x + " format needs complex<float> input");
+  pending_.clear();
+  pending_.reserve(iqBlockSize_x);
+  for(int i=0; i<2; i++)
+  {
+    capacity_[i] = (bufferSize_x + ALIGN - 1) / ALIGN * ALIGN;
+    buffers_[i] = allocAligned(capacity_[i]);
+  }
+  fill_ = 0;
+  fillSize_ = 0;
+  ioBusy_ = false;
+  ioStop_ = false;
+  ioError_ = false;
+  fileSize_ = 0;
+  writtenBlocks_ = 0;
+  droppedBlocks_ = 0;
+  bytesQueued_ = 0;
+  samplesQueued_ = 0;
+  nextIndexSample_ = 0;
+  indexing_ = index_x > 0;
+  ioThread_ = boost::thread(&FileRawWriterComponent::ioLoop, this);
+
+  if(quantise_)
+  {
+    quantisediq::writeHeader(reserve(quantisediq::HEADER_SIZE), iqFormat_, iqBlockSize_x);
+    fillSize_ += quantisediq::HEADER_SIZE;
+    bytesQueued_ += quantisediq::HEADER_SIZE;
+  }
+}
+
+void FileRawWriterComponent::parameterHasChanged(std::string name)
+{
+  //Mark the retune in the index straight away
+  if(name == "frequency" || name == "gain")
+    nextIndexSample_ = 0;
 }
 
 void FileRawWriterComponent::process()
@@ -148,7 +327,10 @@ void FileRawWriterComponent::process()
       writeBlock<long double>();
       break;
     case 11:
-      writeBlock< complex<float> >();
+      if(quantise_)
+        writeQuantisedBlock();
+      else
+        writeBlock< complex<float> >();
       break;
     case 12:
       writeBlock< complex<double> >();
@@ -169,17 +351,250 @@ void FileRawWriterComponent::writeBlock()
   DataSet<T>* readDataSet = NULL;
   inBuf->getReadData(readDataSet);
 
-  //Write to file
-  RawFileUtility::write(readDataSet->data.begin(), readDataSet->data.end(),
-                        hOutFile_, endian_x);
+  //Convert into the fill buffer - the I/O thread does the writing
+  size_t num = readDataSet->data.size();
+  if(num > 0)
+  {
+    char* dest = reserve(num*sizeof(T));
+    if(dest != NULL)
+    {
+      RawFileUtility::convert(&readDataSet->data[0], num,
+                              reinterpret_cast<T*>(dest), swap_);
+      indexSamples(samplesQueued_, num, bytesQueued_, sizeof(T),
+                   readDataSet->timeStamp, readDataSet->sampleRate);
+      fillSize_ += num*sizeof(T);
+      bytesQueued_ += num*sizeof(T);
+      samplesQueued_ += num;
+      writtenBlocks_++;
+    }
+    else
+      dropBlock();
+  }
 
   //Release data set
   inBuf->releaseReadData(readDataSet);
 }
 
+void FileRawWriterComponent::writeQuantisedBlock()
+{
+  ReadBuffer< complex<float> >* inBuf = castToType< complex<float> >(inputBuffers[0]);
+  DataSet< complex<float> >* readDataSet = NULL;
+  inBuf->getReadData(readDataSet);
+
+  //Samples are quantised in blocks of iqBlockSize_x, so carry any
+  //remainder over to the next DataSet
+  const complex<float>* in = readDataSet->data.empty() ? NULL : &readDataSet->data[0];
+  size_t num = readDataSet->data.size();
+  size_t numBlocks = (pending_.size() + num) / iqBlockSize_x;
+  size_t bytes = quantisediq::blockBytes(iqFormat_, iqBlockSize_x);
+  char* dest = numBlocks > 0 ? reserve(numBlocks*bytes) : NULL;
+
+  if(numBlocks > 0 && dest == NULL)
+    dropBlock();
+  else if(num > 0)
+  {
+    //Index entries go at the start of a block, which may be in pending_
+    double t = readDataSet->timeStamp;
+    double rate = readDataSet->sampleRate;
+    uint64_t first = samplesQueued_ - pending_.size();
+    for(size_t b=0; b<numBlocks; b++)
+      indexSamples(first + b*iqBlockSize_x, 1, bytesQueued_ + b*bytes, 0,
+                   sampleTime(t, rate, double(b*iqBlockSize_x) - pending_.size()), rate);
+    samplesQueued_ += num;
+
+    if(numBlocks > 0 && !pending_.empty())
+    {
+      size_t n = iqBlockSize_x - pending_.size();
+      pending_.insert(pending_.end(), in, in + n);
+      quantisediq::encodeBlock(&pending_[0], iqBlockSize_x, iqFormat_, dest);
+      pending_.clear();
+      dest += bytes;
+      in += n;
+      num -= n;
+    }
+    for(; num >= iqBlockSize_x && numBlocks > 0; num -= iqBlockSize_x)
+    {
+      quantisediq::encodeBlock(in, iqBlockSize_x, iqFormat_, dest);
+      dest += bytes;
+      in += iqBlockSize_x;
+    }
+    pending_.insert(pending_.end(), in, in + num);
+    fillSize_ += numBlocks*bytes;
+    bytesQueued_ += numBlocks*bytes;
+    writtenBlocks_++;
+  }
+
+  inBuf->releaseReadData(readDataSet);
+}
+
+void FileRawWriterComponent::indexSamples(uint64_t first, uint64_t num,
+                                          uint64_t byteOffset, size_t sampleBytes,
+                                          double timeStamp, double sampleRate)
+{
+  while(indexing_)
+  {
+    uint64_t s = max(nextIndexSample_, first);
+    if(s >= first + num)
+      return;
+
+    //The sample rate in the header comes from the first DataSet
+    if(!index_.isOpen() && !index_.open(fileName_x + ".idx", sampleRate, index_x))
+    {
+      LOG(LERROR) << "Could not create index " << fileName_x << ".idx";
+      indexing_ = false;
+      return;
+    }
+    CaptureIndexEntry e = {s, byteOffset + (s - first)*sampleBytes,
+                           sampleTime(timeStamp, sampleRate, double(s - first)),
+                           frequency_x, gain_x};
+    index_.add(e);
+    nextIndexSample_ = (s / index_x + 1) * index_x;
+  }
+}
+
+void FileRawWriterComponent::dropBlock()
+{
+  //Report the first drop, then every time the count doubles
+  droppedBlocks_++;
+  if((droppedBlocks_ & (droppedBlocks_ - 1)) == 0)
+    LOG(LWARNING) << "Disk is not keeping up, dropped " << droppedBlocks_
+                  << " blocks so far.";
+}
+
+char* FileRawWriterComponent::reserve(size_t bytes)
+{
+  if(fillSize_ + bytes <= capacity_[fill_])
+    return buffers_[fill_] + fillSize_;
+
+  if(!handOff())
+    return NULL;
+  if(fillSize_ + bytes > capacity_[fill_])
+  {
+    //Block is larger than a buffer - grow the (new) fill buffer
+    size_t size = (fillSize_ + bytes + ALIGN - 1) / ALIGN * ALIGN;
+    char* buf = allocAligned(size);
+    memcpy(buf, buffers_[fill_], fillSize_);
+    free(buffers_[fill_]);
+    buffers_[fill_] = buf;
+    capacity_[fill_] = size;
+  }
+  return buffers_[fill_] + fillSize_;
+}
+
+bool FileRawWriterComponent::handOff()
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  if(ioBusy_)
+    return false;
+
+  //With O_DIRECT only whole aligned blocks can be written, the
+  //remainder is carried over to the start of the next buffer
+  size_t size = direct_x ? fillSize_ / ALIGN * ALIGN : fillSize_;
+  int next = 1 - fill_;
+  memcpy(buffers_[next], buffers_[fill_] + size, fillSize_ - size);
+
+  ioIndex_ = fill_;
+  ioSize_ = size;
+  ioBusy_ = size > 0;
+  fillSize_ -= size;
+  fill_ = next;
+  cond_.notify_all();
+  return true;
+}
+
+void FileRawWriterComponent::ioLoop()
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  while(true)
+  {
+    while(!ioBusy_ && !ioStop_)
+      cond_.wait(lock);
+    if(!ioBusy_)
+      return;
+
+    const char* data = buffers_[ioIndex_];
+    size_t size = ioSize_;
+    lock.unlock();
+    bool ok = writeAll(fd_, data, size);
+    lock.lock();
+
+    if(ok)
+      fileSize_ += size;
+    else if(!ioError_)
+    {
+      ioError_ = true;
+      LOG(LERROR) << "Failed to write to " << fileName_x << ": " << strerror(errno);
+    }
+    ioBusy_ = false;
+    cond_.notify_all();
+  }
+}
+
+void FileRawWriterComponent::closeFile()
+{
+  if(fd_ < 0)
+    return;
+
+  //Quantise the last (partial) block
+  if(quantise_ && !pending_.empty())
+  {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      while(ioBusy_)
+        cond_.wait(lock);
+    }
+    char* dest = reserve(quantisediq::blockBytes(iqFormat_, pending_.size()));
+    quantisediq::encodeBlock(&pending_[0], pending_.size(), iqFormat_, dest);
+    fillSize_ += quantisediq::blockBytes(iqFormat_, pending_.size());
+    bytesQueued_ += quantisediq::blockBytes(iqFormat_, pending_.size());
+    pending_.clear();
+  }
+
+  //Wait for the I/O thread to finish and stop it
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    while(ioBusy_)
+      cond_.wait(lock);
+    ioStop_ = true;
+    cond_.notify_all();
+  }
+  ioThread_.join();
+
+  //Write whatever is left in the fill buffer
+#ifdef O_DIRECT
+  int flags = fcntl(fd_, F_GETFL);
+  if(flags & O_DIRECT)
+    fcntl(fd_, F_SETFL, flags & ~O_DIRECT);
+#endif
+  if(writeAll(fd_, buffers_[fill_], fillSize_))
+    fileSize_ += fillSize_;
+  else
+    LOG(LERROR) << "Failed to write to " << fileName_x << ": " << strerror(errno);
+
+  //Drop any preallocated space we did not use
+  if(preallocate_x > 0 && ftruncate(fd_, fileSize_) != 0)
+    LOG(LWARNING) << "Could not truncate " << fileName_x;
+  close(fd_);
+  fd_ = -1;
+  index_.close();
+
+  if(droppedBlocks_ > 0)
+    LOG(LWARNING) << "Dropped " << droppedBlocks_ << " of "
+                  << writtenBlocks_ + droppedBlocks_ << " blocks writing "
+                  << fileName_x;
+
+  for(int i=0; i<2; i++)
+  {
+    free(buffers_[i]);
+    buffers_[i] = NULL;
+    capacity_[i] = 0;
+  }
+  fillSize_ = 0;
+}
+
 FileRawWriterComponent::~FileRawWriterComponent()
 {
-  hOutFile_.close();
+  closeFile();
 }
 
 } // namespace phy
@@ -34,9 +34,14 @@
 #ifndef PHY_FILERAWWRITERCOMPONENT_H_
 #define PHY_FILERAWWRITERCOMPONENT_H_
 
-#include <fstream>
+#include <vector>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 
 #include "irisapi/PhyComponent.h"
+#include "utility/QuantisedIq.h"
+#include "utility/CaptureIndex.h"
 
 namespace iris
 {
@@ -47,6 +52,28 @@ namespace phy
  *
  * The name of the file to write and the endianness of the data can
  * be specified using parameters.
+ *
+ * Writing is double-buffered. process() converts each DataSet into the
+ * fill buffer. When the fill buffer is full it is handed to a background
+ * I/O thread and the other buffer becomes the fill buffer. process() never
+ * waits for the disk. If the I/O thread is still writing when the fill
+ * buffer is full, the incoming block is dropped and counted.
+ *
+ * The file can optionally be opened with O_DIRECT (bypassing the page
+ * cache) and preallocated to avoid fragmentation on long recordings.
+ *
+ * With format sc16 or sc8, complex<float> input is quantised to 16 or 8
+ * bit IQ with a scale factor per block of iqblocksize samples (see
+ * utility/QuantisedIq.h), cutting the file size by 2 or 4 times.
+ * FileRawReaderComponent expands these files back to complex<float>.
+ *
+ * If index is set, an index of the file is written to <filename>.idx
+ * (see utility/CaptureIndex.h). It holds an entry every index samples with
+ * the position of the sample in the file, its timestamp and the current
+ * frequency and gain parameters. A new entry is also added whenever the
+ * frequency or gain changes. In the sc16/sc8 formats entries are placed at
+ * the start of the following block. FileRawReaderComponent uses the index
+ * to replay a time range of the file.
  */
 class FileRawWriterComponent: public PhyComponent
 {
@@ -59,15 +86,79 @@ class FileRawWriterComponent: public PhyComponent
   virtual void registerPorts();
   virtual void initialize();
   virtual void process();
+  virtual void parameterHasChanged(std::string name);
+
+  /// Number of blocks written to the file so far
+  uint64_t getWrittenBlocks() const { return writtenBlocks_; }
+  /// Number of blocks dropped because the disk could not keep up
+  uint64_t getDroppedBlocks() const { return droppedBlocks_; }
 
  private:
   /// template function to write data
   template<typename T> void writeBlock();
 
+  /// Quantise and write complex<float> data (sc16/sc8 formats)
+  void writeQuantisedBlock();
+
+  /// Add index entries for samples [first, first+num) which are due one
+  void indexSamples(uint64_t first, uint64_t num, uint64_t byteOffset,
+                    std::size_t sampleBytes, double timeStamp, double sampleRate);
+
+  /// Count (and report) a block dropped because the buffers are busy
+  void dropBlock();
+
+  /// Get room for bytes in the fill buffer, return NULL if there is none
+  char* reserve(std::size_t bytes);
+
+  /// Hand the fill buffer to the I/O thread if it is free
+  bool handOff();
+
+  /// Main loop of the I/O thread
+  void ioLoop();
+
+  /// Write out everything, stop the I/O thread and close the file
+  void closeFile();
+
   std::string fileName_x;   ///< Name of file to write to
   std::string endian_x;     ///< Endianness of data
+  uint32_t bufferSize_x;    ///< Size of each of the two buffers in bytes
+  bool direct_x;            ///< Open the file with O_DIRECT
+  uint32_t preallocate_x;   ///< Preallocate this many MB in the file
+  std::string format_x;     ///< File format (raw|sc16|sc8)
+  uint32_t iqBlockSize_x;   ///< Samples per scale factor in sc16/sc8 formats
+  uint32_t index_x;         ///< Samples between index entries (0 = no index)
+  double frequency_x;       ///< Centre frequency recorded in the index
+  double gain_x;            ///< Gain recorded in the index
+
+  int fd_;                  ///< The output file descriptor
+  bool swap_;               ///< Do we need to swap byte order?
+  char* buffers_[2];        ///< The two (aligned) buffers
+  std::size_t capacity_[2]; ///< Size of each buffer in bytes
+  int fill_;                ///< Index of the buffer process() fills
+  std::size_t fillSize_;    ///< Bytes in the fill buffer
+
+  boost::thread ioThread_;
+  boost::mutex mutex_;
+  boost::condition_variable cond_;
+  bool ioBusy_;             ///< The I/O thread owns the other buffer
+  bool ioStop_;             ///< The I/O thread should exit
+  int ioIndex_;             ///< Index of the buffer the I/O thread writes
+  std::size_t ioSize_;      ///< Bytes to write from that buffer
+  uint64_t fileSize_;       ///< Bytes written to the file (I/O thread)
+  bool ioError_;            ///< A write failed (I/O thread)
+
+  uint64_t writtenBlocks_;  ///< Blocks accepted for writing
+  uint64_t droppedBlocks_;  ///< Blocks dropped because both buffers were busy
+
+  bool quantise_;           ///< Writing sc16/sc8?
+  IqFormat iqFormat_;       ///< The quantised format
+  std::vector< std::complex<float> > pending_;  ///< Samples not yet in a full block
 
-  std::ofstream hOutFile_;  ///< The output file stream
+  uint64_t bytesQueued_;    ///< Bytes accepted for the file so far
+  uint64_t samplesQueued_;  ///< Samples accepted for the file so far
+  uint64_t nextIndexSample_;  ///< Sample which is due the next index entry
+  bool indexing_;           ///< Writing an index?
+  CaptureIndexWriter index_;
 };
 
 } // namespace phy
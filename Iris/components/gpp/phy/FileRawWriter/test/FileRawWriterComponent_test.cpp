@@ -0,0 +1,186 @@
+/**
+ * \file components/gpp/phy/FileRawWriter/FileRawWriterComponent_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * Main test file for FileRawWriter component.
+ */
+
+#define BOOST_TEST_MODULE FileRawWriterComponent_Test
+
+#include <cstdio>
+#include <fstream>
+#include <boost/test/unit_test.hpp>
+
+#include "../FileRawWriterComponent.h"
+#include "utility/DataBufferTrivial.h"
+#include "utility/EndianConversion.h"
+
+using namespace std;
+using namespace iris;
+using namespace iris::phy;
+
+static const char* FILENAME = "FileRawWriterComponent_test.bin";
+
+/** Write numBlocks blocks of a ramp through the component, read back the
+ * file and check it. The disk may not keep up, so blocks can be dropped,
+ * but every block in the file must be complete and in order.
+ */
+void checkWrite(FileRawWriterComponent* comp, size_t numBlocks,
+                size_t blockSize, bool big)
+{
+  comp->setValue("filename", FILENAME);
+  comp->registerPorts();
+
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo< complex<float> >::identifier;
+  comp->calculateOutputTypes(iTypes,oTypes);
+
+  DataBufferTrivial< complex<float> > in(2, true);
+  comp->setBuffers(&in, NULL);
+  comp->initialize();
+
+  size_t n = 0;
+  for(size_t b=0;b<numBlocks;b++)
+  {
+    DataSet< complex<float> >* iSet = NULL;
+    in.getWriteData(iSet, blockSize);
+    for(size_t i=0;i<blockSize;i++,n++)
+      iSet->data[i] = complex<float>(n, -(float)n);
+    in.releaseWriteData(iSet);
+    comp->process();
+  }
+  uint64_t written = comp->getWrittenBlocks();
+  BOOST_CHECK_EQUAL(written + comp->getDroppedBlocks(), numBlocks);
+
+  // Destroying the component flushes and closes the file
+  delete comp;
+
+  ifstream f(FILENAME, ios::binary | ios::ate);
+  vector< complex<float> > out(f.tellg()/sizeof(complex<float>));
+  f.seekg(0);
+  f.read(reinterpret_cast<char*>(&out[0]), out.size()*sizeof(complex<float>));
+  f.close();
+  remove(FILENAME);
+
+  BOOST_REQUIRE_EQUAL(out.size(), written*blockSize);
+  for(size_t i=0;i<out.size();i++)
+  {
+    complex<float> x = big ? big2sys(out[i]) : out[i];
+    BOOST_REQUIRE_EQUAL(x.imag(), -x.real());
+    if(i % blockSize == 0)
+      BOOST_REQUIRE_EQUAL(size_t(x.real()) % blockSize, 0u);
+    else
+      BOOST_REQUIRE_EQUAL(x.real(), (big ? big2sys(out[i-1]) : out[i-1]).real() + 1);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE (FileRawWriterComponent_Test)
+
+BOOST_AUTO_TEST_CASE(FileRawWriterComponent_Basic_Test)
+{
+  BOOST_REQUIRE_NO_THROW(FileRawWriterComponent comp("test"));
+}
+
+BOOST_AUTO_TEST_CASE(FileRawWriterComponent_Native_Test)
+{
+  // Small buffers, so there are plenty of hand-offs to the I/O thread
+  FileRawWriterComponent* comp = new FileRawWriterComponent("test");
+  comp->setValue("buffersize", 4096);
+  checkWrite(comp, 1000, 100, false);
+}
+
+BOOST_AUTO_TEST_CASE(FileRawWriterComponent_Big_Test)
+{
+  FileRawWriterComponent* comp = new FileRawWriterComponent("test");
+  comp->setValue("endian", "big");
+  comp->setValue("preallocate", 16);
+  checkWrite(comp, 100, 1000, true);
+}
+
+BOOST_AUTO_TEST_CASE(FileRawWriterComponent_Direct_Test)
+{
+  // Odd block and buffer sizes, so O_DIRECT has a remainder to carry over
+  // and blocks larger than a buffer have to be handled
+  FileRawWriterComponent* comp = new FileRawWriterComponent("test");
+  comp->setValue("direct", true);
+  comp->setValue("buffersize", 10000);
+  checkWrite(comp, 100, 3001, false);
+}
+
+BOOST_AUTO_TEST_CASE(FileRawWriterComponent_Index_Test)
+{
+  // Buffers are big enough to hold everything, so nothing is dropped
+  FileRawWriterComponent comp("test");
+  comp.setValue("filename", FILENAME);
+  comp.setValue("index", 250);
+  comp.setValue("frequency", 2.4e9);
+  comp.registerPorts();
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo< complex<float> >::identifier;
+  comp.calculateOutputTypes(iTypes,oTypes);
+  DataBufferTrivial< complex<float> > in(2, true);
+  comp.setBuffers(&in, NULL);
+  comp.initialize();
+
+  for(size_t b=0;b<100;b++)
+  {
+    // Retune between two entries
+    if(b == 51)
+    {
+      comp.setValue("frequency", 5.8e9);
+      comp.parameterHasChanged("frequency");
+    }
+    DataSet< complex<float> >* iSet = NULL;
+    in.getWriteData(iSet, 100);
+    iSet->timeStamp = 10 + b*0.1;
+    iSet->sampleRate = 1000;
+    in.releaseWriteData(iSet);
+    comp.process();
+  }
+  comp.initialize();  // closes the file and index
+  remove(FILENAME);
+
+  CaptureIndex index;
+  BOOST_REQUIRE(index.load(string(FILENAME) + ".idx"));
+  remove((string(FILENAME) + ".idx").c_str());
+  BOOST_CHECK_EQUAL(index.sampleRate(), 1000);
+
+  // Every 250 samples, plus one at the retune
+  BOOST_REQUIRE_EQUAL(index.size(), 41u);
+  for(size_t i=0;i<index.size();i++)
+  {
+    const CaptureIndexEntry& e = index[i];
+    BOOST_CHECK_EQUAL(e.byteOffset, e.sampleOffset*sizeof(complex<float>));
+    BOOST_CHECK_CLOSE(e.timeStamp, 10 + e.sampleOffset/1000.0, 1e-9);
+    BOOST_CHECK_EQUAL(e.frequency, e.sampleOffset < 5100 ? 2.4e9 : 5.8e9);
+  }
+  BOOST_CHECK_EQUAL(index[21].sampleOffset, 5100u);
+  BOOST_CHECK_EQUAL(index[22].sampleOffset, 5250u);
+  BOOST_CHECK_EQUAL(index.find(12.3), 9u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
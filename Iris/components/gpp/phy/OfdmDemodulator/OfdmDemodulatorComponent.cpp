@@ -53,8 +53,11 @@ namespace iris
 namespace phy
 {
 
-// export library symbols
+// export library symbols - not from the static library, so that several
+// components can be linked into one test or benchmark
+#ifndef IRIS_STATIC_COMPONENT
 IRIS_COMPONENT_EXPORTS(PhyComponent, OfdmDemodulatorComponent);
+#endif
 
 OfdmDemodulatorComponent::OfdmDemodulatorComponent(std::string name)
   : PhyComponent(name,                            // component name
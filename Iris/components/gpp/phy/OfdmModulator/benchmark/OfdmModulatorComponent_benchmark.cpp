@@ -32,17 +32,48 @@
  */
 
 #include "../OfdmModulatorComponent.h"
-#include <boost/date_time/posix_time/posix_time.hpp>
+#include "utility/Benchmark.h"
 #include "utility/DataBufferTrivial.h"
-#include "utility/RawFileUtility.h"
 
 using namespace std;
 using namespace iris;
 using namespace iris::phy;
-namespace bp = boost::posix_time;
+
+/// One process() call on a block which is already in the input buffer
+struct ModulatorCall
+{
+  ModulatorCall(OfdmModulatorComponent& m, DataBufferTrivial<uint8_t>& i,
+                DataBufferTrivial< complex<float> >& o, int n)
+    :mod(m), in(i), out(o), numBytes(n)
+  {}
+
+  void operator()()
+  {
+    // The DataSets already hold data from the first pass
+    DataSet<uint8_t>* iSet = NULL;
+    in.getWriteData(iSet, numBytes);
+    in.releaseWriteData(iSet);
+
+    mod.process();
+
+    DataSet< complex<float> >* oSet = NULL;
+    while(out.hasData())
+    {
+      out.getReadData(oSet);
+      out.releaseReadData(oSet);
+    }
+  }
+
+  OfdmModulatorComponent& mod;
+  DataBufferTrivial<uint8_t>& in;
+  DataBufferTrivial< complex<float> >& out;
+  int numBytes;
+};
 
 int main(int argc, char* argv[])
 {
+  Benchmark bench("OfdmModulatorComponent", argc, argv);
+
   OfdmModulatorComponent mod("test");
   mod.registerPorts();
 
@@ -50,26 +81,27 @@ int main(int argc, char* argv[])
   iTypes["input1"] = TypeInfo< uint8_t >::identifier;
   mod.calculateOutputTypes(iTypes,oTypes);
 
-  DataBufferTrivial<uint8_t> in;
-  DataBufferTrivial< complex<float> > out;
+  // Ring buffers reuse their DataSets, so we measure the steady state
+  DataBufferTrivial<uint8_t> in(2, true);
+  DataBufferTrivial< complex<float> > out(2, true);
 
-  // Create enough data for "numFrames" full frames
-  int numFrames = 100;
-  int numBytes = numFrames*32*24; // #dataSymbols * #bytesPerSymbol
-  DataSet<uint8_t>* iSet = NULL;
-  in.getWriteData(iSet, numBytes);
-  for(int i=0;i<numBytes;i++)
-    iSet->data[i] = i%255;
-  in.releaseWriteData(iSet);
+  // Each process() call gets enough data for one full frame
+  int numBytes = 32*24; // #dataSymbols * #bytesPerSymbol
+  for(int b=0;b<2;b++)
+  {
+    DataSet<uint8_t>* iSet = NULL;
+    in.getWriteData(iSet, numBytes);
+    for(int i=0;i<numBytes;i++)
+      iSet->data[i] = i%255;
+    in.releaseWriteData(iSet);
+    in.getReadData(iSet);
+    in.releaseReadData(iSet);
+  }
 
   mod.setBuffers(&in,&out);
   mod.initialize();
 
-  bp::ptime t1(bp::microsec_clock::local_time());
-  mod.process();
-  bp::ptime t2(bp::microsec_clock::local_time());
-
-  bp::time_duration time = t2-t1;
-  float megBytesPerSec = (numBytes/1.0e6)*(1.0e9/time.total_nanoseconds());
-  cout << "Rate = " << megBytesPerSec << " MB/sec" << endl;
+  ModulatorCall call(mod, in, out, numBytes);
+  bench.run("Frame", numBytes, call, "byte");
+  return bench.finish();
 }
@@ -0,0 +1,156 @@
+/**
+ * \file components/gpp/phy/Resampler/ResamplerComponent.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ * 
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Implementation of the Resampler component.
+ */
+
+#include "ResamplerComponent.h"
+
+#include <vector>
+
+#include "irisapi/LibraryDefs.h"
+#include "irisapi/Version.h"
+
+using namespace std;
+
+namespace iris
+{
+namespace phy
+{
+
+// export library symbols
+IRIS_COMPONENT_EXPORTS(PhyComponent, ResamplerComponent);
+
+ResamplerComponent::ResamplerComponent(string name)
+  : PhyComponent(name,
+                 "resampler",
+                 "A polyphase rational resampler",
+                 "The Iris Project Developers",
+                 "0.1"),
+    groupDelay_(0)
+{
+  registerParameter(
+    "interpolation", "Interpolation factor L (output rate = input rate * L/M)",
+    "1", true, interpolation_x, Interval<uint32_t>(1, 1024));
+
+  registerParameter(
+    "decimation", "Decimation factor M (output rate = input rate * L/M)",
+    "1", true, decimation_x, Interval<uint32_t>(1, 1024));
+
+  registerParameter(
+    "tapsperphase", "Number of filter taps in each of the L phase filters",
+    "16", true, tapsPerPhase_x, Interval<uint32_t>(1, 1024));
+}
+
+void ResamplerComponent::registerPorts()
+{
+  registerInputPort("input1", TypeInfo< Cplx >::identifier);
+  registerOutputPort("output1", TypeInfo< Cplx >::identifier);
+}
+
+void ResamplerComponent::calculateOutputTypes(
+  std::map<std::string,int>& inputTypes,
+  std::map<std::string,int>& outputTypes)
+{
+  outputTypes["output1"] = TypeInfo< Cplx >::identifier;
+}
+
+void ResamplerComponent::initialize()
+{
+  setup();
+}
+
+void ResamplerComponent::parameterHasChanged(std::string name)
+{
+  if(name == "interpolation" || name == "decimation" || name == "tapsperphase")
+    setup();
+}
+
+void ResamplerComponent::setup()
+{
+  // Reduce L/M so the phase filters are as short as possible
+  uint32_t a = interpolation_x, b = decimation_x;
+  while(b != 0)
+  {
+    uint32_t t = a % b;
+    a = b;
+    b = t;
+  }
+  uint32_t l = interpolation_x / a;
+  uint32_t m = decimation_x / a;
+
+  vector<float> coeffs = Resampler<Cplx, float, Cplx>::designFilter(l, m, tapsPerPhase_x);
+  resampler_.setCoeffs(l, m, coeffs.begin(), coeffs.end());
+  groupDelay_ = (coeffs.size() - 1) / 2.0;
+
+  LOG(LINFO) << "Resampling by " << l << "/" << m << " with "
+             << coeffs.size() << " taps";
+}
+
+void ResamplerComponent::process()
+{
+  DataSet<Cplx>* readDataSet = NULL;
+  getInputDataSet("input1", readDataSet);
+
+  double inRate = readDataSet->sampleRate;
+  double l = resampler_.getInterpolation();
+  double m = resampler_.getDecimation();
+
+  // The first output lies getPhase()/L input samples after the first
+  // input, and the linear-phase filter delays the signal by groupDelay_/L
+  double timeStamp = readDataSet->timeStamp;
+  if(inRate > 0)
+    timeStamp += (resampler_.getPhase() - groupDelay_) / (l * inRate);
+
+  size_t size = resampler_.getOutputSize(readDataSet->data.size());
+  if(size == 0)
+  {
+    // Not enough input for an output yet - just update the filter state
+    vector<Cplx> dummy;
+    resampler_.filter(readDataSet->data.begin(), readDataSet->data.end(),
+                      dummy.begin());
+    releaseInputDataSet("input1", readDataSet);
+    return;
+  }
+
+  DataSet<Cplx>* writeDataSet = NULL;
+  getOutputDataSet("output1", writeDataSet, size);
+  resampler_.filter(readDataSet->data.begin(), readDataSet->data.end(),
+                    writeDataSet->data.begin());
+
+  writeDataSet->sampleRate = inRate * l / m;
+  writeDataSet->timeStamp = timeStamp;
+
+  releaseInputDataSet("input1", readDataSet);
+  releaseOutputDataSet("output1", writeDataSet);
+}
+
+} // namespace phy
+} // namespace iris
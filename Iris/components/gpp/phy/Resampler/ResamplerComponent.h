@@ -0,0 +1,85 @@
+/**
+ * \file components/gpp/phy/Resampler/ResamplerComponent.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ * 
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * The ResamplerComponent changes the sample rate of a complex signal
+ * by a rational factor L/M.
+ */
+
+#ifndef PHY_RESAMPLERCOMPONENT_H_
+#define PHY_RESAMPLERCOMPONENT_H_
+
+#include <complex>
+
+#include <irisapi/PhyComponent.h>
+#include "utility/Resampler.h"
+
+namespace iris
+{
+namespace phy
+{
+
+/** The ResamplerComponent changes the sample rate of a complex
+ *  signal by a rational factor L/M using a polyphase filter.
+ *
+ *  The output sampleRate is the input sampleRate times L/M and the
+ *  timeStamp of each output DataSet is that of its first sample, less
+ *  the group delay of the filter.
+ */
+class ResamplerComponent
+  : public PhyComponent
+{
+ public:
+  typedef std::complex<float> Cplx;
+
+  ResamplerComponent(std::string name);
+  virtual void calculateOutputTypes(
+    std::map<std::string, int>& inputTypes,
+    std::map<std::string, int>& outputTypes);
+  virtual void registerPorts();
+  virtual void initialize();
+  virtual void process();
+  virtual void parameterHasChanged(std::string name);
+
+ private:
+  /// Design the filter for the current parameters
+  void setup();
+
+  uint32_t interpolation_x; ///< Interpolation factor L
+  uint32_t decimation_x;    ///< Decimation factor M
+  uint32_t tapsPerPhase_x;  ///< Number of taps in each phase filter
+
+  Resampler<Cplx, float, Cplx> resampler_;  ///< The polyphase resampler
+  double groupDelay_;   ///< Delay of the filter in samples at L times the input rate
+};
+
+} // namespace phy
+} // namespace iris
+
+#endif // PHY_RESAMPLERCOMPONENT_H_
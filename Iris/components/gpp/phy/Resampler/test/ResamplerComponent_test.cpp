@@ -0,0 +1,146 @@
+/**
+ * \file components/gpp/phy/Resampler/ResamplerComponent_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for Resampler component.
+ */
+
+#define BOOST_TEST_MODULE ResamplerComponent_Test
+
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+
+#include "../ResamplerComponent.h"
+#include "utility/DataBufferTrivial.h"
+
+using namespace std;
+using namespace iris;
+using namespace iris::phy;
+
+BOOST_AUTO_TEST_SUITE (ResamplerComponent_Test)
+
+BOOST_AUTO_TEST_CASE(ResamplerComponent_Basic_Test)
+{
+  BOOST_REQUIRE_NO_THROW(ResamplerComponent mod("test"));
+}
+
+BOOST_AUTO_TEST_CASE(ResamplerComponent_Parm_Test)
+{
+  ResamplerComponent mod("test");
+  BOOST_CHECK(mod.getParameterDefaultValue("interpolation") == "1");
+  BOOST_CHECK(mod.getParameterDefaultValue("decimation") == "1");
+  BOOST_CHECK(mod.getParameterDefaultValue("tapsperphase") == "16");
+}
+
+BOOST_AUTO_TEST_CASE(ResamplerComponent_Ports_Test)
+{
+  ResamplerComponent mod("test");
+  BOOST_REQUIRE_NO_THROW(mod.registerPorts());
+
+  vector<Port> iPorts = mod.getInputPorts();
+  BOOST_REQUIRE(iPorts.size() == 1);
+  BOOST_REQUIRE(iPorts.front().portName == "input1");
+  BOOST_REQUIRE(iPorts.front().supportedTypes.front() ==
+      TypeInfo< complex<float> >::identifier);
+
+  vector<Port> oPorts = mod.getOutputPorts();
+  BOOST_REQUIRE(oPorts.size() == 1);
+  BOOST_REQUIRE(oPorts.front().portName == "output1");
+  BOOST_REQUIRE(oPorts.front().supportedTypes.front() ==
+      TypeInfo< complex<float> >::identifier);
+}
+
+BOOST_AUTO_TEST_CASE(ResamplerComponent_Process_Test)
+{
+  ResamplerComponent mod("test");
+  mod.setValue("interpolation", 4);
+  mod.setValue("decimation", 6);
+  mod.registerPorts();
+
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo< complex<float> >::identifier;
+  mod.calculateOutputTypes(iTypes,oTypes);
+
+  DataBufferTrivial< complex<float> > in;
+  DataBufferTrivial< complex<float> > out;
+
+  // A slow complex tone in blocks of 1000 samples at 1MS/s
+  double rate = 1e6;
+  int blockSize = 1000;
+  int numBlocks = 4;
+  for(int b=0;b<numBlocks;b++)
+  {
+    DataSet< complex<float> >* iSet = NULL;
+    in.getWriteData(iSet, blockSize);
+    for(int i=0;i<blockSize;i++)
+    {
+      double t = (b*blockSize + i)/rate;
+      iSet->data[i] = polar(1.0f, float(2*M_PI*10e3*t));
+    }
+    iSet->sampleRate = rate;
+    iSet->timeStamp = b*blockSize/rate;
+    in.releaseWriteData(iSet);
+  }
+
+  mod.setBuffers(&in,&out);
+  mod.initialize();
+  for(int b=0;b<numBlocks;b++)
+    BOOST_REQUIRE_NO_THROW(mod.process());
+
+  // 2/3 resampling gives 2000/3 samples per block on average and
+  // each block starts where the last one left off. The first output is
+  // early by the group delay of the 32 tap filter at 2MS/s.
+  size_t total = 0;
+  double nextTime = -15.5/(2*rate);
+  for(int b=0;b<numBlocks;b++)
+  {
+    BOOST_REQUIRE(out.hasData());
+    DataSet< complex<float> >* oSet = NULL;
+    out.getReadData(oSet);
+    BOOST_CHECK_CLOSE(oSet->sampleRate, rate*2/3, 1e-6);
+    BOOST_CHECK_SMALL(oSet->timeStamp - nextTime, 1e-9);
+    BOOST_CHECK(oSet->data.size() >= 666 && oSet->data.size() <= 667);
+    nextTime = oSet->timeStamp + oSet->data.size()/oSet->sampleRate;
+    total += oSet->data.size();
+
+    // Check the tone and its timing after the filter has settled
+    if(b > 0)
+    {
+      for(size_t i=0;i<oSet->data.size();i++)
+      {
+        double t = oSet->timeStamp + i/oSet->sampleRate;
+        BOOST_CHECK_SMALL(abs(oSet->data[i] - polar(1.0f, float(2*M_PI*10e3*t))), 0.02f);
+      }
+    }
+    out.releaseReadData(oSet);
+  }
+  BOOST_CHECK(total == 2667);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
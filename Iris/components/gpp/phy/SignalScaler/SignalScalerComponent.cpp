@@ -34,29 +34,142 @@
 #include "SignalScalerComponent.h"
 
 #include <algorithm>
-#include <functional>
-#include <numeric>
+#include <cmath>
 #include <complex>
-#include <boost/lambda/lambda.hpp>
-#include <boost/lambda/bind.hpp>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 using namespace std;
-using namespace boost::lambda;
 
 namespace iris
 {
 namespace phy
 {
 
-// export library symbols
+// export library symbols - not from the static library, so that several
+// components can be linked into one test or benchmark
+#ifndef IRIS_STATIC_COMPONENT
 IRIS_COMPONENT_EXPORTS(PhyComponent, SignalScalerComponent);
+#endif
+
+/*
+ * The kernels below work on complex<float> data viewed as interleaved
+ * floats (re0,im0,re1,im1,...) - n is the number of floats. Where SSE2 is
+ * available, two complex samples are processed per iteration; the scalar
+ * loops handle the remainder and all other targets.
+ */
+
+/// Write scaled floats to a complex<float> block
+struct FloatStore
+{
+  float* out;
+  explicit FloatStore(float* o) : out(o) {}
+  void operator()(size_t i, float re, float im) { out[i] = re; out[i+1] = im; }
+#ifdef __SSE2__
+  void operator()(size_t i, __m128 v) { _mm_storeu_ps(out + i, v); }
+#endif
+};
+
+/// Round and saturate scaled floats into an interleaved int16 IQ block
+struct Int16Store
+{
+  int16_t* out;
+  explicit Int16Store(int16_t* o) : out(o) {}
+  static int16_t convert(float x)
+  {
+    // Round to nearest even like cvtps, so results don't depend on alignment
+    x = std::min(std::max(x, -32768.0f), 32767.0f);
+    return (int16_t)lrintf(x);
+  }
+  void operator()(size_t i, float re, float im)
+  {
+    out[i] = convert(re);
+    out[i+1] = convert(im);
+  }
+#ifdef __SSE2__
+  void operator()(size_t i, __m128 v)
+  {
+    // Clamp first - cvtps returns 0x80000000 for out-of-range values
+    v = _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(-32768.0f)), _mm_set1_ps(32767.0f));
+    __m128i w = _mm_cvtps_epi32(v);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(w, w));
+  }
+#endif
+};
+
+/// Find the largest squared magnitude in a block
+static float peakNorm(const float* in, size_t n)
+{
+  float peak = 0;
+  size_t i = 0;
+#ifdef __SSE2__
+  __m128 vpeak = _mm_setzero_ps();
+  for (; i + 4 <= n; i += 4)
+  {
+    __m128 x = _mm_loadu_ps(in + i);
+    __m128 sq = _mm_mul_ps(x, x);
+    // re^2 + im^2 in both lanes of each complex sample
+    sq = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2,3,0,1)));
+    vpeak = _mm_max_ps(vpeak, sq);
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, vpeak);
+  peak = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+  for (; i < n; i += 2)
+    peak = std::max(peak, in[i]*in[i] + in[i+1]*in[i+1]);
+  return peak;
+}
+
+/** Apply a linear gain ramp to a block and find its peak in the same pass.
+ *
+ * Sample k is multiplied by g0 + k*dg.
+ * \return The largest squared magnitude in the input block.
+ */
+template <class Store>
+static float scaleKernel(const float* in, size_t n, float g0, float dg, Store store)
+{
+  float peak = 0;
+  size_t i = 0;
+#ifdef __SSE2__
+  __m128 vpeak = _mm_setzero_ps();
+  __m128 vg0 = _mm_set1_ps(g0);
+  __m128 vdg = _mm_set1_ps(dg);
+  __m128 vk = _mm_set_ps(1, 1, 0, 0);
+  __m128 vstep = _mm_set1_ps(2);
+  for (; i + 4 <= n; i += 4)
+  {
+    __m128 x = _mm_loadu_ps(in + i);
+    __m128 sq = _mm_mul_ps(x, x);
+    sq = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2,3,0,1)));
+    vpeak = _mm_max_ps(vpeak, sq);
+    store(i, _mm_mul_ps(x, _mm_add_ps(vg0, _mm_mul_ps(vdg, vk))));
+    vk = _mm_add_ps(vk, vstep);
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, vpeak);
+  peak = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+  for (; i < n; i += 2)
+  {
+    float g = g0 + dg*(i/2);
+    peak = std::max(peak, in[i]*in[i] + in[i+1]*in[i+1]);
+    store(i, in[i]*g, in[i+1]*g);
+  }
+  return peak;
+}
 
 SignalScalerComponent::SignalScalerComponent(string name)
   : PhyComponent(name,
                  "signalscaler",
                  "A signal scaler",
                  "Paul Sutton",
-                 "0.1")
+                 "0.2")
+  ,agcLocked_(false)
+  ,envelope_(0)
+  ,gain_(0)
 {
   registerParameter(
     "maximum", "The maximum value to scale to.",
@@ -70,82 +183,133 @@ SignalScalerComponent::SignalScalerComponent(string name)
     "maxsamples", "How many samples to check for maxVal (0 means until end)",
     "0", true, maxSamples_x);
 
+  registerParameter(
+    "agc", "Smooth the gain across blocks instead of scaling each block to maximum",
+    "false", false, agc_x);
+
+  registerParameter(
+    "attack", "AGC smoothing factor used when the peak rises (1 means no smoothing)",
+    "0.5", true, attack_x, Interval<float>(0, 1));
+
+  registerParameter(
+    "decay", "AGC smoothing factor used when the peak falls (1 means no smoothing)",
+    "0.05", true, decay_x, Interval<float>(0, 1));
+
+  list<string> allowedTypes;
+  allowedTypes.push_back(TypeInfo< complex<float> >::name());
+  allowedTypes.push_back(TypeInfo< int16_t >::name());
+  registerParameter(
+    "outputtype", "Output type - int16_t gives interleaved IQ (complex<float>|int16_t)",
+    "complex<float>", false, outputType_x, allowedTypes);
 }
 
 void SignalScalerComponent::registerPorts()
 {
   registerInputPort("input1", TypeInfo< complex<float> >::identifier);
-  registerOutputPort("output1", TypeInfo< complex<float> >::identifier);
+
+  vector<int> validTypes;
+  validTypes.push_back(TypeInfo< complex<float> >::identifier);
+  validTypes.push_back(TypeInfo< int16_t >::identifier);
+  registerOutputPort("output1", validTypes);
 }
 
 void SignalScalerComponent::calculateOutputTypes(
   std::map<std::string,int>& inputTypes,
   std::map<std::string,int>& outputTypes)
 {
-  outputTypes["output1"] = TypeInfo< complex<float> >::identifier;
+  if (outputType_x == TypeInfo< int16_t >::name())
+    outputTypes["output1"] = TypeInfo< int16_t >::identifier;
+  else
+    outputTypes["output1"] = TypeInfo< complex<float> >::identifier;
 }
 
 void SignalScalerComponent::initialize()
 {
+  agcLocked_ = false;
+  envelope_ = 0;
+  gain_ = 0;
 }
 
 void SignalScalerComponent::process()
 {
   DataSet<complex<float> >* readDataSet = NULL;
-  DataSet<complex<float> >* writeDataSet = NULL;
-
   getInputDataSet("input1", readDataSet);
   size_t size = readDataSet->data.size();
-  getOutputDataSet("output1", writeDataSet, size);
-
-  writeDataSet->timeStamp = readDataSet->timeStamp;
+  const float* in = reinterpret_cast<const float*>(&readDataSet->data[0]);
 
-  if (factor_x == 0)
+  if (outputType_x == TypeInfo< int16_t >::name())
   {
-    // this is equalent to:
-    // complex<float>* it = readDataSet->data.begin();
-    // complex<float>* maxIt = it;
-    // while (it != readDataSet->data.end())
-    // {
-    //   if (!(norm(*it) < norm(*maxIt))) maxIt = it;
-    //   it++;
-    // }
-    // float maxVal = abs(*maxIt);
-    //
-    // * First, it finds the maximum element in the readDataSet using norm<float>(_1) < norm<float>(_2) as
-    //   comparison predicate, where _1 and _2 are placeholders for the two predicate arguments (i.e., it compares
-    //   the squared magnitudes of both complex numbers).
-    //   - 'norm' is an STL template for computing the squared magnitude of complex numbers, parameterised with the complex
-    //     element type (template <class T> norm(const complex<T>& x); )
-    //   - 'bind' creates a functor given a function and an argument, here a placeholder, i.e., it creates a
-    //     functor class with 'operator()(complex<float>)' which applies the norm<float> function to its argument.
-    //     (see http://www.boost.org/doc/libs/1_40_0/doc/html/lambda/using_library.html#lambda.introductory_examples)
-    // * Then, it computes the absolute value of that maximum (complex number)
-    std::vector<complex<float> >::iterator until = readDataSet->data.end();
-    if (maxSamples_x > 0) until = readDataSet->data.begin() + maxSamples_x;
-    float maxVal = abs(*max_element(readDataSet->data.begin(), until,
-            bind(norm<float>, _1) < bind(norm<float>, _2) ));
-
-    // this is equivalent to:
-    // complex<float>* outit = writeDataSet->data.begin();
-    // for (complex<float>* it = readDataSet->data.begin(); it != readDataSet->data.end(); ++it)
-    //     *outit++ = *it / maxVal * x_maximum;
-    // it applies x / maxVal * x_maximum for each element x
-    // in the readDataSet and writes the result into the writeDataSet (using boost::lambda)
-    // (see http://www.boost.org/doc/libs/1_40_0/doc/html/lambda/using_library.html#lambda.introductory_examples)
-    std::transform(readDataSet->data.begin(), readDataSet->data.end(),
-            writeDataSet->data.begin(), _1 / maxVal * maximum_x);
+    DataSet<int16_t>* writeDataSet = NULL;
+    getOutputDataSet("output1", writeDataSet, 2*size);
+    writeDataSet->timeStamp = readDataSet->timeStamp;
+    writeDataSet->sampleRate = readDataSet->sampleRate;
+    if (size > 0)
+      scale(in, size, Int16Store(&writeDataSet->data[0]));
+    releaseOutputDataSet("output1", writeDataSet);
   }
   else
   {
-    // this applies x * x_factor for each element x in the readDataSet and writes the result to the
-    // writeDataSet
-    std::transform(readDataSet->data.begin(), readDataSet->data.end(), writeDataSet->data.begin(),
-            _1 * factor_x);
+    DataSet<complex<float> >* writeDataSet = NULL;
+    getOutputDataSet("output1", writeDataSet, size);
+    writeDataSet->timeStamp = readDataSet->timeStamp;
+    writeDataSet->sampleRate = readDataSet->sampleRate;
+    if (size > 0)
+      scale(in, size,
+            FloatStore(reinterpret_cast<float*>(&writeDataSet->data[0])));
+    releaseOutputDataSet("output1", writeDataSet);
   }
 
   releaseInputDataSet("input1", readDataSet);
-  releaseOutputDataSet("output1", writeDataSet);
+}
+
+template <class Store>
+void SignalScalerComponent::scale(const float* in, size_t size, Store store)
+{
+  size_t n = 2*size;
+
+  if (factor_x != 0)
+  {
+    scaleKernel(in, n, factor_x, 0, store);
+    return;
+  }
+
+  if (!agc_x || !agcLocked_)
+  {
+    // Scale so the peak of the block (or its first maxsamples) hits maximum.
+    // We multiply by the reciprocal of the peak rather than dividing
+    // each sample by it.
+    size_t until = n;
+    if (maxSamples_x > 0 && 2*(size_t)maxSamples_x < n)
+      until = 2*maxSamples_x;
+    float peak = sqrt(peakNorm(in, until));
+    float gain = peak > 0 ? maximum_x / peak : 0;
+    scaleKernel(in, n, gain, 0, store);
+
+    if (agc_x)
+    {
+      // First block seeds the AGC
+      envelope_ = peak;
+      gain_ = gain;
+      agcLocked_ = peak > 0;
+    }
+    return;
+  }
+
+  // AGC: ramp from the last gain to the one given by the envelope so far,
+  // measuring this block's peak on the way through.
+  float target = maximum_x / envelope_;
+  float dg = (target - gain_) / size;
+  float peak = sqrt(scaleKernel(in, n, gain_ + dg, dg, store));
+  gain_ = target;
+
+  if (peak > envelope_)
+    envelope_ += attack_x * (peak - envelope_);
+  else
+    envelope_ += decay_x * (peak - envelope_);
+
+  // Hold the gain during silence
+  if (envelope_ <= 0)
+    envelope_ = maximum_x / gain_;
 }
 
 } // namespace phy
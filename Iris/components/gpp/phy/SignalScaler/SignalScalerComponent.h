@@ -29,7 +29,8 @@
  * \section DESCRIPTION
  *
  * The SignalScalerComponent scales a signal by a given factor or
- * to a given maximum value.
+ * to a given maximum value. An optional AGC mode smooths the gain
+ * across blocks and the output can be given as interleaved int16 IQ.
  */
 
 #ifndef PHY_SIGNALSCALERCOMPONENT_H_
@@ -44,6 +45,15 @@ namespace phy
 
 /** The SignalScalerComponent scales a signal by a
  *  given factor or to a given maximum value.
+ *
+ *  In AGC mode, the peak magnitude is tracked across blocks using
+ *  attack/decay smoothing and the gain is ramped linearly over each
+ *  block, so there are no gain steps at block boundaries. Scaling and
+ *  peak search are then done in a single pass over the data.
+ *
+ *  If outputtype is "int16_t", the output is written as interleaved,
+ *  saturated int16 IQ samples (I0,Q0,I1,Q1,...) ready for an sc16
+ *  transmit path.
  */
 class SignalScalerComponent
   : public PhyComponent
@@ -58,9 +68,21 @@ class SignalScalerComponent
   virtual void process();
 
  private:
-  float maximum_x;  ///< Maximum value to scale to (only used if x_factor = 0)
-  float factor_x;   ///< Scale input with this value (0 means max is applied)
-  int maxSamples_x; ///< How many samples to check for maxVal (0 means until end)
+  /// Work out the gain for a block of size samples and write the scaled output
+  template <class Store>
+  void scale(const float* in, std::size_t size, Store store);
+
+  float maximum_x;        ///< Maximum value to scale to (only used if x_factor = 0)
+  float factor_x;         ///< Scale input with this value (0 means max is applied)
+  int maxSamples_x;       ///< How many samples to check for maxVal (0 means until end)
+  bool agc_x;             ///< Smooth the gain across blocks (only used if x_factor = 0)
+  float attack_x;         ///< AGC smoothing factor for rising peaks
+  float decay_x;          ///< AGC smoothing factor for falling peaks
+  std::string outputType_x; ///< Output type (complex<float>|int16_t)
+
+  bool agcLocked_;        ///< Has the AGC seen its first block?
+  float envelope_;        ///< Smoothed peak magnitude of the input
+  float gain_;            ///< Gain applied at the end of the last block
 };
 
 } // namespace phy
@@ -32,42 +32,97 @@
  */
 
 #include "../SignalScalerComponent.h"
-#include <boost/date_time/posix_time/posix_time.hpp>
+#include "utility/Benchmark.h"
 #include "utility/DataBufferTrivial.h"
-#include "utility/RawFileUtility.h"
 
 using namespace std;
 using namespace iris;
 using namespace iris::phy;
-namespace bp = boost::posix_time;
 
-int main(int argc, char* argv[])
+/// One process() call on a block which is already in the input buffer
+template <class OutT>
+struct ScalerCall
+{
+  ScalerCall(SignalScalerComponent& m, DataBufferTrivial< complex<float> >& i,
+             DataBufferTrivial< OutT >& o, int n)
+    :mod(m), in(i), out(o), num(n)
+  {}
+
+  void operator()()
+  {
+    // The DataSets already hold data from the first pass
+    DataSet< complex<float> >* iSet = NULL;
+    in.getWriteData(iSet, num);
+    in.releaseWriteData(iSet);
+
+    mod.process();
+
+    DataSet< OutT >* oSet = NULL;
+    out.getReadData(oSet);
+    out.releaseReadData(oSet);
+  }
+
+  SignalScalerComponent& mod;
+  DataBufferTrivial< complex<float> >& in;
+  DataBufferTrivial< OutT >& out;
+  int num;
+};
+
+/// Time process() for a given scaler configuration
+template <class OutT>
+void runBenchmark(Benchmark& bench, string description, SignalScalerComponent& mod)
 {
-  SignalScalerComponent mod("test");
   mod.registerPorts();
 
   map<string, int> iTypes,oTypes;
   iTypes["input1"] = TypeInfo< complex<float> >::identifier;
   mod.calculateOutputTypes(iTypes,oTypes);
 
-  DataBufferTrivial< complex<float> > in;
-  DataBufferTrivial< complex<float> > out;
+  // Ring buffers reuse their DataSets, so we measure the steady state
+  DataBufferTrivial< complex<float> > in(2, true);
+  DataBufferTrivial< OutT > out(2, true);
 
-  DataSet< complex<float> >* iSet = NULL;
-  int num = 1000000;
-  in.getWriteData(iSet, num);
-  for(int i=0;i<num;i++)
-    iSet->data[i] = complex<float>(i,i);
-  in.releaseWriteData(iSet);
+  int num = 10000;
+  for(int b=0;b<2;b++)
+  {
+    DataSet< complex<float> >* iSet = NULL;
+    in.getWriteData(iSet, num);
+    for(int i=0;i<num;i++)
+      iSet->data[i] = complex<float>(i*(b+1),i*(b+1));
+    in.releaseWriteData(iSet);
+    in.getReadData(iSet);
+    in.releaseReadData(iSet);
+  }
 
   mod.setBuffers(&in,&out);
   mod.initialize();
 
-  bp::ptime t1(bp::microsec_clock::local_time());
-  mod.process();
-  bp::ptime t2(bp::microsec_clock::local_time());
+  ScalerCall< OutT > call(mod, in, out, num);
+  bench.run(description, num, call);
+}
 
-  bp::time_duration time = t2-t1;
-  float megSampsPerSec = 1.0e9/time.total_nanoseconds();
-  cout << "Rate = " << megSampsPerSec << " MS/sec" << endl;
+int main(int argc, char* argv[])
+{
+  Benchmark bench("SignalScalerComponent", argc, argv);
+  {
+    SignalScalerComponent mod("test");
+    runBenchmark< complex<float> >(bench, "Peak", mod);
+  }
+  {
+    SignalScalerComponent mod("test");
+    mod.setValue("factor", 0.5f);
+    runBenchmark< complex<float> >(bench, "Factor", mod);
+  }
+  {
+    SignalScalerComponent mod("test");
+    mod.setValue("agc", true);
+    runBenchmark< complex<float> >(bench, "AGC", mod);
+  }
+  {
+    SignalScalerComponent mod("test");
+    mod.setValue("agc", true);
+    mod.setValue("outputtype", "int16_t");
+    runBenchmark< int16_t >(bench, "AGC int16", mod);
+  }
+  return bench.finish();
 }
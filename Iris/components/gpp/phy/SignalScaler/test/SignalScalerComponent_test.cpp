@@ -58,6 +58,8 @@ BOOST_AUTO_TEST_CASE(SignalScalerComponent_Parm_Test)
   SignalScalerComponent mod("test");
   BOOST_CHECK(mod.getParameterDefaultValue("maximum") == "16384");
   BOOST_CHECK(mod.getParameterDefaultValue("factor") == "0");
+  BOOST_CHECK(mod.getParameterDefaultValue("agc") == "false");
+  BOOST_CHECK(mod.getParameterDefaultValue("outputtype") == "complex<float>");
 }
 
 BOOST_AUTO_TEST_CASE(SignalScalerComponent_Ports_Test)
@@ -159,4 +161,139 @@ BOOST_AUTO_TEST_CASE(SignalScalerComponent_Process_Test2)
   out.releaseReadData(oSet);
 }
 
+BOOST_AUTO_TEST_CASE(SignalScalerComponent_Agc_Test)
+{
+  SignalScalerComponent mod("test");
+  mod.setValue("agc", true);
+  mod.setValue("attack", 1.0f);
+  mod.registerPorts();
+
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo< complex<float> >::identifier;
+  mod.calculateOutputTypes(iTypes,oTypes);
+
+  DataBufferTrivial< complex<float> > in;
+  DataBufferTrivial< complex<float> > out;
+
+  // Two blocks of constant amplitude - the second twice as loud
+  DataSet< complex<float> >* iSet = NULL;
+  in.getWriteData(iSet, 128);
+  for(int i=0;i<128;i++)
+    iSet->data[i] = complex<float>(1,0);
+  in.releaseWriteData(iSet);
+  in.getWriteData(iSet, 128);
+  for(int i=0;i<128;i++)
+    iSet->data[i] = complex<float>(2,0);
+  in.releaseWriteData(iSet);
+  in.getWriteData(iSet, 128);
+  for(int i=0;i<128;i++)
+    iSet->data[i] = complex<float>(2,0);
+  in.releaseWriteData(iSet);
+
+  mod.setBuffers(&in,&out);
+  mod.initialize();
+  BOOST_REQUIRE_NO_THROW(mod.process());
+  BOOST_REQUIRE_NO_THROW(mod.process());
+  BOOST_REQUIRE_NO_THROW(mod.process());
+
+  // First block seeds the AGC and is scaled to maximum
+  DataSet< complex<float> >* oSet = NULL;
+  out.getReadData(oSet);
+  BOOST_CHECK_CLOSE(oSet->data[127].real(), 16384.0f, 0.01);
+  out.releaseReadData(oSet);
+
+  // Second block keeps the old gain - the envelope only sees the jump
+  // once the block has been measured
+  out.getReadData(oSet);
+  BOOST_CHECK_CLOSE(oSet->data[0].real(), 32768.0f, 0.01);
+  BOOST_CHECK_CLOSE(oSet->data[127].real(), 32768.0f, 0.01);
+  out.releaseReadData(oSet);
+
+  // Third block ramps smoothly down to the new gain
+  out.getReadData(oSet);
+  BOOST_CHECK(oSet->data[0].real() < 32768.0f);
+  BOOST_CHECK(oSet->data[0].real() > 32000.0f);
+  for(int i=1;i<128;i++)
+    BOOST_CHECK(oSet->data[i].real() <= oSet->data[i-1].real());
+  BOOST_CHECK_CLOSE(oSet->data[127].real(), 16384.0f, 0.01);
+  out.releaseReadData(oSet);
+}
+
+BOOST_AUTO_TEST_CASE(SignalScalerComponent_Int16_Test)
+{
+  SignalScalerComponent mod("test");
+  mod.setValue("factor", 1000.0f);
+  mod.setValue("outputtype", "int16_t");
+  mod.registerPorts();
+
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo< complex<float> >::identifier;
+  mod.calculateOutputTypes(iTypes,oTypes);
+  BOOST_REQUIRE(oTypes["output1"] == TypeInfo< int16_t >::identifier);
+
+  DataBufferTrivial< complex<float> > in;
+  DataBufferTrivial< int16_t > out;
+
+  DataSet< complex<float> >* iSet = NULL;
+  in.getWriteData(iSet, 101);
+  for(int i=0;i<101;i++)
+    iSet->data[i] = complex<float>(i*0.5f, -i*0.5f);
+  iSet->timeStamp = 1.5;
+  in.releaseWriteData(iSet);
+
+  mod.setBuffers(&in,&out);
+  mod.initialize();
+  BOOST_REQUIRE_NO_THROW(mod.process());
+
+  BOOST_REQUIRE(out.hasData());
+  DataSet< int16_t >* oSet = NULL;
+  out.getReadData(oSet);
+  BOOST_REQUIRE(oSet->data.size() == 202);
+  BOOST_CHECK(oSet->timeStamp == 1.5);
+  for(int i=0;i<101;i++)
+  {
+    // Values outside the int16 range saturate rather than wrap
+    BOOST_CHECK_EQUAL(oSet->data[2*i], min(i*500, 32767));
+    BOOST_CHECK_EQUAL(oSet->data[2*i+1], max(-i*500, -32768));
+  }
+  out.releaseReadData(oSet);
+}
+
+BOOST_AUTO_TEST_CASE(SignalScalerComponent_Int16Rounding_Test)
+{
+  // Halves round to even in the vector loop and in the odd sample after it
+  SignalScalerComponent mod("test");
+  mod.setValue("factor", 1.0f);
+  mod.setValue("outputtype", "int16_t");
+  mod.registerPorts();
+
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo< complex<float> >::identifier;
+  mod.calculateOutputTypes(iTypes,oTypes);
+
+  DataBufferTrivial< complex<float> > in;
+  DataBufferTrivial< int16_t > out;
+
+  DataSet< complex<float> >* iSet = NULL;
+  in.getWriteData(iSet, 101);
+  for(int i=0;i<101;i++)
+    iSet->data[i] = complex<float>(i - 49.5f, 49.5f - i);
+  in.releaseWriteData(iSet);
+
+  mod.setBuffers(&in,&out);
+  mod.initialize();
+  BOOST_REQUIRE_NO_THROW(mod.process());
+
+  DataSet< int16_t >* oSet = NULL;
+  out.getReadData(oSet);
+  BOOST_REQUIRE(oSet->data.size() == 202);
+  for(int i=0;i<101;i++)
+  {
+    int even = (i - 50) % 2 == 0 ? i - 50 : i - 49;
+    BOOST_CHECK_EQUAL(oSet->data[2*i], even);
+    BOOST_CHECK_EQUAL(oSet->data[2*i+1], -even);
+  }
+  out.releaseReadData(oSet);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
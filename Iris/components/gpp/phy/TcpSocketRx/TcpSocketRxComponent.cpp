@@ -33,14 +33,20 @@
 
 #include "TcpSocketRxComponent.h"
 
-#include <boost/thread/thread.hpp> //For sleep()
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
 
 #include "irisapi/LibraryDefs.h"
 #include "irisapi/Version.h"
 #include "irisapi/TypeVectors.h"
 
 using namespace std;
-using namespace boost::asio::ip;
+namespace bp = boost::posix_time;
 
 namespace iris
 {
@@ -55,9 +61,17 @@ TcpSocketRxComponent::TcpSocketRxComponent(string name)
                 "tcpsocketrx",
                 "A TCP socket receiver",
                 "Paul Sutton",
-                "0.1"),
-  buffer_(NULL),
-  connected_(false)
+                "0.2"),
+  outputTypeId_(0),
+  listenFd_(-1),
+  fd_(-1),
+  bStopping_(false),
+  connections_(0),
+  partialBytes_(0),
+  headerBytes_(0),
+  set_(NULL),
+  setBytes_(0),
+  setTotal_(0)
 {
   //Register all parameters
   /*
@@ -75,7 +89,7 @@ TcpSocketRxComponent::TcpSocketRxComponent(string name)
                     false,
                     port_x);
   registerParameter("bufferSize",
-                    "The size of the buffer used to receive datagrams",
+                    "Largest output DataSet in bytes (without framing)",
                     "1316",
                     false,
                     bufferSize_x);
@@ -84,6 +98,26 @@ TcpSocketRxComponent::TcpSocketRxComponent(string name)
                     "uint8_t",
                     false,
                     outputType_x);
+  registerParameter("framing",
+                    "Receive DataSets framed by a TcpSocketTx?",
+                    "false",
+                    false,
+                    framing_x);
+  registerParameter("maxMessage",
+                    "Largest framed message in bytes - larger ones close the connection",
+                    "16777216",
+                    false,
+                    maxMessage_x);
+  registerParameter("latency",
+                    "Longest time in ms to wait for a DataSet to fill (without framing)",
+                    "10",
+                    false,
+                    latency_x);
+  registerParameter("rcvbuf",
+                    "Socket receive buffer size in bytes (0 = system default)",
+                    "0",
+                    false,
+                    rcvBuf_x);
 }
 
 void TcpSocketRxComponent::registerPorts()
@@ -100,7 +134,6 @@ void TcpSocketRxComponent::calculateOutputTypes(
     std::map<std::string,int>& inputTypes,
     std::map<std::string,int>& outputTypes)
 {
-  LOG(LINFO) << TypeInfo< complex<float> >::name();
   //Output type is set in the parameters
   if( outputType_x == TypeInfo< uint8_t >::name() )
     outputTypes["output1"] = TypeInfo< uint8_t >::identifier;
@@ -136,33 +169,43 @@ void TcpSocketRxComponent::calculateOutputTypes(
 
 void TcpSocketRxComponent::initialize()
 {
-  //Create our buffer
-  buffer_ = new char[bufferSize_x];
+  closeSockets();
+  connections_ = 0;
+  partialBytes_ = 0;
+  headerBytes_ = 0;
+  set_ = NULL;
 
-  //Create socket and acceptor
-  try
+  //Create socket
+  listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if(listenFd_ < 0)
   {
-    socket_ = new boost::asio::ip::tcp::socket(ioService_);
-    acceptor_ = new tcp::acceptor(ioService_, tcp::endpoint(tcp::v4(), port_x));
+    LOG(LERROR) << "Failed to create socket: " << strerror(errno);
+    return;
   }
-  catch(boost::system::system_error &e)
+  int on = 1;
+  setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  if(rcvBuf_x > 0)
   {
-    LOG(LERROR) << "Failed to create socket: " << e.what();
+    //Set before listening so accepted connections get it too
+    int size = rcvBuf_x;
+    setsockopt(listenFd_, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
   }
 }
 
 void TcpSocketRxComponent::start()
 {
-  //Open socket
-  try
-  {
-    if(!acceptor_->is_open())
-      acceptor_->open(tcp::v4());
-  }
-  catch(boost::system::system_error &e)
-  {
-    LOG(LERROR) << "Failed to open socket and accept a connection: " << e.what();
-  }
+  bStopping_ = false;
+
+  //Bind socket and listen
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port_x);
+  if(listenFd_ < 0
+     || bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+     || listen(listenFd_, 1) != 0)
+    LOG(LERROR) << "Failed to open socket: " << strerror(errno);
 }
 
 void TcpSocketRxComponent::process()
@@ -224,73 +267,252 @@ void TcpSocketRxComponent::process()
 template<typename T>
 void TcpSocketRxComponent::writeOutput()
 {
-  std::size_t size;
+  if(framing_x)
+  {
+    writeFramedOutput<T>();
+    return;
+  }
+
+  //Wait for some data before taking a DataSet, so stop() is not held up
+  if(!waitData())
+    return;
+
+  size_t capacity = max<size_t>(bufferSize_x / sizeof(T), 1) * sizeof(T);
 
-  try
+  //Get the output buffer and receive straight into it
+  WriteBuffer< T >* outBuf = castToType<T>(outputBuffers[0]);
+  DataSet<T>* writeDataSet = NULL;
+  outBuf->getWriteData(writeDataSet, capacity / sizeof(T));
+  char* dest = reinterpret_cast<char*>(&writeDataSet->data[0]);
+
+  //Start with what was left over last time
+  memcpy(dest, partial_, partialBytes_);
+  size_t filled = partialBytes_;
+  partialBytes_ = 0;
+
+  bp::ptime deadline = bp::microsec_clock::universal_time() + bp::milliseconds(latency_x);
+  while(filled < capacity && !bStopping_)
   {
-    if(!connected_)
-    {
-      //Listen for connection if necessary
-      acceptor_->accept(*socket_);
-      connected_ = true;
-    }
+    ssize_t got = receiveSome(dest + filled, capacity - filled);
+    if(got < 0)
+      break;
+    filled += got;
+    if(got > 0)
+      continue;
 
-    //Get data from socket
-    //size = socket_->receive(boost::asio::buffer(d_buffer, x_bufferSize));
-    size = boost::asio::read(*socket_, boost::asio::buffer(buffer_, bufferSize_x));
+    bp::time_duration left = deadline - bp::microsec_clock::universal_time();
+    if(left.is_negative())
+      break;
+    waitReadable(min<long>(left.total_milliseconds() + 1, 100));
   }
-  catch(boost::system::system_error &e)
+
+  //Keep any part of an element for next time
+  if(fd_ >= 0)
   {
-    LOG(LERROR) << "Error listening on socket: " << e.what();
-    boost::this_thread::sleep(boost::posix_time::milliseconds(5000));
-    return;
+    partialBytes_ = filled % sizeof(T);
+    memcpy(partial_, dest + filled - partialBytes_, partialBytes_);
   }
-
-  //Check that we've an integer number of data types in the datagram
-  float f = size/(float)sizeof(T);
-  float intpart, rem;
-  rem = modf(f, &intpart);
-  if(rem != 0)
+  else if(filled % sizeof(T) != 0)
   {
-    LOG(LERROR) << "Did not receive an integer number of elements. Input size = " << size;
+    LOG(LWARNING) << "Connection lost part way through an element - "
+                  << filled % sizeof(T) << " bytes discarded";
   }
-  int numT = (int)intpart;
 
-  //Get the output buffer
+  writeDataSet->data.resize(filled / sizeof(T));
+  outBuf->releaseWriteData(writeDataSet);
+}
+
+template<typename T>
+void TcpSocketRxComponent::writeFramedOutput()
+{
+  using namespace tcpframing;
   WriteBuffer< T >* outBuf = castToType<T>(outputBuffers[0]);
-  DataSet<T>* writeDataSet = NULL;
-  outBuf->getWriteData(writeDataSet, numT);
+  DataSet<T>* s = static_cast<DataSet<T>*>(set_);
 
-  //Copy data into output
-  T* bufT = (T*)buffer_;
-  copy(bufT, bufT+numT, writeDataSet->data.begin());
+  while(!bStopping_)
+  {
+    if(fd_ < 0)
+    {
+      //A lost connection loses the message being received
+      headerBytes_ = 0;
+      acceptConnection(100);
+      continue;
+    }
 
-  //Release the buffer
-  outBuf->releaseWriteData(writeDataSet);
+    //Header first, then the data straight into the DataSet
+    char* dest;
+    size_t want;
+    if(headerBytes_ < HEADER_SIZE)
+    {
+      dest = header_ + headerBytes_;
+      want = HEADER_SIZE - headerBytes_;
+    }
+    else
+    {
+      want = setTotal_ - setBytes_;
+      dest = want > 0 ? reinterpret_cast<char*>(&s->data[0]) + setBytes_ : NULL;
+    }
+
+    ssize_t got = want > 0 ? receiveSome(dest, want) : 0;
+    if(got < 0)
+      continue;
+    if(want > 0 && got == 0)
+    {
+      waitReadable(100);
+      continue;
+    }
+
+    if(headerBytes_ < HEADER_SIZE)
+    {
+      headerBytes_ += got;
+      if(headerBytes_ < HEADER_SIZE)
+        continue;
+
+      MessageHeader h;
+      if(!readHeader(header_, h)
+         || h.type != (uint32_t)TypeInfo<T>::identifier || h.length % sizeof(T) != 0)
+      {
+        LOG(LERROR) << "Received a message which is not framed " << TypeInfo<T>::name()
+                    << " data - closing the connection";
+        closeConnection();
+        continue;
+      }
+      if(h.length > maxMessage_x)
+      {
+        LOG(LERROR) << "Received a message of " << h.length << " bytes, more than maxMessage ("
+                    << maxMessage_x << ") - closing the connection";
+        closeConnection();
+        continue;
+      }
+
+      //A DataSet left over from a lost connection is reused
+      if(s == NULL)
+        outBuf->getWriteData(s, h.length / sizeof(T));
+      else
+        s->data.resize(h.length / sizeof(T));
+      s->timeStamp = h.timeStamp;
+      s->sampleRate = h.sampleRate;
+      set_ = s;
+      setBytes_ = 0;
+      setTotal_ = h.length;
+    }
+    else
+    {
+      setBytes_ += got;
+    }
+
+    if(setBytes_ == setTotal_)
+    {
+      headerBytes_ = 0;
+      set_ = NULL;
+      outBuf->releaseWriteData(s);
+      return;
+    }
+  }
+
+  //Don't leave a DataSet locked
+  if(s != NULL)
+  {
+    s->data.clear();
+    set_ = NULL;
+    headerBytes_ = 0;
+    outBuf->releaseWriteData(s);
+  }
 }
 
-void TcpSocketRxComponent::stop()
+bool TcpSocketRxComponent::waitData()
 {
-  //Close acceptor
-  try
+  while(!bStopping_)
   {
-    acceptor_->close();
-    socket_->close();
+    if(fd_ < 0)
+    {
+      acceptConnection(100);
+      continue;
+    }
+    if(!waitReadable(100))
+      continue;
+
+    //Readable could mean the connection has closed
+    char c;
+    ssize_t got = recv(fd_, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    if(got > 0)
+      return true;
+    if(got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+      receiveSome(&c, 1);   //Reports and closes
   }
-  catch(boost::system::system_error &e)
+  return false;
+}
+
+void TcpSocketRxComponent::acceptConnection(int timeout)
+{
+  pollfd p;
+  p.fd = listenFd_;
+  p.events = POLLIN;
+  p.revents = 0;
+  if(poll(&p, 1, timeout) <= 0 || !(p.revents & POLLIN))
+    return;
+
+  fd_ = accept(listenFd_, NULL, NULL);
+  if(fd_ < 0)
   {
-    LOG(LERROR) << "Failed to close socket: " << e.what();
+    if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+      LOG(LERROR) << "Error accepting a connection: " << strerror(errno);
+    return;
   }
+  partialBytes_ = 0;
+  connections_++;
+  LOG(LINFO) << "Accepted a connection on port " << port_x;
 }
 
-TcpSocketRxComponent::~TcpSocketRxComponent()
+ssize_t TcpSocketRxComponent::receiveSome(char* dest, size_t size)
 {
-  //Destroy our buffer
-  delete [] buffer_;
+  ssize_t got = recv(fd_, dest, size, MSG_DONTWAIT);
+  if(got > 0)
+    return got;
+  if(got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    return 0;
+
+  if(got == 0)
+    LOG(LINFO) << "Connection on port " << port_x << " closed by the sender";
+  else
+    LOG(LERROR) << "Error receiving from socket: " << strerror(errno);
+  closeConnection();
+  return -1;
+}
 
-  //Destroy socket and acceptor
-  delete socket_;
-  delete acceptor_;
+bool TcpSocketRxComponent::waitReadable(int timeout)
+{
+  pollfd p;
+  p.fd = fd_;
+  p.events = POLLIN;
+  p.revents = 0;
+  return fd_ >= 0 && poll(&p, 1, timeout) > 0 && (p.revents & (POLLIN | POLLHUP | POLLERR));
+}
+
+void TcpSocketRxComponent::stop()
+{
+  //process() sees this within 100ms
+  bStopping_ = true;
+}
+
+void TcpSocketRxComponent::closeConnection()
+{
+  if(fd_ >= 0)
+    close(fd_);
+  fd_ = -1;
+}
+
+void TcpSocketRxComponent::closeSockets()
+{
+  closeConnection();
+  if(listenFd_ >= 0)
+    close(listenFd_);
+  listenFd_ = -1;
+}
+
+TcpSocketRxComponent::~TcpSocketRxComponent()
+{
+  closeSockets();
 }
 
 } // namespace phy
@@ -35,9 +35,7 @@
 #define PHY_TCPSOCKETRXCOMPONENT_H_
 
 #include "irisapi/PhyComponent.h"
-
-//For boost asio sockets
-#include <boost/asio.hpp>
+#include "utility/TcpFraming.h"
 
 namespace iris
 {
@@ -48,6 +46,18 @@ namespace phy
  *
  * The TcpSocketRxComponent receives data from a TCP socket. The port number,
  * buffer size and data type can be specified using parameters.
+ *
+ * Without framing, data is output as it arrives: once some has arrived, a
+ * DataSet is filled up to bufferSize bytes or for up to latency ms,
+ * whichever comes first. An element split across reads is carried over to
+ * the next DataSet.
+ *
+ * With framing, the sender must be a TcpSocketTxComponent with framing on
+ * (see utility/TcpFraming.h). Each DataSet sent comes out whole, with its
+ * timeStamp and sampleRate, and bufferSize is ignored. A message larger
+ * than maxMessage bytes closes the connection.
+ *
+ * When the connection is lost the component waits for a new one.
  */
 class TcpSocketRxComponent
   : public PhyComponent
@@ -64,22 +74,57 @@ class TcpSocketRxComponent
   virtual void process();
   virtual void stop();
 
+  /// Number of connections accepted so far
+  uint64_t getConnections() const { return connections_; }
+
  private:
   /// Template function used to write the output.
   template<typename T> void writeOutput();
 
+  /// Template function used to write framed output.
+  template<typename T> void writeFramedOutput();
+
+  /// Wait until there is data to read, accepting a connection if needed
+  bool waitData();
+
+  /// Wait up to timeout ms for a connection
+  void acceptConnection(int timeout);
+
+  /// Read what is available, up to size bytes - returns -1 if the connection is lost
+  ssize_t receiveSome(char* dest, std::size_t size);
+
+  /// Wait up to timeout ms for the connection to become readable
+  bool waitReadable(int timeout);
+
+  /// Close the connection
+  void closeConnection();
+
+  /// Close the connection and the listening socket
+  void closeSockets();
+
   unsigned short port_x;      ///< Port number to bind to.
   unsigned int bufferSize_x;  ///< Size of buffers to be generated.
   std::string outputType_x;   ///< Data type of output.
+  bool framing_x;             ///< Receive framed DataSets?
+  uint32_t maxMessage_x;      ///< Largest framed message in bytes
+  uint32_t latency_x;         ///< Longest time in ms to wait for a DataSet to fill
+  uint32_t rcvBuf_x;          ///< Socket receive buffer size in bytes (0 = system default)
 
   int outputTypeId_;          ///< The ID of the output data type
 
-  boost::asio::io_service ioService_;
-  boost::asio::ip::tcp::socket* socket_;
-  boost::asio::ip::tcp::acceptor* acceptor_;
+  int listenFd_;              ///< The listening socket
+  int fd_;                    ///< The connection
+  volatile bool bStopping_;
+  uint64_t connections_;
+
+  char partial_[32];          ///< Start of an element split across reads
+  std::size_t partialBytes_;
 
-  char* buffer_;
-  bool connected_;
+  char header_[tcpframing::HEADER_SIZE];  ///< Header of the message being received
+  std::size_t headerBytes_;   ///< Bytes of it received so far
+  void* set_;                 ///< The DataSet being received into (a DataSet<T>)
+  std::size_t setBytes_;      ///< Bytes of it received so far
+  std::size_t setTotal_;      ///< Its size in bytes
 };
 
 } // namespace phy
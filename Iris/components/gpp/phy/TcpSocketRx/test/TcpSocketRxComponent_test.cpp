@@ -0,0 +1,248 @@
+/**
+ * \file components/gpp/phy/TcpSocketRx/test/TcpSocketRxComponent_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for TcpSocketRx component.
+ */
+
+#define BOOST_TEST_MODULE TcpSocketRxComponent_Test
+
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <boost/test/unit_test.hpp>
+
+#include "../TcpSocketRxComponent.h"
+#include "utility/DataBufferTrivial.h"
+#include "utility/TcpFraming.h"
+
+using namespace std;
+using namespace iris;
+using namespace iris::phy;
+
+static const int PORT = 50014;
+
+/// Set up and start a component writing to out
+void startComponent(TcpSocketRxComponent& comp, WriteBufferBase* out,
+                    string type, bool framing)
+{
+  comp.setValue("port", PORT);
+  comp.setValue("outputType", type);
+  comp.setValue("bufferSize", 1000);
+  comp.setValue("framing", framing);
+  comp.setValue("latency", 50);
+  comp.registerPorts();
+  map<string, int> iTypes,oTypes;
+  comp.calculateOutputTypes(iTypes,oTypes);
+  comp.setBuffers(NULL, out);
+  comp.initialize();
+  comp.start();
+}
+
+/// A plain client socket connected to the component
+class Sender
+{
+public:
+  Sender()
+  {
+    fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in dest;
+    memset(&dest, 0, sizeof(dest));
+    dest.sin_family = AF_INET;
+    dest.sin_port = htons(PORT);
+    inet_aton("127.0.0.1", &dest.sin_addr);
+    BOOST_REQUIRE(connect(fd_, (sockaddr*)&dest, sizeof(dest)) == 0);
+  }
+  ~Sender() { close(fd_); }
+
+  void send(const void* data, size_t size)
+  {
+    BOOST_REQUIRE_EQUAL(::send(fd_, data, size, 0), (ssize_t)size);
+  }
+
+  /// Send a framed message
+  void sendMessage(const vector< complex<float> >& v, double timeStamp)
+  {
+    MessageHeader h;
+    h.type = TypeInfo< complex<float> >::identifier;
+    h.length = v.size()*sizeof(complex<float>);
+    h.timeStamp = timeStamp;
+    h.sampleRate = 1e6;
+    char header[tcpframing::HEADER_SIZE];
+    tcpframing::writeHeader(header, h);
+    send(header, sizeof(header));
+    send(&v[0], h.length);
+  }
+
+private:
+  int fd_;
+};
+
+BOOST_AUTO_TEST_SUITE (TcpSocketRxComponent_Test)
+
+BOOST_AUTO_TEST_CASE(TcpSocketRxComponent_Raw_Test)
+{
+  TcpSocketRxComponent comp("test");
+  DataBufferTrivial<uint16_t> out(8);
+  startComponent(comp, &out, "uint16_t", false);
+  Sender tx;
+
+  // What has arrived goes out on the deadline, keeping back half an element
+  uint16_t v[] = {0x0100, 0x0302, 0x0504, 0x0706};
+  tx.send(v, 5);
+  comp.process();
+  DataSet<uint16_t>* set = NULL;
+  out.getReadData(set);
+  BOOST_REQUIRE_EQUAL(set->data.size(), 2u);
+  BOOST_CHECK_EQUAL(set->data[1], v[1]);
+  out.releaseReadData(set);
+
+  tx.send((char*)v + 5, 3);
+  comp.process();
+  out.getReadData(set);
+  BOOST_REQUIRE_EQUAL(set->data.size(), 2u);
+  BOOST_CHECK_EQUAL(set->data[0], v[2]);
+  BOOST_CHECK_EQUAL(set->data[1], v[3]);
+  out.releaseReadData(set);
+
+  // A full DataSet goes out without waiting
+  vector<uint16_t> big(1500);
+  for(size_t i=0; i<big.size(); i++)
+    big[i] = i;
+  tx.send(&big[0], big.size()*sizeof(uint16_t));
+  for(size_t n=0; n<big.size(); )
+  {
+    comp.process();
+    out.getReadData(set);
+    BOOST_REQUIRE_LE(set->data.size(), 500u);
+    BOOST_REQUIRE(equal(set->data.begin(), set->data.end(), big.begin() + n));
+    n += set->data.size();
+    out.releaseReadData(set);
+  }
+  comp.stop();
+}
+
+BOOST_AUTO_TEST_CASE(TcpSocketRxComponent_Framed_Test)
+{
+  typedef complex<float> Cplx;
+  TcpSocketRxComponent comp("test");
+  DataBufferTrivial<Cplx> out(8);
+  startComponent(comp, &out, "complex<float>", true);
+
+  // Messages come out whole with their timing, across connections
+  for(int c=0; c<2; c++)
+  {
+    Sender tx;
+    for(int m=0; m<3; m++)
+    {
+      vector<Cplx> v(10000 + 1000*m);
+      for(size_t i=0; i<v.size(); i++)
+        v[i] = Cplx(i, m);
+      tx.sendMessage(v, 10*c + m);
+
+      comp.process();
+      DataSet<Cplx>* set = NULL;
+      out.getReadData(set);
+      BOOST_REQUIRE(set->data == v);
+      BOOST_CHECK_EQUAL(set->timeStamp, 10*c + m);
+      BOOST_CHECK_EQUAL(set->sampleRate, 1e6);
+      out.releaseReadData(set);
+    }
+  }
+  BOOST_CHECK_EQUAL(comp.getConnections(), 2u);
+
+  // Once stopped, process() returns without output
+  comp.stop();
+  comp.process();
+  BOOST_CHECK(!out.hasData());
+}
+
+BOOST_AUTO_TEST_CASE(TcpSocketRxComponent_Partial_Test)
+{
+  // A message cut short by a lost connection is discarded
+  typedef complex<float> Cplx;
+  TcpSocketRxComponent comp("test");
+  DataBufferTrivial<Cplx> out(8);
+  startComponent(comp, &out, "complex<float>", true);
+
+  {
+    Sender tx;
+    MessageHeader h;
+    h.type = TypeInfo<Cplx>::identifier;
+    h.length = 800;
+    h.timeStamp = 0;
+    h.sampleRate = 1;
+    char header[tcpframing::HEADER_SIZE + 400];
+    tcpframing::writeHeader(header, h);
+    tx.send(header, sizeof(header));
+  }
+  Sender tx;
+  vector<Cplx> v(50, Cplx(1, 2));
+  tx.sendMessage(v, 5);
+
+  comp.process();
+  DataSet<Cplx>* set = NULL;
+  out.getReadData(set);
+  BOOST_REQUIRE(set->data == v);
+  BOOST_CHECK_EQUAL(set->timeStamp, 5);
+  out.releaseReadData(set);
+  BOOST_CHECK(!out.hasData());
+  comp.stop();
+}
+
+BOOST_AUTO_TEST_CASE(TcpSocketRxComponent_Oversized_Test)
+{
+  // A message larger than maxMessage closes the connection
+  typedef complex<float> Cplx;
+  TcpSocketRxComponent comp("test");
+  DataBufferTrivial<Cplx> out(8);
+  comp.setValue("maxMessage", 800);
+  startComponent(comp, &out, "complex<float>", true);
+
+  {
+    Sender tx;
+    tx.sendMessage(vector<Cplx>(101, Cplx(3, 4)), 1);
+  }
+  Sender tx;
+  vector<Cplx> v(100, Cplx(1, 2));
+  tx.sendMessage(v, 5);
+
+  comp.process();
+  DataSet<Cplx>* set = NULL;
+  out.getReadData(set);
+  BOOST_REQUIRE(set->data == v);
+  BOOST_CHECK_EQUAL(set->timeStamp, 5);
+  out.releaseReadData(set);
+  BOOST_CHECK_EQUAL(comp.getConnections(), 2u);
+  comp.stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,380 @@
+/**
+ * \file components/gpp/phy/TcpSocketTx/TcpSocketTxComponent.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Implementation of a sink component which writes to a TCP socket.
+ */
+
+#include "TcpSocketTxComponent.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "irisapi/LibraryDefs.h"
+#include "irisapi/Version.h"
+#include "irisapi/TypeVectors.h"
+
+using namespace std;
+namespace bp = boost::posix_time;
+
+namespace iris
+{
+namespace phy
+{
+
+/// Longest time in ms to wait for a connection
+static const int CONNECT_TIMEOUT = 1000;
+
+// export library symbols
+IRIS_COMPONENT_EXPORTS(PhyComponent, TcpSocketTxComponent);
+
+TcpSocketTxComponent::TcpSocketTxComponent(string name)
+  : PhyComponent(name,
+                "tcpsockettx",
+                "A TCP socket transmitter",
+                "The Iris Project Developers",
+                "0.1")
+  ,fd_(-1)
+  ,corked_(false)
+  ,bytes_(0)
+{
+  //Register all parameters
+  /*
+   * format:
+   * registerParameter(name,
+   *                   description,
+   *                   default value,
+   *                   dynamic?,
+   *                   parameter,
+   *                   allowed values)
+   */
+  registerParameter("address",
+                    "Address of the target machine",
+                    "127.0.0.1",
+                    false,
+                    address_x);
+  registerParameter("port",
+                    "Port of the target machine",
+                    "1234",
+                    false,
+                    port_x);
+  registerParameter("framing",
+                    "Frame DataSets with their size, type and timing",
+                    "false",
+                    false,
+                    framing_x);
+  registerParameter("nodelay",
+                    "Send small DataSets straight away (TCP_NODELAY)",
+                    "true",
+                    false,
+                    noDelay_x);
+  registerParameter("cork",
+                    "Hold back partial segments while more DataSets are queued (TCP_CORK)",
+                    "false",
+                    false,
+                    cork_x);
+  registerParameter("sndbuf",
+                    "Socket send buffer size in bytes (0 = system default)",
+                    "0",
+                    false,
+                    sndBuf_x);
+}
+
+void TcpSocketTxComponent::registerPorts()
+{
+  //Register all ports
+  //This component supports all data types
+  vector<int> validTypes = convertToTypeIdVector<IrisDataTypes>();
+
+  //format:        (name, vector of valid types)
+  registerInputPort("input1", validTypes);
+}
+
+void TcpSocketTxComponent::calculateOutputTypes(
+    std::map<std::string,int>& inputTypes,
+    std::map<std::string,int>& outputTypes)
+{
+  //No output
+}
+
+void TcpSocketTxComponent::initialize()
+{
+  closeSocket();
+  bytes_ = 0;
+  lastAttempt_ = bp::ptime();
+#ifndef TCP_CORK
+  if(cork_x)
+    LOG(LWARNING) << "TCP_CORK is not supported on this platform - cork ignored";
+#endif
+}
+
+void TcpSocketTxComponent::process()
+{
+  if( outputBuffers.size() != 0 || inputBuffers.size() != 1)
+  {
+    //Need to throw an exception here
+  }
+
+  switch(inputBuffers[0]->getTypeIdentifier())
+  {
+    case 0:
+      writeOutput<uint8_t>();
+      break;
+    case 1:
+      writeOutput<uint16_t>();
+      break;
+    case 2:
+      writeOutput<uint32_t>();
+      break;
+    case 3:
+      writeOutput<uint64_t>();
+      break;
+    case 4:
+      writeOutput<int8_t>();
+      break;
+    case 5:
+      writeOutput<int16_t>();
+      break;
+    case 6:
+      writeOutput<int32_t>();
+      break;
+    case 7:
+      writeOutput<int64_t>();
+      break;
+    case 8:
+      writeOutput<float>();
+      break;
+    case 9:
+      writeOutput<double>();
+      break;
+    case 10:
+      writeOutput<long double>();
+      break;
+    case 11:
+      writeOutput< complex<float> >();
+      break;
+    case 12:
+      writeOutput< complex<double> >();
+      break;
+    case 13:
+      writeOutput<complex< long double> >();
+      break;
+    default:
+      break;
+  }
+}
+
+template<typename T>
+void TcpSocketTxComponent::writeOutput()
+{
+  //Get a read buffer
+  ReadBuffer<T>* inBuf = castToType<T>(inputBuffers[0]);
+  DataSet<T>* readDataSet = NULL;
+  inBuf->getReadData(readDataSet);
+
+  if(connectSocket())
+  {
+    //Header and data go out in one write, straight from the DataSet
+    iovec iov[2];
+    int count = 0;
+    size_t bytes = readDataSet->data.size()*sizeof(T);
+    if(framing_x)
+    {
+      MessageHeader h;
+      h.type = TypeInfo<T>::identifier;
+      h.length = bytes;
+      h.timeStamp = readDataSet->timeStamp;
+      h.sampleRate = readDataSet->sampleRate;
+      tcpframing::writeHeader(header_, h);
+      iov[count].iov_base = header_;
+      iov[count].iov_len = tcpframing::HEADER_SIZE;
+      count++;
+    }
+    if(bytes > 0)
+    {
+      iov[count].iov_base = &readDataSet->data[0];
+      iov[count].iov_len = bytes;
+      count++;
+    }
+
+    //Corked while more DataSets are waiting - uncorking flushes
+    bool more = cork_x && inBuf->hasData();
+    if(more && !corked_)
+      setCork(true);
+    if(!writeAll(iov, count))
+    {
+      LOG(LERROR) << "An error occurred while sending data to " << address_x << ", port " << port_x << \
+          ": " << strerror(errno);
+      closeSocket();
+    }
+    else if(corked_ && !more)
+    {
+      setCork(false);
+    }
+  }
+
+  //Release the buffer
+  inBuf->releaseReadData(readDataSet);
+}
+
+bool TcpSocketTxComponent::connectSocket()
+{
+  if(fd_ >= 0)
+    return true;
+
+  //Don't hold up the flow by retrying too often
+  bp::ptime now = bp::microsec_clock::universal_time();
+  if(!lastAttempt_.is_not_a_date_time() && now - lastAttempt_ < bp::seconds(1))
+    return false;
+  lastAttempt_ = now;
+
+  sockaddr_in dest;
+  memset(&dest, 0, sizeof(dest));
+  dest.sin_family = AF_INET;
+  dest.sin_port = htons(port_x);
+  if(inet_aton(address_x.c_str(), &dest.sin_addr) == 0)
+  {
+    LOG(LERROR) << "Failed to connect: bad address " << address_x;
+    return false;
+  }
+
+  fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if(fd_ < 0)
+  {
+    LOG(LERROR) << "Failed to create socket: " << strerror(errno);
+    return false;
+  }
+  int on = noDelay_x ? 1 : 0;
+  setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  if(sndBuf_x > 0)
+  {
+    int size = sndBuf_x;
+    setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+  }
+
+  //Connect with a timeout, then go back to blocking writes
+  int flags = fcntl(fd_, F_GETFL, 0);
+  fcntl(fd_, F_SETFL, flags | O_NONBLOCK);
+  int result = connect(fd_, reinterpret_cast<sockaddr*>(&dest), sizeof(dest));
+  if(result != 0 && errno == EINPROGRESS)
+  {
+    pollfd p;
+    p.fd = fd_;
+    p.events = POLLOUT;
+    p.revents = 0;
+    int error = ETIMEDOUT;
+    socklen_t len = sizeof(error);
+    if(poll(&p, 1, CONNECT_TIMEOUT) > 0)
+      getsockopt(fd_, SOL_SOCKET, SO_ERROR, &error, &len);
+    errno = error;
+    result = error == 0 ? 0 : -1;
+  }
+  if(result != 0)
+  {
+    LOG(LWARNING) << "Failed to connect to " << address_x << ", port " << port_x
+                  << ": " << strerror(errno);
+    closeSocket();
+    return false;
+  }
+  fcntl(fd_, F_SETFL, flags);
+
+  LOG(LINFO) << "Connected to " << address_x << ", port " << port_x;
+  return true;
+}
+
+bool TcpSocketTxComponent::writeAll(iovec* iov, int count)
+{
+  msghdr m;
+  memset(&m, 0, sizeof(m));
+  m.msg_iov = iov;
+  m.msg_iovlen = count;
+
+  while(m.msg_iovlen > 0)
+  {
+#ifdef MSG_NOSIGNAL
+    ssize_t n = sendmsg(fd_, &m, MSG_NOSIGNAL);
+#else
+    ssize_t n = sendmsg(fd_, &m, 0);
+#endif
+    if(n < 0)
+    {
+      if(errno == EINTR)
+        continue;
+      return false;
+    }
+    bytes_ += n;
+
+    //Skip what has been written
+    while(m.msg_iovlen > 0 && (size_t)n >= m.msg_iov->iov_len)
+    {
+      n -= m.msg_iov->iov_len;
+      m.msg_iov++;
+      m.msg_iovlen--;
+    }
+    if(m.msg_iovlen > 0)
+    {
+      m.msg_iov->iov_base = static_cast<char*>(m.msg_iov->iov_base) + n;
+      m.msg_iov->iov_len -= n;
+    }
+  }
+  return true;
+}
+
+void TcpSocketTxComponent::setCork(bool on)
+{
+#ifdef TCP_CORK
+  int value = on ? 1 : 0;
+  setsockopt(fd_, IPPROTO_TCP, TCP_CORK, &value, sizeof(value));
+  corked_ = on;
+#endif
+}
+
+void TcpSocketTxComponent::closeSocket()
+{
+  if(fd_ >= 0)
+    close(fd_);
+  fd_ = -1;
+  corked_ = false;
+}
+
+TcpSocketTxComponent::~TcpSocketTxComponent()
+{
+  closeSocket();
+}
+
+} // namespace phy
+} // namespace iris
@@ -0,0 +1,115 @@
+/**
+ * \file components/gpp/phy/TcpSocketTx/TcpSocketTxComponent.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * A sink component which writes to a TCP socket.
+ */
+
+#ifndef PHY_TCPSOCKETTXCOMPONENT_H_
+#define PHY_TCPSOCKETTXCOMPONENT_H_
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "irisapi/PhyComponent.h"
+#include "utility/TcpFraming.h"
+
+struct iovec;
+
+namespace iris
+{
+namespace phy
+{
+
+/** A PhyComponent which transmits data over a TCP socket.
+ *
+ * The TcpSocketTxComponent connects to a TcpSocketRxComponent (or any other
+ * TCP server) at a specified IP address and port, and writes each DataSet
+ * to it. If the connection fails or is lost, DataSets are dropped and the
+ * component tries to connect again, at most once a second.
+ *
+ * With framing (see utility/TcpFraming.h) each DataSet is preceded by a
+ * header carrying its size, type, timeStamp and sampleRate. Header and data
+ * are written with one gather write, straight from the DataSet.
+ *
+ * nodelay (TCP_NODELAY) sends small DataSets straight away rather than
+ * waiting to fill a segment. cork (TCP_CORK, Linux only) instead holds
+ * back partial segments while more DataSets are queued at the input and
+ * flushes when the queue empties, which cuts the packet count for streams
+ * of small DataSets.
+ */
+class TcpSocketTxComponent
+  : public PhyComponent
+{
+public:
+  TcpSocketTxComponent(std::string name);
+  ~TcpSocketTxComponent();
+  virtual void calculateOutputTypes(
+    std::map<std::string, int>& inputTypes,
+    std::map<std::string, int>& outputTypes);
+  virtual void registerPorts();
+  virtual void initialize();
+  virtual void process();
+
+  /// Number of bytes sent so far
+  uint64_t getSentBytes() const { return bytes_; }
+
+private:
+  /// Template function to write output.
+  template<typename T> void writeOutput();
+
+  /// Connect if not connected and not tried recently, return true if connected
+  bool connectSocket();
+
+  /// Write all of count buffers, return false on error
+  bool writeAll(struct iovec* iov, int count);
+
+  /// Turn TCP_CORK on or off
+  void setCork(bool on);
+
+  /// Close the socket
+  void closeSocket();
+
+  std::string address_x;  //!< The IP address to connect to
+  unsigned short port_x;  //!< The destination port number
+  bool framing_x;         //!< Frame DataSets with their size and timing?
+  bool noDelay_x;         //!< Set TCP_NODELAY?
+  bool cork_x;            //!< Cork while more DataSets are queued?
+  uint32_t sndBuf_x;      //!< Socket send buffer size in bytes (0 = system default)
+
+  int fd_;                //!< The socket
+  bool corked_;           //!< Is TCP_CORK on?
+  uint64_t bytes_;        //!< Bytes sent
+  boost::posix_time::ptime lastAttempt_;    //!< Time of the last connection attempt
+  char header_[tcpframing::HEADER_SIZE];    //!< Header of the DataSet being sent
+};
+
+} // namespace phy
+} // namespace iris
+
+#endif // PHY_TCPSOCKETTXCOMPONENT_H_
@@ -0,0 +1,194 @@
+/**
+ * \file components/gpp/phy/TcpSocketTx/test/UdpSocketRxComponent_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main benchmark file for TcpSocketTx component. Framed DataSets are sent
+ * over loopback to a plain socket, to measure throughput and latency.
+ */
+
+#include "../TcpSocketTxComponent.h"
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <boost/thread/thread.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "utility/DataBufferTrivial.h"
+
+using namespace std;
+using namespace iris;
+using namespace iris::phy;
+namespace bp = boost::posix_time;
+
+typedef complex<float> Cplx;
+static const int PORT = 50016;
+
+/// Accepts one connection and reads from it
+struct Sink
+{
+  Sink() : fd(-1), bytes(0)
+  {
+    listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(PORT);
+    bind(listenFd, (sockaddr*)&addr, sizeof(addr));
+    listen(listenFd, 1);
+  }
+  ~Sink() { close(fd); close(listenFd); }
+
+  /// Read exactly size bytes
+  void read(char* buf, size_t size)
+  {
+    if(fd < 0)
+      fd = accept(listenFd, NULL, NULL);
+    for(size_t got=0; got<size; )
+    {
+      ssize_t n = recv(fd, buf + got, size - got, 0);
+      if(n <= 0)
+        return;
+      got += n;
+    }
+    bytes += size;
+  }
+
+  /// Read until the sender closes
+  void operator()()
+  {
+    vector<char> buf(1<<20);
+    fd = accept(listenFd, NULL, NULL);
+    while(recv(fd, &buf[0], buf.size(), 0) > 0)
+      ;
+  }
+
+  int listenFd;
+  int fd;
+  uint64_t bytes;
+};
+
+/// Set up a framed component reading from in
+void startComponent(TcpSocketTxComponent& comp, DataBufferTrivial<Cplx>& in,
+                    bool noDelay, bool cork)
+{
+  comp.setValue("port", PORT);
+  comp.setValue("framing", true);
+  comp.setValue("nodelay", noDelay);
+  comp.setValue("cork", cork);
+  comp.registerPorts();
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo<Cplx>::identifier;
+  comp.calculateOutputTypes(iTypes,oTypes);
+  comp.setBuffers(&in, NULL);
+  comp.initialize();
+  comp.start();
+}
+
+/// Stream numSets DataSets of setSize samples, queueing 4 at a time
+void runThroughput(string description, size_t setSize, size_t numSets,
+                   bool noDelay, bool cork)
+{
+  Sink sink;
+  boost::thread t(boost::ref(sink));
+
+  double secs;
+  {
+    TcpSocketTxComponent comp("test");
+    DataBufferTrivial<Cplx> in(4);
+    startComponent(comp, in, noDelay, cork);
+
+    bp::ptime t1(bp::microsec_clock::local_time());
+    for(size_t s=0; s<numSets; s+=4)
+    {
+      for(int i=0; i<4; i++)
+      {
+        DataSet<Cplx>* set = NULL;
+        in.getWriteData(set, setSize);
+        in.releaseWriteData(set);
+      }
+      for(int i=0; i<4; i++)
+        comp.process();
+    }
+    bp::ptime t2(bp::microsec_clock::local_time());
+    secs = (t2-t1).total_microseconds() / 1e6;
+  }
+  t.join();
+
+  cout << description << ", " << setSize << " samples per DataSet: "
+       << setSize*numSets/secs/1e6 << " MS/s, "
+       << numSets/secs/1e3 << " k DataSets/s" << endl;
+}
+
+/// Send DataSets of setSize samples one at a time and time each until received
+void runLatency(string description, size_t setSize, size_t numSets,
+                bool noDelay, bool cork)
+{
+  Sink sink;
+  TcpSocketTxComponent comp("test");
+  DataBufferTrivial<Cplx> in(1);
+  startComponent(comp, in, noDelay, cork);
+
+  size_t bytes = tcpframing::HEADER_SIZE + setSize*sizeof(Cplx);
+  vector<char> buf(bytes);
+  vector<double> times;
+  for(size_t s=0; s<numSets+10; s++)
+  {
+    DataSet<Cplx>* set = NULL;
+    in.getWriteData(set, setSize);
+    in.releaseWriteData(set);
+
+    bp::ptime t1(bp::microsec_clock::local_time());
+    comp.process();
+    sink.read(&buf[0], bytes);
+    bp::ptime t2(bp::microsec_clock::local_time());
+    if(s >= 10)
+      times.push_back((t2-t1).total_microseconds());
+  }
+
+  sort(times.begin(), times.end());
+  cout << description << ", " << setSize << " samples per DataSet: latency median "
+       << times[times.size()/2] << " us, p99 " << times[times.size()*99/100] << " us" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+  runThroughput("nodelay", 1024, 20000, true, false);
+  runThroughput("nodelay", 65536, 1000, true, false);
+  runThroughput("cork", 64, 100000, false, true);
+  runThroughput("nodelay", 64, 100000, true, false);
+  runThroughput("nagle", 64, 100000, false, false);
+
+  runLatency("nodelay", 64, 10000, true, false);
+  runLatency("nagle", 64, 10000, false, false);
+  runLatency("nodelay", 16384, 2000, true, false);
+}
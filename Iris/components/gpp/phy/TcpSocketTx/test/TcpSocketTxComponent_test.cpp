@@ -0,0 +1,210 @@
+/**
+ * \file components/gpp/phy/TcpSocketTx/test/UdpSocketRxComponent_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for TcpSocketTx component.
+ */
+
+#define BOOST_TEST_MODULE TcpSocketTxComponent_Test
+
+#include <cstring>
+#include <vector>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "../TcpSocketTxComponent.h"
+#include "utility/DataBufferTrivial.h"
+#include "utility/TcpFraming.h"
+
+using namespace std;
+using namespace iris;
+using namespace iris::phy;
+
+static const int PORT = 50015;
+
+/// A plain server socket to catch what the component sends
+class Receiver
+{
+public:
+  Receiver() : fd_(-1)
+  {
+    listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(PORT);
+    bind(listenFd_, (sockaddr*)&addr, sizeof(addr));
+    listen(listenFd_, 1);
+  }
+  ~Receiver() { close(fd_); close(listenFd_); }
+
+  /// Receive exactly size bytes
+  vector<char> receive(size_t size)
+  {
+    if(fd_ < 0)
+      fd_ = accept(listenFd_, NULL, NULL);
+    vector<char> buf(size);
+    size_t got = 0;
+    while(got < size)
+    {
+      ssize_t n = recv(fd_, &buf[got], size - got, 0);
+      BOOST_REQUIRE(n > 0);
+      got += n;
+    }
+    return buf;
+  }
+
+  /// Is there anything more to receive?
+  bool hasData()
+  {
+    pollfd p = {fd_, POLLIN, 0};
+    return poll(&p, 1, 50) > 0;
+  }
+
+private:
+  int listenFd_;
+  int fd_;
+};
+
+/// Set up a component reading from in
+void startComponent(TcpSocketTxComponent& comp, ReadBufferBase* in, bool framing)
+{
+  comp.setValue("port", PORT);
+  comp.setValue("framing", framing);
+  comp.registerPorts();
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = in->getTypeIdentifier();
+  comp.calculateOutputTypes(iTypes,oTypes);
+  comp.setBuffers(in, NULL);
+  comp.initialize();
+  comp.start();
+}
+
+/// Write a DataSet of n elements, each set to its index plus base
+template<typename T>
+void writeDataSet(DataBufferTrivial<T>& in, size_t n, int base, double timeStamp)
+{
+  DataSet<T>* set = NULL;
+  in.getWriteData(set, n);
+  for(size_t i=0; i<n; i++)
+    set->data[i] = T(base + i);
+  set->timeStamp = timeStamp;
+  set->sampleRate = 1e6;
+  in.releaseWriteData(set);
+}
+
+BOOST_AUTO_TEST_SUITE (TcpSocketTxComponent_Test)
+
+BOOST_AUTO_TEST_CASE(TcpSocketTxComponent_Raw_Test)
+{
+  // The bytes of each DataSet and nothing else
+  Receiver rx;
+  TcpSocketTxComponent comp("test");
+  DataBufferTrivial<uint8_t> in;
+  startComponent(comp, &in, false);
+
+  writeDataSet(in, 100, 0, 0);
+  comp.process();
+  writeDataSet(in, 100, 100, 0);
+  comp.process();
+
+  vector<char> d = rx.receive(200);
+  for(size_t i=0; i<d.size(); i++)
+    BOOST_REQUIRE_EQUAL(uint8_t(d[i]), uint8_t(i));
+  BOOST_CHECK(!rx.hasData());
+  BOOST_CHECK_EQUAL(comp.getSentBytes(), 200u);
+}
+
+BOOST_AUTO_TEST_CASE(TcpSocketTxComponent_Framed_Test)
+{
+  // Each DataSet is preceded by a header with its size and timing
+  typedef complex<float> Cplx;
+  Receiver rx;
+  TcpSocketTxComponent comp("test");
+  comp.setValue("cork", true);
+  DataBufferTrivial<Cplx> in(8);
+  startComponent(comp, &in, true);
+
+  size_t sizes[] = {1000, 0, 100000};
+  for(int d=0; d<3; d++)
+    writeDataSet(in, sizes[d], d, d + 0.5);
+  for(int d=0; d<3; d++)
+    comp.process();
+
+  for(int d=0; d<3; d++)
+  {
+    vector<char> p = rx.receive(tcpframing::HEADER_SIZE);
+    MessageHeader h;
+    BOOST_REQUIRE(tcpframing::readHeader(&p[0], h));
+    BOOST_CHECK_EQUAL(h.type, (uint32_t)TypeInfo<Cplx>::identifier);
+    BOOST_REQUIRE_EQUAL(h.length, sizes[d]*sizeof(Cplx));
+    BOOST_CHECK_EQUAL(h.timeStamp, d + 0.5);
+    BOOST_CHECK_EQUAL(h.sampleRate, 1e6);
+    vector<Cplx> v(sizes[d]);
+    if(h.length > 0)
+    {
+      p = rx.receive(h.length);
+      memcpy(&v[0], &p[0], h.length);
+    }
+    for(size_t i=0; i<v.size(); i++)
+      BOOST_REQUIRE(v[i] == Cplx(d + i));
+  }
+  BOOST_CHECK(!rx.hasData());
+}
+
+BOOST_AUTO_TEST_CASE(TcpSocketTxComponent_Reconnect_Test)
+{
+  // With nobody listening DataSets are dropped, without holding up the flow
+  TcpSocketTxComponent comp("test");
+  DataBufferTrivial<uint8_t> in;
+  startComponent(comp, &in, false);
+  for(int d=0; d<3; d++)
+  {
+    writeDataSet(in, 10, 0, 0);
+    comp.process();
+  }
+  BOOST_CHECK_EQUAL(comp.getSentBytes(), 0u);
+
+  // A second later the component connects again
+  Receiver rx;
+  boost::this_thread::sleep(boost::posix_time::milliseconds(1100));
+  writeDataSet(in, 10, 0, 0);
+  comp.process();
+  rx.receive(10);
+  BOOST_CHECK_EQUAL(comp.getSentBytes(), 10u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,315 @@
+/**
+ * \file components/gpp/phy/TriggerCapture/TriggerCaptureComponent.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ * 
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Implementation of the TriggerCapture component.
+ */
+
+#include "TriggerCaptureComponent.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "irisapi/LibraryDefs.h"
+#include "irisapi/Version.h"
+#include "utility/RawFileUtility.h"
+#include "utility/SpscDataBuffer.h"
+
+using namespace std;
+
+namespace iris
+{
+namespace phy
+{
+
+// export library symbols
+IRIS_COMPONENT_EXPORTS(PhyComponent, TriggerCaptureComponent);
+
+/// Initial number of DataSets whose timing we remember
+static const size_t NUM_BLOCKS = 4096;
+
+/// Number of samples the I/O thread copies and checks at a time
+static const size_t CHUNK_SIZE = 65536;
+
+/// Tolerance (in samples) when converting times to sample indices
+static const double INDEX_TOLERANCE = 1e-6;
+
+TriggerCaptureComponent::TriggerCaptureComponent(string name)
+  : PhyComponent(name,
+                 "triggercapture",
+                 "Captures the samples around trigger events",
+                 "The Iris Project Developers",
+                 "0.1"),
+    blocks_(NUM_BLOCKS),
+    numBlocks_(0),
+    head_(0),
+    reserved_(0),
+    numJobs_(0),
+    ioStop_(false),
+    numCaptures_(0)
+{
+  registerParameter(
+    "length", "Length of the capture ring in seconds",
+    "1.0", false, length_x, Interval<double>(1e-6, 3600));
+  registerParameter(
+    "pretrigger", "Seconds to capture before a trigger",
+    "0.1", true, preTrigger_x, Interval<double>(0, 3600));
+  registerParameter(
+    "posttrigger", "Seconds to capture after a trigger",
+    "0.1", true, postTrigger_x, Interval<double>(0, 3600));
+  registerParameter(
+    "trigger", "Set to a time to capture the samples around it",
+    "-1", true, trigger_x);
+  registerParameter(
+    "filename", "Prefix of the capture files",
+    "capture", false, fileName_x);
+}
+
+TriggerCaptureComponent::~TriggerCaptureComponent()
+{
+  stopThread();
+}
+
+void TriggerCaptureComponent::registerPorts()
+{
+  registerInputPort("input1", TypeInfo< Cplx >::identifier);
+}
+
+void TriggerCaptureComponent::calculateOutputTypes(
+    std::map<std::string,int>& inputTypes,
+    std::map<std::string,int>& outputTypes)
+{
+  //No output
+}
+
+void TriggerCaptureComponent::initialize()
+{
+  stopThread();
+  ring_.clear();
+  numBlocks_ = 0;
+  head_ = 0;
+  reserved_ = 0;
+  triggers_.clear();
+  numJobs_ = 0;
+  ioStop_ = false;
+  numCaptures_ = 0;
+  ioThread_ = boost::thread(&TriggerCaptureComponent::ioLoop, this);
+}
+
+void TriggerCaptureComponent::parameterHasChanged(std::string name)
+{
+  if(name == "trigger")
+    triggers_.push_back(trigger_x);
+}
+
+void TriggerCaptureComponent::process()
+{
+  DataSet<Cplx>* in = NULL;
+  getInputDataSet("input1", in);
+  size_t n = in->data.size();
+
+  //Size the ring from the first sample rate we see
+  if(ring_.empty())
+  {
+    double rate = in->sampleRate > 0 ? in->sampleRate : 1.0;
+    ring_.resize(max(size_t(ceil(length_x*rate)), 2*n));
+    LOG(LDEBUG) << "Capture ring holds " << ring_.size() << " samples.";
+  }
+
+  //Announce the region we are about to overwrite, then copy
+  size_t size = ring_.size();
+  size_t h = head_;
+  if(n > size)
+  {
+    h += n - size;
+    n = size;
+  }
+  spscdetail::storeRelease(reserved_, h + n);
+  spscdetail::fullFence();
+  const Cplx* src = &in->data[in->data.size() - n];
+  size_t pos = h % size;
+  size_t first = min(n, size - pos);
+  memcpy(&ring_[pos], src, first*sizeof(Cplx));
+  memcpy(&ring_[0], src + first, (n - first)*sizeof(Cplx));
+  spscdetail::storeRelease(head_, h + n);
+
+  //Grow the timing history rather than forget a block still in the ring
+  size_t oldest = h + n > size ? h + n - size : 0;
+  if(numBlocks_ >= blocks_.size()
+     && blocks_[(numBlocks_ + 1) % blocks_.size()].first > oldest)
+  {
+    vector<BlockInfo> grown(2*blocks_.size());
+    for(size_t k = numBlocks_ - blocks_.size(); k < numBlocks_; k++)
+      grown[k % grown.size()] = blocks_[k % blocks_.size()];
+    blocks_.swap(grown);
+  }
+
+  BlockInfo& info = blocks_[numBlocks_++ % blocks_.size()];
+  info.first = h;
+  info.sampleRate = in->sampleRate > 0 ? in->sampleRate : 1.0;
+  info.timeStamp = in->timeStamp + (in->data.size() - n)/info.sampleRate;
+
+  releaseInputDataSet("input1", in);
+
+  if(!triggers_.empty())
+    checkTriggers();
+}
+
+bool TriggerCaptureComponent::findIndex(double t, size_t& index)
+{
+  size_t oldest = head_ > ring_.size() ? head_ - ring_.size() : 0;
+  size_t next = head_;
+  size_t k = numBlocks_;
+  for(; k > 0 && numBlocks_ - k < blocks_.size(); k--)
+  {
+    const BlockInfo& b = blocks_[(k-1) % blocks_.size()];
+    double x = (t - b.timeStamp)*b.sampleRate;
+    if(x > -INDEX_TOLERANCE)
+    {
+      //The newest block starting at or before t holds the sample. If t
+      //falls in a gap after it, the first sample after t starts the next
+      //block. After the newest block, the sample has not arrived yet.
+      index = b.first + size_t(ceil(x - INDEX_TOLERANCE));
+      if(k < numBlocks_)
+        index = min(index, next);
+      if(index < oldest)
+      {
+        index = oldest;
+        return false;
+      }
+      return true;
+    }
+    next = b.first;
+    if(b.first <= oldest)
+      break;
+  }
+  index = max(oldest, next);
+  return false;
+}
+
+void TriggerCaptureComponent::checkTriggers()
+{
+  deque<double>::iterator it = triggers_.begin();
+  while(it != triggers_.end())
+  {
+    size_t begin, end;
+    findIndex(*it + postTrigger_x, end);
+    if(end > head_)
+    {
+      ++it;   //Still waiting for the post-trigger samples
+      continue;
+    }
+    if(!findIndex(*it - preTrigger_x, begin))
+      LOG(LWARNING) << "Capture at " << *it << " starts before the oldest sample in the ring.";
+
+    if(begin < end)
+    {
+      stringstream name;
+      name << fileName_x << "_" << numJobs_++ << ".bin";
+      Job job = {begin, end, name.str()};
+      boost::mutex::scoped_lock lock(mutex_);
+      jobs_.push_back(job);
+      cond_.notify_all();
+    }
+    else
+      LOG(LWARNING) << "Capture at " << *it << " is no longer in the ring.";
+    it = triggers_.erase(it);
+  }
+}
+
+void TriggerCaptureComponent::ioLoop()
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  while(true)
+  {
+    while(jobs_.empty() && !ioStop_)
+      cond_.wait(lock);
+    if(jobs_.empty())
+      return;
+
+    Job job = jobs_.front();
+    lock.unlock();
+    writeJob(job);
+    lock.lock();
+    jobs_.pop_front();
+    numCaptures_++;
+  }
+}
+
+void TriggerCaptureComponent::writeJob(const Job& job)
+{
+  ofstream file(job.fileName.c_str(), ios::binary | ios::trunc);
+  if(!file.is_open())
+  {
+    LOG(LERROR) << "Could not open file " << job.fileName << " for writing.";
+    return;
+  }
+
+  size_t size = ring_.size();
+  vector<Cplx> chunk(min(CHUNK_SIZE, job.end - job.begin));
+  for(size_t i = job.begin; i < job.end; i += chunk.size())
+  {
+    size_t n = min(chunk.size(), job.end - i);
+    size_t pos = i % size;
+    size_t first = min(n, size - pos);
+    memcpy(&chunk[0], &ring_[pos], first*sizeof(Cplx));
+    memcpy(&chunk[first], &ring_[0], (n - first)*sizeof(Cplx));
+
+    //If the writer has started overwriting what we copied, stop here
+    spscdetail::fullFence();
+    if(spscdetail::loadAcquire(reserved_) > i + size)
+    {
+      LOG(LWARNING) << "Capture " << job.fileName << " was overwritten and is truncated.";
+      break;
+    }
+    RawFileUtility::writeBlock(&chunk[0], n, file);
+  }
+}
+
+void TriggerCaptureComponent::stopThread()
+{
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    ioStop_ = true;
+    cond_.notify_all();
+  }
+  if(ioThread_.joinable())
+    ioThread_.join();
+}
+
+size_t TriggerCaptureComponent::getNumCaptures()
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  return numCaptures_;
+}
+
+} // namespace phy
+} // namespace iris
@@ -0,0 +1,147 @@
+/**
+ * \file components/gpp/phy/TriggerCapture/TriggerCaptureComponent.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ * 
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * The TriggerCaptureComponent keeps the last few seconds of a complex
+ * signal in memory and writes the samples around trigger events to file.
+ */
+
+#ifndef PHY_TRIGGERCAPTURECOMPONENT_H_
+#define PHY_TRIGGERCAPTURECOMPONENT_H_
+
+#include <complex>
+#include <deque>
+#include <vector>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <irisapi/PhyComponent.h>
+
+namespace iris
+{
+namespace phy
+{
+
+/** The TriggerCaptureComponent records the samples around trigger events.
+ *
+ * Incoming samples are copied into a ring holding the last "length"
+ * seconds, along with the timeStamp and sampleRate of each DataSet.
+ * Setting the dynamic "trigger" parameter to a time T (in the time base of
+ * the input timeStamps, e.g. from a controller reacting to a detection
+ * event) captures every sample with a timestamp in [T-pretrigger,
+ * T+posttrigger). Once the last of those samples has arrived, the window
+ * is handed to a background thread which writes it to
+ * <filename>_<n>.bin (raw native complex<float>), so process() never
+ * waits for the disk.
+ *
+ * The ring has a single writer (process()) and the background thread
+ * reads it without locks. The writer announces the region it is about to
+ * overwrite before touching it, and the reader checks that announcement
+ * after copying each chunk. If the reader falls so far behind that its
+ * data is overwritten, the capture is truncated at that point and a
+ * warning is logged.
+ */
+class TriggerCaptureComponent
+  : public PhyComponent
+{
+ public:
+  typedef std::complex<float> Cplx;
+
+  TriggerCaptureComponent(std::string name);
+  ~TriggerCaptureComponent();
+  virtual void calculateOutputTypes(
+    std::map<std::string, int>& inputTypes,
+    std::map<std::string, int>& outputTypes);
+  virtual void registerPorts();
+  virtual void initialize();
+  virtual void process();
+  virtual void parameterHasChanged(std::string name);
+
+  /// Number of capture files completed so far
+  std::size_t getNumCaptures();
+
+ private:
+  /// Timing of one input DataSet in the ring
+  struct BlockInfo
+  {
+    std::size_t first;      ///< Index of the first sample
+    double timeStamp;       ///< Time of the first sample
+    double sampleRate;      ///< Sample rate of the block
+  };
+
+  /// A window waiting to be written by the background thread
+  struct Job
+  {
+    std::size_t begin;      ///< Index of the first sample to write
+    std::size_t end;        ///< Index after the last sample to write
+    std::string fileName;   ///< File to write to
+  };
+
+  /// Find the index of the first sample at or after time t
+  bool findIndex(double t, std::size_t& index);
+
+  /// Hand any triggers whose windows are complete to the I/O thread
+  void checkTriggers();
+
+  /// Main loop of the I/O thread
+  void ioLoop();
+
+  /// Write one window to file
+  void writeJob(const Job& job);
+
+  /// Finish all jobs and stop the I/O thread
+  void stopThread();
+
+  double length_x;          ///< Length of the ring in seconds
+  double preTrigger_x;      ///< Seconds to capture before a trigger
+  double postTrigger_x;     ///< Seconds to capture after a trigger
+  double trigger_x;         ///< Set to a time to capture around it
+  std::string fileName_x;   ///< Prefix of the capture files
+
+  std::vector<Cplx> ring_;          ///< The samples
+  std::vector<BlockInfo> blocks_;   ///< Timing of the most recent DataSets
+  std::size_t numBlocks_;           ///< Number of DataSets received
+  volatile std::size_t head_;       ///< Number of samples written to the ring
+  volatile std::size_t reserved_;   ///< Samples written or being written
+  std::deque<double> triggers_;     ///< Triggers waiting for their post-trigger samples
+  std::size_t numJobs_;             ///< Number of windows handed to the I/O thread
+
+  boost::thread ioThread_;
+  boost::mutex mutex_;
+  boost::condition_variable cond_;
+  std::deque<Job> jobs_;            ///< Windows waiting to be written
+  bool ioStop_;                     ///< The I/O thread should exit
+  std::size_t numCaptures_;         ///< Windows written
+};
+
+} // namespace phy
+} // namespace iris
+
+#endif // PHY_TRIGGERCAPTURECOMPONENT_H_
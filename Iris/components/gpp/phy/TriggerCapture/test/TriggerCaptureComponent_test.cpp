@@ -0,0 +1,199 @@
+/**
+ * \file components/gpp/phy/TriggerCapture/TriggerCaptureComponent_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ * 
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for TriggerCapture component.
+ */
+
+#define BOOST_TEST_MODULE TriggerCaptureComponent_Test
+
+#include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <boost/thread/thread.hpp>
+
+#include "../TriggerCaptureComponent.h"
+#include "utility/DataBufferTrivial.h"
+
+using namespace std;
+using namespace iris;
+using namespace iris::phy;
+
+typedef complex<float> Cplx;
+
+/// Feeds a ramp (sample n has value n) at 1kHz, by default in blocks of 100 samples
+struct Feeder
+{
+  Feeder(TriggerCaptureComponent& comp, size_t block = 100, double length = 1.0)
+    :comp_(comp), in_(2, true), block_(block), n_(0)
+  {
+    comp_.setValue("length", length);
+    comp_.setValue("filename", "TriggerCapture_test");
+    comp_.registerPorts();
+    map<string, int> iTypes,oTypes;
+    iTypes["input1"] = TypeInfo< Cplx >::identifier;
+    comp_.calculateOutputTypes(iTypes,oTypes);
+    comp_.setBuffers(&in_, NULL);
+    comp_.initialize();
+  }
+
+  /// Feed samples up to (not including) index end
+  void feed(size_t end)
+  {
+    while(n_ < end)
+    {
+      DataSet<Cplx>* set = NULL;
+      in_.getWriteData(set, block_);
+      set->sampleRate = 1000;
+      set->timeStamp = n_/1000.0;
+      for(size_t i=0;i<block_;i++)
+        set->data[i] = Cplx(n_+i, 0);
+      n_ += block_;
+      in_.releaseWriteData(set);
+      comp_.process();
+    }
+  }
+
+  /// Give the I/O thread time to write num captures
+  void wait(size_t num)
+  {
+    for(int i=0;i<1000 && comp_.getNumCaptures() < num;i++)
+      boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+    BOOST_REQUIRE_EQUAL(comp_.getNumCaptures(), num);
+  }
+
+  void trigger(double t)
+  {
+    comp_.setValue("trigger", t);
+    comp_.parameterHasChanged("trigger");
+  }
+
+  TriggerCaptureComponent& comp_;
+  DataBufferTrivial<Cplx> in_;
+  size_t block_;
+  size_t n_;
+};
+
+/// Read a capture file and remove it
+vector<Cplx> readCapture(int num)
+{
+  stringstream name;
+  name << "TriggerCapture_test_" << num << ".bin";
+  ifstream f(name.str().c_str(), ios::binary | ios::ate);
+  vector<Cplx> out(f.good() ? size_t(f.tellg())/sizeof(Cplx) : 0);
+  f.seekg(0);
+  if(!out.empty())
+    f.read(reinterpret_cast<char*>(&out[0]), out.size()*sizeof(Cplx));
+  f.close();
+  remove(name.str().c_str());
+  return out;
+}
+
+/// Check a capture holds exactly the samples [begin, end)
+void checkCapture(int num, size_t begin, size_t end)
+{
+  vector<Cplx> out = readCapture(num);
+  BOOST_REQUIRE_EQUAL(out.size(), end - begin);
+  for(size_t i=0;i<out.size();i++)
+    BOOST_REQUIRE_EQUAL(out[i].real(), float(begin + i));
+}
+
+BOOST_AUTO_TEST_SUITE (TriggerCaptureComponent_Test)
+
+BOOST_AUTO_TEST_CASE(TriggerCaptureComponent_Basic_Test)
+{
+  BOOST_REQUIRE_NO_THROW(TriggerCaptureComponent comp("test"));
+}
+
+BOOST_AUTO_TEST_CASE(TriggerCaptureComponent_Window_Test)
+{
+  TriggerCaptureComponent* comp = new TriggerCaptureComponent("test");
+  comp->setValue("pretrigger", 0.25);
+  comp->setValue("posttrigger", 0.5);
+  {
+    Feeder feeder(*comp);
+
+    // Trigger on a sample time: window [2.25, 3.0) is samples 2250-2999
+    feeder.feed(2600);
+    feeder.trigger(2.5);
+    feeder.feed(2900);
+    BOOST_CHECK_EQUAL(comp->getNumCaptures(), 0u);  // post-trigger not there yet
+
+    // Trigger between samples: window [2.2504, 3.0004) is samples 2251-3000
+    feeder.trigger(2.5004);
+    feeder.feed(3100);
+    feeder.wait(2);
+
+    // Trigger in the future, set before any of its samples arrive
+    feeder.trigger(4.0);
+    feeder.feed(4500);
+    feeder.wait(3);
+    feeder.feed(5000);
+
+    // Trigger older than the ring - nothing to capture
+    feeder.trigger(1.0);
+    feeder.feed(5100);
+
+    // Window [3.8, 4.4) half out of the ring, which holds 4200-5199
+    // when the trigger is processed: samples 4200-4399 only
+    comp->setValue("pretrigger", 0.5);
+    comp->setValue("posttrigger", 0.1);
+    feeder.trigger(4.3);
+    feeder.feed(5200);
+    feeder.wait(4);
+  }
+  delete comp;    // waits for the I/O thread
+
+  checkCapture(0, 2250, 3000);
+  checkCapture(1, 2251, 3001);
+  checkCapture(2, 3750, 4500);
+  checkCapture(3, 4200, 4400);
+  BOOST_CHECK(readCapture(4).empty());
+}
+
+BOOST_AUTO_TEST_CASE(TriggerCaptureComponent_SmallBlocks_Test)
+{
+  // More DataSets in the ring than the initial timing history holds
+  TriggerCaptureComponent* comp = new TriggerCaptureComponent("test");
+  comp->setValue("pretrigger", 0.25);
+  comp->setValue("posttrigger", 0.5);
+  {
+    Feeder feeder(*comp, 1, 10.0);
+    feeder.feed(9000);
+    feeder.trigger(0.5);
+    feeder.feed(9001);
+    feeder.wait(1);
+  }
+  delete comp;
+
+  checkCapture(0, 250, 1000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -33,17 +33,35 @@
 
 #include "UdpSocketRxComponent.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
 #include "irisapi/LibraryDefs.h"
 #include "irisapi/Version.h"
 
 using namespace std;
-using namespace boost::asio::ip;
+namespace bp = boost::posix_time;
 
 namespace iris
 {
 namespace phy
 {
 
+/// Slot size for framed datagrams - the largest UDP payload
+static const size_t MAX_DATAGRAM = 65536;
+
+/// Most lost DataSets to replace with zeros in one go
+static const int32_t MAX_FILL = 64;
+
+/// A datagram further behind than this comes from a restarted sender
+static const int32_t MAX_REORDER = 65536;
+
 // export library symbols
 IRIS_COMPONENT_EXPORTS(PhyComponent, UdpSocketRxComponent);
 
@@ -52,8 +70,28 @@ UdpSocketRxComponent::UdpSocketRxComponent(string name)
                 "udpsocketrx",
                 "A udp socket rx",
                 "Paul Sutton",
-                "0.1")
+                "0.2")
+  ,outputTypeId_(0)
+  ,fd_(-1)
   ,bStopping_(false)
+  ,datagrams_(0)
+  ,warned_(false)
+  ,warnedSize_(false)
+  ,numPackets_(0)
+  ,nextPacket_(0)
+  ,seqValid_(false)
+  ,expected_(0)
+  ,lastValid_(false)
+  ,lastId_(0)
+  ,set_(NULL)
+  ,assembling_(false)
+  ,setId_(0)
+  ,setTotal_(0)
+  ,setReceived_(0)
+  ,released_(0)
+  ,lost_(0)
+  ,reordered_(0)
+  ,incomplete_(0)
 {
   //Register all parameters
   /*
@@ -80,6 +118,42 @@ UdpSocketRxComponent::UdpSocketRxComponent(string name)
                     "uint8_t",
                     false,
                     outputType_x);
+  registerParameter("datasetsize",
+                    "Target size of output DataSets in bytes (0 = one DataSet per datagram)",
+                    "0",
+                    false,
+                    dataSetSize_x);
+  registerParameter("latency",
+                    "Longest time in ms to wait for a DataSet to fill",
+                    "10",
+                    false,
+                    latency_x);
+  registerParameter("batch",
+                    "Maximum number of datagrams to receive per system call",
+                    "32",
+                    false,
+                    batch_x,
+                    Interval<uint32_t>(1, 1024));
+  registerParameter("rcvbuf",
+                    "Socket receive buffer size in bytes (0 = system default)",
+                    "0",
+                    false,
+                    rcvBuf_x);
+  registerParameter("framing",
+                    "Reassemble DataSets from a framed UdpSocketTx?",
+                    "false",
+                    false,
+                    framing_x);
+  registerParameter("zerofill",
+                    "Zero-fill lost data (framing only)?",
+                    "true",
+                    false,
+                    zeroFill_x);
+  registerParameter("maxMessage",
+                    "Largest framed DataSet in bytes - larger ones are discarded (framing only)",
+                    "16777216",
+                    false,
+                    maxMessage_x);
 }
 
 void UdpSocketRxComponent::registerPorts()
@@ -144,32 +218,57 @@ void UdpSocketRxComponent::calculateOutputTypes(
 
 void UdpSocketRxComponent::initialize()
 {
-  //Create our buffer
-  buffer_ = new char[bufferSize_x];
+  closeSocket();
+  datagrams_ = 0;
+  warned_ = false;
+#ifdef MSG_WAITFORONE
+  msgs_.resize(batch_x);
+  iovs_.resize(batch_x);
+#endif
+
+  numPackets_ = nextPacket_ = 0;
+  seqValid_ = lastValid_ = assembling_ = false;
+  set_ = NULL;
+  lost_ = reordered_ = incomplete_ = 0;
+  if(framing_x)
+  {
+    pool_.resize(batch_x * MAX_DATAGRAM);
+    sizes_.resize(batch_x);
+  }
 
   //Create socket
-  try
+  fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+  if(fd_ < 0)
   {
-    socket_ = new boost::asio::ip::udp::socket(ioService_);
+    LOG(LERROR) << "Failed to create socket: " << strerror(errno);
+    return;
   }
-  catch(boost::system::system_error &e)
+
+  if(rcvBuf_x > 0)
   {
-    LOG(LERROR) << "Failed to create socket: " << e.what();
+    //The kernel caps this at net.core.rmem_max (and Linux doubles it)
+    int size = rcvBuf_x;
+    socklen_t len = sizeof(size);
+    setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &size, len);
+    getsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &size, &len);
+    if(size < (int)rcvBuf_x)
+      LOG(LWARNING) << "Asked for a " << rcvBuf_x << " byte receive buffer but got "
+                    << size << " - check net.core.rmem_max";
   }
 }
 
 void UdpSocketRxComponent::start()
 {
-  //Open socket
-  try
-  {
-    socket_->open(udp::v4());
-    socket_->bind(udp::endpoint(udp::v4(), port_x));
-  }
-  catch(boost::system::system_error &e)
-  {
-    LOG(LERROR) << "Failed to open socket: " << e.what();
-  }
+  bStopping_ = false;
+
+  //Bind socket
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port_x);
+  if(fd_ < 0 || bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+    LOG(LERROR) << "Failed to open socket: " << strerror(errno);
 }
 
 void UdpSocketRxComponent::process()
@@ -231,70 +330,422 @@ void UdpSocketRxComponent::process()
 template<typename T>
 void UdpSocketRxComponent::writeOutput()
 {
-  if(!bStopping_)
+  if(framing_x)
+  {
+    writeFramedOutput<T>();
+    return;
+  }
+
+  //Wait for the first datagram before taking a DataSet, so stop() is not held up
+  do
+  {
+    if(bStopping_ || fd_ < 0)
+      return;
+  } while(!waitReadable(100));
+
+  //Room for at least datasetsize bytes, in whole datagrams
+  size_t target = max<size_t>(dataSetSize_x, 1);
+  size_t capacity = (target + bufferSize_x - 1) / bufferSize_x * bufferSize_x;
+
+  //Get the output buffer and receive straight into it
+  WriteBuffer< T >* outBuf = castToType<T>(outputBuffers[0]);
+  DataSet<T>* writeDataSet = NULL;
+  outBuf->getWriteData(writeDataSet, (capacity + sizeof(T) - 1) / sizeof(T));
+  char* dest = reinterpret_cast<char*>(&writeDataSet->data[0]);
+
+  size_t filled = receiveBatch(dest, capacity, sizeof(T));
+  bp::ptime deadline = bp::microsec_clock::universal_time() + bp::milliseconds(latency_x);
+  while(filled < target && capacity - filled >= bufferSize_x && !bStopping_)
+  {
+    bp::time_duration left = deadline - bp::microsec_clock::universal_time();
+    if(left.is_negative())
+      break;
+    if(waitReadable(left.total_milliseconds() + 1))
+      filled += receiveBatch(dest + filled, capacity - filled, sizeof(T));
+  }
+
+  //Hand on what we have
+  writeDataSet->data.resize(filled / sizeof(T));
+  outBuf->releaseWriteData(writeDataSet);
+}
+
+template<typename T>
+void UdpSocketRxComponent::writeFramedOutput()
+{
+  //Handle datagrams until at least one DataSet has gone out and the pool is empty
+  released_ = 0;
+  while(!bStopping_ && fd_ >= 0)
   {
-    //Get data from socket
-    std::size_t size;
-    try
+    if(nextPacket_ < numPackets_)
     {
-      udp::endpoint sender_endpoint;
-      size = socket_->receive_from(boost::asio::buffer(buffer_, bufferSize_x), sender_endpoint);
+      handlePacket<T>(&pool_[nextPacket_ * MAX_DATAGRAM], sizes_[nextPacket_]);
+      nextPacket_++;
+      continue;
     }
-    catch(boost::system::system_error &e)
+    if(released_ > 0)
+      return;
+
+    //Wait for more, but not beyond the deadline of the DataSet being reassembled
+    int timeout = 100;
+    if(assembling_)
     {
-      if(!bStopping_)
+      bp::time_duration left = deadline_ - bp::microsec_clock::universal_time();
+      if(left.is_negative())
       {
-        LOG(LERROR) << "Error receiving from socket: " << e.what();
+        finishDataSet<T>();
+        continue;
       }
-      return;
+      timeout = min<int>(timeout, left.total_milliseconds() + 1);
+    }
+    if(waitReadable(timeout))
+    {
+      numPackets_ = receivePackets();
+      nextPacket_ = 0;
     }
+  }
 
-    //Check that we've an integer number of data types in the datagram
-    float f = size/(float)sizeof(T);
-    float intpart, rem;
-    rem = modf(f, &intpart);
-    if(rem != 0)
+  //Don't leave a DataSet locked
+  if(set_ != NULL)
+  {
+    if(assembling_)
+      finishDataSet<T>();
+    if(set_ != NULL)
     {
-      LOG(LERROR) << "Did not receive an integer number of elements - data will be lost";
+      DataSet<T>* s = static_cast<DataSet<T>*>(set_);
+      s->data.clear();
+      castToType<T>(outputBuffers[0])->releaseWriteData(s);
+      set_ = NULL;
     }
-    int numT = (int)intpart;
+  }
+}
 
-    //Get the output buffer
-    WriteBuffer< T >* outBuf = castToType<T>(outputBuffers[0]);
-    DataSet<T>* writeDataSet = NULL;
-    outBuf->getWriteData(writeDataSet, numT);
+template<typename T>
+void UdpSocketRxComponent::handlePacket(const char* packet, size_t size)
+{
+  FrameHeader h;
+  if(!udpframing::readHeader(packet, size, h)
+     || h.type != (uint32_t)TypeInfo<T>::identifier || h.total % sizeof(T) != 0)
+  {
+    if(!warned_)
+      LOG(LERROR) << "Received a datagram which is not framed " << TypeInfo<T>::name()
+                  << " data - discarding";
+    warned_ = true;
+    return;
+  }
 
-    //Copy data into output
-    T* bufT = (T*)buffer_;
-    copy(bufT, bufT+numT, writeDataSet->data.begin());
+  //A sender which starts again begins with the first fragment of DataSet 0
+  //- or, if that was lost, with datagrams far behind those we have seen.
+  //A duplicate of the very first datagram looks like a restart too, which
+  //costs a repeated DataSet rather than the rest of the stream.
+  if(seqValid_)
+  {
+    uint32_t newest = assembling_ ? setId_ : lastId_;
+    bool first = h.dataSet == 0 && (h.flags & udpframing::FRAME_FIRST);
+    if((first && newest != 0) || udpframing::distance(expected_, h.sequence) < -MAX_REORDER)
+    {
+      LOG(LINFO) << "Sender restarted - starting again from DataSet " << h.dataSet;
+      if(assembling_)
+        finishDataSet<T>();
+      seqValid_ = false;
+      lastValid_ = false;
+    }
+  }
 
-    //Release the buffer
-    outBuf->releaseWriteData(writeDataSet);
+  //Sequence numbers tell us about loss and reordering
+  if(!seqValid_)
+  {
+    expected_ = h.sequence;
+    seqValid_ = true;
   }
+  int32_t gap = udpframing::distance(expected_, h.sequence);
+  if(gap >= 0)
+  {
+    lost_ += gap;
+    expected_ = h.sequence + 1;
+  }
+  else
+  {
+    //Counted as lost when we skipped over it
+    reordered_++;
+    if(lost_ > 0)
+      lost_--;
+  }
+
+  //The DataSet is allocated at the size in the header, which a corrupt or
+  //hostile datagram could set to anything up to 4GiB
+  if(h.total > maxMessage_x)
+  {
+    if(!warnedSize_)
+      LOG(LERROR) << "Received a fragment of a DataSet of " << h.total
+                  << " bytes, more than maxMessage (" << maxMessage_x << ") - discarding";
+    warnedSize_ = true;
+    return;
+  }
+
+  if(assembling_ && h.dataSet != setId_)
+  {
+    if(udpframing::distance(setId_, h.dataSet) < 0)
+      return;   //Too late - the DataSet has been moved past
+    finishDataSet<T>();
+  }
+  if(!assembling_)
+  {
+    if(lastValid_)
+    {
+      int32_t skipped = udpframing::distance(lastId_, h.dataSet) - 1;
+      if(skipped < 0)
+        return; //Too late - the DataSet has been output
+      if(skipped > 0)
+      {
+        incomplete_ += skipped;
+        if(zeroFill_x)
+          fillLost<T>(skipped, h);
+      }
+    }
+    startDataSet<T>(h);
+  }
+
+  //The fragment must fit the DataSet as it was started - a corrupt
+  //datagram or a restarted sender could reuse the id with another size
+  size_t payload = size - udpframing::HEADER_SIZE;
+  if(h.total != setTotal_ || (uint64_t)h.offset + payload > setTotal_)
+  {
+    LOG(LDEBUG) << "Fragment of DataSet " << h.dataSet << " does not fit - discarding";
+    return;
+  }
+
+  //Fragments never overlap, so one that does is a duplicate
+  for(size_t i=0; i<fragments_.size(); i++)
+  {
+    if(h.offset < fragments_[i].first + fragments_[i].second
+       && fragments_[i].first < h.offset + payload)
+      return;
+  }
+
+  DataSet<T>* s = static_cast<DataSet<T>*>(set_);
+  if(payload > 0)
+    memcpy(reinterpret_cast<char*>(&s->data[0]) + h.offset,
+           packet + udpframing::HEADER_SIZE, payload);
+  fragments_.push_back(make_pair(h.offset, (uint32_t)payload));
+  setReceived_ += payload;
+  if(setReceived_ >= setTotal_)
+    finishDataSet<T>();
 }
 
-void UdpSocketRxComponent::stop()
+template<typename T>
+void UdpSocketRxComponent::startDataSet(const FrameHeader& h)
 {
-  //Close socket
-  try
+  //A dropped DataSet is still held - reuse it
+  DataSet<T>* s = static_cast<DataSet<T>*>(set_);
+  if(s == NULL)
+    castToType<T>(outputBuffers[0])->getWriteData(s, h.total / sizeof(T));
+  else
+    s->data.resize(h.total / sizeof(T));
+  s->timeStamp = h.timeStamp;
+  s->sampleRate = h.sampleRate;
+
+  set_ = s;
+  assembling_ = true;
+  setId_ = h.dataSet;
+  setTotal_ = h.total;
+  setReceived_ = 0;
+  fragments_.clear();
+  deadline_ = bp::microsec_clock::universal_time() + bp::milliseconds(latency_x);
+}
+
+template<typename T>
+void UdpSocketRxComponent::finishDataSet()
+{
+  DataSet<T>* s = static_cast<DataSet<T>*>(set_);
+  assembling_ = false;
+  lastValid_ = true;
+  lastId_ = setId_;
+
+  if(setReceived_ < setTotal_)
   {
-    bStopping_ = true;
-    socket_->shutdown(udp::socket::shutdown_receive);
-    socket_->close();
+    incomplete_++;
+    if(!zeroFill_x)
+      return;   //Keep hold of the DataSet for the next one
+
+    //Zero the gaps between the fragments we got
+    char* data = reinterpret_cast<char*>(&s->data[0]);
+    sort(fragments_.begin(), fragments_.end());
+    uint32_t pos = 0;
+    for(size_t i=0; i<fragments_.size(); i++)
+    {
+      if(fragments_[i].first > pos)
+        memset(data + pos, 0, fragments_[i].first - pos);
+      pos = max(pos, fragments_[i].first + fragments_[i].second);
+    }
+    if(setTotal_ > pos)
+      memset(data + pos, 0, setTotal_ - pos);
   }
-  catch(boost::system::system_error &e)
+
+  castToType<T>(outputBuffers[0])->releaseWriteData(s);
+  set_ = NULL;
+  released_++;
+}
+
+template<typename T>
+void UdpSocketRxComponent::fillLost(int32_t num, const FrameHeader& h)
+{
+  if(num > MAX_FILL)
   {
-      LOG(LERROR) << "Failed to close socket: " << e.what();
+    LOG(LWARNING) << "Lost " << num << " DataSets - only replacing the last " << MAX_FILL;
+    num = MAX_FILL;
+  }
+
+  WriteBuffer< T >* outBuf = castToType<T>(outputBuffers[0]);
+  size_t n = h.total / sizeof(T);
+  for(int32_t i=num; i>0; i--)
+  {
+    //Assume the lost DataSets were the same size as this one
+    DataSet<T>* s = static_cast<DataSet<T>*>(set_);
+    if(s == NULL)
+      outBuf->getWriteData(s, n);
+    else
+      s->data.resize(n);
+    memset(reinterpret_cast<char*>(&s->data[0]), 0, n * sizeof(T));
+    s->sampleRate = h.sampleRate;
+    s->timeStamp = h.sampleRate > 0 ? h.timeStamp - i*n/h.sampleRate : h.timeStamp;
+    outBuf->releaseWriteData(s);
+    set_ = NULL;
+    released_++;
   }
 }
 
-UdpSocketRxComponent::~UdpSocketRxComponent()
+size_t UdpSocketRxComponent::receivePackets()
+{
+  size_t num = batch_x;
+
+#ifdef MSG_WAITFORONE
+  for(size_t i=0; i<num; i++)
+  {
+    iovs_[i].iov_base = &pool_[i * MAX_DATAGRAM];
+    iovs_[i].iov_len = MAX_DATAGRAM;
+    memset(&msgs_[i], 0, sizeof(msgs_[i]));
+    msgs_[i].msg_hdr.msg_iov = &iovs_[i];
+    msgs_[i].msg_hdr.msg_iovlen = 1;
+  }
+  int got = recvmmsg(fd_, &msgs_[0], num, MSG_DONTWAIT, NULL);
+  if(got < 0)
+  {
+    if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && !bStopping_)
+      LOG(LERROR) << "Error receiving from socket: " << strerror(errno);
+    return 0;
+  }
+  for(int i=0; i<got; i++)
+    sizes_[i] = msgs_[i].msg_len;
+  datagrams_ += got;
+  return got;
+#else
+  size_t got = 0;
+  for(; got<num; got++)
+  {
+    ssize_t size = recv(fd_, &pool_[got * MAX_DATAGRAM], MAX_DATAGRAM, MSG_DONTWAIT);
+    if(size < 0)
+    {
+      if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && !bStopping_)
+        LOG(LERROR) << "Error receiving from socket: " << strerror(errno);
+      break;
+    }
+    sizes_[got] = size;
+    datagrams_++;
+  }
+  return got;
+#endif
+}
+
+bool UdpSocketRxComponent::waitReadable(int timeout)
 {
-  //Destroy our buffer
-  delete [] buffer_;
+  pollfd p;
+  p.fd = fd_;
+  p.events = POLLIN;
+  p.revents = 0;
+  return fd_ >= 0 && poll(&p, 1, timeout) > 0 && (p.revents & POLLIN);
+}
+
+size_t UdpSocketRxComponent::receiveBatch(char* dest, size_t space, size_t elemSize)
+{
+  size_t num = min<size_t>(batch_x, space / bufferSize_x);
+  size_t filled = 0;
+
+#ifdef MSG_WAITFORONE
+  //Each datagram gets a slot of bufferSize bytes
+  for(size_t i=0; i<num; i++)
+  {
+    iovs_[i].iov_base = dest + i*bufferSize_x;
+    iovs_[i].iov_len = bufferSize_x;
+    memset(&msgs_[i], 0, sizeof(msgs_[i]));
+    msgs_[i].msg_hdr.msg_iov = &iovs_[i];
+    msgs_[i].msg_hdr.msg_iovlen = 1;
+  }
+  int got = recvmmsg(fd_, &msgs_[0], num, MSG_DONTWAIT, NULL);
+  if(got < 0)
+  {
+    if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && !bStopping_)
+      LOG(LERROR) << "Error receiving from socket: " << strerror(errno);
+    return 0;
+  }
 
-  //Destroy socket
-  delete socket_;
+  for(int i=0; i<got; i++)
+  {
+    size_t size = msgs_[i].msg_len;
+    if((msgs_[i].msg_hdr.msg_flags & MSG_TRUNC) || size % elemSize != 0)
+    {
+      if(!warned_)
+        LOG(LERROR) << "Did not receive an integer number of elements - data will be lost";
+      warned_ = true;
+      size -= size % elemSize;
+    }
+    //Close the gap left by a short datagram
+    if(filled != i*bufferSize_x)
+      memmove(dest + filled, dest + i*bufferSize_x, size);
+    filled += size;
+  }
+  datagrams_ += got;
+#else
+  for(size_t i=0; i<num; i++)
+  {
+    ssize_t size = recv(fd_, dest + filled, bufferSize_x, MSG_DONTWAIT);
+    if(size < 0)
+    {
+      if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && !bStopping_)
+        LOG(LERROR) << "Error receiving from socket: " << strerror(errno);
+      break;
+    }
+    if(size % elemSize != 0)
+    {
+      if(!warned_)
+        LOG(LERROR) << "Did not receive an integer number of elements - data will be lost";
+      warned_ = true;
+      size -= size % elemSize;
+    }
+    filled += size;
+    datagrams_++;
+  }
+#endif
+  return filled;
+}
+
+void UdpSocketRxComponent::stop()
+{
+  //Wakes up a blocked receive - process() then sees bStopping_
+  bStopping_ = true;
+  if(fd_ >= 0)
+    shutdown(fd_, SHUT_RD);
+}
+
+void UdpSocketRxComponent::closeSocket()
+{
+  if(fd_ >= 0)
+    close(fd_);
+  fd_ = -1;
+}
+
+UdpSocketRxComponent::~UdpSocketRxComponent()
+{
+  closeSocket();
 }
 
 } // namespace phy
@@ -34,10 +34,13 @@
 #ifndef PHY_UDPSOCKETRXCOMPONENT_H_
 #define PHY_UDPSOCKETRXCOMPONENT_H_
 
-#include "irisapi/PhyComponent.h"
+#include <vector>
+#include <utility>
+#include <sys/socket.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
 
-//For boost asio sockets
-#include <boost/asio.hpp>
+#include "irisapi/PhyComponent.h"
+#include "utility/UdpFraming.h"
 
 namespace iris
 {
@@ -48,6 +51,25 @@ namespace phy
  *
  * The UdpSocketRxComponent receives data from a UDP socket. The port
  * number, buffer size and data type can be set using parameters.
+ *
+ * Datagrams are received in batches (with recvmmsg where available)
+ * straight into the output DataSet. Several datagrams are aggregated into
+ * one DataSet until it holds at least datasetsize bytes or latency ms have
+ * passed since its first datagram arrived. With datasetsize 0 each datagram
+ * goes out in a DataSet of its own. bufferSize is the largest datagram
+ * expected - if datagrams are shorter they are moved down to close the gap.
+ * The socket receive buffer (SO_RCVBUF) can be enlarged to ride out bursts.
+ *
+ * With framing, the datagrams must come from a UdpSocketTxComponent with
+ * framing on (see utility/UdpFraming.h). Each DataSet sent is reassembled
+ * and output with its timeStamp and sampleRate, and datasetsize is ignored.
+ * Lost and reordered datagrams are counted from the sequence numbers. A
+ * DataSet still missing fragments latency ms after it started, or when the
+ * next DataSet starts, is output with the gaps zero-filled if zerofill is
+ * set and dropped otherwise. With zerofill, DataSets lost completely are
+ * replaced by zeros too, so the output stays continuous. DataSets larger
+ * than maxMessage bytes are discarded. When the sender is restarted, its
+ * DataSet and sequence numbers start again from 0 and reassembly follows.
  */
 class UdpSocketRxComponent
   : public PhyComponent
@@ -64,19 +86,94 @@ public:
   virtual void process();
   virtual void stop();
 
+  /// Number of datagrams received so far
+  uint64_t getReceivedDatagrams() const { return datagrams_; }
+  /// Number of datagrams lost so far (framing only)
+  uint64_t getLostDatagrams() const { return lost_; }
+  /// Number of datagrams which arrived out of order so far (framing only)
+  uint64_t getReorderedDatagrams() const { return reordered_; }
+  /// Number of DataSets which were missing data (framing only)
+  uint64_t getIncompleteDataSets() const { return incomplete_; }
+
 private:
   /// Template function to write output.
   template<typename T> void writeOutput();
 
+  /// Template function to reassemble framed DataSets and write them out
+  template<typename T> void writeFramedOutput();
+
+  /// Handle one framed datagram
+  template<typename T> void handlePacket(const char* packet, std::size_t size);
+
+  /// Start reassembling a DataSet
+  template<typename T> void startDataSet(const FrameHeader& h);
+
+  /// Output (or drop) the DataSet being reassembled
+  template<typename T> void finishDataSet();
+
+  /// Output num zero DataSets in place of lost ones before h
+  template<typename T> void fillLost(int32_t num, const FrameHeader& h);
+
+  /// Receive up to a batch of framed datagrams into the packet pool
+  std::size_t receivePackets();
+
+  /// Wait up to timeout ms for the socket to become readable
+  bool waitReadable(int timeout);
+
+  /** Receive up to a batch of waiting datagrams without blocking
+   *
+   * @param dest      Where to put the datagrams (back to back)
+   * @param space     Bytes available at dest
+   * @param elemSize  Size of an output element - datagrams are cut to a multiple
+   * @return          Number of bytes written to dest
+   */
+  std::size_t receiveBatch(char* dest, std::size_t space, std::size_t elemSize);
+
+  /// Close the socket
+  void closeSocket();
+
   unsigned short port_x;      ///< The port to receive from.
   unsigned int bufferSize_x;  ///< Size of the buffer used to receive datagrams.
   std::string outputType_x;   ///< The data type of output data.
+  uint32_t dataSetSize_x;     ///< Target size of output DataSets in bytes (0 = one datagram)
+  uint32_t latency_x;         ///< Longest time in ms a datagram waits for a DataSet to fill
+  uint32_t batch_x;           ///< Maximum datagrams per receive call
+  uint32_t rcvBuf_x;          ///< Socket receive buffer size in bytes (0 = system default)
+  bool framing_x;             ///< Reassemble framed DataSets?
+  bool zeroFill_x;            ///< Zero-fill lost data?
+  uint32_t maxMessage_x;      ///< Largest framed DataSet in bytes
 
   int outputTypeId_;
-  boost::asio::io_service ioService_;
-  boost::asio::ip::udp::socket* socket_;
-  char* buffer_;
-  bool bStopping_;
+  int fd_;                    ///< The socket
+  volatile bool bStopping_;
+  uint64_t datagrams_;        ///< Datagrams received
+  bool warned_;               ///< Have we warned about a bad datagram?
+  bool warnedSize_;           ///< Have we warned about an oversized DataSet?
+#ifdef MSG_WAITFORONE
+  std::vector<struct mmsghdr> msgs_;
+  std::vector<struct iovec> iovs_;
+#endif
+
+  //Framing state
+  std::vector<char> pool_;            ///< Slots for received datagrams
+  std::vector<std::size_t> sizes_;    ///< Size of the datagram in each slot
+  std::size_t numPackets_;            ///< Datagrams in the pool
+  std::size_t nextPacket_;            ///< Next datagram to handle
+  bool seqValid_;                     ///< Have we seen a sequence number?
+  uint32_t expected_;                 ///< Next sequence number expected
+  bool lastValid_;                    ///< Have we output a DataSet?
+  uint32_t lastId_;                   ///< Id of the last DataSet output
+  void* set_;                         ///< The DataSet being reassembled (a DataSet<T>)
+  bool assembling_;                   ///< Is set_ being reassembled?
+  uint32_t setId_;                    ///< Id of the DataSet being reassembled
+  uint32_t setTotal_;                 ///< Its size in bytes
+  uint32_t setReceived_;              ///< Bytes of it received so far, without duplicates
+  std::vector< std::pair<uint32_t, uint32_t> > fragments_;  ///< Offset, size of each fragment
+  boost::posix_time::ptime deadline_; ///< When to give up waiting for fragments
+  std::size_t released_;              ///< DataSets output in this call to process()
+  uint64_t lost_;
+  uint64_t reordered_;
+  uint64_t incomplete_;
 };
 
 } // namespace phy
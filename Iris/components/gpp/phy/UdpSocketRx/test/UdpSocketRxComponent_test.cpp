@@ -0,0 +1,420 @@
+/**
+ * \file components/gpp/phy/UdpSocketRx/test/UdpSocketRxComponent_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for UdpSocketRx component.
+ */
+
+#define BOOST_TEST_MODULE UdpSocketRxComponent_Test
+
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <boost/test/unit_test.hpp>
+
+#include "../UdpSocketRxComponent.h"
+#include "utility/DataBufferTrivial.h"
+#include "utility/UdpSocketTransmitter.h"
+#include "utility/UdpFraming.h"
+
+using namespace std;
+using namespace iris;
+using namespace iris::phy;
+
+static const int PORT = 50011;
+
+/// Set up and start a component writing to out
+void startComponent(UdpSocketRxComponent& comp, WriteBufferBase* out,
+                    string type, string bufferSize, string dataSetSize)
+{
+  comp.setValue("port", PORT);
+  comp.setValue("outputType", type);
+  comp.setValue("bufferSize", bufferSize);
+  comp.setValue("datasetsize", dataSetSize);
+  comp.setValue("latency", 50);
+  comp.setValue("rcvbuf", 1<<20);
+  comp.registerPorts();
+  map<string, int> iTypes,oTypes;
+  comp.calculateOutputTypes(iTypes,oTypes);
+  comp.setBuffers(NULL, out);
+  comp.initialize();
+  comp.start();
+}
+
+/// Send num datagrams of size bytes, each filled with its own index
+void sendDatagrams(UdpSocketTransmitter& tx, size_t num, size_t size)
+{
+  vector<uint8_t> v(size);
+  for(size_t i=0; i<num; i++)
+  {
+    fill(v.begin(), v.end(), uint8_t(i));
+    tx.write(v.begin(), v.end());
+  }
+}
+
+/// Sends framed DataSets of uint16_t the way UdpSocketTx does
+class FramedSender
+{
+public:
+  /// Start at datagram sequence, as a sender which has been running a while
+  explicit FramedSender(uint32_t sequence = 0) : sequence_(sequence), dataSet_(0)
+  {
+    fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    memset(&dest_, 0, sizeof(dest_));
+    dest_.sin_family = AF_INET;
+    dest_.sin_port = htons(PORT);
+    inet_aton("127.0.0.1", &dest_.sin_addr);
+  }
+  ~FramedSender() { close(fd_); }
+
+  /// Send v in fragments of fragment bytes, skipping those flagged in lose
+  void send(const vector<uint16_t>& v, size_t fragment,
+            vector<bool> lose = vector<bool>(), vector<size_t> order = vector<size_t>())
+  {
+    FrameHeader h;
+    h.dataSet = dataSet_++;
+    h.total = v.size()*sizeof(uint16_t);
+    h.type = TypeInfo<uint16_t>::identifier;
+    h.timeStamp = h.dataSet;
+    h.sampleRate = v.size();
+    size_t count = (h.total + fragment - 1) / fragment;
+    for(size_t i=0; i<count; i++)
+      if(order.size() < count)
+        order.push_back(i);
+    lose.resize(count, false);
+
+    for(size_t j=0; j<count; j++)
+    {
+      size_t i = order[j];
+      h.sequence = sequence_ + i;
+      h.offset = i*fragment;
+      h.flags = (i == 0 ? udpframing::FRAME_FIRST : 0) | (i == count-1 ? udpframing::FRAME_LAST : 0);
+      size_t size = min<size_t>(fragment, h.total - h.offset);
+      vector<char> buf(udpframing::HEADER_SIZE + size);
+      udpframing::writeHeader(&buf[0], h);
+      memcpy(&buf[udpframing::HEADER_SIZE], (const char*)&v[0] + h.offset, size);
+      if(!lose[i])
+        sendto(fd_, &buf[0], buf.size(), 0, (sockaddr*)&dest_, sizeof(dest_));
+    }
+    sequence_ += count;
+  }
+
+private:
+  int fd_;
+  sockaddr_in dest_;
+  uint32_t sequence_;
+  uint32_t dataSet_;
+};
+
+/// A DataSet of n elements, each set to its index plus base
+vector<uint16_t> makeData(size_t n, uint16_t base)
+{
+  vector<uint16_t> v(n);
+  for(size_t i=0; i<n; i++)
+    v[i] = base + i;
+  return v;
+}
+
+/// Set up and start a component reassembling framed DataSets
+void startFramed(UdpSocketRxComponent& comp, WriteBufferBase* out, bool zeroFill)
+{
+  comp.setValue("framing", true);
+  comp.setValue("zerofill", zeroFill);
+  startComponent(comp, out, "uint16_t", "1316", "0");
+}
+
+BOOST_AUTO_TEST_SUITE (UdpSocketRxComponent_Test)
+
+BOOST_AUTO_TEST_CASE(UdpSocketRxComponent_Aggregate_Test)
+{
+  UdpSocketRxComponent comp("test");
+  DataBufferTrivial<uint8_t> out;
+  startComponent(comp, &out, "uint8_t", "1316", "13160");
+
+  // 25 datagrams give two full DataSets, the third goes out on the deadline
+  UdpSocketTransmitter tx("127.0.0.1", PORT);
+  sendDatagrams(tx, 25, 1316);
+
+  size_t expected[] = {13160, 13160, 6580};
+  size_t datagram = 0;
+  for(int d=0; d<3; d++)
+  {
+    comp.process();
+    DataSet<uint8_t>* set = NULL;
+    out.getReadData(set);
+    BOOST_REQUIRE_EQUAL(set->data.size(), expected[d]);
+    for(size_t i=0; i<set->data.size(); i+=1316, datagram++)
+      BOOST_REQUIRE(set->data[i] == datagram && set->data[i+1315] == datagram);
+    out.releaseReadData(set);
+  }
+  BOOST_CHECK_EQUAL(comp.getReceivedDatagrams(), 25u);
+  comp.stop();
+}
+
+BOOST_AUTO_TEST_CASE(UdpSocketRxComponent_Short_Test)
+{
+  // Datagrams shorter than bufferSize are packed back to back
+  UdpSocketRxComponent comp("test");
+  DataBufferTrivial<uint16_t> out;
+  startComponent(comp, &out, "uint16_t", "1000", "4000");
+
+  UdpSocketTransmitter tx("127.0.0.1", PORT);
+  sendDatagrams(tx, 10, 300);
+
+  comp.process();
+  DataSet<uint16_t>* set = NULL;
+  out.getReadData(set);
+  BOOST_REQUIRE_EQUAL(set->data.size(), 1500u);
+  for(size_t i=0; i<set->data.size(); i++)
+    BOOST_REQUIRE_EQUAL(set->data[i], (i/150)*0x101);
+  out.releaseReadData(set);
+  comp.stop();
+}
+
+BOOST_AUTO_TEST_CASE(UdpSocketRxComponent_Single_Test)
+{
+  // With no target size each datagram gets a DataSet of its own
+  UdpSocketRxComponent comp("test");
+  DataBufferTrivial<uint8_t> out;
+  startComponent(comp, &out, "uint8_t", "1316", "0");
+
+  UdpSocketTransmitter tx("127.0.0.1", PORT);
+  sendDatagrams(tx, 3, 100);
+
+  for(int d=0; d<3; d++)
+  {
+    comp.process();
+    DataSet<uint8_t>* set = NULL;
+    out.getReadData(set);
+    BOOST_REQUIRE_EQUAL(set->data.size(), 100u);
+    BOOST_CHECK_EQUAL(set->data[0], d);
+    out.releaseReadData(set);
+  }
+
+  // Once stopped, process() returns without output
+  comp.stop();
+  comp.process();
+  BOOST_CHECK(!out.hasData());
+}
+
+BOOST_AUTO_TEST_CASE(UdpSocketRxComponent_Framed_Test)
+{
+  // DataSets come out whole, with their timing, even with reordered fragments
+  UdpSocketRxComponent comp("test");
+  DataBufferTrivial<uint16_t> out(8);
+  startFramed(comp, &out, true);
+
+  FramedSender tx;
+  tx.send(makeData(2500, 0), 1400);
+  size_t order[] = {1, 0, 3, 2};
+  tx.send(makeData(2500, 1000), 1400, vector<bool>(), vector<size_t>(order, order+4));
+
+  for(int d=0; d<2; d++)
+  {
+    if(!out.hasData())
+      comp.process();
+    DataSet<uint16_t>* set = NULL;
+    out.getReadData(set);
+    BOOST_REQUIRE(set->data == makeData(2500, d*1000));
+    BOOST_CHECK_EQUAL(set->timeStamp, d);
+    BOOST_CHECK_EQUAL(set->sampleRate, 2500);
+    out.releaseReadData(set);
+  }
+  BOOST_CHECK_EQUAL(comp.getLostDatagrams(), 0u);
+  BOOST_CHECK_EQUAL(comp.getReorderedDatagrams(), 2u);
+  BOOST_CHECK_EQUAL(comp.getIncompleteDataSets(), 0u);
+  comp.stop();
+}
+
+BOOST_AUTO_TEST_CASE(UdpSocketRxComponent_ZeroFill_Test)
+{
+  // A lost fragment and a lost DataSet are replaced by zeros
+  UdpSocketRxComponent comp("test");
+  DataBufferTrivial<uint16_t> out(8);
+  startFramed(comp, &out, true);
+
+  FramedSender tx;
+  vector<bool> lose(4, false);
+  tx.send(makeData(2500, 0), 1400);
+  lose[1] = true;
+  tx.send(makeData(2500, 1000), 1400, lose);
+  tx.send(makeData(2500, 2000), 1400, vector<bool>(4, true));
+  tx.send(makeData(2500, 3000), 1400);
+
+  vector<uint16_t> expected[4];
+  expected[0] = makeData(2500, 0);
+  expected[1] = makeData(2500, 1000);
+  fill(expected[1].begin()+700, expected[1].begin()+1400, 0);
+  expected[2] = vector<uint16_t>(2500, 0);
+  expected[3] = makeData(2500, 3000);
+
+  for(int d=0; d<4; d++)
+  {
+    if(!out.hasData())
+      comp.process();
+    DataSet<uint16_t>* set = NULL;
+    out.getReadData(set);
+    BOOST_REQUIRE(set->data == expected[d]);
+    BOOST_CHECK_EQUAL(set->timeStamp, d);
+    out.releaseReadData(set);
+  }
+  BOOST_CHECK_EQUAL(comp.getLostDatagrams(), 5u);
+  BOOST_CHECK_EQUAL(comp.getIncompleteDataSets(), 2u);
+  comp.stop();
+}
+
+BOOST_AUTO_TEST_CASE(UdpSocketRxComponent_Duplicate_Test)
+{
+  // Duplicated fragments don't complete a DataSet, and fragments which
+  // don't fit it (here from a restarted sender) are discarded
+  UdpSocketRxComponent comp("test");
+  DataBufferTrivial<uint16_t> out(8);
+  startFramed(comp, &out, true);
+
+  FramedSender tx;
+  size_t order[] = {0, 0, 1, 2};
+  tx.send(makeData(2500, 0), 1400, vector<bool>(), vector<size_t>(order, order+4));
+  FramedSender restarted;
+  restarted.send(makeData(5000, 7), 1400);
+  tx.send(makeData(2500, 1000), 1400);
+
+  vector<uint16_t> expected[2];
+  expected[0] = makeData(2500, 0);
+  fill(expected[0].begin()+2100, expected[0].end(), 0);
+  expected[1] = makeData(2500, 1000);
+
+  for(int d=0; d<2; d++)
+  {
+    if(!out.hasData())
+      comp.process();
+    DataSet<uint16_t>* set = NULL;
+    out.getReadData(set);
+    BOOST_REQUIRE(set->data == expected[d]);
+    out.releaseReadData(set);
+  }
+  BOOST_CHECK_EQUAL(comp.getIncompleteDataSets(), 1u);
+  comp.stop();
+}
+
+BOOST_AUTO_TEST_CASE(UdpSocketRxComponent_Restart_Test)
+{
+  // A restarted sender begins again at DataSet 0. It is recognised by the
+  // first fragment of DataSet 0 or, if that is lost, by the jump back in
+  // sequence numbers.
+  for(int lostFirst=0; lostFirst<2; lostFirst++)
+  {
+    UdpSocketRxComponent comp("test");
+    DataBufferTrivial<uint16_t> out(8);
+    startFramed(comp, &out, true);
+
+    FramedSender tx(lostFirst ? 100000 : 0);
+    for(int d=0; d<3; d++)
+      tx.send(makeData(2500, d*1000), 1400);
+    FramedSender restarted;
+    vector<bool> lose(4, false);
+    lose[0] = lostFirst == 1;
+    restarted.send(makeData(2500, 3000), 1400, lose);
+    restarted.send(makeData(2500, 4000), 1400);
+
+    for(int d=0; d<5; d++)
+    {
+      vector<uint16_t> expected = makeData(2500, d*1000);
+      if(d == 3 && lostFirst)
+        fill(expected.begin(), expected.begin()+700, 0);
+      if(!out.hasData())
+        comp.process();
+      DataSet<uint16_t>* set = NULL;
+      out.getReadData(set);
+      BOOST_REQUIRE(set->data == expected);
+      BOOST_CHECK_EQUAL(set->timeStamp, d < 3 ? d : d-3);
+      out.releaseReadData(set);
+    }
+    BOOST_CHECK(!out.hasData());
+    BOOST_CHECK_EQUAL(comp.getReorderedDatagrams(), 0u);
+    BOOST_CHECK_EQUAL(comp.getIncompleteDataSets(), (uint64_t)lostFirst);
+    comp.stop();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(UdpSocketRxComponent_Oversized_Test)
+{
+  // A DataSet larger than maxMessage is discarded without being allocated
+  UdpSocketRxComponent comp("test");
+  comp.setValue("maxMessage", 4000);
+  DataBufferTrivial<uint16_t> out(8);
+  startFramed(comp, &out, true);
+
+  FramedSender tx;
+  tx.send(makeData(2500, 0), 1400);
+  tx.send(makeData(1000, 1000), 1400);
+
+  comp.process();
+  DataSet<uint16_t>* set = NULL;
+  out.getReadData(set);
+  BOOST_REQUIRE(set->data == makeData(1000, 1000));
+  BOOST_CHECK_EQUAL(set->timeStamp, 1);
+  out.releaseReadData(set);
+  BOOST_CHECK(!out.hasData());
+  BOOST_CHECK_EQUAL(comp.getIncompleteDataSets(), 0u);
+  comp.stop();
+}
+
+BOOST_AUTO_TEST_CASE(UdpSocketRxComponent_Drop_Test)
+{
+  // Without zerofill, incomplete DataSets are dropped - the last one on the deadline
+  UdpSocketRxComponent comp("test");
+  DataBufferTrivial<uint16_t> out(8);
+  startFramed(comp, &out, false);
+
+  FramedSender tx;
+  vector<bool> lose(4, false);
+  lose[3] = true;
+  tx.send(makeData(2500, 0), 1400, lose);
+  tx.send(makeData(2500, 1000), 1400);
+  tx.send(makeData(2500, 2000), 1400, lose);
+
+  comp.process();
+  DataSet<uint16_t>* set = NULL;
+  out.getReadData(set);
+  BOOST_REQUIRE(set->data == makeData(2500, 1000));
+  out.releaseReadData(set);
+  BOOST_CHECK(!out.hasData());
+
+  // The held DataSet is released empty when stopped
+  comp.stop();
+  comp.process();
+  out.getReadData(set);
+  BOOST_CHECK(set->data.empty());
+  out.releaseReadData(set);
+  BOOST_CHECK_EQUAL(comp.getLostDatagrams(), 1u);
+  BOOST_CHECK_EQUAL(comp.getIncompleteDataSets(), 2u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
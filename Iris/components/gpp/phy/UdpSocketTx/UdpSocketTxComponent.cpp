@@ -33,11 +33,16 @@
 
 #include "UdpSocketTxComponent.h"
 
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <arpa/inet.h>
+
 #include "irisapi/LibraryDefs.h"
 #include "irisapi/Version.h"
+#include "utility/UdpFraming.h"
 
 using namespace std;
-using namespace boost::asio::ip;
 
 namespace iris
 {
@@ -52,7 +57,11 @@ UdpSocketTxComponent::UdpSocketTxComponent(string name)
                 "udpsockettx",
                 "A UDP socket tx",
                 "Paul Sutton",
-                "0.1")
+                "0.2")
+  ,fd_(-1)
+  ,sequence_(0)
+  ,dataSet_(0)
+  ,datagrams_(0)
 {
   //Register all parameters
   /*
@@ -74,8 +83,22 @@ UdpSocketTxComponent::UdpSocketTxComponent(string name)
                     "1234",
                     false,
                     port_x);
-  socket_ = NULL;
-  endPoint_ = NULL;
+  registerParameter("framing",
+                    "Frame DataSets with sequence numbers and timing, fragmenting to fit the mtu",
+                    "false",
+                    false,
+                    framing_x);
+  registerParameter("mtu",
+                    "Largest IP packet to send when framing",
+                    "1500",
+                    false,
+                    mtu_x,
+                    Interval<uint32_t>(576, 65535));
+  registerParameter("sndbuf",
+                    "Socket send buffer size in bytes (0 = system default)",
+                    "0",
+                    false,
+                    sndBuf_x);
 }
 
 void UdpSocketTxComponent::registerPorts()
@@ -110,16 +133,31 @@ void UdpSocketTxComponent::calculateOutputTypes(
 
 void UdpSocketTxComponent::initialize()
 {
+  closeSocket();
+  sequence_ = 0;
+  dataSet_ = 0;
+  datagrams_ = 0;
+
+  memset(&dest_, 0, sizeof(dest_));
+  dest_.sin_family = AF_INET;
+  dest_.sin_port = htons(port_x);
+  if(inet_aton(address_x.c_str(), &dest_.sin_addr) == 0)
+  {
+    LOG(LERROR) << "Failed to create socket: bad address " << address_x;
+    return;
+  }
+
   //Create socket
-  try
+  fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+  if(fd_ < 0)
   {
-      socket_ = new boost::asio::ip::udp::socket(ioService_);
-      socket_->open(udp::v4());
-      endPoint_ = new udp::endpoint(address::from_string(address_x), port_x);
+    LOG(LERROR) << "Failed to create socket: " << strerror(errno);
+    return;
   }
-  catch(boost::system::system_error &e)
+  if(sndBuf_x > 0)
   {
-      LOG(LERROR) << "Failed to create socket: " << e.what();
+    int size = sndBuf_x;
+    setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
   }
 }
 
@@ -187,32 +225,104 @@ void UdpSocketTxComponent::writeOutput()
   DataSet<T>* readDataSet = NULL;
   inBuf->getReadData(readDataSet);
 
-  try
+  const char* data = readDataSet->data.empty() ? NULL
+      : reinterpret_cast<const char*>(&readDataSet->data[0]);
+  size_t bytes = readDataSet->data.size()*sizeof(T);
+  if(fd_ >= 0 && framing_x)
   {
-    socket_->send_to(boost::asio::buffer(readDataSet->data), *endPoint_);
+    sendFramed(data, bytes, sizeof(T), TypeInfo<T>::identifier,
+               readDataSet->timeStamp, readDataSet->sampleRate);
   }
-  catch (boost::system::system_error &e)
+  else if(fd_ >= 0)
   {
-    LOG(LERROR) << "An error occurred while sending data to " << address_x << ", port " << port_x << \
-        ": " << e.what();
+    if(sendto(fd_, data, bytes, 0, reinterpret_cast<sockaddr*>(&dest_), sizeof(dest_)) < 0)
+      LOG(LERROR) << "An error occurred while sending data to " << address_x << ", port " << port_x << \
+          ": " << strerror(errno);
+    else
+      datagrams_++;
   }
 
   inBuf->releaseReadData(readDataSet);
 }
 
-UdpSocketTxComponent::~UdpSocketTxComponent()
+void UdpSocketTxComponent::sendFramed(const char* data, size_t bytes, size_t elemSize,
+                                      int type, double timeStamp, double sampleRate)
 {
-  try
+  using namespace udpframing;
+  size_t fragment = fragmentSize(mtu_x, elemSize);
+  size_t count = max<size_t>(1, (bytes + fragment - 1) / fragment);
+  headers_.resize(count*HEADER_SIZE);
+  iovs_.resize(count*2);
+  msgs_.resize(count);
+
+  //Headers point at the DataSet, nothing is copied
+  FrameHeader h;
+  h.dataSet = dataSet_++;
+  h.total = bytes;
+  h.type = type;
+  h.timeStamp = timeStamp;
+  h.sampleRate = sampleRate;
+  for(size_t i=0; i<count; i++)
   {
-    socket_->shutdown(udp::socket::shutdown_send);
-    socket_->close();
+    h.sequence = sequence_++;
+    h.offset = i*fragment;
+    h.flags = (i == 0 ? FRAME_FIRST : 0) | (i == count-1 ? FRAME_LAST : 0);
+    writeHeader(&headers_[i*HEADER_SIZE], h);
+
+    iovs_[2*i].iov_base = &headers_[i*HEADER_SIZE];
+    iovs_[2*i].iov_len = HEADER_SIZE;
+    iovs_[2*i+1].iov_base = const_cast<char*>(data) + h.offset;
+    iovs_[2*i+1].iov_len = min(fragment, bytes - h.offset);
+
+#ifdef MSG_WAITFORONE
+    msghdr& m = msgs_[i].msg_hdr;
+#else
+    msghdr& m = msgs_[i];
+#endif
+    memset(&m, 0, sizeof(m));
+    m.msg_name = &dest_;
+    m.msg_namelen = sizeof(dest_);
+    m.msg_iov = &iovs_[2*i];
+    m.msg_iovlen = 2;
   }
-  catch (boost::system::system_error &e)
+
+  if(!sendMessages(count))
+    LOG(LERROR) << "An error occurred while sending data to " << address_x << ", port " << port_x << \
+        ": " << strerror(errno);
+}
+
+bool UdpSocketTxComponent::sendMessages(size_t count)
+{
+  size_t sent = 0;
+  while(sent < count)
   {
-    LOG(LERROR) << "An error occurred closing socket: " << e.what();
+#ifdef MSG_WAITFORONE
+    int n = sendmmsg(fd_, &msgs_[sent], count - sent, 0);
+#else
+    int n = sendmsg(fd_, &msgs_[sent], 0) < 0 ? -1 : 1;
+#endif
+    if(n < 0)
+    {
+      if(errno == EINTR)
+        continue;
+      return false;
+    }
+    sent += n;
+    datagrams_ += n;
   }
-  delete socket_;
-  delete endPoint_;
+  return true;
+}
+
+void UdpSocketTxComponent::closeSocket()
+{
+  if(fd_ >= 0)
+    close(fd_);
+  fd_ = -1;
+}
+
+UdpSocketTxComponent::~UdpSocketTxComponent()
+{
+  closeSocket();
 }
 
 
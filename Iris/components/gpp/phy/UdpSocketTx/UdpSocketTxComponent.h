@@ -34,10 +34,11 @@
 #ifndef PHY_UDPSOCKETTXCOMPONENT_H_
 #define PHY_UDPSOCKETTXCOMPONENT_H_
 
-#include "irisapi/PhyComponent.h"
+#include <vector>
+#include <sys/socket.h>
+#include <netinet/in.h>
 
-//For boost asio sockets
-#include <boost/asio.hpp>
+#include "irisapi/PhyComponent.h"
 
 namespace iris
 {
@@ -48,6 +49,13 @@ namespace phy
  *
  * The UdpSocketTxComponent transmits data over a UDP socket
  * to a specified IP address and port.
+ *
+ * Without framing each DataSet is sent as one datagram. With framing
+ * (see utility/UdpFraming.h) each DataSet is split into fragments which
+ * fit the mtu, each with a header carrying sequence numbers, timeStamp and
+ * sampleRate, so DataSets of any size can be sent and UdpSocketRxComponent
+ * can reassemble them and detect loss. The fragments of a DataSet are sent
+ * in batches with sendmmsg where available, straight from the DataSet.
  */
 class UdpSocketTxComponent
   : public PhyComponent
@@ -62,17 +70,41 @@ public:
   virtual void initialize();
   virtual void process();
 
+  /// Number of datagrams sent so far
+  uint64_t getSentDatagrams() const { return datagrams_; }
+
 private:
   /// Template function to write output.
   template<typename T> void writeOutput();
 
+  /// Send a DataSet as framed fragments
+  void sendFramed(const char* data, std::size_t bytes, std::size_t elemSize,
+                  int type, double timeStamp, double sampleRate);
+
+  /// Send count prepared messages, return false on error
+  bool sendMessages(std::size_t count);
+
+  /// Close the socket
+  void closeSocket();
+
   std::string address_x;  //!< The IP address to send to
   unsigned short port_x;  //!< The destination port number
+  bool framing_x;         //!< Frame and fragment DataSets?
+  uint32_t mtu_x;         //!< Largest IP packet to send when framing
+  uint32_t sndBuf_x;      //!< Socket send buffer size in bytes (0 = system default)
 
-  boost::asio::io_service ioService_;
-  boost::asio::ip::udp::socket* socket_;
-  boost::asio::ip::udp::endpoint* endPoint_;
-
+  int fd_;                //!< The socket
+  sockaddr_in dest_;      //!< Where we send to
+  uint32_t sequence_;     //!< Sequence number of the next datagram
+  uint32_t dataSet_;      //!< Sequence number of the next DataSet
+  uint64_t datagrams_;    //!< Datagrams sent
+  std::vector<char> headers_;         //!< Headers of the fragments being sent
+  std::vector<struct iovec> iovs_;    //!< Header and data of each fragment
+#ifdef MSG_WAITFORONE
+  std::vector<struct mmsghdr> msgs_;
+#else
+  std::vector<struct msghdr> msgs_;
+#endif
 };
 
 } // namespace phy
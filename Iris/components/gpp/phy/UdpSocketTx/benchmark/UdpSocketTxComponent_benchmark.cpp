@@ -0,0 +1,147 @@
+/**
+ * \file components/gpp/phy/UdpSocketTx/test/UdpSocketRxComponent_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main benchmark file for UdpSocketTx component. Framed DataSets are sent
+ * over loopback to a thread which receives and reassembles them.
+ */
+
+#include "../UdpSocketTxComponent.h"
+#include <cstring>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <boost/thread/thread.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "utility/DataBufferTrivial.h"
+#include "utility/UdpFraming.h"
+
+using namespace std;
+using namespace iris;
+using namespace iris::phy;
+namespace bp = boost::posix_time;
+
+typedef complex<float> Cplx;
+static const int PORT = 50013;
+
+/// Receives framed datagrams and copies them into place, like UdpSocketRx
+struct Reassembler
+{
+  Reassembler(size_t setBytes)
+    :set(setBytes), datagrams(0), bytes(0), stopping(false)
+  {
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    int size = 1<<24;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    timeval tv = {0, 100000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(PORT);
+    bind(fd, (sockaddr*)&addr, sizeof(addr));
+  }
+  ~Reassembler() { close(fd); }
+
+  void operator()()
+  {
+    vector<char> buf(65536);
+    while(!stopping)
+    {
+      ssize_t size = recv(fd, &buf[0], buf.size(), 0);
+      FrameHeader h;
+      if(size <= 0 || !udpframing::readHeader(&buf[0], size, h) || h.total > set.size())
+        continue;
+      memcpy(&set[h.offset], &buf[udpframing::HEADER_SIZE], size - udpframing::HEADER_SIZE);
+      bytes += size - udpframing::HEADER_SIZE;
+      datagrams++;
+    }
+  }
+
+  int fd;
+  vector<char> set;
+  uint64_t datagrams;
+  uint64_t bytes;
+  volatile bool stopping;
+};
+
+/// Send numSets DataSets of setSize samples and print the rates achieved
+void runBenchmark(uint32_t mtu, size_t setSize, size_t numSets)
+{
+  Reassembler rx(setSize*sizeof(Cplx));
+  boost::thread t(boost::ref(rx));
+
+  UdpSocketTxComponent comp("test");
+  comp.setValue("port", PORT);
+  comp.setValue("framing", true);
+  comp.setValue("mtu", mtu);
+  comp.setValue("sndbuf", 1<<22);
+  comp.registerPorts();
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo<Cplx>::identifier;
+  comp.calculateOutputTypes(iTypes,oTypes);
+
+  DataBufferTrivial<Cplx> in(2);
+  comp.setBuffers(&in, NULL);
+  comp.initialize();
+  comp.start();
+
+  bp::ptime t1(bp::microsec_clock::local_time());
+  for(size_t s=0; s<numSets; s++)
+  {
+    DataSet<Cplx>* set = NULL;
+    in.getWriteData(set, setSize);
+    set->timeStamp = s;
+    set->sampleRate = 1e6;
+    in.releaseWriteData(set);
+    comp.process();
+  }
+  bp::ptime t2(bp::microsec_clock::local_time());
+
+  boost::this_thread::sleep(bp::milliseconds(200));
+  rx.stopping = true;
+  t.join();
+  comp.stop();
+
+  double secs = (t2-t1).total_microseconds() / 1e6;
+  double sent = comp.getSentDatagrams();
+  cout << "mtu " << mtu << ", " << setSize << " samples per DataSet: "
+       << setSize*numSets/secs/1e6 << " MS/s sent, "
+       << sent/secs/1e3 << " k datagrams/s, "
+       << rx.bytes/sizeof(Cplx)/secs/1e6 << " MS/s received, "
+       << 100.0*(sent - rx.datagrams)/sent << "% lost" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+  runBenchmark(1500, 16384, 2000);
+  runBenchmark(9000, 16384, 2000);
+  runBenchmark(65535, 16384, 2000);
+}
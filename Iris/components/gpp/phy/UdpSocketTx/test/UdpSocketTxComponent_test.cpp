@@ -0,0 +1,179 @@
+/**
+ * \file components/gpp/phy/UdpSocketTx/test/UdpSocketRxComponent_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for UdpSocketTx component.
+ */
+
+#define BOOST_TEST_MODULE UdpSocketTxComponent_Test
+
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <boost/test/unit_test.hpp>
+
+#include "../UdpSocketTxComponent.h"
+#include "utility/DataBufferTrivial.h"
+#include "utility/UdpFraming.h"
+
+using namespace std;
+using namespace iris;
+using namespace iris::phy;
+
+static const int PORT = 50012;
+
+/// A plain socket to catch what the component sends
+class Receiver
+{
+public:
+  Receiver()
+  {
+    fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    int size = 1<<22;
+    setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    timeval tv = {1, 0};
+    setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(PORT);
+    bind(fd_, (sockaddr*)&addr, sizeof(addr));
+  }
+  ~Receiver() { close(fd_); }
+
+  /// Receive one datagram, empty on timeout
+  vector<char> receive()
+  {
+    vector<char> buf(65536);
+    ssize_t size = recv(fd_, &buf[0], buf.size(), 0);
+    buf.resize(size > 0 ? size : 0);
+    return buf;
+  }
+
+private:
+  int fd_;
+};
+
+/// Set up a component reading from in
+void startComponent(UdpSocketTxComponent& comp, ReadBufferBase* in,
+                    bool framing, uint32_t mtu)
+{
+  comp.setValue("port", PORT);
+  comp.setValue("framing", framing);
+  comp.setValue("mtu", mtu);
+  comp.registerPorts();
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = in->getTypeIdentifier();
+  comp.calculateOutputTypes(iTypes,oTypes);
+  comp.setBuffers(in, NULL);
+  comp.initialize();
+  comp.start();
+}
+
+BOOST_AUTO_TEST_SUITE (UdpSocketTxComponent_Test)
+
+BOOST_AUTO_TEST_CASE(UdpSocketTxComponent_Unframed_Test)
+{
+  // Each DataSet is sent as it is, in one datagram
+  Receiver rx;
+  UdpSocketTxComponent comp("test");
+  DataBufferTrivial<uint8_t> in;
+  startComponent(comp, &in, false, 1500);
+
+  DataSet<uint8_t>* set = NULL;
+  in.getWriteData(set, 1000);
+  for(size_t i=0; i<set->data.size(); i++)
+    set->data[i] = i;
+  in.releaseWriteData(set);
+  comp.process();
+
+  vector<char> d = rx.receive();
+  BOOST_REQUIRE_EQUAL(d.size(), 1000u);
+  for(size_t i=0; i<d.size(); i++)
+    BOOST_REQUIRE_EQUAL(uint8_t(d[i]), uint8_t(i));
+  BOOST_CHECK_EQUAL(comp.getSentDatagrams(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(UdpSocketTxComponent_Framed_Test)
+{
+  // DataSets larger than a datagram are split to fit the mtu
+  typedef complex<float> Cplx;
+  Receiver rx;
+  UdpSocketTxComponent comp("test");
+  DataBufferTrivial<Cplx> in;
+  startComponent(comp, &in, true, 1500);
+
+  size_t n = 20000;
+  size_t fragment = udpframing::fragmentSize(1500, sizeof(Cplx));
+  size_t count = (n*sizeof(Cplx) + fragment - 1) / fragment;
+  BOOST_REQUIRE_EQUAL(fragment, 1432u);
+
+  for(uint32_t d=0; d<2; d++)
+  {
+    DataSet<Cplx>* set = NULL;
+    in.getWriteData(set, n);
+    for(size_t i=0; i<n; i++)
+      set->data[i] = Cplx(i, d);
+    set->timeStamp = 1.5 + d;
+    set->sampleRate = 1e6;
+    in.releaseWriteData(set);
+    comp.process();
+  }
+
+  for(uint32_t d=0; d<2; d++)
+  {
+    vector<Cplx> v(n);
+    for(size_t f=0; f<count; f++)
+    {
+      vector<char> p = rx.receive();
+      FrameHeader h;
+      BOOST_REQUIRE(udpframing::readHeader(&p[0], p.size(), h));
+      BOOST_REQUIRE_LE(p.size() + udpframing::IP_UDP_OVERHEAD, 1500u);
+      BOOST_CHECK_EQUAL(h.sequence, d*count + f);
+      BOOST_CHECK_EQUAL(h.dataSet, d);
+      BOOST_CHECK_EQUAL(h.offset, f*fragment);
+      BOOST_CHECK_EQUAL(h.total, n*sizeof(Cplx));
+      BOOST_CHECK_EQUAL(h.type, (uint32_t)TypeInfo<Cplx>::identifier);
+      BOOST_CHECK_EQUAL(h.timeStamp, 1.5 + d);
+      BOOST_CHECK_EQUAL(h.sampleRate, 1e6);
+      BOOST_CHECK_EQUAL(h.flags, (f == 0 ? udpframing::FRAME_FIRST : 0)
+                                 | (f == count-1 ? udpframing::FRAME_LAST : 0));
+      memcpy((char*)&v[0] + h.offset, &p[udpframing::HEADER_SIZE],
+             p.size() - udpframing::HEADER_SIZE);
+    }
+    for(size_t i=0; i<n; i++)
+      BOOST_REQUIRE(v[i] == Cplx(i, d));
+  }
+  BOOST_CHECK_EQUAL(comp.getSentDatagrams(), 2*count);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
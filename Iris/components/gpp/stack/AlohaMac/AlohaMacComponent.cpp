@@ -30,6 +30,18 @@
  *
  * Implementation of a simple Aloha MAC component.
  *
+ * With window set to 1 the MAC uses stop-and-wait ARQ. With a larger
+ * window up to window DATA frames are in flight at once, lost frames are
+ * retransmitted individually (selective repeat) and the receiver delivers
+ * them upwards in order, with separate sequence numbers for each peer.
+ * In that mode small packets for the same destination can also be
+ * aggregated into one DATA frame, each with its own sequence number and
+ * CRC.
+ *
+ * Frames are sent with a protobuf AlohaPacket header by default, or with
+ * a compact fixed binary header (see MacHeader). Both are understood on
+ * receive.
+ *
  */
 
 #include "irisapi/LibraryDefs.h"
@@ -56,7 +68,7 @@ AlohaMacComponent::AlohaMacComponent(std::string name)
                    "alohamacstackcomponent",
                    "A simple Aloha MAC component",
                    "Andre Puschmann",
-                   "0.1")
+                   "0.2")
   ,txSeqNo_(1)
   ,rxSeqNo_(0)
   ,rxPktBuffer_(10000)
@@ -71,6 +83,14 @@ AlohaMacComponent::AlohaMacComponent(std::string name)
 #endif
   registerParameter("acktimeout", "Time to wait for ACK packets in ms", "100", false, ackTimeout_x);
   registerParameter("maxretry", "Number of retransmissions", "100", false, maxRetry_x);
+  registerParameter("window", "Number of unacknowledged DATA frames (1 = stop-and-wait)", "1", false,
+                    window_x, Interval<int>(1, ARQ_MAX_WINDOW));
+  registerParameter("aggregation", "Max bytes of packets per DATA frame (0 = no aggregation, needs window > 1)", "0", false,
+                    aggregation_x);
+  registerParameter("aggregationdelay", "Max time in ms to wait for more packets to aggregate", "0", false,
+                    aggregationDelay_x);
+  registerParameter("binaryheader", "Send the fixed binary header instead of protobuf", "false", false,
+                    binaryHeader_x);
 }
 
 
@@ -83,17 +103,34 @@ void AlohaMacComponent::initialize()
 {
     maxRetry_x++; // first attempt does not count as retransmission
     // set local address according to user configuration
+    if (!MacAddress::fromString(localAddress_x, localAddress_))
+      throw IrisException("Invalid local address " + localAddress_x + " - expected 12 hex digits.");
+    if (!MacAddress::fromString(destinationAddress_x, destinationAddress_))
+      throw IrisException("Invalid destination address " + destinationAddress_x + " - expected 12 hex digits.");
 #ifdef __unix__
     if (isEthernetDevice_x) {
         LOG(LINFO) << "Trying to retrieve MAC address from " << ethernetDeviceName_x << ".";
-        std::string backup(localAddress_x);
-        if ((NetworkingHelper::getLocalAddress(ethernetDeviceName_x, localAddress_x)) == false) {
+        if ((NetworkingHelper::getLocalAddress(ethernetDeviceName_x, localAddress_)) == false)
             LOG(LERROR) << "Failed! Using local address given by user.";
-            localAddress_x = backup;
-        }
+        else
+            localAddress_x = localAddress_.toString();
     }
 #endif
-    LOG(LINFO) << "Local address is: " << localAddress_x;
+    LOG(LINFO) << "Local address is: " << localAddress_;
+
+    // colliding stations must not pick the same backoffs
+    uint64_t address = localAddress_.toInt();
+    seed_ = uint32_t(address) ^ uint32_t(address >> 32)
+            ^ uint32_t(boost::posix_time::microsec_clock::universal_time().time_of_day().total_microseconds());
+    rng_.seed(seed_);
+
+    if (window_x > 1) {
+      LOG(LINFO) << "Selective repeat ARQ with a window of " << window_x << " frames.";
+    }
+    if (aggregation_x > 0 && window_x <= 1) {
+      LOG(LWARNING) << "Frame aggregation needs a window > 1 - disabled.";
+      aggregation_x = 0;
+    }
 }
 
 
@@ -114,7 +151,12 @@ void AlohaMacComponent::processMessageFromBelow(boost::shared_ptr<StackDataSet>
 void AlohaMacComponent::start()
 {
   rxThread_.reset(new boost::thread(boost::bind( &AlohaMacComponent::rxThreadFunction, this)));
-  txThread_.reset(new boost::thread(boost::bind( &AlohaMacComponent::txThreadFunction, this)));
+  if (window_x > 1) {
+    txThread_.reset(new boost::thread(boost::bind( &AlohaMacComponent::txWindowThreadFunction, this)));
+    retxThread_.reset(new boost::thread(boost::bind( &AlohaMacComponent::retxThreadFunction, this)));
+  } else {
+    txThread_.reset(new boost::thread(boost::bind( &AlohaMacComponent::txThreadFunction, this)));
+  }
 }
 
 void AlohaMacComponent::stop()
@@ -124,6 +166,10 @@ void AlohaMacComponent::stop()
   rxThread_->join();
   txThread_->interrupt();
   txThread_->join();
+  if (retxThread_) {
+    retxThread_->interrupt();
+    retxThread_->join();
+  }
 }
 
 void AlohaMacComponent::rxThreadFunction()
@@ -133,47 +179,63 @@ void AlohaMacComponent::rxThreadFunction()
 
   try
   {
+    std::vector<uint32_t> seqnos;
+    std::vector< boost::shared_ptr<StackDataSet> > subframes;
     while(true)
     {
       boost::this_thread::interruption_point();
 
       boost::shared_ptr<StackDataSet> frame = rxPktBuffer_.popDataSet();
 
-      AlohaPacket newPacket;
-      StackHelper::deserializeAndStripDataset(frame, newPacket);
+      MacHeader header;
+      seqnos.clear();
+      subframes.clear();
+      if (!decodeFrame(frame, header, seqnos, subframes)) {
+        LOG(LWARNING) << "Dropping frame with invalid header.";
+        continue;
+      }
 
       // handle broadcast frames first
-      if (newPacket.type() == AlohaPacket::BROADCAST) {
-          LOG(LINFO) << "Received broadcast packet from " << newPacket.source();
+      if (header.type == AlohaPacket::BROADCAST) {
+          LOG(LINFO) << "Received broadcast packet from " << header.source;
           sendUpwards(frame);
       }
 
       // handle DATA and ACK only if they are for us
-      if (newPacket.destination() == localAddress_x) {
-        switch(newPacket.type()) {
+      if (header.isFor(localAddress_)) {
+        switch(header.type) {
         case AlohaPacket::DATA:
         {
-          LOG(LINFO) << "Got DATA " << newPacket.seqno() << " from " << newPacket.source();
-          sendAckPacket(newPacket.source(), newPacket.seqno());
+          LOG(LINFO) << "Got DATA " << header.seqno << " from " << header.source;
+          if (header.hasTxBase()) {
+            // sender uses selective repeat
+            handleWindowData(header, frame, seqnos, subframes);
+            break;
+          }
+          sendAckPacket(header.source, header.seqno);
 
           // check if packet contains new data
-          if (newPacket.seqno() > rxSeqNo_ || newPacket.seqno() == 1) {
+          if (header.seqno > rxSeqNo_ || header.seqno == 1) {
             // send new data packet up
             sendUpwards(frame);
-            rxSeqNo_ = newPacket.seqno(); // update seqno
-            if (newPacket.seqno() == 1) LOG(LINFO) << "Receiver restart detected.";
+            rxSeqNo_ = header.seqno; // update seqno
+            if (header.seqno == 1) LOG(LINFO) << "Receiver restart detected.";
           }
           break;
         }
         case AlohaPacket::ACK:
         {
-          LOG(LINFO) << "Got ACK  " << newPacket.seqno();
+          LOG(LINFO) << "Got ACK  " << header.seqno;
+          if (window_x > 1) {
+            handleWindowAck(header);
+            break;
+          }
           boost::unique_lock<boost::mutex> lock(seqNoMutex_);
-          if (newPacket.seqno() == txSeqNo_) {
+          if (header.seqno == txSeqNo_) {
             // received right ACK
             lock.unlock();
             ackArrivedCond_.notify_one();
-          } else if (newPacket.seqno() > txSeqNo_) {
+          } else if (header.seqno > txSeqNo_) {
             LOG(LERROR) << "Received future ACK.";
           } else {
             LOG(LERROR) << "Received too old ACK";
@@ -212,26 +274,18 @@ void AlohaMacComponent::txThreadFunction()
       boost::shared_ptr<StackDataSet> frame = txPktBuffer_.popDataSet();
 
       // determine frame source and destination
-      std::string source(localAddress_x);
-      std::string destination(destinationAddress_x);
-#ifdef __unix__
-      if (isEthernetDevice_x) {
-        NetworkingHelper::getAddressFromEthernetFrame(frame, source, destination);
-      }
-#endif
-      bool isBroadcast = (destination == BROADCAST_ADDRESS ? true : false);
+      MacHeader header;
+      getAddresses(frame, header);
+      bool isBroadcast = header.isBroadcast();
 
       boost::unique_lock<boost::mutex> lock(seqNoMutex_);
-      AlohaPacket dataPacket;
-      dataPacket.set_source(source);
-      dataPacket.set_destination(destination);
       if (isBroadcast) {
-          dataPacket.set_type(AlohaPacket::BROADCAST);
+          header.type = AlohaPacket::BROADCAST;
       } else {
-          dataPacket.set_type(AlohaPacket::DATA);
-          dataPacket.set_seqno(txSeqNo_);
+          header.type = AlohaPacket::DATA;
+          header.seqno = txSeqNo_;
       }
-      StackHelper::mergeAndSerializeDataset(frame, dataPacket);
+      encodeFrame(frame, header);
 
       if (isBroadcast) {
           // send to PHY and we are done
@@ -250,9 +304,7 @@ void AlohaMacComponent::txThreadFunction()
               // returns false if timeout was reached
               LOG(LINFO) << "ACK time out for " << txCounter << ". transmission of " << txSeqNo_;
               // wait random time before trying again, here between ackTimeout and 2*ackTimeout
-              int collisionTimeout = rand() % ackTimeout_x;
-              collisionTimeout = std::min(ackTimeout_x + collisionTimeout, 2 * ackTimeout_x);
-              boost::this_thread::sleep(boost::posix_time::milliseconds(collisionTimeout));
+              boost::this_thread::sleep(collisionBackoff(rng_, ackTimeout_x));
             } else {
               // ACK received before timeout
               stop_signal = true;
@@ -280,21 +332,372 @@ void AlohaMacComponent::txThreadFunction()
 }
 
 
-void AlohaMacComponent::sendAckPacket(const string destination, uint32_t seqno)
+void AlohaMacComponent::txWindowThreadFunction()
+{
+  boost::this_thread::sleep(boost::posix_time::seconds(1));
+  LOG(LINFO) << "Tx thread started.";
+
+  try
+  {
+    while(true)
+    {
+      boost::this_thread::interruption_point();
+
+      boost::shared_ptr<StackDataSet> frame;
+      if (pendingFrames_.empty()) {
+        frame = txPktBuffer_.popDataSet();
+      } else {
+        frame = pendingFrames_.front();
+        pendingFrames_.pop_front();
+      }
+
+      MacHeader header;
+      getAddresses(frame, header);
+
+      if (header.isBroadcast()) {
+        header.type = AlohaPacket::BROADCAST;
+        encodeFrame(frame, header);
+        LOG(LINFO) << "Tx BROADCAST";
+        sendDownwards(frame);
+        continue;
+      }
+
+      if (aggregation_x > 0) {
+        txAggregate(frame, header);
+        continue;
+      }
+
+      // wait for room in the window
+      boost::unique_lock<boost::mutex> lock(arqMutex_);
+      ArqSender& sender = arqSender(header.destination);
+      while (sender.isFull())
+        windowOpenCond_.wait(lock);
+
+      header.type = AlohaPacket::DATA;
+      header.seqno = sender.nextSeqNo();
+      header.setTxBase(sender.base());
+      encodeFrame(frame, header);
+      sender.add(frame, boost::posix_time::microsec_clock::universal_time());
+      lock.unlock();
+      timerCond_.notify_one();
+
+      LOG(LINFO) << "Tx DATA  " << header.seqno;
+      sendDownwards(frame);
+    }
+  }
+  catch(IrisException& ex)
+  {
+    LOG(LFATAL) << "Error in AlohaMac component: " << ex.what() << " - Tx thread exiting.";
+  }
+  catch(boost::thread_interrupted)
+  {
+    LOG(LINFO) << "Thread " << boost::this_thread::get_id() << " in stack component interrupted.";
+  }
+}
+
+
+void AlohaMacComponent::retxThreadFunction()
+{
+  try
+  {
+    std::vector< boost::shared_ptr<StackDataSet> > resend;
+    std::vector<uint32_t> seqnos, txBases;
+    boost::unique_lock<boost::mutex> lock(arqMutex_);
+    while(true)
+    {
+      boost::this_thread::interruption_point();
+
+      // sleep until the next retransmission timer of any peer expires
+      boost::posix_time::ptime deadline, next;
+      bool running = false;
+      ArqSenderMap::iterator it;
+      for (it = arqSenders_.begin(); it != arqSenders_.end(); ++it) {
+        if (it->second->nextDeadline(next) && (!running || next < deadline)) {
+          deadline = next;
+          running = true;
+        }
+      }
+      if (running)
+        timerCond_.timed_wait(lock, deadline);
+      else
+        timerCond_.wait(lock);
+
+      boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+      size_t n = 0;
+      for (it = arqSenders_.begin(); it != arqSenders_.end(); ++it) {
+        n += it->second->expire(now, resend, &seqnos);
+        txBases.resize(resend.size(), it->second->base());
+      }
+      if (n > 0)
+        windowOpenCond_.notify_one();
+      if (resend.empty())
+        continue;
+
+      lock.unlock();
+      if (aggregation_x > 0) {
+        resendAggregated(txBases, seqnos, resend);
+      } else {
+        for (size_t i = 0; i < resend.size(); i++) {
+          LOG(LINFO) << "Tx DATA  " << seqnos[i] << " (retransmission)";
+          sendDownwards(resend[i]);
+        }
+      }
+      resend.clear();
+      seqnos.clear();
+      txBases.clear();
+      lock.lock();
+    }
+  }
+  catch(IrisException& ex)
+  {
+    LOG(LFATAL) << "Error in AlohaMac component: " << ex.what() << " - Retransmission thread exiting.";
+  }
+  catch(boost::thread_interrupted)
+  {
+    LOG(LINFO) << "Thread " << boost::this_thread::get_id() << " in stack component interrupted.";
+  }
+}
+
+
+void AlohaMacComponent::getAddresses(boost::shared_ptr<StackDataSet> frame, MacHeader& header)
+{
+  header.source = localAddress_;
+  header.destination = destinationAddress_;
+#ifdef __unix__
+  if (isEthernetDevice_x)
+    NetworkingHelper::getAddressFromEthernetFrame(*frame, header.source, header.destination);
+#endif
+}
+
+
+void AlohaMacComponent::encodeFrame(boost::shared_ptr<StackDataSet> frame, const MacHeader& header)
+{
+  if (binaryHeader_x) {
+    header.push(*frame);
+  } else {
+    AlohaPacket packet;
+    header.toProtobuf(packet);
+    StackHelper::mergeAndSerializeDataset(frame, packet);
+  }
+}
+
+
+bool AlohaMacComponent::decodeFrame(boost::shared_ptr<StackDataSet> frame, MacHeader& header,
+                                    std::vector<uint32_t>& seqnos,
+                                    std::vector< boost::shared_ptr<StackDataSet> >& subframes)
+{
+  size_t bad = 0;
+  if (MacHeader::isBinary(*frame)) {
+    if (!header.pull(*frame))
+      return false;
+    if (header.subframes > 0)
+      bad = FrameAggregation::split(header, frame, seqnos, subframes);
+  } else {
+    AlohaPacket packet;
+    if (!StackHelper::deserializeAndStripDataset(frame, packet) || !header.fromProtobuf(packet))
+      return false;
+    if (header.subframes > 0)
+      bad = FrameAggregation::split(packet, frame, seqnos, subframes);
+  }
+  if (bad > 0)
+    LOG(LINFO) << "Dropped " << bad << " of " << int(header.subframes) << " subframes with bad CRC.";
+  return true;
+}
+
+
+void AlohaMacComponent::txAggregate(boost::shared_ptr<StackDataSet> frame, const MacHeader& header)
+{
+  // collect queued packets for the same destination, up to aggregation_x bytes
+  std::vector< boost::shared_ptr<StackDataSet> > subframes(1, frame);
+  size_t bytes = frame->data.size();
+  boost::posix_time::ptime deadline = boost::posix_time::microsec_clock::universal_time()
+                                      + boost::posix_time::milliseconds(aggregationDelay_x);
+  while (subframes.size() < size_t(window_x)) {
+    boost::shared_ptr<StackDataSet> next;
+    if (!pendingFrames_.empty()) {
+      next = pendingFrames_.front();
+      pendingFrames_.pop_front();
+    } else if (!txPktBuffer_.isEmpty()) {
+      next = txPktBuffer_.popDataSet();
+    } else if (boost::posix_time::microsec_clock::universal_time() < deadline) {
+      boost::this_thread::sleep(boost::posix_time::microseconds(100));
+      continue;
+    } else {
+      break;
+    }
+
+    MacHeader nextHeader;
+    getAddresses(next, nextHeader);
+    if (!nextHeader.isFor(header.destination) || bytes + next->data.size() > size_t(aggregation_x)) {
+      pendingFrames_.push_front(next);
+      break;
+    }
+    subframes.push_back(next);
+    bytes += next->data.size();
+  }
+
+  boost::unique_lock<boost::mutex> lock(arqMutex_);
+  ArqSender& sender = arqSender(header.destination);
+  while (sender.isFull())
+    windowOpenCond_.wait(lock);
+
+  // whatever does not fit into the window goes into the next frame
+  while (subframes.size() > sender.space()) {
+    pendingFrames_.push_front(subframes.back());
+    subframes.pop_back();
+  }
+
+  MacHeader aggregate(header);
+  aggregate.setTxBase(sender.base());
+  std::vector<uint32_t> seqnos;
+  boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+  for (size_t i = 0; i < subframes.size(); i++) {
+    seqnos.push_back(sender.nextSeqNo());
+    sender.add(subframes[i], now);
+  }
+  lock.unlock();
+  timerCond_.notify_one();
+
+  sendAggregate(aggregate, seqnos, subframes);
+}
+
+
+void AlohaMacComponent::resendAggregated(const std::vector<uint32_t>& txBases, const std::vector<uint32_t>& seqnos,
+                                         const std::vector< boost::shared_ptr<StackDataSet> >& subframes)
+{
+  size_t i = 0;
+  while (i < subframes.size()) {
+    MacHeader header;
+    getAddresses(subframes[i], header);
+    header.setTxBase(txBases[i]);
+    std::vector<uint32_t> groupSeqnos(1, seqnos[i]);
+    std::vector< boost::shared_ptr<StackDataSet> > group(1, subframes[i]);
+    size_t bytes = subframes[i]->data.size();
+
+    for (i++; i < subframes.size(); i++) {
+      MacHeader nextHeader;
+      getAddresses(subframes[i], nextHeader);
+      if (!nextHeader.isFor(header.destination) || bytes + subframes[i]->data.size() > size_t(aggregation_x))
+        break;
+      groupSeqnos.push_back(seqnos[i]);
+      group.push_back(subframes[i]);
+      bytes += subframes[i]->data.size();
+    }
+    sendAggregate(header, groupSeqnos, group);
+  }
+}
+
+
+void AlohaMacComponent::sendAggregate(MacHeader& header, const std::vector<uint32_t>& seqnos,
+                                      const std::vector< boost::shared_ptr<StackDataSet> >& subframes)
+{
+  boost::shared_ptr<StackDataSet> frame;
+  if (binaryHeader_x) {
+    frame = FrameAggregation::merge(header, seqnos, subframes);
+  } else {
+    AlohaPacket packet;
+    header.toProtobuf(packet);
+    frame = FrameAggregation::merge(packet, seqnos, subframes);
+  }
+
+  LOG(LINFO) << "Tx DATA  " << seqnos.front() << " (" << seqnos.size() << " subframes)";
+  sendDownwards(frame);
+}
+
+
+void AlohaMacComponent::handleWindowData(const MacHeader& header, boost::shared_ptr<StackDataSet> frame,
+                                         const std::vector<uint32_t>& seqnos,
+                                         const std::vector< boost::shared_ptr<StackDataSet> >& subframes)
+{
+  ArqReceiver& receiver = arqReceiver(header.source);
+  std::vector< boost::shared_ptr<StackDataSet> > deliver;
+  bool restart = false;
+  if (header.subframes > 0) {
+    // aggregated frame
+    for (size_t i = 0; i < subframes.size(); i++)
+      restart |= receiver.receive(seqnos[i], header.txbase, subframes[i], deliver);
+  } else {
+    restart = receiver.receive(header.seqno, header.txbase, frame, deliver);
+  }
+  if (restart)
+    LOG(LINFO) << "Sender restart detected for " << header.source << ".";
+  sendSelectiveAckPacket(header.source, receiver.cumulativeAck(), receiver.selectiveAck());
+
+  for (size_t i = 0; i < deliver.size(); i++)
+    sendUpwards(deliver[i]);
+}
+
+
+void AlohaMacComponent::handleWindowAck(const MacHeader& header)
+{
+  boost::unique_lock<boost::mutex> lock(arqMutex_);
+  ArqSenderMap::iterator it = arqSenders_.find(header.source);
+  if (it == arqSenders_.end() || it->second->isEmpty()) {
+    LOG(LINFO) << "Ignoring ACK from " << header.source << " - no frames outstanding.";
+    return;
+  }
+  size_t n;
+  if (header.hasSack())
+    n = it->second->ack(header.seqno, header.sack);
+  else
+    n = it->second->ackOne(header.seqno); // stop-and-wait receiver
+  lock.unlock();
+  if (n > 0)
+    windowOpenCond_.notify_one();
+}
+
+
+ArqSender& AlohaMacComponent::arqSender(const MacAddress& peer)
+{
+  // called with arqMutex_ held
+  boost::shared_ptr<ArqSender>& sender = arqSenders_[peer];
+  if (!sender)
+    sender.reset(new ArqSender(window_x, maxRetry_x, ackTimeout_x, seed_ ^ uint32_t(hash_value(peer))));
+  return *sender;
+}
+
+
+ArqReceiver& AlohaMacComponent::arqReceiver(const MacAddress& peer)
+{
+  boost::shared_ptr<ArqReceiver>& receiver = arqReceivers_[peer];
+  if (!receiver)
+    receiver.reset(new ArqReceiver);
+  return *receiver;
+}
+
+
+void AlohaMacComponent::sendAckPacket(const MacAddress& destination, uint32_t seqno)
 {
-  AlohaPacket ackPacket;
-  ackPacket.set_source(localAddress_x);
-  ackPacket.set_destination(destination);
-  ackPacket.set_type(AlohaPacket::ACK);
-  ackPacket.set_seqno(seqno);
+  MacHeader ack;
+  ack.source = localAddress_;
+  ack.destination = destination;
+  ack.type = AlohaPacket::ACK;
+  ack.seqno = seqno;
 
   boost::shared_ptr<StackDataSet> buffer(new StackDataSet);
-  StackHelper::mergeAndSerializeDataset(buffer, ackPacket);
+  encodeFrame(buffer, ack);
   //StackHelper::printDataset(buffer, "ACK Tx");
 
   sendDownwards(buffer);
   LOG(LINFO) << "Tx  ACK  " << seqno;
 }
 
+
+void AlohaMacComponent::sendSelectiveAckPacket(const MacAddress& destination, uint32_t cumulative, uint64_t sack)
+{
+  MacHeader ack;
+  ack.source = localAddress_;
+  ack.destination = destination;
+  ack.type = AlohaPacket::ACK;
+  ack.seqno = cumulative;
+  ack.setSack(sack);
+
+  boost::shared_ptr<StackDataSet> buffer(new StackDataSet);
+  encodeFrame(buffer, ack);
+
+  sendDownwards(buffer);
+  LOG(LINFO) << "Tx  ACK  " << cumulative << " sack " << std::hex << sack;
+}
+
 } // namespace stack
 } // namespace iris
@@ -30,6 +30,17 @@
  *
  * Implementation of a simple Aloha MAC component.
  *
+ * With window set to 1 the MAC uses stop-and-wait ARQ. With a larger
+ * window up to window DATA frames are in flight at once, lost frames are
+ * retransmitted individually (selective repeat) and the receiver delivers
+ * them upwards in order, with separate sequence numbers for each peer.
+ * In that mode small packets for the same destination can also be
+ * aggregated into one DATA frame.
+ *
+ * Frames are sent with a protobuf AlohaPacket header by default, or with
+ * a compact fixed binary header (see MacHeader). Both are understood on
+ * receive.
+ *
  */
 
 #ifndef STACK_ALOHAMACCOMPONENT_H_
@@ -37,9 +48,12 @@
 
 #include "irisapi/StackComponent.h"
 #include <stdio.h>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/unordered_map.hpp>
 #include "alohamac.pb.h"
-
-#define BROADCAST_ADDRESS "ffffffffffff"
+#include "SelectiveRepeatArq.h"
+#include "FrameAggregation.h"
+#include "MacHeader.h"
 
 namespace iris
 {
@@ -68,21 +82,57 @@ private:
   std::string ethernetDeviceName_x;   ///< Name of the Ethernet device to use (e.g. tap0)
   int ackTimeout_x;                   ///< Time to wait for ACK packets (ms)
   int maxRetry_x;                     ///< Number of retransmissions
+  int window_x;                       ///< Number of unacknowledged DATA frames (1 = stop-and-wait)
+  int aggregation_x;                  ///< Max bytes of packets per DATA frame (0 = no aggregation)
+  int aggregationDelay_x;             ///< Max time to wait for more packets to aggregate (ms)
+  bool binaryHeader_x;                ///< Send the fixed binary header instead of protobuf
 
   // local variables
+  MacAddress localAddress_;
+  MacAddress destinationAddress_;
   StackDataBuffer rxPktBuffer_, txPktBuffer_;
   uint32_t txSeqNo_;          ///< sequence number of outgoing data packets
   uint32_t rxSeqNo_;          ///< sequence number of incoming data packets
   boost::condition_variable ackArrivedCond_;
   boost::mutex seqNoMutex_;
+  uint32_t seed_;             ///< seed of the random backoffs, differs between nodes
+  boost::mt19937 rng_;        ///< random backoff for stop-and-wait
+
+  // selective repeat (window > 1), one sender and receiver per peer
+  typedef boost::unordered_map< MacAddress, boost::shared_ptr<ArqSender> > ArqSenderMap;
+  typedef boost::unordered_map< MacAddress, boost::shared_ptr<ArqReceiver> > ArqReceiverMap;
+  ArqSenderMap arqSenders_;
+  ArqReceiverMap arqReceivers_; ///< only used by the rx thread
+  boost::mutex arqMutex_;       ///< protects arqSenders_
+  boost::condition_variable windowOpenCond_;
+  boost::condition_variable timerCond_;
+  std::deque< boost::shared_ptr<StackDataSet> > pendingFrames_; ///< popped but not sent yet, tx thread only
 
   // thread pointers
-  boost::scoped_ptr< boost::thread > rxThread_, txThread_;
+  boost::scoped_ptr< boost::thread > rxThread_, txThread_, retxThread_;
 
   // private functions
-  void sendAckPacket(const std::string destination, uint32_t seqno);
+  void encodeFrame(boost::shared_ptr<StackDataSet> frame, const MacHeader& header);
+  bool decodeFrame(boost::shared_ptr<StackDataSet> frame, MacHeader& header, std::vector<uint32_t>& seqnos,
+                   std::vector< boost::shared_ptr<StackDataSet> >& subframes);
+  void sendAckPacket(const MacAddress& destination, uint32_t seqno);
+  void sendSelectiveAckPacket(const MacAddress& destination, uint32_t cumulative, uint64_t sack);
+  void getAddresses(boost::shared_ptr<StackDataSet> frame, MacHeader& header);
+  void txAggregate(boost::shared_ptr<StackDataSet> frame, const MacHeader& header);
+  ArqSender& arqSender(const MacAddress& peer);
+  ArqReceiver& arqReceiver(const MacAddress& peer);
+  void resendAggregated(const std::vector<uint32_t>& txBases, const std::vector<uint32_t>& seqnos,
+                        const std::vector< boost::shared_ptr<StackDataSet> >& subframes);
+  void sendAggregate(MacHeader& header, const std::vector<uint32_t>& seqnos,
+                     const std::vector< boost::shared_ptr<StackDataSet> >& subframes);
+  void handleWindowData(const MacHeader& header, boost::shared_ptr<StackDataSet> frame,
+                        const std::vector<uint32_t>& seqnos,
+                        const std::vector< boost::shared_ptr<StackDataSet> >& subframes);
+  void handleWindowAck(const MacHeader& header);
   void rxThreadFunction();
   void txThreadFunction();
+  void txWindowThreadFunction();
+  void retxThreadFunction();
 };
 
 } // namespace stack
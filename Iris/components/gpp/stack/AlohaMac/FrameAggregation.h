@@ -0,0 +1,222 @@
+/**
+ * \file components/gpp/stack/AlohaMac/FrameAggregation.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Packing of several upper-layer packets into one AlohaMac DATA frame,
+ * with a protobuf or a binary header.
+ */
+
+#ifndef STACK_FRAMEAGGREGATION_H_
+#define STACK_FRAMEAGGREGATION_H_
+
+#include <string>
+#include <vector>
+#include <boost/crc.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "irisapi/StackDataBuffer.h"
+#include "utility/StackHelper.h"
+#include "alohamac.pb.h"
+#include "MacHeader.h"
+
+namespace iris
+{
+namespace stack
+{
+
+/** Static functions to build and split aggregated AlohaMac DATA frames.
+ *
+ * With a protobuf header each subframe is carried as its own payload, so
+ * protobuf provides the length delimiters, and the subseqno and subcrc
+ * fields hold the sequence number and the CRC-32 of each payload. With a
+ * binary header the same is held in the subframe descriptors (see
+ * MacHeader). A subframe
+ * which fails its CRC is dropped on its own and can be retransmitted on
+ * its own, while the others are delivered.
+ */
+class FrameAggregation
+{
+public:
+  typedef boost::shared_ptr<StackDataSet> Frame;
+
+  /// CRC-32 of a subframe
+  static uint32_t crc(const std::deque<uint8_t>& data)
+  {
+    boost::crc_32_type crc;
+    for(std::deque<uint8_t>::const_iterator it = data.begin(); it != data.end(); ++it)
+      crc.process_byte(*it);
+    return crc.checksum();
+  }
+
+  /** Build an aggregated DATA frame
+   *
+   * @param packet      Header with source, destination and txbase set
+   * @param seqnos      Sequence number of each subframe
+   * @param subframes   The subframes, which are not changed
+   * @return            The serialized frame
+   */
+  static Frame merge(AlohaPacket& packet, const std::vector<uint32_t>& seqnos,
+                     const std::vector<Frame>& subframes)
+  {
+    std::size_t n = subframes.size();
+    packet.set_type(AlohaPacket::DATA);
+    packet.set_seqno(seqnos[0]);
+    for(std::size_t i=0; i<n; i++)
+    {
+      packet.add_subseqno(seqnos[i]);
+      packet.add_subcrc(crc(subframes[i]->data));
+    }
+    // the last subframe becomes the payload added by StackHelper
+    for(std::size_t i=0; i+1<n; i++)
+      packet.add_payload(std::string(subframes[i]->data.begin(), subframes[i]->data.end()));
+
+    Frame frame(new StackDataSet(*subframes[n-1]));
+    StackHelper::mergeAndSerializeDataset(frame, packet);
+    return frame;
+  }
+
+  /** Build an aggregated DATA frame with a binary header
+   *
+   * @param header      Header with source, destination and txbase set
+   * @param seqnos      Sequence number of each subframe
+   * @param subframes   The subframes, which are not changed
+   * @return            The serialized frame
+   */
+  static Frame merge(MacHeader& header, const std::vector<uint32_t>& seqnos,
+                     const std::vector<Frame>& subframes)
+  {
+    std::size_t n = subframes.size();
+    header.type = AlohaPacket::DATA;
+    header.seqno = seqnos[0];
+    header.subframes = n;
+
+    Frame frame(new StackDataSet);
+    uint8_t buf[MacHeader::SIZE];
+    header.write(buf);
+    frame->data.insert(frame->data.end(), buf, buf + MacHeader::SIZE);
+    for(std::size_t i=0; i<n; i++)
+    {
+      MacHeader::put32(buf, seqnos[i]);
+      MacHeader::put32(buf + 4, subframes[i]->data.size());
+      MacHeader::put32(buf + 8, crc(subframes[i]->data));
+      frame->data.insert(frame->data.end(), buf, buf + MacHeader::DESCRIPTOR_SIZE);
+    }
+    for(std::size_t i=0; i<n; i++)
+      frame->data.insert(frame->data.end(), subframes[i]->data.begin(), subframes[i]->data.end());
+    return frame;
+  }
+
+  /** Split an aggregated DATA frame
+   *
+   * @param packet      Header as parsed by StackHelper::deserializeAndStripDataset()
+   * @param frame       The frame as left by StackHelper::deserializeAndStripDataset()
+   * @param seqnos      Sequence number of each good subframe is appended
+   * @param subframes   Each good subframe is appended
+   * @return            Number of subframes dropped because of a bad CRC
+   */
+  static std::size_t split(const AlohaPacket& packet, Frame frame,
+                           std::vector<uint32_t>& seqnos, std::vector<Frame>& subframes)
+  {
+    int n = packet.subseqno_size();
+    if(packet.subcrc_size() != n)
+      return n;
+
+    // a single payload has been stripped into the frame already
+    bool stripped = (n == 1 && packet.payload_size() == 0);
+    if(!stripped && packet.payload_size() != n)
+      return n;
+
+    std::size_t bad = 0;
+    for(int i=0; i<n; i++)
+    {
+      Frame sub(frame);
+      if(!stripped)
+      {
+        const std::string& p = packet.payload(i);
+        sub.reset(new StackDataSet);
+        sub->data.assign(p.begin(), p.end());
+      }
+      if(crc(sub->data) != packet.subcrc(i))
+      {
+        bad++;
+        continue;
+      }
+      seqnos.push_back(packet.subseqno(i));
+      subframes.push_back(sub);
+    }
+    return bad;
+  }
+
+  /** Split an aggregated DATA frame with a binary header
+   *
+   * @param header      Header as read by MacHeader::pull()
+   * @param frame       The frame after MacHeader::pull()
+   * @param seqnos      Sequence number of each good subframe is appended
+   * @param subframes   Each good subframe is appended
+   * @return            Number of subframes dropped because of a bad CRC
+   */
+  static std::size_t split(const MacHeader& header, Frame frame,
+                           std::vector<uint32_t>& seqnos, std::vector<Frame>& subframes)
+  {
+    std::size_t n = header.subframes;
+    std::size_t size = frame->data.size();
+    std::size_t offset = n * MacHeader::DESCRIPTOR_SIZE;
+    if(size < offset)
+      return n;
+
+    uint8_t desc[255 * MacHeader::DESCRIPTOR_SIZE];
+    std::copy(frame->data.begin(), frame->data.begin() + offset, desc);
+
+    std::size_t bad = 0;
+    for(std::size_t i=0; i<n; i++)
+    {
+      const uint8_t* d = desc + i * MacHeader::DESCRIPTOR_SIZE;
+      std::size_t length = MacHeader::get32(d + 4);
+      if(length > size - offset)
+        return bad + n - i;
+
+      Frame sub(new StackDataSet);
+      sub->data.assign(frame->data.begin() + offset, frame->data.begin() + offset + length);
+      offset += length;
+      if(crc(sub->data) != MacHeader::get32(d + 8))
+      {
+        bad++;
+        continue;
+      }
+      seqnos.push_back(MacHeader::get32(d));
+      subframes.push_back(sub);
+    }
+    return bad;
+  }
+};
+
+} // namespace stack
+} // namespace iris
+
+#endif // STACK_FRAMEAGGREGATION_H_
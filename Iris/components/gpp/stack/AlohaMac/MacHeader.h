@@ -0,0 +1,245 @@
+/**
+ * \file components/gpp/stack/AlohaMac/MacHeader.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * The header of an AlohaMac frame and its fixed-layout binary format.
+ */
+
+#ifndef STACK_MACHEADER_H_
+#define STACK_MACHEADER_H_
+
+#include <algorithm>
+#include <string>
+#include <boost/cstdint.hpp>
+
+#include "irisapi/StackDataBuffer.h"
+#include "utility/MacAddress.h"
+#include "utility/PacketBuffer.h"
+#include "alohamac.pb.h"
+
+namespace iris
+{
+namespace stack
+{
+
+/** The header of an AlohaMac frame.
+ *
+ * The header can be sent as a protobuf AlohaPacket or in a fixed binary
+ * layout, which is read and written without any allocation. All binary
+ * fields are in network byte order:
+ *
+ *   offset  size  field
+ *        0     1  magic (0xa5)
+ *        1     1  type (AlohaPacket::PacketType)
+ *        2     1  flags (HAS_TXBASE, HAS_SACK)
+ *        3     1  number of subframes (0 if not aggregated)
+ *        4     6  destination address
+ *       10     6  source address
+ *       16     4  seqno
+ *       20     4  txbase
+ *       24     8  sack
+ *
+ * In an aggregated frame the header is followed by one descriptor per
+ * subframe - seqno (4), length (4) and CRC-32 (4) - and then the subframes.
+ *
+ * A serialized AlohaPacket starts with the tag of its source field (0x0a),
+ * so a receiver can tell the two formats apart by the first byte.
+ */
+struct MacHeader
+{
+  enum
+  {
+    MAGIC = 0xa5,           ///< First byte of a binary header
+    SIZE = 32,              ///< Size of the binary header
+    DESCRIPTOR_SIZE = 12    ///< Size of a subframe descriptor
+  };
+
+  enum Flags
+  {
+    HAS_TXBASE = 0x01,  ///< txbase is valid (sender uses selective repeat)
+    HAS_SACK = 0x02     ///< sack is valid (receiver uses selective repeat)
+  };
+
+  uint8_t type;
+  uint8_t flags;
+  uint8_t subframes;
+  MacAddress destination;
+  MacAddress source;
+  uint32_t seqno;
+  uint32_t txbase;
+  uint64_t sack;
+
+  MacHeader()
+    :type(AlohaPacket::DATA), flags(0), subframes(0), seqno(0), txbase(0), sack(0)
+  {}
+
+  bool hasTxBase() const { return (flags & HAS_TXBASE) != 0; }
+  bool hasSack() const { return (flags & HAS_SACK) != 0; }
+  void setTxBase(uint32_t t) { txbase = t; flags |= HAS_TXBASE; }
+  void setSack(uint64_t s) { sack = s; flags |= HAS_SACK; }
+
+  /// Is this frame for the given address?
+  bool isFor(const MacAddress& address) const
+  {
+    return destination == address;
+  }
+
+  /// Is this frame for everybody?
+  bool isBroadcast() const
+  {
+    return destination.isBroadcast();
+  }
+
+  /// Write the binary header to p, which must hold SIZE bytes
+  void write(uint8_t* p) const
+  {
+    p[0] = MAGIC;
+    p[1] = type;
+    p[2] = flags;
+    p[3] = subframes;
+    destination.write(p + 4);
+    source.write(p + 10);
+    put32(p + 16, seqno);
+    put32(p + 20, txbase);
+    put32(p + 24, uint32_t(sack >> 32));
+    put32(p + 28, uint32_t(sack));
+  }
+
+  /// Read the binary header from p, which must hold SIZE bytes
+  bool read(const uint8_t* p)
+  {
+    if(p[0] != MAGIC || p[1] > AlohaPacket::PacketType_MAX)
+      return false;
+    type = p[1];
+    flags = p[2];
+    subframes = p[3];
+    destination = MacAddress(p + 4);
+    source = MacAddress(p + 10);
+    seqno = get32(p + 16);
+    txbase = get32(p + 20);
+    sack = (uint64_t(get32(p + 24)) << 32) | get32(p + 28);
+    return true;
+  }
+
+  /// Prepend the binary header to a packet
+  void push(PacketBuffer& packet) const
+  {
+    write(packet.push(SIZE));
+  }
+
+  /// Read and remove the binary header of a packet
+  bool pull(PacketBuffer& packet)
+  {
+    if(packet.size() < SIZE || !read(packet.data()))
+      return false;
+    packet.pull(SIZE);
+    return true;
+  }
+
+  /// Prepend the binary header to a StackDataSet
+  void push(StackDataSet& frame) const
+  {
+    uint8_t buf[SIZE];
+    write(buf);
+    frame.data.insert(frame.data.begin(), buf, buf + SIZE);
+  }
+
+  /// Read and remove the binary header of a StackDataSet
+  bool pull(StackDataSet& frame)
+  {
+    if(frame.data.size() < SIZE)
+      return false;
+    uint8_t buf[SIZE];
+    std::copy(frame.data.begin(), frame.data.begin() + SIZE, buf);
+    if(!read(buf))
+      return false;
+    frame.data.erase(frame.data.begin(), frame.data.begin() + SIZE);
+    return true;
+  }
+
+  /// Does a received frame start with a binary header?
+  static bool isBinary(const StackDataSet& frame)
+  {
+    return !frame.data.empty() && frame.data.front() == MAGIC;
+  }
+
+  /// Fill an AlohaPacket with this header
+  void toProtobuf(AlohaPacket& packet) const
+  {
+    packet.set_source(source.toString());
+    packet.set_destination(destination.toString());
+    packet.set_type(AlohaPacket::PacketType(type));
+    if(type != AlohaPacket::BROADCAST)
+      packet.set_seqno(seqno);
+    if(hasTxBase())
+      packet.set_txbase(txbase);
+    if(hasSack())
+      packet.set_sack(sack);
+  }
+
+  /// Fill this header from an AlohaPacket, false if an address is malformed
+  bool fromProtobuf(const AlohaPacket& packet)
+  {
+    if(!MacAddress::fromString(packet.source(), source) ||
+       !MacAddress::fromString(packet.destination(), destination))
+      return false;
+    type = packet.type();
+    flags = 0;
+    subframes = std::min(packet.subseqno_size(), 255);
+    seqno = packet.seqno();
+    txbase = 0;
+    sack = 0;
+    if(packet.has_txbase())
+      setTxBase(packet.txbase());
+    if(packet.has_sack())
+      setSack(packet.sack());
+    return true;
+  }
+
+  /// Write a big-endian 32 bit value
+  static void put32(uint8_t* p, uint32_t x)
+  {
+    p[0] = uint8_t(x >> 24);
+    p[1] = uint8_t(x >> 16);
+    p[2] = uint8_t(x >> 8);
+    p[3] = uint8_t(x);
+  }
+
+  /// Read a big-endian 32 bit value
+  static uint32_t get32(const uint8_t* p)
+  {
+    return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | p[3];
+  }
+
+};
+
+} // namespace stack
+} // namespace iris
+
+#endif // STACK_MACHEADER_H_
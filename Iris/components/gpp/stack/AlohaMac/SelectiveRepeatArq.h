@@ -0,0 +1,387 @@
+/**
+ * \file components/gpp/stack/AlohaMac/SelectiveRepeatArq.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Sender and receiver state for the selective-repeat ARQ mode of the
+ * AlohaMac component. Neither class locks or sleeps - the component
+ * threads do that and pass the current time in.
+ */
+
+#ifndef STACK_SELECTIVEREPEATARQ_H_
+#define STACK_SELECTIVEREPEATARQ_H_
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int.hpp>
+#include <boost/random/variate_generator.hpp>
+
+#include "irisapi/StackDataBuffer.h"
+
+namespace iris
+{
+namespace stack
+{
+
+/// Largest supported window - one bit per frame in the selective ACK bitmap
+static const uint32_t ARQ_MAX_WINDOW = 64;
+
+/// Serial number comparison, a < b taking wrap-around into account
+inline bool seqBefore(uint32_t a, uint32_t b)
+{
+  return int32_t(a - b) < 0;
+}
+
+/** Random time to wait before retransmitting after an ACK timeout.
+ *
+ * Returns a value between ackTimeout and 2*ackTimeout so that colliding
+ * stations do not retransmit at the same time again.
+ */
+inline boost::posix_time::time_duration collisionBackoff(boost::mt19937& rng, int ackTimeout)
+{
+  boost::uniform_int<int> dist(0, std::max(ackTimeout - 1, 0));
+  return boost::posix_time::milliseconds(ackTimeout + dist(rng));
+}
+
+/** Sender side of selective-repeat ARQ.
+ *
+ * Holds up to window frames which have been sent but not yet acknowledged,
+ * each with its own retransmission timer. Frames leave the window when
+ * they are acknowledged or after maxTx transmissions. With a window of 1
+ * this is the classic stop-and-wait scheme.
+ */
+class ArqSender
+{
+public:
+  typedef boost::shared_ptr<StackDataSet> Frame;
+
+  /** Create a sender
+   *
+   * @param window      Max number of unacknowledged frames (1..ARQ_MAX_WINDOW)
+   * @param maxTx       Max number of transmissions of a frame
+   * @param ackTimeout  Time to wait for an ACK in ms
+   * @param seed        Seed of the random backoff, should differ between nodes
+   */
+  ArqSender(uint32_t window, uint32_t maxTx, int ackTimeout, uint32_t seed = 5489u)
+    :windowSize_(std::min(std::max(window, 1u), ARQ_MAX_WINDOW))
+    ,maxTx_(std::max(maxTx, 1u))
+    ,ackTimeout_(ackTimeout)
+    ,base_(1)
+    ,rng_(seed)
+    ,givenUp_(0)
+    ,retransmissions_(0)
+  {}
+
+  /// Is the window full?
+  bool isFull() const { return window_.size() >= windowSize_; }
+  /// Number of frames which can be added before the window is full
+  std::size_t space() const { return windowSize_ - window_.size(); }
+  /// Are all sent frames acknowledged?
+  bool isEmpty() const { return window_.empty(); }
+  /// Sequence number of the oldest frame in the window (or the next one)
+  uint32_t base() const { return base_; }
+  /// Sequence number the next frame will get
+  uint32_t nextSeqNo() const { return base_ + window_.size(); }
+  /// Number of frames dropped after maxTx transmissions
+  uint64_t getGivenUp() const { return givenUp_; }
+  /// Number of retransmissions
+  uint64_t getRetransmissions() const { return retransmissions_; }
+
+  /** Add a frame which has just been sent with seqno nextSeqNo()
+   *
+   * @param frame   The frame as sent, kept for retransmission
+   * @param now     The time it was sent
+   */
+  void add(Frame frame, boost::posix_time::ptime now)
+  {
+    Entry e;
+    e.frame = frame;
+    e.deadline = now + boost::posix_time::milliseconds(ackTimeout_);
+    e.txCount = 1;
+    e.acked = false;
+    e.backoff = false;
+    window_.push_back(e);
+  }
+
+  /** Handle a cumulative ACK with selective ACK bitmap
+   *
+   * @param cumulative  All frames up to and including this one were received
+   * @param sack        Bit i set: frame cumulative+2+i was received
+   * @return            Number of frames which left the window
+   */
+  std::size_t ack(uint32_t cumulative, uint64_t sack)
+  {
+    for(std::size_t i=0; i<window_.size(); i++)
+    {
+      uint32_t seqno = base_ + i;
+      if(!seqBefore(cumulative, seqno))
+        window_[i].acked = true;
+      else
+      {
+        uint32_t bit = seqno - cumulative - 2;
+        if(bit < 64 && (sack >> bit) & 1)
+          window_[i].acked = true;
+      }
+    }
+    return slide();
+  }
+
+  /** Handle an ACK for a single frame
+   *
+   * @param seqno   The acknowledged frame
+   * @return        Number of frames which left the window
+   */
+  std::size_t ackOne(uint32_t seqno)
+  {
+    uint32_t i = seqno - base_;
+    if(i < window_.size())
+      window_[i].acked = true;
+    return slide();
+  }
+
+  /// Get the time of the next timer expiry, false if no timer is running
+  bool nextDeadline(boost::posix_time::ptime& deadline) const
+  {
+    bool found = false;
+    for(std::size_t i=0; i<window_.size(); i++)
+    {
+      if(window_[i].acked)
+        continue;
+      if(!found || window_[i].deadline < deadline)
+        deadline = window_[i].deadline;
+      found = true;
+    }
+    return found;
+  }
+
+  /** Run the retransmission timers
+   *
+   * A frame whose ACK timer expires waits a random backoff (see
+   * collisionBackoff()) and is then retransmitted, or dropped if it
+   * has been sent maxTx times already.
+   *
+   * @param now     The current time
+   * @param resend  Frames which are due for retransmission are appended
+   * @param seqnos  If given, their sequence numbers are appended
+   * @return        Number of frames which left the window
+   */
+  std::size_t expire(boost::posix_time::ptime now, std::vector<Frame>& resend,
+                     std::vector<uint32_t>* seqnos = NULL)
+  {
+    for(std::size_t i=0; i<window_.size(); i++)
+    {
+      Entry& e = window_[i];
+      if(e.acked || now < e.deadline)
+        continue;
+      if(e.backoff)
+      {
+        resend.push_back(e.frame);
+        if(seqnos)
+          seqnos->push_back(base_ + i);
+        e.txCount++;
+        e.backoff = false;
+        e.deadline = now + boost::posix_time::milliseconds(ackTimeout_);
+        retransmissions_++;
+      }
+      else if(e.txCount >= maxTx_)
+      {
+        // Give up - the receiver learns about it from base() in later frames
+        e.acked = true;
+        e.frame.reset();
+        givenUp_++;
+      }
+      else
+      {
+        e.backoff = true;
+        e.deadline = now + collisionBackoff(rng_, ackTimeout_);
+      }
+    }
+    return slide();
+  }
+
+private:
+  struct Entry
+  {
+    Frame frame;
+    boost::posix_time::ptime deadline;
+    uint32_t txCount;
+    bool acked;
+    bool backoff;   ///< Timer is running the backoff, not the ACK timeout
+  };
+
+  /// Remove acknowledged frames from the front of the window
+  std::size_t slide()
+  {
+    std::size_t n = 0;
+    while(!window_.empty() && window_.front().acked)
+    {
+      window_.pop_front();
+      base_++;
+      n++;
+    }
+    return n;
+  }
+
+  uint32_t windowSize_;
+  uint32_t maxTx_;
+  int ackTimeout_;
+  uint32_t base_;             ///< Sequence number of window_.front()
+  std::deque<Entry> window_;  ///< Sent frames, oldest first
+  boost::mt19937 rng_;
+  uint64_t givenUp_;
+  uint64_t retransmissions_;
+};
+
+/** Receiver side of selective-repeat ARQ.
+ *
+ * Frames which arrive out of order are held in a reorder buffer until the
+ * gap before them is filled, so they are delivered upwards in order. Every
+ * DATA frame carries the sender's window base - frames before it will
+ * never be retransmitted, so the receiver stops waiting for them.
+ */
+class ArqReceiver
+{
+public:
+  typedef boost::shared_ptr<StackDataSet> Frame;
+
+  ArqReceiver()
+    :next_(1)
+    ,buffered_(0)
+    ,slots_(ARQ_MAX_WINDOW)
+  {}
+
+  /** Handle a received DATA frame
+   *
+   * @param seqno     Sequence number of the frame
+   * @param txBase    Window base of the sender when it sent the frame
+   * @param frame     The frame (header already stripped)
+   * @param deliver   Frames which can now be sent upwards are appended, in order
+   * @return          True if txBase shows that the sender has restarted
+   */
+  bool receive(uint32_t seqno, uint32_t txBase, Frame frame, std::vector<Frame>& deliver)
+  {
+    bool restart = false;
+    // A running sender is never more than a window behind us, and one
+    // which starts again sends frame 1 with a window base of 1. That is
+    // also what a retransmission of frame 1 looks like if all its ACKs
+    // were lost - the frame is then delivered twice, which is better than
+    // stalling a restarted sender.
+    if(seqBefore(txBase, next_ - ARQ_MAX_WINDOW) || (seqno == 1 && txBase == 1 && next_ != 1))
+    {
+      reset(txBase);
+      restart = true;
+    }
+    // The sender gave up on everything before txBase
+    if(seqBefore(next_, txBase))
+    {
+      if(txBase - next_ >= ARQ_MAX_WINDOW)
+      {
+        flush(deliver);
+        next_ = txBase;
+      }
+      while(next_ != txBase)
+        advance(deliver);
+    }
+
+    uint32_t offset = seqno - next_;
+    if(offset < ARQ_MAX_WINDOW)
+    {
+      Frame& slot = slots_[seqno % ARQ_MAX_WINDOW];
+      if(!slot)
+      {
+        slot = frame;
+        buffered_++;
+      }
+      while(slots_[next_ % ARQ_MAX_WINDOW])
+        advance(deliver);
+    }
+    return restart;
+  }
+
+  /// All frames up to and including this one have been received
+  uint32_t cumulativeAck() const { return next_ - 1; }
+
+  /// Bit i set: frame cumulativeAck()+2+i is in the reorder buffer
+  uint64_t selectiveAck() const
+  {
+    uint64_t sack = 0;
+    if(buffered_ == 0)
+      return sack;
+    for(uint32_t i=0; i<ARQ_MAX_WINDOW-1; i++)
+      if(slots_[(next_ + 1 + i) % ARQ_MAX_WINDOW])
+        sack |= uint64_t(1) << i;
+    return sack;
+  }
+
+  /// Number of frames waiting in the reorder buffer
+  std::size_t getBuffered() const { return buffered_; }
+
+private:
+  /// Move next_ on by one, delivering the frame in its slot if there is one
+  void advance(std::vector<Frame>& deliver)
+  {
+    Frame& slot = slots_[next_ % ARQ_MAX_WINDOW];
+    if(slot)
+    {
+      deliver.push_back(slot);
+      slot.reset();
+      buffered_--;
+    }
+    next_++;
+  }
+
+  /// Deliver everything in the reorder buffer
+  void flush(std::vector<Frame>& deliver)
+  {
+    for(uint32_t i=0; i<ARQ_MAX_WINDOW && buffered_ > 0; i++)
+      advance(deliver);
+  }
+
+  /// Start again at seqno, dropping the reorder buffer
+  void reset(uint32_t seqno)
+  {
+    for(uint32_t i=0; i<ARQ_MAX_WINDOW; i++)
+      slots_[i].reset();
+    buffered_ = 0;
+    next_ = seqno;
+  }
+
+  uint32_t next_;             ///< Next sequence number to deliver
+  std::size_t buffered_;      ///< Number of frames in slots_
+  std::vector<Frame> slots_;  ///< Reorder buffer, indexed by seqno % ARQ_MAX_WINDOW
+};
+
+} // namespace stack
+} // namespace iris
+
+#endif // STACK_SELECTIVEREPEATARQ_H_
@@ -0,0 +1,168 @@
+/**
+ * \file components/gpp/stack/AlohaMac/benchmark/FrameAggregation_benchmark.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Goodput of small-packet traffic with and without AlohaMac frame
+ * aggregation over an emulated link. Every PHY frame costs a fixed
+ * preamble/header time plus its bytes at the PHY rate. Bit errors are
+ * applied to the serialized frames: a plain frame with an error is lost
+ * (as if dropped by the PHY CRC), an aggregated frame loses only the
+ * subframes which fail their CRC. Lost packets are sent again in the next
+ * frame; ACKs are not modelled.
+ */
+
+#include <iostream>
+#include <set>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/bernoulli_distribution.hpp>
+#include <boost/random/uniform_int.hpp>
+#include "FrameAggregation.h"
+
+using namespace std;
+using namespace iris;
+using namespace iris::stack;
+
+typedef boost::shared_ptr<StackDataSet> Frame;
+
+/// Flip bits with the given bit error rate, return number of flips
+size_t corrupt(Frame frame, double ber, boost::mt19937& rng)
+{
+  boost::bernoulli_distribution<> hit(8 * ber);
+  boost::uniform_int<> bit(0, 7);
+  size_t flips = 0;
+  for(size_t i=0; i<frame->data.size(); i++)
+  {
+    if(hit(rng))
+    {
+      frame->data[i] ^= 1 << bit(rng);
+      flips++;
+    }
+  }
+  return flips;
+}
+
+/** Send numPackets packets, return goodput in Mbit/s
+ *
+ * @param packetSize    Size of each upper-layer packet
+ * @param aggregation   Max bytes per frame, 0 for no aggregation
+ * @param ber           Bit error rate
+ */
+double run(size_t packetSize, size_t aggregation, double ber, uint32_t numPackets)
+{
+  const double overhead = 250e-6;   // preamble and header symbols
+  const double rate = 12e6;         // PHY bit rate
+  boost::mt19937 rng(42);
+
+  deque< pair<uint32_t, Frame> > queue;
+  uint32_t offered = 0, delivered = 0;
+  double airtime = 0;
+
+  while(delivered < numPackets)
+  {
+    // take lost packets first, then new ones
+    vector<uint32_t> seqnos;
+    vector<Frame> subframes;
+    size_t bytes = 0;
+    while(subframes.empty() || (aggregation > 0 && bytes + packetSize <= aggregation))
+    {
+      if(queue.empty() && offered < numPackets)
+        queue.push_back(make_pair(++offered, Frame(new StackDataSet)));
+      if(queue.empty())
+        break;
+      queue.front().second->data.assign(packetSize, uint8_t(queue.front().first));
+      seqnos.push_back(queue.front().first);
+      subframes.push_back(queue.front().second);
+      queue.pop_front();
+      bytes += packetSize;
+    }
+
+    AlohaPacket header;
+    header.set_source("f009e090e90e");
+    header.set_destination("00f0f0f0f0f0");
+    header.set_txbase(1);
+    Frame frame;
+    if(aggregation == 0)
+    {
+      frame.reset(new StackDataSet(*subframes[0]));
+      header.set_type(AlohaPacket::DATA);
+      header.set_seqno(seqnos[0]);
+      StackHelper::mergeAndSerializeDataset(frame, header);
+    }
+    else
+    {
+      frame = FrameAggregation::merge(header, seqnos, subframes);
+    }
+    airtime += overhead + frame->data.size() * 8 / rate;
+
+    // see what gets through
+    set<uint32_t> good;
+    size_t flips = corrupt(frame, ber, rng);
+    AlohaPacket packet;
+    if(aggregation == 0)
+    {
+      if(flips == 0)
+        good.insert(seqnos[0]);
+    }
+    else if(StackHelper::deserializeAndStripDataset(frame, packet))
+    {
+      vector<uint32_t> okSeqnos;
+      vector<Frame> ok;
+      FrameAggregation::split(packet, frame, okSeqnos, ok);
+      good.insert(okSeqnos.begin(), okSeqnos.end());
+    }
+    delivered += good.size();
+    for(size_t i=subframes.size(); i>0; i--)
+      if(good.count(seqnos[i-1]) == 0)
+        queue.push_front(make_pair(seqnos[i-1], subframes[i-1]));
+  }
+  return numPackets * packetSize * 8 / airtime / 1e6;
+}
+
+int main(int argc, char* argv[])
+{
+  // corrupted headers are expected, don't log them
+  google::protobuf::SetLogHandler(NULL);
+
+  size_t sizes[] = {60, 300};
+  size_t aggregations[] = {0, 1500, 4000};
+  double bers[] = {0, 1e-5, 1e-4};
+  for(int s=0; s<2; s++)
+  {
+    for(int b=0; b<3; b++)
+    {
+      cout << sizes[s] << " B packets, BER " << bers[b] << ":";
+      for(int a=0; a<3; a++)
+      {
+        double goodput = run(sizes[s], aggregations[a], bers[b], 20000);
+        cout << "  aggregation " << aggregations[a] << ": " << goodput << " Mbit/s";
+      }
+      cout << endl;
+    }
+  }
+}
@@ -0,0 +1,167 @@
+/**
+ * \file components/gpp/stack/AlohaMac/benchmark/MacHeader_benchmark.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Per-packet CPU cost of writing and reading the AlohaMac header, with the
+ * protobuf AlohaPacket and with the fixed binary MacHeader.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "utility/StackHelper.h"
+#include "MacHeader.h"
+
+using namespace std;
+using namespace iris;
+using namespace iris::stack;
+namespace bp = boost::posix_time;
+
+static const string LOCAL("aabbcc222222");
+static const string REMOTE("aabbcc111111");
+
+/// Protobuf with string addresses, compared as strings
+struct ProtobufStrings
+{
+  static bool run(boost::shared_ptr<StackDataSet> frame, uint32_t seqno)
+  {
+    AlohaPacket tx;
+    tx.set_source(REMOTE);
+    tx.set_destination(LOCAL);
+    tx.set_type(AlohaPacket::DATA);
+    tx.set_seqno(seqno);
+    tx.set_txbase(seqno);
+    StackHelper::mergeAndSerializeDataset(frame, tx);
+
+    AlohaPacket rx;
+    return StackHelper::deserializeAndStripDataset(frame, rx) && rx.destination() == LOCAL;
+  }
+};
+
+/// Protobuf as AlohaMac sends it, converted to and from a MacHeader
+struct Protobuf
+{
+  static bool run(boost::shared_ptr<StackDataSet> frame, uint32_t seqno)
+  {
+    static MacAddress local, remote;
+    static bool init = MacAddress::fromString(LOCAL, local) && MacAddress::fromString(REMOTE, remote);
+    MacHeader tx;
+    tx.source = remote;
+    tx.destination = local;
+    tx.seqno = seqno;
+    tx.setTxBase(seqno);
+    AlohaPacket txPacket;
+    tx.toProtobuf(txPacket);
+    StackHelper::mergeAndSerializeDataset(frame, txPacket);
+
+    AlohaPacket rxPacket;
+    MacHeader rx;
+    return init && StackHelper::deserializeAndStripDataset(frame, rxPacket) &&
+           rx.fromProtobuf(rxPacket) && rx.isFor(local);
+  }
+};
+
+/// Binary header on a StackDataSet
+struct Binary
+{
+  static bool run(boost::shared_ptr<StackDataSet> frame, uint32_t seqno)
+  {
+    static MacAddress local, remote;
+    static bool init = MacAddress::fromString(LOCAL, local) && MacAddress::fromString(REMOTE, remote);
+    MacHeader tx;
+    tx.source = remote;
+    tx.destination = local;
+    tx.seqno = seqno;
+    tx.setTxBase(seqno);
+    tx.push(*frame);
+
+    MacHeader rx;
+    return init && MacHeader::isBinary(*frame) && rx.pull(*frame) && rx.isFor(local);
+  }
+};
+
+/// Write and read the header of numPackets frames, return ns per packet
+template <class Format>
+double timeFormat(const vector<uint8_t>& data, size_t numPackets)
+{
+  bp::ptime t1(bp::microsec_clock::local_time());
+  for(size_t i=0; i<numPackets; i++)
+  {
+    boost::shared_ptr<StackDataSet> frame(new StackDataSet);
+    frame->data.assign(data.begin(), data.end());
+    if(!Format::run(frame, i) || frame->data.size() != data.size())
+      exit(1);
+  }
+  bp::ptime t2(bp::microsec_clock::local_time());
+  return (t2-t1).total_nanoseconds() / double(numPackets);
+}
+
+/// The same for the binary header on a reused PacketBuffer
+double timeBinaryPacketBuffer(const vector<uint8_t>& data, size_t numPackets)
+{
+  MacAddress local, remote;
+  MacAddress::fromString(LOCAL, local);
+  MacAddress::fromString(REMOTE, remote);
+  PacketBuffer packet(PacketBuffer::DEFAULT_HEADROOM + data.size());
+  bp::ptime t1(bp::microsec_clock::local_time());
+  for(size_t i=0; i<numPackets; i++)
+  {
+    packet.assign(&data[0], data.size());
+    MacHeader tx;
+    tx.source = remote;
+    tx.destination = local;
+    tx.seqno = i;
+    tx.setTxBase(i);
+    tx.push(packet);
+
+    MacHeader rx;
+    if(!rx.pull(packet) || !rx.isFor(local) || packet.size() != data.size())
+      exit(1);
+  }
+  bp::ptime t2(bp::microsec_clock::local_time());
+  return (t2-t1).total_nanoseconds() / double(numPackets);
+}
+
+int main(int argc, char* argv[])
+{
+  size_t sizes[] = {64, 1500};
+  for(int s=0; s<2; s++)
+  {
+    vector<uint8_t> data(sizes[s]);
+    for(size_t i=0; i<data.size(); i++)
+      data[i] = i;
+    size_t numPackets = 1000000;
+
+    cout << sizes[s] << " B: protobuf (string addresses) " << timeFormat<ProtobufStrings>(data, numPackets)
+         << " ns/packet, protobuf " << timeFormat<Protobuf>(data, numPackets)
+         << " ns/packet, binary " << timeFormat<Binary>(data, numPackets)
+         << " ns/packet, binary PacketBuffer " << timeBinaryPacketBuffer(data, numPackets)
+         << " ns/packet" << endl;
+  }
+}
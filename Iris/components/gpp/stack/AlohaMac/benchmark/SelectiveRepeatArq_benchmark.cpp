@@ -0,0 +1,198 @@
+/**
+ * \file components/gpp/stack/AlohaMac/benchmark/SelectiveRepeatArq_benchmark.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Throughput of the AlohaMac ARQ over an emulated lossy link. The link
+ * is simulated in virtual time: DATA frames occupy the channel for their
+ * airtime, every frame and ACK sees the same one-way delay and each is
+ * lost with a given probability. Window 1 is stop-and-wait.
+ */
+
+#include <iostream>
+#include <map>
+#include <boost/random/bernoulli_distribution.hpp>
+#include "SelectiveRepeatArq.h"
+
+using namespace std;
+using namespace iris;
+using namespace iris::stack;
+namespace bp = boost::posix_time;
+
+typedef boost::shared_ptr<StackDataSet> Frame;
+
+/// Something arriving at one end of the link
+struct Event
+{
+  bool isAck;
+  uint32_t seqno;     ///< DATA: seqno, ACK: cumulative ACK
+  uint32_t txBase;
+  uint64_t sack;
+};
+
+struct Result
+{
+  double framesPerSecond;
+  uint64_t retransmissions;
+};
+
+/// Frames carry their seqno in the payload so retransmissions can be matched up
+Frame makeFrame(uint32_t seqno)
+{
+  Frame f(new StackDataSet);
+  for(int i=0; i<4; i++)
+    f->data.push_back(seqno >> (8*i));
+  return f;
+}
+
+uint32_t seqNoOf(Frame f)
+{
+  uint32_t seqno = 0;
+  for(int i=0; i<4; i++)
+    seqno |= uint32_t(f->data[i]) << (8*i);
+  return seqno;
+}
+
+/** Send numFrames frames over the emulated link
+ *
+ * @param window      ARQ window
+ * @param loss        Probability of losing a DATA frame or ACK
+ * @param numFrames   Number of frames to send
+ * @param airtime     Time a DATA frame occupies the channel
+ * @param delay       One-way link delay
+ * @param ackTimeout  ACK timeout in ms
+ */
+Result run(uint32_t window, double loss, uint32_t numFrames,
+           bp::time_duration airtime, bp::time_duration delay, int ackTimeout)
+{
+  boost::mt19937 rng(42);
+  boost::bernoulli_distribution<> lost(loss);
+  ArqSender tx(window, 100, ackTimeout);
+  ArqReceiver rx;
+
+  multimap<bp::ptime, Event> events;
+  deque<Frame> retxQueue;
+  vector<Frame> frames;
+  uint32_t offered = 0;
+  uint64_t delivered = 0;
+
+  const bp::ptime start(boost::gregorian::date(2013, 1, 1));
+  bp::ptime now = start;
+  bp::ptime channelFree = start;
+
+  while(offered < numFrames || !tx.isEmpty())
+  {
+    // Transmit if the channel is free
+    bool pending = !retxQueue.empty() || (!tx.isFull() && offered < numFrames);
+    if(pending && channelFree <= now)
+    {
+      Event e = {false, 0, tx.base(), 0};
+      if(!retxQueue.empty())
+      {
+        e.seqno = seqNoOf(retxQueue.front());
+        retxQueue.pop_front();
+      }
+      else
+      {
+        e.seqno = tx.nextSeqNo();
+        tx.add(makeFrame(e.seqno), now);
+        offered++;
+      }
+      channelFree = now + airtime;
+      if(!lost(rng))
+        events.insert(make_pair(channelFree + delay, e));
+      pending = !retxQueue.empty() || (!tx.isFull() && offered < numFrames);
+    }
+
+    // Move on to whatever happens next
+    bp::ptime next(bp::pos_infin);
+    if(!events.empty())
+      next = events.begin()->first;
+    bp::ptime deadline;
+    if(tx.nextDeadline(deadline) && deadline < next)
+      next = deadline;
+    if(pending && channelFree < next)
+      next = channelFree;
+    if(next.is_pos_infinity())
+      break;
+    now = std::max(now, next);
+
+    while(!events.empty() && events.begin()->first <= now)
+    {
+      Event e = events.begin()->second;
+      events.erase(events.begin());
+      if(e.isAck)
+      {
+        tx.ack(e.seqno, e.sack);
+      }
+      else
+      {
+        frames.clear();
+        rx.receive(e.seqno, e.txBase, makeFrame(e.seqno), frames);
+        delivered += frames.size();
+        Event ack = {true, rx.cumulativeAck(), 0, rx.selectiveAck()};
+        if(!lost(rng))
+          events.insert(make_pair(now + delay, ack));
+      }
+    }
+
+    vector<Frame> resend;
+    tx.expire(now, resend);
+    retxQueue.insert(retxQueue.end(), resend.begin(), resend.end());
+  }
+
+  Result r;
+  r.framesPerSecond = delivered / ((now - start).total_microseconds() / 1e6);
+  r.retransmissions = tx.getRetransmissions();
+  return r;
+}
+
+int main(int argc, char* argv[])
+{
+  // 1500 byte frames at 24 Mbit/s, 2 ms one-way latency through host and radio
+  bp::time_duration airtime = bp::microseconds(500);
+  bp::time_duration delay = bp::milliseconds(2);
+  int ackTimeout = 10;
+  uint32_t numFrames = 20000;
+
+  double losses[] = {0.0, 0.01, 0.1};
+  uint32_t windows[] = {1, 4, 8, 16, 32, 64};
+  for(int l=0; l<3; l++)
+  {
+    double stopAndWait = 0;
+    for(int w=0; w<6; w++)
+    {
+      Result r = run(windows[w], losses[l], numFrames, airtime, delay, ackTimeout);
+      if(windows[w] == 1)
+        stopAndWait = r.framesPerSecond;
+      cout << "Loss " << losses[l] << ", window " << windows[w] << ": "
+           << r.framesPerSecond << " frames/s (" << r.framesPerSecond / stopAndWait
+           << "x stop-and-wait), " << r.retransmissions << " retransmissions" << endl;
+    }
+  }
+}
@@ -0,0 +1,144 @@
+/**
+ * \file components/gpp/stack/AlohaMac/benchmark/StackHelper_benchmark.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Benchmark of the StackHelper functions which wrap packets in and strip
+ * them out of AlohaPacket headers, per packet from 64 B to 9 KiB.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "utility/StackHelper.h"
+#include "alohamac.pb.h"
+
+using namespace std;
+using namespace iris;
+namespace bp = boost::posix_time;
+
+/// The copy chain StackHelper used before PacketBuffer, for comparison
+struct CopyChain
+{
+  static void merge(boost::shared_ptr<StackDataSet> frame, AlohaPacket &protobuf)
+  {
+    std::vector<uint8_t> payload(frame->data.begin(), frame->data.end());
+    protobuf.add_payload(&payload.front(), payload.size());
+    payload.clear();
+    payload.resize(protobuf.ByteSize());
+    protobuf.SerializeWithCachedSizesToArray(&payload.front());
+    frame->data.clear();
+    frame->data.insert(frame->data.begin(), payload.begin(), payload.end());
+  }
+
+  static bool strip(boost::shared_ptr<StackDataSet> frame, AlohaPacket &protobuf)
+  {
+    std::vector<uint8_t> buffer(frame->data.begin(), frame->data.end());
+    if (!protobuf.ParseFromArray((void*)&buffer.front(), buffer.size()))
+      return false;
+    if (protobuf.mutable_payload()->size() == 1) {
+      std::string payload = protobuf.mutable_payload()->Get(0);
+      frame->data.clear();
+      frame->data.insert(frame->data.end(), payload.c_str(), payload.c_str() + payload.size());
+    }
+    return true;
+  }
+};
+
+void fillHeader(AlohaPacket& packet, uint32_t seqno)
+{
+  packet.set_source("f009e090e90e");
+  packet.set_destination("00f0f0f0f0f0");
+  packet.set_type(AlohaPacket::DATA);
+  packet.set_seqno(seqno);
+}
+
+/// Wrap and strip numPackets StackDataSets, return ns per packet
+template <class Helper>
+double timeStackDataSet(const vector<uint8_t>& data, size_t numPackets)
+{
+  bp::ptime t1(bp::microsec_clock::local_time());
+  for(size_t i=0; i<numPackets; i++)
+  {
+    boost::shared_ptr<StackDataSet> frame(new StackDataSet);
+    frame->data.assign(data.begin(), data.end());
+    AlohaPacket tx;
+    fillHeader(tx, i);
+    Helper::merge(frame, tx);
+    AlohaPacket rx;
+    if(!Helper::strip(frame, rx) || frame->data.size() != data.size())
+      exit(1);
+  }
+  bp::ptime t2(bp::microsec_clock::local_time());
+  return (t2-t1).total_nanoseconds() / double(numPackets);
+}
+
+struct NewHelper
+{
+  static void merge(boost::shared_ptr<StackDataSet> frame, AlohaPacket &protobuf)
+  { StackHelper::mergeAndSerializeDataset(frame, protobuf); }
+  static bool strip(boost::shared_ptr<StackDataSet> frame, AlohaPacket &protobuf)
+  { return StackHelper::deserializeAndStripDataset(frame, protobuf); }
+};
+
+/// Wrap and strip numPackets in one reused PacketBuffer, return ns per packet
+double timePacketBuffer(const vector<uint8_t>& data, size_t numPackets)
+{
+  PacketBuffer packet(PacketBuffer::DEFAULT_HEADROOM + data.size());
+  bp::ptime t1(bp::microsec_clock::local_time());
+  for(size_t i=0; i<numPackets; i++)
+  {
+    packet.assign(&data[0], data.size());
+    AlohaPacket tx;
+    fillHeader(tx, i);
+    StackHelper::mergeAndSerializeDataset(packet, tx);
+    AlohaPacket rx;
+    if(!StackHelper::deserializeAndStripDataset(packet, rx) || packet.size() != data.size())
+      exit(1);
+  }
+  bp::ptime t2(bp::microsec_clock::local_time());
+  return (t2-t1).total_nanoseconds() / double(numPackets);
+}
+
+int main(int argc, char* argv[])
+{
+  size_t sizes[] = {64, 256, 1024, 1500, 4096, 9216};
+  for(int s=0; s<6; s++)
+  {
+    vector<uint8_t> data(sizes[s]);
+    for(size_t i=0; i<data.size(); i++)
+      data[i] = i;
+    size_t numPackets = 20000000 / (sizes[s] + 200);
+
+    double chain = timeStackDataSet<CopyChain>(data, numPackets);
+    double stack = timeStackDataSet<NewHelper>(data, numPackets);
+    double packet = timePacketBuffer(data, numPackets);
+    cout << sizes[s] << " B: copy chain " << chain << " ns/packet, StackDataSet "
+         << stack << " ns/packet, PacketBuffer " << packet << " ns/packet" << endl;
+  }
+}
@@ -0,0 +1,172 @@
+/**
+ *  \file components/gpp/stack/AlohaMac/test/FrameAggregation_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for the frame aggregation of AlohaMac.
+ */
+
+#define BOOST_TEST_MODULE FrameAggregation_Test
+
+#include "FrameAggregation.h"
+
+#include <algorithm>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace iris;
+using namespace iris::stack;
+
+typedef boost::shared_ptr<StackDataSet> Frame;
+
+Frame makeFrame(size_t size, uint8_t fill)
+{
+  Frame f(new StackDataSet);
+  f->data.assign(size, fill);
+  return f;
+}
+
+/// Build an aggregated frame of subframes with seqnos 10, 11, ...
+Frame build(const vector<Frame>& subframes)
+{
+  vector<uint32_t> seqnos;
+  for(size_t i=0; i<subframes.size(); i++)
+    seqnos.push_back(10 + i);
+  AlohaPacket packet;
+  packet.set_source("f009e090e90e");
+  packet.set_destination("00f0f0f0f0f0");
+  packet.set_txbase(7);
+  return FrameAggregation::merge(packet, seqnos, subframes);
+}
+
+BOOST_AUTO_TEST_SUITE (FrameAggregation_Test)
+
+BOOST_AUTO_TEST_CASE(FrameAggregation_Test_RoundTrip)
+{
+  vector<Frame> in;
+  in.push_back(makeFrame(40, 1));
+  in.push_back(makeFrame(0, 2));
+  in.push_back(makeFrame(300, 3));
+  Frame frame = build(in);
+  BOOST_CHECK_EQUAL(in[2]->data.size(), 300u);
+
+  AlohaPacket packet;
+  BOOST_REQUIRE(StackHelper::deserializeAndStripDataset(frame, packet));
+  BOOST_CHECK_EQUAL(packet.type(), AlohaPacket::DATA);
+  BOOST_CHECK_EQUAL(packet.seqno(), 10u);
+  BOOST_CHECK_EQUAL(packet.txbase(), 7u);
+
+  vector<uint32_t> seqnos;
+  vector<Frame> out;
+  BOOST_CHECK_EQUAL(FrameAggregation::split(packet, frame, seqnos, out), 0u);
+  BOOST_REQUIRE_EQUAL(out.size(), 3u);
+  for(size_t i=0; i<3; i++)
+  {
+    BOOST_CHECK_EQUAL(seqnos[i], 10 + i);
+    BOOST_CHECK(out[i]->data == in[i]->data);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FrameAggregation_Test_Single)
+{
+  vector<Frame> in(1, makeFrame(100, 5));
+  Frame frame = build(in);
+
+  AlohaPacket packet;
+  BOOST_REQUIRE(StackHelper::deserializeAndStripDataset(frame, packet));
+  vector<uint32_t> seqnos;
+  vector<Frame> out;
+  BOOST_CHECK_EQUAL(FrameAggregation::split(packet, frame, seqnos, out), 0u);
+  BOOST_REQUIRE_EQUAL(out.size(), 1u);
+  BOOST_CHECK_EQUAL(seqnos[0], 10u);
+  BOOST_CHECK(out[0]->data == in[0]->data);
+}
+
+BOOST_AUTO_TEST_CASE(FrameAggregation_Test_BadCrc)
+{
+  vector<Frame> in;
+  in.push_back(makeFrame(50, 1));
+  in.push_back(makeFrame(50, 2));
+  in.push_back(makeFrame(50, 3));
+  Frame frame = build(in);
+
+  // flip a bit in the middle of the second subframe
+  std::deque<uint8_t>::iterator it = std::find(frame->data.begin(), frame->data.end(), 2);
+  BOOST_REQUIRE(it != frame->data.end());
+  it[20] ^= 0x10;
+
+  AlohaPacket packet;
+  BOOST_REQUIRE(StackHelper::deserializeAndStripDataset(frame, packet));
+  vector<uint32_t> seqnos;
+  vector<Frame> out;
+  BOOST_CHECK_EQUAL(FrameAggregation::split(packet, frame, seqnos, out), 1u);
+  BOOST_REQUIRE_EQUAL(out.size(), 2u);
+  BOOST_CHECK_EQUAL(seqnos[0], 10u);
+  BOOST_CHECK_EQUAL(seqnos[1], 12u);
+  BOOST_CHECK(out[1]->data == in[2]->data);
+}
+
+BOOST_AUTO_TEST_CASE(FrameAggregation_Test_Binary)
+{
+  vector<Frame> in;
+  in.push_back(makeFrame(40, 1));
+  in.push_back(makeFrame(0, 2));
+  in.push_back(makeFrame(300, 3));
+  vector<uint32_t> seqnos;
+  for(size_t i=0; i<in.size(); i++)
+    seqnos.push_back(10 + i);
+  MacHeader header;
+  header.setTxBase(7);
+  Frame frame = FrameAggregation::merge(header, seqnos, in);
+  BOOST_CHECK_EQUAL(frame->data.size(), MacHeader::SIZE + 3 * MacHeader::DESCRIPTOR_SIZE + 340);
+
+  // corrupt the last subframe
+  frame->data.back() ^= 1;
+
+  MacHeader h;
+  BOOST_REQUIRE(h.pull(*frame));
+  BOOST_CHECK_EQUAL(h.subframes, 3);
+  BOOST_CHECK_EQUAL(h.seqno, 10u);
+  BOOST_CHECK_EQUAL(h.txbase, 7u);
+  vector<uint32_t> okSeqnos;
+  vector<Frame> out;
+  BOOST_CHECK_EQUAL(FrameAggregation::split(h, frame, okSeqnos, out), 1u);
+  BOOST_REQUIRE_EQUAL(out.size(), 2u);
+  BOOST_CHECK_EQUAL(okSeqnos[1], 11u);
+  BOOST_CHECK(out[0]->data == in[0]->data);
+  BOOST_CHECK(out[1]->data.empty());
+
+  // truncated frame loses the subframes which don't fit
+  frame->data.resize(3 * MacHeader::DESCRIPTOR_SIZE + 50);
+  out.clear();
+  BOOST_CHECK_EQUAL(FrameAggregation::split(h, frame, okSeqnos, out), 1u);
+  BOOST_CHECK_EQUAL(out.size(), 2u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
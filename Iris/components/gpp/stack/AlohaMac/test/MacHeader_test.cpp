@@ -0,0 +1,138 @@
+/**
+ *  \file components/gpp/stack/AlohaMac/test/MacHeader_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for the AlohaMac frame header.
+ */
+
+#define BOOST_TEST_MODULE MacHeader_Test
+
+#include "MacHeader.h"
+
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace iris;
+using namespace iris::stack;
+
+MacHeader makeHeader()
+{
+  MacHeader h;
+  MacAddress::fromString("aabbcc111111", h.source);
+  MacAddress::fromString("AABBCC222222", h.destination);
+  h.type = AlohaPacket::ACK;
+  h.seqno = 0x01020304;
+  h.setSack(0x8000000000000001ULL);
+  return h;
+}
+
+BOOST_AUTO_TEST_SUITE (MacHeader_Test)
+
+BOOST_AUTO_TEST_CASE(MacHeader_Test_Broadcast)
+{
+  MacHeader h;
+  BOOST_CHECK(!h.isBroadcast());
+  h.destination = MacAddress::broadcast();
+  BOOST_CHECK(h.isBroadcast());
+  MacAddress::fromString("fffffffffffe", h.destination);
+  BOOST_CHECK(!h.isBroadcast());
+}
+
+BOOST_AUTO_TEST_CASE(MacHeader_Test_Binary)
+{
+  MacHeader in = makeHeader();
+  StackDataSet frame;
+  frame.data.assign(10, 7);
+  in.push(frame);
+  BOOST_REQUIRE_EQUAL(frame.data.size(), MacHeader::SIZE + 10);
+  BOOST_CHECK(MacHeader::isBinary(frame));
+  BOOST_CHECK_EQUAL(frame.data[16], 0x01);   // big endian seqno
+  BOOST_CHECK_EQUAL(frame.data[19], 0x04);
+  BOOST_CHECK_EQUAL(frame.data[4], 0xaa);     // destination
+  BOOST_CHECK_EQUAL(frame.data[15], 0x11);    // source
+
+  MacHeader out;
+  BOOST_REQUIRE(out.pull(frame));
+  BOOST_CHECK_EQUAL(frame.data.size(), 10u);
+  BOOST_CHECK_EQUAL(out.type, AlohaPacket::ACK);
+  BOOST_CHECK_EQUAL(out.seqno, in.seqno);
+  BOOST_CHECK(out.hasSack());
+  BOOST_CHECK(!out.hasTxBase());
+  BOOST_CHECK_EQUAL(out.sack, in.sack);
+  BOOST_CHECK(out.isFor(in.destination));
+  BOOST_CHECK_EQUAL(out.source.toString(), "aabbcc111111");
+
+  // PacketBuffer gives the same bytes
+  PacketBuffer packet;
+  in.push(packet);
+  BOOST_REQUIRE_EQUAL(packet.size(), MacHeader::SIZE);
+  MacHeader out2;
+  BOOST_REQUIRE(out2.pull(packet));
+  BOOST_CHECK(packet.empty());
+  BOOST_CHECK_EQUAL(out2.sack, in.sack);
+
+  // too short or wrong magic
+  StackDataSet bad;
+  bad.data.assign(MacHeader::SIZE - 1, MacHeader::MAGIC);
+  BOOST_CHECK(!out.pull(bad));
+  bad.data.assign(MacHeader::SIZE, 0x0a);
+  BOOST_CHECK(!out.pull(bad));
+  BOOST_CHECK_EQUAL(bad.data.size(), MacHeader::SIZE);
+}
+
+BOOST_AUTO_TEST_CASE(MacHeader_Test_Protobuf)
+{
+  MacHeader in = makeHeader();
+  AlohaPacket packet;
+  in.toProtobuf(packet);
+  BOOST_CHECK_EQUAL(packet.source(), "aabbcc111111");
+  BOOST_CHECK_EQUAL(packet.destination(), "aabbcc222222");
+  BOOST_CHECK(packet.has_sack());
+  BOOST_CHECK(!packet.has_txbase());
+
+  // a serialized AlohaPacket is never mistaken for a binary header
+  string bytes = packet.SerializeAsString();
+  StackDataSet frame;
+  frame.data.assign(bytes.begin(), bytes.end());
+  BOOST_CHECK(!MacHeader::isBinary(frame));
+
+  MacHeader out;
+  BOOST_REQUIRE(out.fromProtobuf(packet));
+  BOOST_CHECK_EQUAL(out.type, in.type);
+  BOOST_CHECK_EQUAL(out.seqno, in.seqno);
+  BOOST_CHECK_EQUAL(out.flags, in.flags);
+  BOOST_CHECK_EQUAL(out.sack, in.sack);
+  BOOST_CHECK(out.isFor(in.destination));
+
+  packet.set_source("node1");
+  BOOST_CHECK(!out.fromProtobuf(packet));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
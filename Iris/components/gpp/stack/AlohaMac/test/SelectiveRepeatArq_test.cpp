@@ -0,0 +1,195 @@
+/**
+ *  \file components/gpp/stack/AlohaMac/test/SelectiveRepeatArq_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for the selective-repeat ARQ classes of AlohaMac.
+ */
+
+#define BOOST_TEST_MODULE SelectiveRepeatArq_Test
+
+#include "SelectiveRepeatArq.h"
+
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace iris;
+using namespace iris::stack;
+namespace bp = boost::posix_time;
+
+typedef boost::shared_ptr<StackDataSet> Frame;
+
+Frame makeFrame(uint8_t id)
+{
+  Frame f(new StackDataSet);
+  f->data.push_back(id);
+  return f;
+}
+
+BOOST_AUTO_TEST_SUITE (SelectiveRepeatArq_Test)
+
+BOOST_AUTO_TEST_CASE(SelectiveRepeatArq_Test_Reorder)
+{
+  ArqReceiver rx;
+  vector<Frame> out;
+
+  BOOST_CHECK(!rx.receive(2, 1, makeFrame(2), out));
+  BOOST_CHECK(!rx.receive(4, 1, makeFrame(4), out));
+  BOOST_CHECK(out.empty());
+  BOOST_CHECK_EQUAL(rx.cumulativeAck(), 0u);
+  BOOST_CHECK_EQUAL(rx.selectiveAck(), 5u);   // 2 and 4
+  BOOST_CHECK_EQUAL(rx.getBuffered(), 2u);
+
+  // Duplicate is ignored, the gap fill releases 1 and 2
+  rx.receive(2, 1, makeFrame(2), out);
+  rx.receive(1, 1, makeFrame(1), out);
+  BOOST_REQUIRE_EQUAL(out.size(), 2u);
+  BOOST_CHECK_EQUAL(out[0]->data[0], 1);
+  BOOST_CHECK_EQUAL(out[1]->data[0], 2);
+  BOOST_CHECK_EQUAL(rx.cumulativeAck(), 2u);
+  BOOST_CHECK_EQUAL(rx.selectiveAck(), 1u);   // 4
+
+  // Sender gave up on 3, so 4 and 5 go up
+  rx.receive(5, 4, makeFrame(5), out);
+  BOOST_REQUIRE_EQUAL(out.size(), 4u);
+  BOOST_CHECK_EQUAL(out[2]->data[0], 4);
+  BOOST_CHECK_EQUAL(out[3]->data[0], 5);
+  BOOST_CHECK_EQUAL(rx.cumulativeAck(), 5u);
+  BOOST_CHECK_EQUAL(rx.getBuffered(), 0u);
+
+  // Old retransmission is ignored
+  out.clear();
+  rx.receive(3, 3, makeFrame(3), out);
+  BOOST_CHECK(out.empty());
+}
+
+BOOST_AUTO_TEST_CASE(SelectiveRepeatArq_Test_Restart)
+{
+  ArqReceiver rx;
+  vector<Frame> out;
+  for(uint32_t i=1; i<=200; i++)
+    BOOST_CHECK(!rx.receive(i, i, makeFrame(i), out));
+  BOOST_CHECK_EQUAL(out.size(), 200u);
+  BOOST_CHECK_EQUAL(rx.cumulativeAck(), 200u);
+
+  out.clear();
+  BOOST_CHECK(rx.receive(1, 1, makeFrame(1), out));
+  BOOST_CHECK_EQUAL(out.size(), 1u);
+  BOOST_CHECK_EQUAL(rx.cumulativeAck(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(SelectiveRepeatArq_Test_ShortRestart)
+{
+  // Sender restarts less than a window after it started
+  ArqReceiver rx;
+  vector<Frame> out;
+  for(uint32_t i=1; i<=10; i++)
+    BOOST_CHECK(!rx.receive(i, 1, makeFrame(i), out));
+  BOOST_CHECK_EQUAL(out.size(), 10u);
+
+  out.clear();
+  BOOST_CHECK(rx.receive(1, 1, makeFrame(1), out));
+  BOOST_CHECK(!rx.receive(2, 1, makeFrame(2), out));
+  BOOST_REQUIRE_EQUAL(out.size(), 2u);
+  BOOST_CHECK(out[0]->data == makeFrame(1)->data);
+  BOOST_CHECK(out[1]->data == makeFrame(2)->data);
+  BOOST_CHECK_EQUAL(rx.cumulativeAck(), 2u);
+
+  // Frame 1 itself is not a restart
+  ArqReceiver fresh;
+  out.clear();
+  BOOST_CHECK(!fresh.receive(1, 1, makeFrame(1), out));
+  BOOST_CHECK_EQUAL(out.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(SelectiveRepeatArq_Test_SenderAck)
+{
+  bp::ptime now(bp::microsec_clock::universal_time());
+  ArqSender tx(4, 3, 10);
+  for(int i=0; i<4; i++)
+  {
+    BOOST_CHECK(!tx.isFull());
+    BOOST_CHECK_EQUAL(tx.space(), size_t(4 - i));
+    BOOST_CHECK_EQUAL(tx.nextSeqNo(), uint32_t(i + 1));
+    tx.add(makeFrame(i + 1), now);
+  }
+  BOOST_CHECK(tx.isFull());
+
+  // 3 selectively acked, window can't move
+  BOOST_CHECK_EQUAL(tx.ack(0, 2), 0u);
+  // 1 acked cumulatively - 2 is still missing
+  BOOST_CHECK_EQUAL(tx.ack(1, 0), 1u);
+  BOOST_CHECK_EQUAL(tx.base(), 2u);
+  // stop-and-wait style ACK for 2 moves the window past 3
+  BOOST_CHECK_EQUAL(tx.ackOne(2), 2u);
+  BOOST_CHECK_EQUAL(tx.base(), 4u);
+  BOOST_CHECK_EQUAL(tx.nextSeqNo(), 5u);
+  BOOST_CHECK(!tx.isEmpty());
+  BOOST_CHECK_EQUAL(tx.ack(10, 0), 1u);
+  BOOST_CHECK(tx.isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(SelectiveRepeatArq_Test_Timers)
+{
+  bp::ptime now(bp::microsec_clock::universal_time());
+  ArqSender tx(2, 2, 10);
+  tx.add(makeFrame(1), now);
+  tx.add(makeFrame(2), now + bp::milliseconds(5));
+
+  bp::ptime deadline;
+  BOOST_REQUIRE(tx.nextDeadline(deadline));
+  BOOST_CHECK(deadline == now + bp::milliseconds(10));
+
+  // ACK timeout of frame 1 starts its backoff
+  vector<Frame> resend;
+  BOOST_CHECK_EQUAL(tx.expire(now + bp::milliseconds(10), resend), 0u);
+  BOOST_CHECK(resend.empty());
+  tx.ackOne(2);
+  BOOST_CHECK_EQUAL(tx.space(), 0u);  // 1 holds the window
+
+  // backoff is between 10 and 20 ms
+  BOOST_REQUIRE(tx.nextDeadline(deadline));
+  BOOST_CHECK(deadline >= now + bp::milliseconds(20));
+  BOOST_CHECK(deadline < now + bp::milliseconds(30));
+  vector<uint32_t> seqnos;
+  tx.expire(deadline, resend, &seqnos);
+  BOOST_REQUIRE_EQUAL(resend.size(), 1u);
+  BOOST_CHECK_EQUAL(resend[0]->data[0], 1);
+  BOOST_CHECK_EQUAL(seqnos.at(0), 1u);
+  BOOST_CHECK_EQUAL(tx.getRetransmissions(), 1u);
+
+  // second timeout gives up after maxTx transmissions
+  BOOST_CHECK_EQUAL(tx.expire(deadline + bp::milliseconds(10), resend), 2u);
+  BOOST_CHECK_EQUAL(tx.getGivenUp(), 1u);
+  BOOST_CHECK(tx.isEmpty());
+  BOOST_CHECK_EQUAL(tx.base(), 3u);
+  BOOST_CHECK(!tx.nextDeadline(deadline));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
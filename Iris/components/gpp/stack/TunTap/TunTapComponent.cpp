@@ -58,7 +58,7 @@ TunTapComponent::TunTapComponent(std::string name)
                    "tuntapstackcomponent",
                    "Interface to tun/tap virtual network devices",
                    "Andre Puschmann",
-                   "0.1")
+                   "0.2")
 {
   //Format: registerParameter(name, description, default, dynamic?, parameter, allowed values);
   registerParameter("device",
@@ -71,6 +71,18 @@ TunTapComponent::TunTapComponent(std::string name)
                     "true",
                     true,
                     readFromBelow_x);
+  registerParameter("queues",
+                    "Number of device queues, each read by its own thread (needs IFF_MULTI_QUEUE for > 1)",
+                    "1",
+                    false,
+                    queues_x,
+                    Interval<int>(1, 64));
+  registerParameter("batchsize",
+                    "Max packets read from a queue at once",
+                    "32",
+                    false,
+                    batchSize_x,
+                    Interval<int>(1, 1024));
 }
 
 
@@ -82,17 +94,22 @@ void TunTapComponent::initialize()
 void TunTapComponent::processMessage(boost::shared_ptr<StackDataSet> incomingFrame)
 {
   size_t frameSize = incomingFrame->data.size();
-  size_t writtenBytes;
-
+  ssize_t writtenBytes;
 
   //LOG(LDEBUG) << "processMessage() called.";
-  assert(frameSize <= MAX_BUF_SIZE);
-  for (int i = 0; i < (int)frameSize; i++)
-    buffer_[i] = incomingFrame->data[i];
+  if (tunFds_.empty())
+    return;
+  if (frameSize > MAX_BUF_SIZE) {
+    LOG(LERROR) << "Dropping frame of " << frameSize << " bytes - too large for tun/tap device.";
+    return;
+  }
 
-  writtenBytes = write(tunFd_, buffer_, frameSize);
+  // The device needs the frame in one write(). std::copy moves the deque
+  // a block at a time rather than byte by byte.
+  std::copy(incomingFrame->data.begin(), incomingFrame->data.end(), buffer_);
+  writtenBytes = write(tunFds_.front(), buffer_, frameSize);
 
-  if (writtenBytes != frameSize)
+  if (writtenBytes != (ssize_t)frameSize)
     LOG(LERROR) << "Less bytes written to tun/tap device then requested.";
   else
   {
@@ -125,43 +142,59 @@ void TunTapComponent::start()
 {
   //LOG(LDEBUG) << "start() called.";
 
-  // Connect to the device
-  strcpy(tunName_, tunTapDevice_x.c_str());
+  // Connect to the device, one file descriptor per queue
+  strncpy(tunName_, tunTapDevice_x.c_str(), IFNAMSIZ - 1);
+  tunName_[IFNAMSIZ - 1] = '\0';
   int flags = strstr(tunName_, "tap") == NULL ? IFF_TUN : IFF_TAP | IFF_NO_PI;
-  if ((tunFd_ = allocateTunDevice(tunName_, flags)) >= 0)
-  {
-    LOG(LINFO) << "Successfully attached to tun/tap device "
-      << tunTapDevice_x;
+  if (queues_x > 1) {
+#ifdef IFF_MULTI_QUEUE
+    flags |= IFF_MULTI_QUEUE;
+#else
+    LOG(LWARNING) << "No IFF_MULTI_QUEUE support - using a single queue.";
+    queues_x = 1;
+#endif
   }
-  else
+  for (int i = 0; i < queues_x; i++)
   {
-    LOG(LFATAL) << "Error allocating tun/tap interface.";
-    return;
+    int fd = allocateTunTapQueue(tunName_, flags);
+    if (fd < 0)
+    {
+      LOG(LFATAL) << "Error allocating tun/tap interface.";
+      stop();
+      return;
+    }
+    tunFds_.push_back(fd);
+    readers_.push_back(boost::shared_ptr<TunTapReader>(new TunTapReader(fd, batchSize_x, MAX_BUF_SIZE)));
   }
+  LOG(LINFO) << "Successfully attached to tun/tap device "
+    << tunName_ << " with " << queues_x << " queue(s).";
 
-  // start thread
-  rxThread_.reset(new boost::thread(boost::bind( &TunTapComponent::rxThreadFunction, this)));
+  // start one thread per queue
+  for (size_t i = 0; i < readers_.size(); i++)
+    rxThreads_.push_back(boost::shared_ptr<boost::thread>(
+        new boost::thread(boost::bind(&TunTapComponent::rxThreadFunction, this, readers_[i].get()))));
 }
 
 
 void TunTapComponent::stop()
 {
-  if (rxThread_) {
-    rxThread_->interrupt();
-    rxThread_->join();
+  for (size_t i = 0; i < rxThreads_.size(); i++) {
+    rxThreads_[i]->interrupt();
+    readers_[i]->wakeup();
   }
-  close(tunFd_);
+  for (size_t i = 0; i < rxThreads_.size(); i++)
+    rxThreads_[i]->join();
+  rxThreads_.clear();
+  readers_.clear();
+  for (size_t i = 0; i < tunFds_.size(); i++)
+    close(tunFds_[i]);
+  tunFds_.clear();
 }
 
 
-void TunTapComponent::rxThreadFunction()
+void TunTapComponent::rxThreadFunction(TunTapReader* reader)
 {
   //LOG(LINFO) << "RX thread started, listening on tun/tap device " << x_tunTapDevice;
-  fd_set socketSet;
-  struct timeval selectTimeout;
-  char buffer[MAX_BUF_SIZE];
-  int nread;
-
   try
   {
     // read data coming from the kernel
@@ -169,34 +202,19 @@ void TunTapComponent::rxThreadFunction()
     {
       boost::this_thread::interruption_point();
 
-      // reset socket set and add tap descriptor
-      FD_ZERO(&socketSet);
-      FD_SET(tunFd_, &socketSet);
-
-      // initialize timeout
-      selectTimeout.tv_sec = 1;
-      selectTimeout.tv_usec = 0;
+      // suspend thread until we receive packets or stop() wakes us up
+      size_t n = reader->read(-1);
+      if (n > 0)
+        LOG(LDEBUG) << "Read " << n << " packets from device " << tunName_;
 
-      // suspend thread until we receive a packet or timeout
-      if (select(tunFd_ + 1, &socketSet, NULL, NULL, &selectTimeout) == 0) {
-        //LOG(LDEBUG) << "Timeout while waiting for incoming packet.";
-      } else {
-        if (FD_ISSET(tunFd_, &socketSet)) {
-          if ((nread = read(tunFd_, buffer, MAX_BUF_SIZE)) < 0)
-          {
-            LOG(LFATAL) << "Error while reading from tun/tap interface.";
-            continue;
-          }
-          LOG(LDEBUG) << "Read " << nread << " bytes from device "
-            << tunName_;
+      for (size_t i = 0; i < n; i++)
+      {
+        // copy received data into new StackDataSet
+        shared_ptr<StackDataSet> packetBuffer(new StackDataSet);
+        packetBuffer->data.assign(reader->packet(i), reader->packet(i) + reader->packetSize(i));
 
-          // copy received data into new StackDataSet
-          shared_ptr<StackDataSet> packetBuffer(new StackDataSet);
-          packetBuffer->data.assign(buffer, buffer + nread);
-
-          // send downwards
-          sendDownwards(packetBuffer);
-        }
+        // send downwards
+        sendDownwards(packetBuffer);
       }
     } // while (true)
     throw SystemException("Rx thread stopped unexpectedly.");
@@ -204,7 +222,7 @@ void TunTapComponent::rxThreadFunction()
   catch(IrisException& ex)
   {
     LOG(LFATAL) << "Error in TunTap component: " << ex.what()
-      << " - TX thread exiting.";
+      << " - RX thread exiting.";
   }
   catch(boost::thread_interrupted)
   {
@@ -213,59 +231,5 @@ void TunTapComponent::rxThreadFunction()
   }
 }
 
-
-/* Arguments taken by the function:
-*
-* code shamelessly taken from
-* http://backreference.org/2010/03/26/tuntap-interface-tutorial/
-*
-* char *dev: the name of an interface (or '\0'). MUST have enough
-*   space to hold the interface name if '\0' is passed
-* int flags: interface flags (eg, IFF_TUN etc.)
-*/
-int TunTapComponent::allocateTunDevice(char *dev, int flags)
-{
-  struct ifreq ifr;
-  int fd, err;
-  const char *clonedev = (const char *)"/dev/net/tun";
-
-
-  // open the clone device
-  if((fd = open(clonedev, O_RDWR)) < 0)
-  {
-    return fd;
-  }
-
-  // preparation of the struct ifr, of type "struct ifreq"
-  memset(&ifr, 0, sizeof(ifr));
-
-  ifr.ifr_flags = flags;   // IFF_TUN or IFF_TAP, plus maybe IFF_NO_PI
-
-  if (*dev)
-  {
-    // if a device name was specified, put it in the structure; otherwise,
-    // the kernel will try to allocate the "next" device of the
-    // specified type
-    strncpy(ifr.ifr_name, dev, IFNAMSIZ);
-  }
-
-  // try to create the device
-  if((err = ioctl(fd, TUNSETIFF, (void *) &ifr)) < 0)
-  {
-    close(fd);
-    return err;
-  }
-
-  // if the operation was successful, write back the name of the
-  // interface to the variable "dev", so the caller can know
-  // it. Note that the caller MUST reserve space in *dev (see calling
-  // code below)
-  strcpy(dev, ifr.ifr_name);
-
-  // this is the special file descriptor that the caller will use to talk
-  // with the virtual interface
-  return fd;
-}
-
 } // namespace stack
 } // namespace iris
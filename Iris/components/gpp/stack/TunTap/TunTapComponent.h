@@ -31,22 +31,22 @@
  * This component implements a software connector between Iris and
  * virtual network device drivers TUN/TAP on Linux/Unix systems.
  *
+ * With queues set above 1 the device is opened with IFF_MULTI_QUEUE and
+ * every queue gets its own reader thread, so the kernel can spread flows
+ * over several cores.
+ *
  */
 
 #ifndef STACK_TUNTAPCOMPONENT_H_
 #define STACK_TUNTAPCOMPONENT_H_
 
 #include "irisapi/StackComponent.h"
-#include "TunTapComponent.h"
 #include <stdio.h>
-#include <sys/ioctl.h>
-#include <fcntl.h>
+#include <vector>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <netinet/in.h>
-#include <linux/if.h>
-#include <linux/if_tun.h>
-#include <boost/format.hpp>
+#include "TunTapDevice.h"
 
 #define MAX_BUF_SIZE (10 * 1024) // should be enough for now
 
@@ -72,16 +72,18 @@ private:
   //Exposed parameters
   bool readFromBelow_x;       ///< Accept blocks from below (istead of above)
   std::string tunTapDevice_x; ///< Name of the Tun/Tap device to attach to
+  int queues_x;               ///< Number of device queues, each with a reader thread
+  int batchSize_x;            ///< Max packets read from a queue at once
 
   char tunName_[IFNAMSIZ];
-  int tunFd_;
-  char buffer_[MAX_BUF_SIZE];
-  boost::scoped_ptr< boost::thread > rxThread_;
+  std::vector<int> tunFds_;   ///< one per queue, the first one is written to
+  uint8_t buffer_[MAX_BUF_SIZE];
+  std::vector< boost::shared_ptr<TunTapReader> > readers_;
+  std::vector< boost::shared_ptr<boost::thread> > rxThreads_;
 
   // private functions
   void processMessage(boost::shared_ptr<StackDataSet> incomingFrame);
-  void rxThreadFunction();
-  int allocateTunDevice(char *dev, int flags);
+  void rxThreadFunction(TunTapReader* reader);
 
 };
 
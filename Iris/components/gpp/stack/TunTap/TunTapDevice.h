@@ -0,0 +1,221 @@
+/**
+ * \file components/gpp/stack/TunTap/TunTapDevice.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Opening the queues of a tun/tap device and reading packets from them
+ * in batches.
+ */
+
+#ifndef STACK_TUNTAPDEVICE_H_
+#define STACK_TUNTAPDEVICE_H_
+
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <linux/if.h>
+#include <linux/if_tun.h>
+#include <boost/cstdint.hpp>
+#include <irisapi/Logging.h>
+
+namespace iris
+{
+namespace stack
+{
+
+/* Open one queue of a tun/tap device
+*
+* code shamelessly taken from
+* http://backreference.org/2010/03/26/tuntap-interface-tutorial/
+*
+* char *dev: the name of an interface (or '\0'). MUST have enough
+*   space to hold the interface name (IFNAMSIZ) if '\0' is passed
+* int flags: interface flags (eg, IFF_TUN etc.). With IFF_MULTI_QUEUE
+*   each call with the same name attaches another queue to the device.
+*
+* Returns the file descriptor of the queue, or a negative value on error.
+*/
+inline int allocateTunTapQueue(char *dev, int flags)
+{
+  struct ifreq ifr;
+  int fd, err;
+  const char *clonedev = (const char *)"/dev/net/tun";
+
+  // open the clone device
+  if((fd = open(clonedev, O_RDWR)) < 0)
+  {
+    return fd;
+  }
+
+  // preparation of the struct ifr, of type "struct ifreq"
+  memset(&ifr, 0, sizeof(ifr));
+
+  ifr.ifr_flags = flags;   // IFF_TUN or IFF_TAP, plus maybe IFF_NO_PI
+
+  if (*dev)
+  {
+    // if a device name was specified, put it in the structure; otherwise,
+    // the kernel will try to allocate the "next" device of the
+    // specified type
+    strncpy(ifr.ifr_name, dev, IFNAMSIZ);
+  }
+
+  // try to create the device
+  if((err = ioctl(fd, TUNSETIFF, (void *) &ifr)) < 0)
+  {
+    close(fd);
+    return err;
+  }
+
+  // if the operation was successful, write back the name of the
+  // interface to the variable "dev", so the caller can know it
+  strcpy(dev, ifr.ifr_name);
+
+  // this is the special file descriptor that the caller will use to talk
+  // with the virtual interface
+  return fd;
+}
+
+/** Reads packets from one queue of a tun/tap device in batches.
+ *
+ * The queue is switched to non-blocking mode and waited on with epoll.
+ * Once it is readable, read() takes packets until the queue is empty or
+ * the batch is full, each straight into its own slot of a buffer
+ * allocated up front. The packets stay valid until the next read().
+ *
+ * wakeup() makes a read() waiting in another thread return at once, so
+ * a reader thread can be stopped without a timeout.
+ *
+ * Linux only (epoll, eventfd).
+ */
+class TunTapReader
+{
+public:
+  /** Prepare to read from a queue
+   *
+   * @param fd         The queue, as returned by allocateTunTapQueue()
+   * @param batch      Most packets to read per read() call
+   * @param maxPacket  Size of each packet slot - longer packets are truncated
+   */
+  TunTapReader(int fd, std::size_t batch, std::size_t maxPacket)
+    :fd_(fd), maxPacket_(maxPacket), buffer_(batch * maxPacket), sizes_(batch)
+  {
+    epollFd_ = epoll_create(2);
+    wakeFd_ = eventfd(0, EFD_NONBLOCK);
+    if(epollFd_ < 0 || wakeFd_ < 0 || fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) | O_NONBLOCK) < 0)
+    {
+      LOG(LERROR) << "Failed to set up reading from tun/tap queue: " << strerror(errno);
+      return;
+    }
+    epoll_event e;
+    e.events = EPOLLIN;
+    e.data.fd = fd_;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd_, &e);
+    e.data.fd = wakeFd_;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &e);
+  }
+
+  ~TunTapReader()
+  {
+    if(wakeFd_ >= 0)
+      close(wakeFd_);
+    if(epollFd_ >= 0)
+      close(epollFd_);
+  }
+
+  /** Wait for packets and read them
+   *
+   * @param timeout  Most milliseconds to wait, -1 to wait until woken up
+   * @return The number of packets read - 0 on timeout, wakeup or error
+   */
+  std::size_t read(int timeout)
+  {
+    epoll_event events[2];
+    int n = epoll_wait(epollFd_, events, 2, timeout);
+    if(n < 0 && errno != EINTR)
+      LOG(LERROR) << "Error while waiting for tun/tap queue: " << strerror(errno);
+    bool readable = false;
+    for(int i=0; i<n; i++)
+    {
+      if(events[i].data.fd == wakeFd_)
+        return 0;
+      readable = true;
+    }
+    if(!readable)
+      return 0;
+
+    std::size_t count = 0;
+    while(count < sizes_.size())
+    {
+      ssize_t got = ::read(fd_, &buffer_[count * maxPacket_], maxPacket_);
+      if(got < 0)
+      {
+        if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+          LOG(LERROR) << "Error while reading from tun/tap queue: " << strerror(errno);
+        break;
+      }
+      sizes_[count++] = got;
+    }
+    return count;
+  }
+
+  /// Packet i of the last read()
+  const uint8_t* packet(std::size_t i) const { return &buffer_[i * maxPacket_]; }
+
+  /// Size of packet i of the last read()
+  std::size_t packetSize(std::size_t i) const { return sizes_[i]; }
+
+  /// Make a waiting read() return - and every read() after it
+  void wakeup()
+  {
+    uint64_t one = 1;
+    if(write(wakeFd_, &one, sizeof(one)) < 0)
+      LOG(LERROR) << "Failed to wake up tun/tap reader: " << strerror(errno);
+  }
+
+private:
+  TunTapReader(const TunTapReader&);
+  TunTapReader& operator=(const TunTapReader&);
+
+  int fd_;
+  int epollFd_;
+  int wakeFd_;
+  std::size_t maxPacket_;
+  std::vector<uint8_t> buffer_;
+  std::vector<std::size_t> sizes_;
+};
+
+} // namespace stack
+} // namespace iris
+
+#endif // STACK_TUNTAPDEVICE_H_
@@ -0,0 +1,288 @@
+/**
+ * \file components/gpp/stack/TunTap/benchmark/TunTap_benchmark.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Packets/s and Mbit/s read from and written to a tun device, with the
+ * way TunTapComponent used to do it and the way it does it now.
+ *
+ * The benchmark creates a tun device with an address of its own and
+ * sends UDP packets to a peer address behind it, which the kernel routes
+ * into the device. It needs CAP_NET_ADMIN (e.g. run as root or in a
+ * network namespace with "unshare -rn") and is skipped otherwise.
+ */
+
+#include "TunTapDevice.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <irisapi/StackDataBuffer.h>
+
+using namespace std;
+using namespace iris;
+using namespace iris::stack;
+namespace bp = boost::posix_time;
+
+static const char* LOCAL_IP = "10.213.0.1";
+static const char* PEER_IP = "10.213.0.2";
+static const size_t MAX_PACKET = 10 * 1024;
+static const int DURATION_MS = 1000;
+
+struct Counter
+{
+  Counter() :packets(0), bytes(0) {}
+  uint64_t packets;
+  uint64_t bytes;
+};
+
+/// Give the device its address and bring it up
+bool configure(const char* name)
+{
+  int s = socket(AF_INET, SOCK_DGRAM, 0);
+  struct ifreq ifr;
+  memset(&ifr, 0, sizeof(ifr));
+  strncpy(ifr.ifr_name, name, IFNAMSIZ - 1);
+  sockaddr_in* addr = reinterpret_cast<sockaddr_in*>(&ifr.ifr_addr);
+  addr->sin_family = AF_INET;
+  inet_aton(LOCAL_IP, &addr->sin_addr);
+  bool ok = ioctl(s, SIOCSIFADDR, &ifr) == 0;
+  inet_aton("255.255.255.0", &addr->sin_addr);
+  ok = ok && ioctl(s, SIOCSIFNETMASK, &ifr) == 0;
+  ok = ok && ioctl(s, SIOCGIFFLAGS, &ifr) == 0;
+  ifr.ifr_flags |= IFF_UP | IFF_RUNNING;
+  ok = ok && ioctl(s, SIOCSIFFLAGS, &ifr) == 0;
+  close(s);
+  return ok;
+}
+
+/// Send UDP packets to the peer until interrupted
+void sender(size_t payload, unsigned short port)
+{
+  int s = socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in dest;
+  memset(&dest, 0, sizeof(dest));
+  dest.sin_family = AF_INET;
+  dest.sin_port = htons(port);
+  inet_aton(PEER_IP, &dest.sin_addr);
+  vector<char> data(payload, 'x');
+  while(!boost::this_thread::interruption_requested())
+    sendto(s, &data[0], data.size(), 0, reinterpret_cast<sockaddr*>(&dest), sizeof(dest));
+  close(s);
+}
+
+/// TunTapComponent before: select() with a timeout, read() into a stack buffer
+void selectReader(int fd, Counter* counter)
+{
+  char buffer[MAX_PACKET];
+  while(!boost::this_thread::interruption_requested())
+  {
+    fd_set socketSet;
+    FD_ZERO(&socketSet);
+    FD_SET(fd, &socketSet);
+    struct timeval selectTimeout;
+    selectTimeout.tv_sec = 0;
+    selectTimeout.tv_usec = 100000;
+    if(select(fd + 1, &socketSet, NULL, NULL, &selectTimeout) <= 0)
+      continue;
+    int nread = read(fd, buffer, MAX_PACKET);
+    if(nread < 0)
+      continue;
+    boost::shared_ptr<StackDataSet> set(new StackDataSet);
+    set->data.assign(buffer, buffer + nread);
+    counter->packets++;
+    counter->bytes += nread;
+  }
+}
+
+/// TunTapComponent now: epoll and batched reads into the TunTapReader buffer
+void batchReader(TunTapReader* reader, Counter* counter)
+{
+  while(!boost::this_thread::interruption_requested())
+  {
+    size_t n = reader->read(-1);
+    for(size_t i=0; i<n; i++)
+    {
+      boost::shared_ptr<StackDataSet> set(new StackDataSet);
+      set->data.assign(reader->packet(i), reader->packet(i) + reader->packetSize(i));
+      counter->packets++;
+      counter->bytes += reader->packetSize(i);
+    }
+  }
+}
+
+void report(string name, const vector<Counter>& counters, double seconds)
+{
+  Counter total;
+  for(size_t i=0; i<counters.size(); i++)
+  {
+    total.packets += counters[i].packets;
+    total.bytes += counters[i].bytes;
+  }
+  cout << "  " << setw(34) << left << name << fixed << setprecision(0)
+       << setw(10) << right << total.packets / seconds << " packets/s "
+       << setprecision(1) << setw(8) << total.bytes * 8 / seconds / 1e6 << " Mbit/s" << endl;
+}
+
+/** Read from a device with the given number of queues for a while
+ *
+ * @param batch  Packets per read with TunTapReader, 0 for the old select() reader
+ */
+void runRx(string name, size_t payload, size_t queues, size_t batch)
+{
+  char dev[IFNAMSIZ] = "irisbench%d";
+  int flags = IFF_TUN | IFF_NO_PI;
+  if(queues > 1)
+    flags |= IFF_MULTI_QUEUE;
+  vector<int> fds;
+  for(size_t i=0; i<queues; i++)
+  {
+    int fd = allocateTunTapQueue(dev, flags);
+    if(fd < 0)
+    {
+      cout << "  " << name << ": cannot create tun device - skipped." << endl;
+      return;
+    }
+    fds.push_back(fd);
+  }
+  if(!configure(dev))
+  {
+    cout << "  " << name << ": cannot configure " << dev << " - skipped." << endl;
+    return;
+  }
+
+  vector<Counter> counters(queues);
+  vector< boost::shared_ptr<TunTapReader> > readers;
+  boost::thread_group readerThreads, senderThreads;
+  for(size_t i=0; i<queues; i++)
+  {
+    if(batch == 0)
+    {
+      readerThreads.create_thread(boost::bind(selectReader, fds[i], &counters[i]));
+    }
+    else
+    {
+      readers.push_back(boost::shared_ptr<TunTapReader>(new TunTapReader(fds[i], batch, MAX_PACKET)));
+      readerThreads.create_thread(boost::bind(batchReader, readers.back().get(), &counters[i]));
+    }
+  }
+  // one flow per queue, the kernel spreads them by their hash
+  bp::ptime t1(bp::microsec_clock::local_time());
+  for(size_t i=0; i<queues; i++)
+    senderThreads.create_thread(boost::bind(sender, payload, 5000 + i));
+  boost::this_thread::sleep(bp::milliseconds(DURATION_MS));
+  senderThreads.interrupt_all();
+  senderThreads.join_all();
+  bp::ptime t2(bp::microsec_clock::local_time());
+
+  // let the readers drain the device
+  boost::this_thread::sleep(bp::milliseconds(50));
+  readerThreads.interrupt_all();
+  for(size_t i=0; i<readers.size(); i++)
+    readers[i]->wakeup();
+  readerThreads.join_all();
+  report(name, counters, (t2-t1).total_microseconds() / 1e6);
+
+  readers.clear();
+  for(size_t i=0; i<fds.size(); i++)
+    close(fds[i]);
+}
+
+/** Write IPv4 packets from StackDataSets to a device for a while
+ *
+ * @param byteLoop  Copy the frame byte by byte like TunTapComponent used to
+ */
+void runTx(string name, size_t size, bool byteLoop)
+{
+  char dev[IFNAMSIZ] = "irisbench%d";
+  int fd = allocateTunTapQueue(dev, IFF_TUN | IFF_NO_PI);
+  if(fd < 0 || !configure(dev))
+  {
+    cout << "  " << name << ": cannot create tun device - skipped." << endl;
+    return;
+  }
+
+  // a packet for the peer address, which the kernel won't forward
+  StackDataSet frame;
+  frame.data.assign(size, 0);
+  uint8_t ip[20] = {0x45, 0, uint8_t(size >> 8), uint8_t(size), 0, 0, 0, 0, 64, 17, 0, 0,
+                    10, 213, 0, 3, 10, 213, 0, 2};
+  copy(ip, ip + sizeof(ip), frame.data.begin());
+
+  uint8_t buffer[MAX_PACKET];
+  vector<Counter> counters(1);
+  bp::ptime t1(bp::microsec_clock::local_time());
+  bp::ptime t2 = t1;
+  while((t2-t1).total_milliseconds() < DURATION_MS)
+  {
+    for(int r=0; r<1000; r++)
+    {
+      if(byteLoop)
+        for (int i = 0; i < (int)size; i++)
+          buffer[i] = frame.data[i];
+      else
+        copy(frame.data.begin(), frame.data.end(), buffer);
+      if(write(fd, buffer, size) == (ssize_t)size)
+      {
+        counters[0].packets++;
+        counters[0].bytes += size;
+      }
+    }
+    t2 = bp::microsec_clock::local_time();
+  }
+  report(name, counters, (t2-t1).total_microseconds() / 1e6);
+  close(fd);
+}
+
+int main(int argc, char* argv[])
+{
+  size_t sizes[] = {64, 1400};
+  for(size_t s=0; s<2; s++)
+  {
+    cout << "Rx, " << sizes[s] << " B UDP payload:" << endl;
+    runRx("select, 1 queue (before)", sizes[s], 1, 0);
+    runRx("epoll batch 32, 1 queue", sizes[s], 1, 32);
+    runRx("epoll batch 32, 4 queues", sizes[s], 4, 32);
+  }
+  for(size_t s=0; s<2; s++)
+  {
+    size_t size = sizes[s] + 28;
+    cout << "Tx, " << size << " B IP packets:" << endl;
+    runTx("byte loop (before)", size, true);
+    runTx("std::copy", size, false);
+  }
+}
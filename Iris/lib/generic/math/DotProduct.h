@@ -0,0 +1,175 @@
+/**
+ * \file DotProduct.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Vectorised dot products for filtering and resampling.
+ */
+
+#ifndef DOTPRODUCT_H_
+#define DOTPRODUCT_H_
+
+#include <complex>
+#include <cstddef>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace iris
+{
+
+/** Computes the dot product sum(coeffs[i]*input[i]) of two contiguous arrays.
+ *
+ * The generic version works for any types which can be multiplied and
+ * accumulated in AccT. Specialisations using SSE2 are provided for float
+ * and complex<float> inputs with float or complex<float> coefficients.
+ */
+template <class AccT, class CoeffT, class InT>
+struct DotProduct
+{
+  static AccT apply(const CoeffT* coeffs, const InT* input, std::size_t n)
+  {
+    AccT acc = AccT();
+    for (std::size_t i = 0; i < n; ++i)
+      acc += coeffs[i] * input[i];
+    return acc;
+  }
+};
+
+#ifdef __SSE2__
+
+namespace dotdetail
+{
+/// Sum the four lanes of an SSE register
+inline float hsum(__m128 v)
+{
+  __m128 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+  s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+  return _mm_cvtss_f32(s);
+}
+} // namespace dotdetail
+
+/// Real coefficients, real input
+template <>
+struct DotProduct<float, float, float>
+{
+  static float apply(const float* coeffs, const float* input, std::size_t n)
+  {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+      acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(coeffs + i),
+                                         _mm_loadu_ps(input + i)));
+      acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(coeffs + i + 4),
+                                         _mm_loadu_ps(input + i + 4)));
+    }
+    float acc = dotdetail::hsum(_mm_add_ps(acc0, acc1));
+    for (; i < n; ++i)
+      acc += coeffs[i] * input[i];
+    return acc;
+  }
+};
+
+/// Real coefficients, complex input
+template <>
+struct DotProduct<std::complex<float>, float, std::complex<float> >
+{
+  static std::complex<float> apply(const float* coeffs,
+                                   const std::complex<float>* input,
+                                   std::size_t n)
+  {
+    const float* in = reinterpret_cast<const float*>(input);
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+      // [h0 h1 h2 h3] -> [h0 h0 h1 h1] and [h2 h2 h3 h3]
+      __m128 h = _mm_loadu_ps(coeffs + i);
+      acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_unpacklo_ps(h, h),
+                                         _mm_loadu_ps(in + 2*i)));
+      acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_unpackhi_ps(h, h),
+                                         _mm_loadu_ps(in + 2*i + 4)));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, _mm_add_ps(acc0, acc1));
+    std::complex<float> acc(lanes[0] + lanes[2], lanes[1] + lanes[3]);
+    for (; i < n; ++i)
+      acc += coeffs[i] * input[i];
+    return acc;
+  }
+};
+
+/// Complex coefficients, complex input
+template <>
+struct DotProduct<std::complex<float>, std::complex<float>, std::complex<float> >
+{
+  static std::complex<float> apply(const std::complex<float>* coeffs,
+                                   const std::complex<float>* input,
+                                   std::size_t n)
+  {
+    const float* h = reinterpret_cast<const float*>(coeffs);
+    const float* in = reinterpret_cast<const float*>(input);
+    // For x = a+jb, h = c+jd accumulate [ac bd] and [ad bc]
+    __m128 accDirect = _mm_setzero_ps();
+    __m128 accCross = _mm_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+    {
+      __m128 x = _mm_loadu_ps(in + 2*i);
+      __m128 c = _mm_loadu_ps(h + 2*i);
+      accDirect = _mm_add_ps(accDirect, _mm_mul_ps(x, c));
+      accCross = _mm_add_ps(accCross, _mm_mul_ps(x,
+                     _mm_shuffle_ps(c, c, _MM_SHUFFLE(2,3,0,1))));
+    }
+    float d[4], x[4];
+    _mm_storeu_ps(d, accDirect);
+    _mm_storeu_ps(x, accCross);
+    std::complex<float> acc(d[0] - d[1] + d[2] - d[3],
+                            x[0] + x[1] + x[2] + x[3]);
+    for (; i < n; ++i)
+      acc += coeffs[i] * input[i];
+    return acc;
+  }
+};
+
+#endif // __SSE2__
+
+/// Convenience function - deduces the coefficient and input types
+template <class AccT, class CoeffT, class InT>
+inline AccT dotProduct(const CoeffT* coeffs, const InT* input, std::size_t n)
+{
+  return DotProduct<AccT, CoeffT, InT>::apply(coeffs, input, n);
+}
+
+} // namespace iris
+
+#endif // DOTPRODUCT_H_
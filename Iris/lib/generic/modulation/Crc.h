@@ -43,7 +43,7 @@ namespace iris
 namespace crcdetail
 {
 
-uint32_t crcTable[256]= {
+static const uint32_t crcTable[256]= {
   0x00000000U,0x04C11DB7U,0x09823B6EU,0x0D4326D9U,0x130476DCU,0x17C56B6BU,0x1A864DB2U,0x1E475005U,
   0x2608EDB8U,0x22C9F00FU,0x2F8AD6D6U,0x2B4BCB61U,0x350C9B64U,0x31CD86D3U,0x3C8EA00AU,0x384FBDBDU,
   0x4C11DB70U,0x48D0C6C7U,0x4593E01EU,0x4152FDA9U,0x5F15ADACU,0x5BD4B01BU,0x569796C2U,0x52568B75U,
@@ -45,7 +45,7 @@ namespace whitenerdetail
 {
 
 /// The code used to whiten incoming data
-uint8_t whitenCode[4096] = {
+static const uint8_t whitenCode[4096] = {
 	255,  63,   0,  16,   0,  12,   0,   5, 192,   3,  16,   1, 204,   0,  85, 192,
 	63,  16,  16,  12,  12,   5, 197, 195,  19,  17, 205, 204,  85, 149, 255,  47, 
 	0,  28,   0,   9, 192,   6, 208,   2, 220,   1, 153, 192, 106, 208,  47,  28, 
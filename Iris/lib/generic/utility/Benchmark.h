@@ -0,0 +1,495 @@
+/**
+ * \file Benchmark.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * A small framework for statistical micro-benchmarks.
+ */
+
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/foreach.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#ifdef __linux__
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace iris
+{
+
+/** Counts CPU cycles.
+ *
+ * The hardware cycle counter is read through perf events on Linux if the
+ * kernel allows it. Otherwise the x86 time stamp counter is used, which
+ * ticks at a fixed reference rate rather than the current clock rate.
+ * On other targets there is no counter and read() returns 0.
+ */
+class CycleCounter
+{
+public:
+  CycleCounter()
+    :fd_(-1)
+  {
+#ifdef __linux__
+    perf_event_attr attr;
+    std::fill((char*)&attr, (char*)&attr + sizeof(attr), 0);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    boost::uint64_t value;
+    if(fd_ >= 0 && ::read(fd_, &value, sizeof(value)) != sizeof(value))
+    {
+      close(fd_);
+      fd_ = -1;
+    }
+#endif
+  }
+
+  ~CycleCounter()
+  {
+#ifdef __linux__
+    if(fd_ >= 0)
+      close(fd_);
+#endif
+  }
+
+  /// Where the cycles come from - "perf", "tsc" or "none"
+  std::string source() const
+  {
+    if(fd_ >= 0)
+      return "perf";
+#if defined(__i386__) || defined(__x86_64__) || defined(_MSC_VER)
+    return "tsc";
+#else
+    return "none";
+#endif
+  }
+
+  boost::uint64_t read() const
+  {
+#ifdef __linux__
+    boost::uint64_t value;
+    if(fd_ >= 0 && ::read(fd_, &value, sizeof(value)) == sizeof(value))
+      return value;
+#endif
+#if defined(__i386__) || defined(__x86_64__)
+    boost::uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return (boost::uint64_t(hi) << 32) | lo;
+#elif defined(_MSC_VER)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+  }
+
+private:
+  CycleCounter(const CycleCounter&);
+  CycleCounter& operator=(const CycleCounter&);
+
+  int fd_;
+};
+
+/// Quote a string for JSON, escaping quotes, backslashes and control characters
+inline std::string jsonString(const std::string& s)
+{
+  std::string out("\"");
+  for(std::size_t i=0; i<s.size(); i++)
+  {
+    unsigned char c = s[i];
+    if(c == '"' || c == '\\')
+    {
+      out += '\\';
+      out += c;
+    }
+    else if(c < 0x20)
+    {
+      char buf[8];
+      std::sprintf(buf, "\\u%04x", c);
+      out += buf;
+    }
+    else
+      out += c;
+  }
+  return out + "\"";
+}
+
+/// The measurements of one benchmark case, with times per item in ns
+struct BenchmarkResult
+{
+  std::string name;
+  std::string unit;             ///< What an item is, e.g. "sample"
+  double itemsPerCall;          ///< Items handled by one call of the function
+  int calls;                    ///< Calls per timed run
+  std::vector<double> times;    ///< ns per item of each run, sorted
+  double median;
+  double p99;
+  double min;
+  double mean;
+  double stddev;
+  double cycles;                ///< Median cycles per item (0 without a counter)
+
+  /// Millions of items per second at the median time
+  double rate() const { return median > 0 ? 1e3/median : 0; }
+};
+
+/** Runs micro-benchmarks and reports their statistics.
+ *
+ * Each case is a function object whose call does one unit of work, such
+ * as one process() call of a component. After a warm-up, which also
+ * decides how many calls make up one timed run, the case is timed over a
+ * number of runs. The median, 99th percentile, minimum, mean and standard
+ * deviation of the time per item, and the median cycles per item, are
+ * printed.
+ *
+ * The command line of the benchmark is read for these options:
+ *
+ *   --runs N          Timed runs per case (default 30)
+ *   --mintime S       Minimum time of one run in seconds (default 0.01)
+ *   --warmup S        Warm-up time per case in seconds (default 0.1)
+ *   --cpu N           Pin the process to CPU N (default: the current CPU,
+ *                     -1 to not pin)
+ *   --json FILE       Write the results to FILE as JSON
+ *   --label TEXT      Label for the JSON results, e.g. a commit id
+ *   --baseline FILE   Compare the medians with a JSON file written before
+ *   --threshold F     Fraction by which a median may exceed the baseline
+ *                     before it is a regression (default 0.1)
+ *
+ * Other arguments are ignored. finish() returns the exit code for main():
+ * REGRESSED (1) if any case regressed against the baseline and NO_BASELINE
+ * (2) if a baseline was given but could not be read.
+ *
+ * \code
+ *   Benchmark bench("Example", argc, argv);
+ *   bench.run("Process", blockSize, processOneBlock);
+ *   return bench.finish();
+ * \endcode
+ */
+class Benchmark
+{
+public:
+  /// Most calls in one timed run
+  static const int MAX_CALLS = 1 << 30;
+
+  Benchmark(std::string suite, int argc, char* argv[])
+    :suite_(suite), runs_(30), minTime_(0.01), warmupTime_(0.1), cpu_(-2), threshold_(0.1)
+  {
+    for(int i=1; i<argc; i++)
+    {
+      std::string arg = argv[i];
+      std::string value;
+      std::string::size_type eq = arg.find('=');
+      if(eq != std::string::npos)
+      {
+        value = arg.substr(eq + 1);
+        arg = arg.substr(0, eq);
+      }
+      else if(i + 1 < argc && isOption(arg))
+      {
+        value = argv[++i];
+      }
+
+      if(arg == "--runs")
+        runs_ = std::max(1, std::atoi(value.c_str()));
+      else if(arg == "--mintime")
+        minTime_ = std::atof(value.c_str());
+      else if(arg == "--warmup")
+        warmupTime_ = std::atof(value.c_str());
+      else if(arg == "--cpu")
+        cpu_ = std::atoi(value.c_str());
+      else if(arg == "--json")
+        json_ = value;
+      else if(arg == "--label")
+        label_ = value;
+      else if(arg == "--baseline")
+        baseline_ = value;
+      else if(arg == "--threshold")
+        threshold_ = std::atof(value.c_str());
+    }
+    pin();
+  }
+
+  /** Time a benchmark case
+   *
+   * @param name          Name of the case, unique within the suite
+   * @param itemsPerCall  Items (samples, bytes...) handled by each call of f
+   * @param f             Function object doing one call's work
+   * @param unit          What an item is
+   */
+  template <class Function>
+  const BenchmarkResult& run(std::string name, double itemsPerCall, Function& f,
+                             std::string unit = "sample")
+  {
+    // Warm up, doubling the calls until a run would take minTime_
+    int calls = 1;
+    double start = now();
+    while(true)
+    {
+      double t = now();
+      for(int i=0; i<calls; i++)
+        f();
+      double elapsed = now() - t;
+      if(elapsed < minTime_ && calls < MAX_CALLS)
+      {
+        // In double - a call that takes next to no time would overflow an int
+        double grown = elapsed > 0 ? std::max(calls*2.0, calls*minTime_/elapsed) : calls*2.0;
+        calls = int(std::min(grown, double(MAX_CALLS)));
+      }
+      else if(now() - start >= warmupTime_)
+        break;
+    }
+
+    BenchmarkResult res;
+    res.name = name;
+    res.unit = unit;
+    res.itemsPerCall = itemsPerCall;
+    res.calls = calls;
+    std::vector<double> cycles;
+    for(int r=0; r<runs_; r++)
+    {
+      boost::uint64_t c = counter_.read();
+      double t = now();
+      for(int i=0; i<calls; i++)
+        f();
+      t = now() - t;
+      c = counter_.read() - c;
+      res.times.push_back(t*1e9/(calls*itemsPerCall));
+      cycles.push_back(c/(calls*itemsPerCall));
+    }
+
+    std::sort(res.times.begin(), res.times.end());
+    std::sort(cycles.begin(), cycles.end());
+    res.median = percentile(res.times, 0.5);
+    res.p99 = percentile(res.times, 0.99);
+    res.min = res.times.front();
+    res.cycles = percentile(cycles, 0.5);
+    double sum = 0, sumSq = 0;
+    for(size_t i=0; i<res.times.size(); i++)
+    {
+      sum += res.times[i];
+      sumSq += res.times[i]*res.times[i];
+    }
+    res.mean = sum/res.times.size();
+    res.stddev = std::sqrt(std::max(0.0, sumSq/res.times.size() - res.mean*res.mean));
+
+    std::cout << suite_ << " " << name << ": Rate = " << res.rate() << " M" << unit << "s/sec"
+              << ", median " << res.median << " ns/" << unit
+              << ", p99 " << res.p99 << " ns/" << unit;
+    if(counter_.source() != "none")
+      std::cout << ", " << res.cycles << " cycles/" << unit;
+    std::cout << " (" << runs_ << " runs of " << calls << " calls)" << std::endl;
+
+    results_.push_back(res);
+    return results_.back();
+  }
+
+  /// Exit codes returned by finish()
+  enum ExitCode
+  {
+    PASSED = 0,         ///< No case regressed, or there was no baseline
+    REGRESSED = 1,      ///< A median is slower than the baseline allows
+    NO_BASELINE = 2     ///< The baseline could not be read
+  };
+
+  /// Write the JSON results and compare with the baseline; returns the exit code
+  int finish()
+  {
+    if(!json_.empty())
+      writeJson();
+    if(!baseline_.empty())
+      return compare();
+    return PASSED;
+  }
+
+  const std::vector<BenchmarkResult>& getResults() const { return results_; }
+
+private:
+  static bool isOption(const std::string& arg)
+  {
+    return arg == "--runs" || arg == "--mintime" || arg == "--warmup" || arg == "--cpu" ||
+           arg == "--json" || arg == "--label" || arg == "--baseline" || arg == "--threshold";
+  }
+
+  /// Value at fraction p of a sorted vector (nearest rank)
+  static double percentile(const std::vector<double>& sorted, double p)
+  {
+    if(sorted.empty())
+      return 0;
+    size_t i = size_t(std::ceil(p*sorted.size()));
+    return sorted[std::min(sorted.size() - 1, i > 0 ? i - 1 : 0)];
+  }
+
+  /// Monotonic time in seconds
+  static double now()
+  {
+#ifdef __linux__
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec*1e-9;
+#else
+    using namespace boost::posix_time;
+    static const ptime epoch(microsec_clock::local_time());
+    return (microsec_clock::local_time() - epoch).total_microseconds()*1e-6;
+#endif
+  }
+
+  /// Keep the process on one CPU, so runs don't migrate between cores
+  void pin()
+  {
+#ifdef __linux__
+    if(cpu_ == -2)
+      cpu_ = sched_getcpu();
+    if(cpu_ < 0)
+      return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu_, &set);
+    if(sched_setaffinity(0, sizeof(set), &set) != 0)
+    {
+      std::cerr << "Benchmark: could not pin to CPU " << cpu_ << std::endl;
+      cpu_ = -1;
+    }
+#else
+    cpu_ = -1;
+#endif
+  }
+
+  void writeJson() const
+  {
+    std::ofstream out(json_.c_str());
+    if(!out)
+    {
+      std::cerr << "Benchmark: could not write " << json_ << std::endl;
+      return;
+    }
+    out << std::setprecision(6)
+        << "{\n"
+        << "  \"suite\": " << jsonString(suite_) << ",\n"
+        << "  \"label\": " << jsonString(label_) << ",\n"
+        << "  \"time\": \"" << boost::posix_time::to_iso_extended_string(
+                                boost::posix_time::second_clock::universal_time()) << "\",\n"
+        << "  \"cpu\": " << cpu_ << ",\n"
+        << "  \"cycles\": \"" << counter_.source() << "\",\n"
+        << "  \"results\": [\n";
+    for(size_t i=0; i<results_.size(); i++)
+    {
+      const BenchmarkResult& r = results_[i];
+      out << "    {\"name\": " << jsonString(r.name)
+          << ", \"unit\": " << jsonString(r.unit)
+          << ", \"items_per_call\": " << r.itemsPerCall
+          << ", \"calls\": " << r.calls
+          << ", \"runs\": " << r.times.size()
+          << ", \"median_ns\": " << r.median
+          << ", \"p99_ns\": " << r.p99
+          << ", \"min_ns\": " << r.min
+          << ", \"mean_ns\": " << r.mean
+          << ", \"stddev_ns\": " << r.stddev
+          << ", \"cycles\": " << r.cycles
+          << ", \"rate\": " << r.rate() << "}"
+          << (i + 1 < results_.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n"
+        << "}" << std::endl;
+  }
+
+  /// Compare the medians with the baseline; returns the exit code
+  int compare() const
+  {
+    namespace pt = boost::property_tree;
+    std::map<std::string, double> base;
+    try
+    {
+      pt::ptree tree;
+      pt::read_json(baseline_, tree);
+      BOOST_FOREACH(const pt::ptree::value_type& v, tree.get_child("results"))
+        base[v.second.get<std::string>("name")] = v.second.get<double>("median_ns");
+    }
+    catch(pt::ptree_error& e)
+    {
+      std::cerr << "Benchmark: could not read baseline " << baseline_ << ": " << e.what() << std::endl;
+      return NO_BASELINE;
+    }
+
+    bool ok = true;
+    for(size_t i=0; i<results_.size(); i++)
+    {
+      const BenchmarkResult& r = results_[i];
+      std::map<std::string, double>::const_iterator it = base.find(r.name);
+      if(it == base.end() || it->second <= 0)
+        continue;
+      double change = r.median/it->second - 1;
+      bool regressed = change > threshold_;
+      std::cout << suite_ << " " << r.name << ": " << std::showpos << change*100 << std::noshowpos
+                << "% against baseline" << (regressed ? " - REGRESSION" : "") << std::endl;
+      ok = ok && !regressed;
+    }
+    return ok ? PASSED : REGRESSED;
+  }
+
+  std::string suite_;
+  int runs_;
+  double minTime_;
+  double warmupTime_;
+  int cpu_;             ///< CPU we are pinned to, -1 if none
+  double threshold_;
+  std::string json_;
+  std::string label_;
+  std::string baseline_;
+  CycleCounter counter_;
+  std::vector<BenchmarkResult> results_;
+};
+
+} // namespace iris
+
+#endif // BENCHMARK_H_
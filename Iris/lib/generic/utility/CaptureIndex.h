@@ -0,0 +1,301 @@
+/**
+ * \file CaptureIndex.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * A sidecar index for capture files, used to seek to a point in time
+ * and to split a capture into time ranges.
+ */
+
+#ifndef CAPTUREINDEX_H_
+#define CAPTUREINDEX_H_
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+
+#include "EndianConversion.h"
+
+namespace iris
+{
+
+/// One point in a capture file
+struct CaptureIndexEntry
+{
+  uint64_t sampleOffset;  ///< Number of samples in the file before this point
+  uint64_t byteOffset;    ///< Position of this point in the file
+  double timeStamp;       ///< Time of the sample at this point
+  double frequency;       ///< Centre frequency when the sample was captured
+  double gain;            ///< Receive gain when the sample was captured
+};
+
+/// A part of a capture file which can be replayed on its own
+struct CaptureRange
+{
+  double startTime;       ///< Time of the first sample
+  double stopTime;        ///< Time of the first sample after the range (-1 = end of file)
+  uint64_t startByte;     ///< Position of the first sample in the file
+  uint64_t stopByte;      ///< Position after the last sample (0 = end of file)
+  uint64_t startSample;   ///< Number of samples in the file before the range
+};
+
+namespace captureindex
+{
+  static const char MAGIC[8] = {'I','R','I','S','I','D','X','\0'};
+  static const uint32_t VERSION = 1;
+  static const std::size_t HEADER_SIZE = 32;
+  static const std::size_t ENTRY_SIZE = 40;
+
+  template <typename T>
+  inline void put(char* p, T x)
+  {
+    x = sys2lit(x);
+    memcpy(p, &x, sizeof(T));
+  }
+
+  template <typename T>
+  inline T get(const char* p)
+  {
+    T x;
+    memcpy(&x, p, sizeof(T));
+    return lit2sys(x);
+  }
+
+  inline bool earlier(const CaptureIndexEntry& a, double t)
+  {
+    return a.timeStamp < t;
+  }
+
+  inline bool later(double t, const CaptureIndexEntry& a)
+  {
+    return t < a.timeStamp;
+  }
+} // namespace captureindex
+
+/** Writes the index of a capture file as the capture is written.
+ *
+ * The index of "capture.bin" is kept in "capture.bin.idx". It starts with a
+ * 32 byte header:
+ *   - magic "IRISIDX\0" (8 bytes)
+ *   - version (uint32, currently 1)
+ *   - size of an entry in bytes (uint32, 40)
+ *   - sample rate (double)
+ *   - nominal number of samples between entries (uint64)
+ *
+ * followed by one 40 byte CaptureIndexEntry after another (the fields in
+ * order, uint64 and double). All fields are little-endian. Entries are
+ * appended, so if the capture is interrupted the index still holds every
+ * entry which made it to disk.
+ */
+class CaptureIndexWriter
+{
+public:
+  /** Create the index file
+   *
+   * @param filename    The index file
+   * @param sampleRate  Sample rate of the capture
+   * @param interval    Nominal number of samples between entries
+   * @return            false if the file could not be created
+   */
+  bool open(std::string filename, double sampleRate, uint64_t interval)
+  {
+    using namespace captureindex;
+    close();
+    file_.open(filename.c_str(), std::ios::binary | std::ios::trunc);
+    if(!file_.is_open())
+      return false;
+
+    char header[HEADER_SIZE];
+    memcpy(header, MAGIC, sizeof(MAGIC));
+    put<uint32_t>(header + 8, VERSION);
+    put<uint32_t>(header + 12, ENTRY_SIZE);
+    put<double>(header + 16, sampleRate);
+    put<uint64_t>(header + 24, interval);
+    file_.write(header, HEADER_SIZE);
+    return file_.good();
+  }
+
+  bool isOpen() const { return file_.is_open(); }
+
+  /// Add an entry - entries must be added in order of time
+  void add(const CaptureIndexEntry& e)
+  {
+    using namespace captureindex;
+    char buf[ENTRY_SIZE];
+    put<uint64_t>(buf, e.sampleOffset);
+    put<uint64_t>(buf + 8, e.byteOffset);
+    put<double>(buf + 16, e.timeStamp);
+    put<double>(buf + 24, e.frequency);
+    put<double>(buf + 32, e.gain);
+    file_.write(buf, ENTRY_SIZE);
+  }
+
+  void close()
+  {
+    if(file_.is_open())
+      file_.close();
+  }
+
+private:
+  std::ofstream file_;
+};
+
+/** The index of a capture file.
+ *
+ * Entries are sorted by time, so the entry for a given time is found with
+ * a binary search. A capture can be replayed from any entry and split at
+ * entries into ranges which can be replayed independently (e.g. by several
+ * processes at once).
+ */
+class CaptureIndex
+{
+public:
+  CaptureIndex()
+    :sampleRate_(0), interval_(0)
+  {}
+
+  /** Load an index file
+   *
+   * @param filename  The index file
+   * @return          false if the file could not be read or is not an index
+   */
+  bool load(std::string filename)
+  {
+    using namespace captureindex;
+    entries_.clear();
+    std::ifstream file(filename.c_str(), std::ios::binary);
+    char header[HEADER_SIZE];
+    if(!file.read(header, HEADER_SIZE) || memcmp(header, MAGIC, sizeof(MAGIC)) != 0
+       || get<uint32_t>(header + 8) != VERSION
+       || get<uint32_t>(header + 12) != ENTRY_SIZE)
+      return false;
+    sampleRate_ = get<double>(header + 16);
+    interval_ = get<uint64_t>(header + 24);
+
+    //A partial entry at the end is ignored
+    char buf[ENTRY_SIZE];
+    while(file.read(buf, ENTRY_SIZE))
+    {
+      CaptureIndexEntry e;
+      e.sampleOffset = get<uint64_t>(buf);
+      e.byteOffset = get<uint64_t>(buf + 8);
+      e.timeStamp = get<double>(buf + 16);
+      e.frequency = get<double>(buf + 24);
+      e.gain = get<double>(buf + 32);
+      entries_.push_back(e);
+    }
+    return true;
+  }
+
+  double sampleRate() const { return sampleRate_; }
+  uint64_t interval() const { return interval_; }
+  std::size_t size() const { return entries_.size(); }
+  bool empty() const { return entries_.empty(); }
+  const CaptureIndexEntry& operator[](std::size_t i) const { return entries_[i]; }
+
+  /** Find the last entry at or before a point in time - O(log n)
+   *
+   * @param t   The time
+   * @return    Index of the entry, 0 if t is before the first entry
+   */
+  std::size_t find(double t) const
+  {
+    std::vector<CaptureIndexEntry>::const_iterator it =
+        std::upper_bound(entries_.begin(), entries_.end(), t, captureindex::later);
+    return it == entries_.begin() ? 0 : it - entries_.begin() - 1;
+  }
+
+  /** Get the range of the file which covers a time interval
+   *
+   * The range starts at the last entry at or before start and stops at
+   * the first entry at or after stop, so it may be a little wider than
+   * the interval.
+   *
+   * @param start   Start time
+   * @param stop    Stop time (< 0 for the end of the file)
+   */
+  CaptureRange range(double start, double stop) const
+  {
+    CaptureRange r = {0, -1, 0, 0, 0};
+    if(entries_.empty())
+      return r;
+    const CaptureIndexEntry& first = entries_[find(start)];
+    r.startTime = first.timeStamp;
+    r.startByte = first.byteOffset;
+    r.startSample = first.sampleOffset;
+    if(stop >= 0)
+    {
+      std::vector<CaptureIndexEntry>::const_iterator it =
+          std::lower_bound(entries_.begin(), entries_.end(), stop, captureindex::earlier);
+      if(it != entries_.end() && it->byteOffset > r.startByte)
+      {
+        r.stopTime = it->timeStamp;
+        r.stopByte = it->byteOffset;
+      }
+    }
+    return r;
+  }
+
+  /** Split the file into ranges of (nearly) equal length
+   *
+   * The ranges are contiguous, the last one runs to the end of the file.
+   *
+   * @param n   Number of ranges wanted - fewer are returned if the index
+   *            has fewer than n entries
+   */
+  std::vector<CaptureRange> split(std::size_t n) const
+  {
+    std::vector<CaptureRange> ranges;
+    n = std::min(n, entries_.size());
+    for(std::size_t i=0; i<n; i++)
+    {
+      const CaptureIndexEntry& first = entries_[i*entries_.size()/n];
+      CaptureRange r = {first.timeStamp, -1, first.byteOffset, 0, first.sampleOffset};
+      if(i+1 < n)
+      {
+        const CaptureIndexEntry& next = entries_[(i+1)*entries_.size()/n];
+        r.stopTime = next.timeStamp;
+        r.stopByte = next.byteOffset;
+      }
+      ranges.push_back(r);
+    }
+    return ranges;
+  }
+
+private:
+  std::vector<CaptureIndexEntry> entries_;
+  double sampleRate_;
+  uint64_t interval_;
+};
+
+} // namespace iris
+
+#endif // CAPTUREINDEX_H_
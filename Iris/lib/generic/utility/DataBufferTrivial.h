@@ -50,8 +50,14 @@ namespace iris
 *	calling ReleaseWriteSet(). Components can get a DataSet to read from by
 *	calling GetReadSet(). When finished reading, the component releases the
 *	DataSet by calling ReleaseReadSet().	The DataBufferTrivial is not
-*	thread-safe. It does not block, and keeps growing if new DataSets are
-*	requested.
+*	thread-safe and does not block.
+*
+*	By default the buffer keeps growing if new DataSets are requested, so every
+*	DataSet ever written can be inspected with getBuffer(). In ring mode the
+*	buffer has a fixed capacity and DataSets (and their data vectors) are
+*	reused, so there is no reallocation once every DataSet has been written
+*	once. Use ring mode for benchmarks which drive components over many
+*	process() calls.
 */
 template <typename T>
 class DataBufferTrivial
@@ -59,8 +65,14 @@ class DataBufferTrivial
 {
 public:
 
-  explicit DataBufferTrivial(std::size_t buffer_size = 3)
+  /** Create a buffer
+   *
+   * @param buffer_size   Initial number of DataSets (the capacity in ring mode)
+   * @param ring          Reuse a fixed number of DataSets instead of growing
+   */
+  explicit DataBufferTrivial(std::size_t buffer_size = 3, bool ring = false)
     :buffer_(buffer_size) ,
+    isRing_(ring),
     isReadLocked_(false),
     isWriteLocked_(false),
     readIndex_(0),
@@ -107,6 +119,8 @@ public:
   {
     if(isWriteLocked_)
       throw DataBufferReleaseException("getWriteData() called before previous DataSet was released");
+    if(isRing_ && !notFull_)
+      throw IrisException("getWriteData() called on a full DataBufferTrivial ring");
     isWriteLocked_ = true;
     if(buffer_[writeIndex_].data.size() != size)
       buffer_[writeIndex_].data.resize(size);
@@ -121,7 +135,10 @@ public:
   {
     if(++readIndex_ == buffer_.size())
     {
-      buffer_.resize(readIndex_+1);
+      if(isRing_)
+        readIndex_ = 0;
+      else
+        buffer_.resize(readIndex_+1);
     }
     if(readIndex_ == writeIndex_)
       notEmpty_ = false;
@@ -138,7 +155,10 @@ public:
   {
     if(++writeIndex_ == buffer_.size())
     {
-      buffer_.resize(writeIndex_+1);
+      if(isRing_)
+        writeIndex_ = 0;
+      else
+        buffer_.resize(writeIndex_+1);
     }
     if(readIndex_ == writeIndex_)
       notFull_ = false;
@@ -147,7 +167,11 @@ public:
     setPtr = NULL;
   };
 
-  std::vector< DataSet<T> > getBuffer() { return buffer_; }
+  /// Access all DataSets in the buffer (in ring mode, only the last capacity)
+  const std::vector< DataSet<T> >& getBuffer() const { return buffer_; }
+
+  /// Is this buffer in ring mode?
+  bool isRing() const { return isRing_; }
 
 private:
   /// The data type of this buffer
@@ -156,6 +180,9 @@ private:
   /// The vector of DataSets
   std::vector< DataSet<T> > buffer_;
 
+  /// Reuse DataSets rather than growing?
+  bool isRing_;
+
   bool isReadLocked_;
   bool isWriteLocked_;
 
@@ -37,6 +37,15 @@
 #include <boost/cstdint.hpp>
 #include <boost/detail/endian.hpp>
 #include <complex>
+#include <cstddef>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
 
 // define macros to switch byte order (only use with unsigned numbers!)
 #define _swapbytes16(x) (((x)>>8) | ((x)<<8))
@@ -266,6 +275,203 @@ inline T sys2lit(T x)
 #endif
 }
 
+// ------------ batch conversions
+
+// size of the units whose bytes are reversed - complex numbers swap
+// their real and imaginary parts separately
+template <class T>
+struct __swap_unit
+{
+  static const std::size_t size = sizeof(T);
+};
+
+template <class T>
+struct __swap_unit<std::complex<T> >
+{
+  static const std::size_t size = sizeof(T);
+};
+
+namespace endiandetail
+{
+
+#ifdef __SSE2__
+  // reverse the bytes of each 16 bit lane
+  inline __m128i swap16(__m128i x)
+  {
+    return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+  }
+
+  // reverse the bytes of each unit in a 16 byte vector
+  template <std::size_t N> __m128i swapVector(__m128i x);
+
+  template <> inline __m128i swapVector<2>(__m128i x)
+  {
+#ifdef __SSSE3__
+    return _mm_shuffle_epi8(x, _mm_set_epi8(14,15,12,13,10,11,8,9,6,7,4,5,2,3,0,1));
+#else
+    return swap16(x);
+#endif
+  }
+
+  template <> inline __m128i swapVector<4>(__m128i x)
+  {
+#ifdef __SSSE3__
+    return _mm_shuffle_epi8(x, _mm_set_epi8(12,13,14,15,8,9,10,11,4,5,6,7,0,1,2,3));
+#else
+    x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2,3,0,1));
+    x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(2,3,0,1));
+    return swap16(x);
+#endif
+  }
+
+  template <> inline __m128i swapVector<8>(__m128i x)
+  {
+#ifdef __SSSE3__
+    return _mm_shuffle_epi8(x, _mm_set_epi8(8,9,10,11,12,13,14,15,0,1,2,3,4,5,6,7));
+#else
+    x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(0,1,2,3));
+    x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(0,1,2,3));
+    return swap16(x);
+#endif
+  }
+#endif
+
+  // reverse the bytes of one unit
+  template <std::size_t N>
+  inline void swapUnit(const unsigned char* in, unsigned char* out)
+  {
+    unsigned char tmp[N];
+    for(std::size_t i = 0; i < N; ++i)
+      tmp[N-1-i] = in[i];
+    std::memcpy(out, tmp, N);
+  }
+
+  template <> inline void swapUnit<2>(const unsigned char* in, unsigned char* out)
+  {
+    boost::uint16_t x;
+    std::memcpy(&x, in, 2);
+    x = _swapbytes16(x);
+    std::memcpy(out, &x, 2);
+  }
+
+  template <> inline void swapUnit<4>(const unsigned char* in, unsigned char* out)
+  {
+    boost::uint32_t x;
+    std::memcpy(&x, in, 4);
+#ifdef __GNUC__
+    x = __builtin_bswap32(x);
+#else
+    x = _swapbytes32(x);
+#endif
+    std::memcpy(out, &x, 4);
+  }
+
+  template <> inline void swapUnit<8>(const unsigned char* in, unsigned char* out)
+  {
+    boost::uint64_t x;
+    std::memcpy(&x, in, 8);
+#ifdef __GNUC__
+    x = __builtin_bswap64(x);
+#else
+    x = _swapbytes64(x);
+#endif
+    std::memcpy(out, &x, 8);
+  }
+
+  // reverse the bytes of num units of N bytes - in may equal out
+  template <std::size_t N>
+  inline void swapUnits(const unsigned char* in, unsigned char* out, std::size_t num)
+  {
+    std::size_t i = 0;
+#ifdef __SSE2__
+    if(N == 2 || N == 4 || N == 8)
+    {
+      // (the ternary only keeps swapVector<> instantiable for other N)
+      const std::size_t perVector = 16 / N;
+      for(; i + 2*perVector <= num; i += 2*perVector)
+      {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i*N));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i*N + 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i*N), swapVector<N == 2 ? 2 : N == 4 ? 4 : 8>(a));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i*N + 16), swapVector<N == 2 ? 2 : N == 4 ? 4 : 8>(b));
+      }
+    }
+#endif
+    for(; i < num; ++i)
+      swapUnit<N>(in + i*N, out + i*N);
+  }
+
+} // namespace endiandetail
+
+//! swaps the byte order of [first, last) into out (out may equal first)
+template <typename T>
+inline void swap_bytes(const T* first, const T* last, T* out)
+{
+  const std::size_t unit = __swap_unit<T>::size;
+  const unsigned char* in = reinterpret_cast<const unsigned char*>(first);
+  unsigned char* o = reinterpret_cast<unsigned char*>(out);
+  std::size_t num = (last - first) * (sizeof(T) / unit);
+  if(unit == 1)
+  {
+    if(in != o)
+      std::memmove(o, in, num);
+  }
+  else
+    endiandetail::swapUnits<unit>(in, o, num);
+}
+
+//! copies [first, last) into out, unless they are the same
+template <typename T>
+inline void __copy_block(const T* first, const T* last, T* out)
+{
+  if(first != out)
+    std::memmove(out, first, (last - first) * sizeof(T));
+}
+
+//! converts [first, last) from big endian to the system's format (out may equal first)
+template <typename T>
+inline void big2sys(const T* first, const T* last, T* out)
+{
+#ifdef BOOST_BIG_ENDIAN
+  __copy_block(first, last, out);
+#else
+  swap_bytes(first, last, out);
+#endif
+}
+
+//! converts [first, last) from the system's format to big endian (out may equal first)
+template <typename T>
+inline void sys2big(const T* first, const T* last, T* out)
+{
+#ifdef BOOST_BIG_ENDIAN
+  __copy_block(first, last, out);
+#else
+  swap_bytes(first, last, out);
+#endif
+}
+
+//! converts [first, last) from little endian to the system's format (out may equal first)
+template <typename T>
+inline void lit2sys(const T* first, const T* last, T* out)
+{
+#ifdef BOOST_BIG_ENDIAN
+  swap_bytes(first, last, out);
+#else
+  __copy_block(first, last, out);
+#endif
+}
+
+//! converts [first, last) from the system's format to little endian (out may equal first)
+template <typename T>
+inline void sys2lit(const T* first, const T* last, T* out)
+{
+#ifdef BOOST_BIG_ENDIAN
+  swap_bytes(first, last, out);
+#else
+  __copy_block(first, last, out);
+#endif
+}
+
 
 
 #endif
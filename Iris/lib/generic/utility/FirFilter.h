@@ -37,38 +37,105 @@
 #include <vector>
 #include <deque>
 #include <algorithm>
+#include <complex>
+#include <cstring>
+#include <cmath>
+#include <iterator>
 
-#include <boost/lambda/lambda.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "math/DotProduct.h"
+#include "math/kissfft/kissfft.hh"
 
 namespace iris
 {
 
-//! Filters input data by applying an FIR filter with the 
-//! given coefficients
+//! Filtering engines available to FirFilter
+enum FirEngine
+{
+  FIR_AUTO,     //!< Choose engine by number of taps and block length
+  FIR_DIRECT,   //!< Vectorised direct form
+  FIR_FFT       //!< FFT-based overlap-save fast convolution
+};
+
+namespace firdetail
+{
+//! Scalar type underlying a real or complex type
+template<class T> struct Scalar { typedef T type; };
+template<class T> struct Scalar< std::complex<T> > { typedef T type; };
+
+//! Convert an overlap-save result to the output type
+template<class OutT, class T>
+inline void assign(OutT& out, const std::complex<T>& x) { out = OutT(x.real()); }
+template<class OutT, class T>
+inline void assign(std::complex<OutT>& out, const std::complex<T>& x) { out = std::complex<OutT>(x); }
+} // namespace firdetail
+
+//! \brief Filters input data by applying an FIR filter with the
+//! given coefficients.
+//!
+//! Short filters use a direct form, with the delay line held twice in a
+//! contiguous buffer so that each output is a single vectorised dot product.
+//! Long filters use overlap-save fast convolution. Both engines keep their
+//! state between calls to filter() and produce one output per input with
+//! no added latency. With FIR_AUTO a long filter also keeps the direct form
+//! delay line, and calls too short to pay for an fft block use the direct
+//! form - the input iterators must then be forward iterators.
 template<class InT, class CoeffT = InT, class OutT = InT>
 class FirFilter
 {
 public:
+  //! Filters with at least this many taps use the FFT engine by default
+  static const std::size_t FFT_THRESHOLD = 192;
+
   //! default constructor - no coefficients are set
   FirFilter()
+    : engine_(FIR_DIRECT), pos_(0), fftSize_(0), minFftLength_(0)
   {
   }
 
   //! constructor setting the filter coefficients
   template<class It>
-  FirFilter(It coeff_start, It coeff_end) :
-    coeffs_(coeff_start, coeff_end), sums_(coeffs_.size() + 1)
+  FirFilter(It coeff_start, It coeff_end, FirEngine engine = FIR_AUTO)
   {
+    setCoeffs(coeff_start, coeff_end, engine);
   }
 
-  //! set the filter coefficients
+  //! set the filter coefficients and clear the filter state
   template<class It>
-  void setCoeffs(It coeff_start, It coeff_end)
+  void setCoeffs(It coeff_start, It coeff_end, FirEngine engine = FIR_AUTO)
   {
-    coeffs_.clear();
     coeffs_.assign(coeff_start, coeff_end);
-    sums_.clear();
-    sums_.resize(coeffs_.size() + 1);
+    bool automatic = engine == FIR_AUTO;
+    if (automatic)
+      engine = coeffs_.size() >= FFT_THRESHOLD ? FIR_FFT : FIR_DIRECT;
+    engine_ = engine;
+
+    history_.clear();
+    pos_ = 0;
+    frame_.clear();
+    spectrum_.clear();
+    work_.clear();
+    result_.clear();
+    minFftLength_ = 0;
+    if (engine_ == FIR_FFT)
+      setupFft();
+    if (engine_ == FIR_DIRECT || automatic)
+      setupDirect();
+    if (engine_ == FIR_FFT && automatic)
+      minFftLength_ = std::min(fftSize_ - coeffs_.size() + 1,
+                               std::size_t(std::ceil(fftBlockCost(fftSize_) / coeffs_.size())));
+  }
+
+  //! get the engine in use
+  FirEngine getEngine() const { return engine_; }
+
+  //! clear the filter state, keeping the coefficients
+  void reset()
+  {
+    std::fill(history_.begin(), history_.end(), InT());
+    std::fill(frame_.begin(), frame_.end(), Cplx());
+    pos_ = 0;
   }
 
   //! \brief Apply filter to given input sequence, writing output to output iterator.
@@ -77,18 +144,152 @@ public:
   template<class InIt, class OutIt>
   OutIt filter(InIt istart, InIt iend, OutIt ostart)
   {
+    if (coeffs_.empty())
+    {
+      for (; istart != iend; ++istart)
+        *ostart++ = OutT();
+      return ostart;
+    }
+    if (engine_ == FIR_DIRECT)
+      return filterDirect(istart, iend, ostart);
+    if (minFftLength_ > 0 && std::size_t(std::distance(istart, iend)) < minFftLength_)
+    {
+      ostart = filterDirect(istart, iend, ostart);
+      // The next fft block starts from the last numTaps-1 inputs
+      std::size_t numTaps = coeffs_.size();
+      for (std::size_t i = 0; i < numTaps - 1; ++i)
+        frame_[i] = Cplx(history_[pos_ + 1 + i]);
+      return ostart;
+    }
+    return filterFft(istart, iend, ostart);
+  }
+
+private:
+  typedef typename firdetail::Scalar<OutT>::type Scalar;
+  typedef std::complex<Scalar> Cplx;
+  typedef kissfft<Scalar> Fft;
+
+  //! Overlap-save fft length for a filter
+  static std::size_t fftSizeFor(std::size_t numTaps)
+  {
+    std::size_t size = 2;
+    while (size < 4*numTaps)
+      size *= 2;
+    return size;
+  }
+
+  //! Cost of one overlap-save block in multiply-adds of the direct form,
+  //! scaled so that full blocks break even at FFT_THRESHOLD taps
+  static double fftBlockCost(std::size_t fftSize)
+  {
+    double n0 = double(fftSizeFor(FFT_THRESHOLD));
+    double perLog = FFT_THRESHOLD * (n0 - FFT_THRESHOLD + 1) / (n0 * std::log(n0));
+    return perLog * fftSize * std::log(double(fftSize));
+  }
+
+  void setupDirect()
+  {
+    // Reverse the coefficients so the oldest sample meets the last tap
+    std::reverse(coeffs_.begin(), coeffs_.end());
+    history_.assign(2*coeffs_.size(), InT());
+    pos_ = 0;
+  }
+
+  void setupFft()
+  {
+    std::size_t numTaps = coeffs_.size();
+    fftSize_ = fftSizeFor(numTaps);
+    fwd_.reset(new Fft(fftSize_, false));
+    inv_.reset(new Fft(fftSize_, true));
+
+    // Precompute the filter spectrum, folding in the 1/N of the inverse fft
+    std::vector<Cplx> padded(fftSize_);
+    for (std::size_t i = 0; i < numTaps; ++i)
+      padded[i] = Cplx(coeffs_[i]) / Scalar(fftSize_);
+    spectrum_.resize(fftSize_);
+    fwd_->transform(&padded[0], &spectrum_[0]);
+
+    frame_.assign(fftSize_, Cplx());
+    work_.resize(fftSize_);
+    result_.resize(fftSize_);
+  }
+
+  template<class InIt, class OutIt>
+  OutIt filterDirect(InIt istart, InIt iend, OutIt ostart)
+  {
+    std::size_t numTaps = coeffs_.size();
+    const CoeffT* coeffs = &coeffs_[0];
+    InT* history = &history_[0];
     while (istart != iend)
     {
-      // multiply with each coefficient & add
-      std::transform(coeffs_.begin(), coeffs_.end(), ++sums_.begin(), sums_.begin(),
-          *istart++ * boost::lambda::_1 + boost::lambda::_2);
-      *ostart++ = sums_.front();
+      // Write each sample twice so the last numTaps inputs are always
+      // contiguous, starting at pos_+1
+      history[pos_] = history[pos_ + numTaps] = *istart++;
+      *ostart++ = dotProduct<OutT>(coeffs, history + pos_ + 1, numTaps);
+      if (++pos_ == numTaps)
+        pos_ = 0;
     }
     return ostart;
   }
-private:
-  std::vector<CoeffT> coeffs_; //!< coefficient vector
-  std::vector<OutT> sums_; //!< keeps sums in a delay line
+
+  template<class InIt, class OutIt>
+  OutIt filterFft(InIt istart, InIt iend, OutIt ostart)
+  {
+    // frame_ holds the last numTaps-1 inputs followed by up to
+    // fftSize_-numTaps+1 new ones. A short final block is zero-padded,
+    // which leaves its valid outputs unchanged.
+    std::size_t history = coeffs_.size() - 1;
+    std::size_t blockSize = fftSize_ - history;
+    bool direct = !history_.empty();
+    while (istart != iend)
+    {
+      std::size_t n = 0;
+      for (; n < blockSize && istart != iend; ++n, ++istart)
+      {
+        frame_[history + n] = Cplx(*istart);
+        // Keep the direct form delay line for short calls (FIR_AUTO)
+        if (direct)
+        {
+          history_[pos_] = history_[pos_ + history + 1] = *istart;
+          if (++pos_ == history + 1)
+            pos_ = 0;
+        }
+      }
+      std::fill(frame_.begin() + history + n, frame_.end(), Cplx());
+
+      fwd_->transform(&frame_[0], &work_[0]);
+      for (std::size_t i = 0; i < fftSize_; ++i)
+      {
+        const Cplx& a = work_[i];
+        const Cplx& b = spectrum_[i];
+        work_[i] = Cplx(a.real()*b.real() - a.imag()*b.imag(),
+                        a.real()*b.imag() + a.imag()*b.real());
+      }
+      inv_->transform(&work_[0], &result_[0]);
+
+      for (std::size_t i = 0; i < n; ++i)
+        firdetail::assign(*ostart++, result_[history + i]);
+
+      // Keep the last numTaps-1 inputs for the next block
+      std::copy(frame_.begin() + n, frame_.begin() + n + history, frame_.begin());
+    }
+    return ostart;
+  }
+
+  FirEngine engine_;              //!< engine in use
+  std::vector<CoeffT> coeffs_;    //!< coefficients (reversed for the direct form)
+
+  std::vector<InT> history_;      //!< doubled delay line for the direct form
+  std::size_t pos_;               //!< current position in history_
+
+  std::size_t fftSize_;           //!< overlap-save fft length
+  boost::shared_ptr<Fft> fwd_;    //!< forward fft
+  boost::shared_ptr<Fft> inv_;    //!< inverse fft
+  std::vector<Cplx> spectrum_;    //!< scaled filter spectrum
+  std::vector<Cplx> frame_;       //!< overlap-save input frame
+  std::vector<Cplx> work_;        //!< fft work buffer
+  std::vector<Cplx> result_;      //!< inverse fft output
+  std::size_t minFftLength_;      //!< shorter calls use the direct form (0 = never)
 };
 
 //! \brief Upsampling & interpolating filter.
@@ -0,0 +1,261 @@
+/**
+ * \file GaussianNoise.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * A fast, seeded generator of complex Gaussian noise.
+ */
+
+#ifndef GAUSSIANNOISE_H_
+#define GAUSSIANNOISE_H_
+
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <boost/cstdint.hpp>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace iris
+{
+
+/** Generates circularly-symmetric complex Gaussian noise.
+ *
+ * Four independent xorshift128 generators run side by side, one per SSE2
+ * lane. Each pair of uniform numbers gives one complex sample by the
+ * Box-Muller transform:
+ *
+ *   z = sigma * sqrt(-ln(u1)) * exp(j*2*pi*u2)
+ *
+ * so E|z|^2 = sigma^2, split evenly between the real and imaginary parts.
+ * With SSE2 the logarithm, sine and cosine are evaluated with polynomials
+ * accurate to about 1e-7, four samples at a time. Other targets use the
+ * same generators with the standard library functions.
+ *
+ * The uniform numbers have 23 bits, which limits the magnitude of a
+ * sample to about 5.6 sigma in each dimension.
+ *
+ * The same seed and the same sequence of calls give the same noise on
+ * the same build.
+ */
+class GaussianNoise
+{
+public:
+  /// Number of samples made per step - calls for fewer throw the rest away
+  enum { LANES = 4 };
+
+  explicit GaussianNoise(boost::uint32_t seed = 1)
+  {
+    setSeed(seed);
+  }
+
+  /// Restart the generators from a seed
+  void setSeed(boost::uint32_t seed)
+  {
+    // splitmix32 spreads the seed over the 16 state words
+    boost::uint32_t s = seed;
+    for(int i=0; i<4*LANES; i++)
+    {
+      s += 0x9e3779b9u;
+      boost::uint32_t z = s;
+      z = (z ^ (z >> 16)) * 0x85ebca6bu;
+      z = (z ^ (z >> 13)) * 0xc2b2ae35u;
+      z ^= z >> 16;
+      state_[i] = z ? z : 0x6d2b79f5u;   // xorshift state must not be all zero
+    }
+  }
+
+  /// Write n samples of noise with power sigma^2 to out
+  void generate(std::complex<float>* out, std::size_t n, float sigma)
+  {
+    run(out, n, sigma, false);
+  }
+
+  /// Add n samples of noise with power sigma^2 to data
+  void add(std::complex<float>* data, std::size_t n, float sigma)
+  {
+    run(data, n, sigma, true);
+  }
+
+private:
+  /// Turns the top 23 bits of a random word into [0,1)
+  static float uniformScale() { return 1.0f / 8388608.0f; }
+
+#ifdef __SSE2__
+  static __m128i step(__m128i& x, __m128i& y, __m128i& z, __m128i& w)
+  {
+    __m128i t = _mm_xor_si128(x, _mm_slli_epi32(x, 11));
+    x = y; y = z; z = w;
+    w = _mm_xor_si128(_mm_xor_si128(w, _mm_srli_epi32(w, 19)),
+                      _mm_xor_si128(t, _mm_srli_epi32(t, 8)));
+    return w;
+  }
+
+  /// Natural logarithm of x in (0,1]
+  static __m128 log(__m128 x)
+  {
+    // x = m * 2^e with m in [sqrt(0.5), sqrt(2))
+    __m128i bits = _mm_castps_si128(x);
+    __m128i e = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+    __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)),
+                                             _mm_set1_epi32(0x3f800000)));
+    __m128 big = _mm_cmpgt_ps(m, _mm_set1_ps(1.41421356f));
+    m = _mm_sub_ps(m, _mm_and_ps(big, _mm_mul_ps(m, _mm_set1_ps(0.5f))));
+    __m128 ef = _mm_add_ps(_mm_cvtepi32_ps(e), _mm_and_ps(big, _mm_set1_ps(1.0f)));
+
+    // ln(m) = 2*atanh(t) with t = (m-1)/(m+1), |t| < 0.172
+    __m128 t = _mm_div_ps(_mm_sub_ps(m, _mm_set1_ps(1.0f)), _mm_add_ps(m, _mm_set1_ps(1.0f)));
+    __m128 t2 = _mm_mul_ps(t, t);
+    __m128 p = _mm_add_ps(_mm_set1_ps(1.0f/5), _mm_mul_ps(t2, _mm_set1_ps(1.0f/7)));
+    p = _mm_add_ps(_mm_set1_ps(1.0f/3), _mm_mul_ps(t2, p));
+    p = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(t2, p));
+    return _mm_add_ps(_mm_mul_ps(ef, _mm_set1_ps(0.69314718f)),
+                      _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(2.0f), t), p));
+  }
+
+  /// Sine and cosine of x in [-pi,pi)
+  static void sincos(__m128 x, __m128& s, __m128& c)
+  {
+    // Reflect into [-pi/2,pi/2] - sine is unchanged, cosine flips sign
+    const __m128 halfPi = _mm_set1_ps(1.57079633f);
+    const __m128 pi = _mm_set1_ps(3.14159265f);
+    __m128 hi = _mm_cmpgt_ps(x, halfPi);
+    __m128 lo = _mm_cmplt_ps(x, _mm_sub_ps(_mm_setzero_ps(), halfPi));
+    __m128 y = _mm_or_ps(_mm_and_ps(hi, _mm_sub_ps(pi, x)), _mm_andnot_ps(hi, x));
+    y = _mm_or_ps(_mm_and_ps(lo, _mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), pi), x)), _mm_andnot_ps(lo, y));
+    __m128 flip = _mm_and_ps(_mm_or_ps(hi, lo), _mm_set1_ps(-0.0f));
+
+    __m128 y2 = _mm_mul_ps(y, y);
+    __m128 ps = _mm_add_ps(_mm_set1_ps(-1.0f/5040), _mm_mul_ps(y2, _mm_set1_ps(1.0f/362880)));
+    ps = _mm_add_ps(_mm_set1_ps(1.0f/120), _mm_mul_ps(y2, ps));
+    ps = _mm_add_ps(_mm_set1_ps(-1.0f/6), _mm_mul_ps(y2, ps));
+    s = _mm_add_ps(y, _mm_mul_ps(_mm_mul_ps(y, y2), ps));
+
+    __m128 pc = _mm_add_ps(_mm_set1_ps(1.0f/40320), _mm_mul_ps(y2, _mm_set1_ps(-1.0f/3628800)));
+    pc = _mm_add_ps(_mm_set1_ps(-1.0f/720), _mm_mul_ps(y2, pc));
+    pc = _mm_add_ps(_mm_set1_ps(1.0f/24), _mm_mul_ps(y2, pc));
+    pc = _mm_add_ps(_mm_set1_ps(-0.5f), _mm_mul_ps(y2, pc));
+    c = _mm_xor_ps(_mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(y2, pc)), flip);
+  }
+
+  void run(std::complex<float>* data, std::size_t n, float sigma, bool accumulate)
+  {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state_));
+    __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state_ + 4));
+    __m128i z = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state_ + 8));
+    __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state_ + 12));
+    const __m128 scale = _mm_set1_ps(uniformScale());
+    const __m128 twoPi = _mm_set1_ps(6.28318531f);
+    const __m128 pi = _mm_set1_ps(3.14159265f);
+    const __m128 vsigma = _mm_set1_ps(sigma);
+    float* out = reinterpret_cast<float*>(data);
+
+    for(std::size_t i=0; i<n; i+=LANES)
+    {
+      // u1 in (0,1], u2 in [0,1)
+      __m128 u1 = _mm_sub_ps(_mm_set1_ps(1.0f),
+                             _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(step(x, y, z, w), 9)), scale));
+      __m128 u2 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(step(x, y, z, w), 9)), scale);
+      __m128 r = _mm_mul_ps(vsigma, _mm_sqrt_ps(_mm_sub_ps(_mm_setzero_ps(), log(u1))));
+      __m128 s, c;
+      sincos(_mm_sub_ps(_mm_mul_ps(u2, twoPi), pi), s, c);
+      __m128 re = _mm_mul_ps(r, c);
+      __m128 im = _mm_mul_ps(r, s);
+      __m128 lo = _mm_unpacklo_ps(re, im);
+      __m128 hi = _mm_unpackhi_ps(re, im);
+
+      if(i + LANES <= n)
+      {
+        if(accumulate)
+        {
+          lo = _mm_add_ps(lo, _mm_loadu_ps(out + 2*i));
+          hi = _mm_add_ps(hi, _mm_loadu_ps(out + 2*i + 4));
+        }
+        _mm_storeu_ps(out + 2*i, lo);
+        _mm_storeu_ps(out + 2*i + 4, hi);
+      }
+      else
+      {
+        float tmp[2*LANES];
+        _mm_storeu_ps(tmp, lo);
+        _mm_storeu_ps(tmp + 4, hi);
+        for(std::size_t k=0; k<2*(n-i); k++)
+          out[2*i + k] = accumulate ? out[2*i + k] + tmp[k] : tmp[k];
+      }
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state_), x);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state_ + 4), y);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state_ + 8), z);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state_ + 12), w);
+  }
+#else
+  /// One xorshift128 step of all lanes
+  void step(boost::uint32_t* out)
+  {
+    boost::uint32_t* x = state_;
+    boost::uint32_t* w = state_ + 12;
+    for(int l=0; l<LANES; l++)
+    {
+      boost::uint32_t t = x[l] ^ (x[l] << 11);
+      x[l] = state_[4 + l];
+      state_[4 + l] = state_[8 + l];
+      state_[8 + l] = w[l];
+      w[l] = (w[l] ^ (w[l] >> 19)) ^ (t ^ (t >> 8));
+      out[l] = w[l];
+    }
+  }
+
+  void run(std::complex<float>* data, std::size_t n, float sigma, bool accumulate)
+  {
+    boost::uint32_t r1[LANES], r2[LANES];
+    for(std::size_t i=0; i<n; i+=LANES)
+    {
+      step(r1);
+      step(r2);
+      for(std::size_t l=0; l<LANES && i+l<n; l++)
+      {
+        float u1 = 1.0f - (r1[l] >> 9) * uniformScale();
+        float u2 = (r2[l] >> 9) * uniformScale();
+        float r = sigma * std::sqrt(-std::log(u1));
+        float a = u2 * 6.28318531f - 3.14159265f;
+        std::complex<float> v(r * std::cos(a), r * std::sin(a));
+        data[i+l] = accumulate ? data[i+l] + v : v;
+      }
+    }
+  }
+#endif
+
+  boost::uint32_t state_[4*LANES];  ///< x, y, z and w words of each lane
+};
+
+} // namespace iris
+
+#endif // GAUSSIANNOISE_H_
@@ -0,0 +1,159 @@
+/**
+ * \file MacAddress.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * A 48 bit MAC address held as a single integer.
+ */
+
+#ifndef MACADDRESS_H_
+#define MACADDRESS_H_
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <boost/cstdint.hpp>
+
+namespace iris
+{
+
+/** A 48 bit MAC address.
+ *
+ * The address is kept in the low 48 bits of a uint64_t, first byte on
+ * the wire in the most significant position. Comparing, ordering and
+ * hashing are single integer operations and the address can be read from
+ * and written to frame memory without any allocation.
+ *
+ * Hex strings like "f009e090e90e" are only used at the edges - for
+ * parameters and for logging.
+ */
+class MacAddress
+{
+public:
+  /// Size of an address on the wire
+  enum { SIZE = 6 };
+
+  /// The all-zero address
+  MacAddress()
+    :value_(0)
+  {}
+
+  /// Read an address from frame memory holding SIZE bytes
+  explicit MacAddress(const uint8_t* p)
+    :value_(uint64_t(p[0]) << 40 | uint64_t(p[1]) << 32 | uint64_t(p[2]) << 24 |
+            uint64_t(p[3]) << 16 | uint64_t(p[4]) << 8 | uint64_t(p[5]))
+  {}
+
+  /// The broadcast address ff:ff:ff:ff:ff:ff
+  static MacAddress broadcast()
+  {
+    MacAddress a;
+    a.value_ = MASK;
+    return a;
+  }
+
+  /// Write the address to frame memory with room for SIZE bytes
+  void write(uint8_t* p) const
+  {
+    p[0] = uint8_t(value_ >> 40);
+    p[1] = uint8_t(value_ >> 32);
+    p[2] = uint8_t(value_ >> 24);
+    p[3] = uint8_t(value_ >> 16);
+    p[4] = uint8_t(value_ >> 8);
+    p[5] = uint8_t(value_);
+  }
+
+  uint64_t toInt() const { return value_; }
+  bool isBroadcast() const { return value_ == MASK; }
+  bool isZero() const { return value_ == 0; }
+
+  bool operator==(const MacAddress& other) const { return value_ == other.value_; }
+  bool operator!=(const MacAddress& other) const { return value_ != other.value_; }
+  bool operator<(const MacAddress& other) const { return value_ < other.value_; }
+
+  /** Parse a 12 digit hex address like "f009e090e90e"
+   *
+   * Upper and lower case digits are accepted, separators are not.
+   * @return false and leave address unchanged if hex is malformed
+   */
+  static bool fromString(const std::string& hex, MacAddress& address)
+  {
+    if(hex.size() != 2 * SIZE)
+      return false;
+    uint64_t v = 0;
+    for(std::size_t i=0; i<hex.size(); i++)
+    {
+      int d = hexDigit(hex[i]);
+      if(d < 0)
+        return false;
+      v = v << 4 | uint64_t(d);
+    }
+    address.value_ = v;
+    return true;
+  }
+
+  /// Format as 12 lower case hex digits
+  std::string toString() const
+  {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(2 * SIZE, '0');
+    for(std::size_t i=0; i<hex.size(); i++)
+      hex[i] = digits[(value_ >> (4 * (hex.size() - 1 - i))) & 0xf];
+    return hex;
+  }
+
+  /// Hash for boost::hash and boost::unordered containers
+  friend std::size_t hash_value(const MacAddress& a)
+  {
+    // The low bytes vary most between hosts, so fold the high ones in
+    uint64_t h = a.value_ * 0x9e3779b97f4a7c15ULL;
+    return std::size_t(h ^ (h >> 32));
+  }
+
+  friend std::ostream& operator<<(std::ostream& os, const MacAddress& a)
+  {
+    return os << a.toString();
+  }
+
+private:
+  static const uint64_t MASK = 0xffffffffffffULL;
+
+  static int hexDigit(char c)
+  {
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+  }
+
+  uint64_t value_;
+};
+
+} // namespace iris
+
+#endif // MACADDRESS_H_
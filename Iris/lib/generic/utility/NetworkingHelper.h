@@ -40,9 +40,10 @@
 #ifndef NETWORKINGHELPER_H
 #define NETWORKINGHELPER_H
 
+#include <algorithm>
 #include <boost/shared_ptr.hpp>
 #include <irisapi/StackDataBuffer.h>
-#include <boost/format.hpp>
+#include "MacAddress.h"
 #include <net/ethernet.h>
 #include <arpa/inet.h>
 #include <sys/ioctl.h>
@@ -55,46 +56,75 @@ class NetworkingHelper
 {
 public:
     /**
-     * \brief Parse StackDataSet and retrieve Ethernet source and destionation address.
+     * \brief Retrieve Ethernet source and destination address from frame memory.
      *
-     * This function parses a StackDataSet, interprets it as an Ethernet frame and tries
-     * to retrieve the source and destionation address of it. It doesn't change anything
-     * if the given StackDataSet is not an Ethernet frame.
+     * This function interprets size bytes at data as an Ethernet frame and reads
+     * its source and destination address without copying or allocating. It
+     * doesn't change anything if the frame is too short or not an IP or ARP frame.
      *
-     * \param packet the StackDataSet
+     * \param data pointer to the first byte of the frame
+     * \param size number of bytes at data
      * \param source reference to the source address to be filled
      * \param destination reference to the destination address to be filled
      * \return true - if successful, false otherwise.
      */
-    static bool getAddressFromEthernetFrame(boost::shared_ptr<StackDataSet> packet, std::string &source, std::string &destination)
+    static bool getAddressFromEthernetFrame(const uint8_t* data, std::size_t size, MacAddress &source, MacAddress &destination)
     {
-        unsigned char packetBuffer[sizeof(struct ether_header)];
-        const struct ether_header* ethernetHeader;
-        boost::format destination_fmt("%02x%02x%02x%02x%02x%02x");
-        boost::format source_fmt("%02x%02x%02x%02x%02x%02x");
-
-        // serialize ethernet header
-        for (int i = 0; i < sizeof(struct ether_header); i++)
-            packetBuffer[i] = packet->data[i];
+        if (size < sizeof(struct ether_header))
+            return false;
 
         // check if it's an IP or ARP frame
-        ethernetHeader = (struct ether_header*)packetBuffer;
-        if ((ntohs(ethernetHeader->ether_type) != ETHERTYPE_IP) &&
-            (ntohs(ethernetHeader->ether_type) != ETHERTYPE_ARP))
-        {
+        uint16_t type = uint16_t(data[12] << 8 | data[13]);
+        if (type != ETHERTYPE_IP && type != ETHERTYPE_ARP)
             return false;
-        }
 
-        for (size_t i = 0; i < 6; i++) {
-            destination_fmt % (int(ethernetHeader->ether_dhost[i]) & 0xFF);
-            source_fmt % (int(ethernetHeader->ether_shost[i]) & 0xFF);
-        }
-
-        destination = destination_fmt.str();
-        source = source_fmt.str();
+        destination = MacAddress(data);
+        source = MacAddress(data + MacAddress::SIZE);
         return true;
     }
 
+    /**
+     * \brief Parse StackDataSet and retrieve Ethernet source and destionation address.
+     *
+     * Like the overload above, for a StackDataSet. Only the Ethernet header is
+     * copied out of the deque, onto the stack.
+     *
+     * \param packet the StackDataSet
+     * \param source reference to the source address to be filled
+     * \param destination reference to the destination address to be filled
+     * \return true - if successful, false otherwise.
+     */
+    static bool getAddressFromEthernetFrame(const StackDataSet &packet, MacAddress &source, MacAddress &destination)
+    {
+        uint8_t header[sizeof(struct ether_header)];
+        if (packet.data.size() < sizeof(header))
+            return false;
+        std::copy(packet.data.begin(), packet.data.begin() + sizeof(header), header);
+        return getAddressFromEthernetFrame(header, sizeof(header), source, destination);
+    }
+
+    /**
+     * \brief Parse StackDataSet and retrieve Ethernet source and destionation address.
+     *
+     * This function parses a StackDataSet, interprets it as an Ethernet frame and tries
+     * to retrieve the source and destionation address of it as 12 digit hex strings.
+     * It doesn't change anything if the given StackDataSet is not an Ethernet frame.
+     * Prefer the MacAddress overloads on the data path.
+     *
+     * \param packet the StackDataSet
+     * \param source reference to the source address to be filled
+     * \param destination reference to the destination address to be filled
+     * \return true - if successful, false otherwise.
+     */
+    static bool getAddressFromEthernetFrame(boost::shared_ptr<StackDataSet> packet, std::string &source, std::string &destination)
+    {
+        MacAddress src, dst;
+        if (!getAddressFromEthernetFrame(*packet, src, dst))
+            return false;
+        destination = dst.toString();
+        source = src.toString();
+        return true;
+    }
 
     /**
      * \brief Retrieve MAC address from given network interface
@@ -105,24 +135,37 @@ public:
      * \param address reference to the address to be filled
      * \return true - if successful, false otherwise.
      */
-    static bool getLocalAddress(const std::string interface, std::string &address)
+    static bool getLocalAddress(const std::string interface, MacAddress &address)
     {
-        boost::format fmt("%02x%02x%02x%02x%02x%02x");
         struct ifreq buffer;
 
         int s = socket(PF_INET, SOCK_DGRAM, 0);
         memset(&buffer, 0x00, sizeof(buffer));
-        strcpy(buffer.ifr_name, interface.c_str());
+        strncpy(buffer.ifr_name, interface.c_str(), IFNAMSIZ - 1);
         if (ioctl(s, SIOCGIFHWADDR, &buffer) != 0) {
             //LOG(LERROR) << "Error while reading MAC address from device " << interface;
+            close(s);
             return false;
         }
         close(s);
 
-        for (size_t i = 0; i < 6; i++)
-            fmt % (int(buffer.ifr_hwaddr.sa_data[i]) & 0xFF);
+        address = MacAddress(reinterpret_cast<const uint8_t*>(buffer.ifr_hwaddr.sa_data));
+        return true;
+    }
 
-        address = fmt.str();
+    /**
+     * \brief Retrieve MAC address from given network interface as a 12 digit hex string
+     *
+     * \param interface name of the network interface
+     * \param address reference to the address to be filled
+     * \return true - if successful, false otherwise.
+     */
+    static bool getLocalAddress(const std::string interface, std::string &address)
+    {
+        MacAddress a;
+        if (!getLocalAddress(interface, a))
+            return false;
+        address = a.toString();
         return true;
     }
 };
@@ -0,0 +1,183 @@
+/**
+ * \file PacketBuffer.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * A contiguous packet buffer with room to add headers and trailers
+ * in place.
+ */
+
+#ifndef PACKETBUFFER_H_
+#define PACKETBUFFER_H_
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <vector>
+#include <boost/cstdint.hpp>
+
+namespace iris
+{
+
+/** A packet held in one block of memory with headroom and tailroom.
+ *
+ * Like a Linux sk_buff, the packet sits in the middle of its storage.
+ * Each layer going down can push() its header into the headroom in front
+ * of the data and put() a trailer into the tailroom after it. Each layer
+ * going up can pull() its header off the front and trim() a trailer off
+ * the end. None of these move the data; they only move the ends. If the
+ * headroom or tailroom runs out, the storage grows and the data is moved
+ * once.
+ *
+ * The storage is kept when the packet is cleared or reassigned, so one
+ * PacketBuffer can be reused for packet after packet without allocating.
+ */
+class PacketBuffer
+{
+public:
+  /// Headroom left by default - enough for a few layers of headers
+  static const std::size_t DEFAULT_HEADROOM = 128;
+
+  typedef uint8_t* iterator;
+  typedef const uint8_t* const_iterator;
+
+  /** Create an empty packet
+   *
+   * @param capacity  Bytes of storage to allocate
+   * @param headroom  Bytes to leave in front of the data
+   */
+  explicit PacketBuffer(std::size_t capacity = 2048,
+                        std::size_t headroom = DEFAULT_HEADROOM)
+    :buf_(std::max(capacity, headroom)), head_(headroom), tail_(headroom)
+  {}
+
+  uint8_t* data() { return buf_.empty() ? NULL : &buf_[head_]; }
+  const uint8_t* data() const { return buf_.empty() ? NULL : &buf_[head_]; }
+  std::size_t size() const { return tail_ - head_; }
+  bool empty() const { return tail_ == head_; }
+
+  iterator begin() { return data(); }
+  iterator end() { return data() + size(); }
+  const_iterator begin() const { return data(); }
+  const_iterator end() const { return data() + size(); }
+
+  uint8_t& operator[](std::size_t i) { return buf_[head_ + i]; }
+  const uint8_t& operator[](std::size_t i) const { return buf_[head_ + i]; }
+
+  /// Bytes free in front of the data
+  std::size_t headroom() const { return head_; }
+  /// Bytes free after the data
+  std::size_t tailroom() const { return buf_.size() - tail_; }
+
+  /// Add n bytes to the front, return a pointer to them
+  uint8_t* push(std::size_t n)
+  {
+    if(n > head_)
+      grow(n + DEFAULT_HEADROOM, 0);
+    head_ -= n;
+    return &buf_[head_];
+  }
+
+  /// Remove n bytes from the front, return a pointer to the new front
+  uint8_t* pull(std::size_t n)
+  {
+    head_ += std::min(n, size());
+    return data();
+  }
+
+  /// Add n bytes to the end, return a pointer to them
+  uint8_t* put(std::size_t n)
+  {
+    if(n > tailroom())
+      grow(0, std::max(n, buf_.size()/2));
+    tail_ += n;
+    return &buf_[tail_ - n];
+  }
+
+  /// Keep only the first n bytes
+  void trim(std::size_t n)
+  {
+    tail_ = head_ + std::min(n, size());
+  }
+
+  /// Empty the packet, leaving headroom bytes in front
+  void clear(std::size_t headroom = DEFAULT_HEADROOM)
+  {
+    if(headroom > buf_.size())
+      buf_.resize(headroom);
+    head_ = tail_ = headroom;
+  }
+
+  /// Make sure there is at least this much room at each end
+  void reserve(std::size_t headroom, std::size_t tailroom)
+  {
+    if(headroom > head_ || tailroom > this->tailroom())
+      grow(headroom > head_ ? headroom - head_ : 0,
+           tailroom > this->tailroom() ? tailroom - this->tailroom() : 0);
+  }
+
+  /// Replace the packet with a copy of [first, last), leaving headroom in front
+  template <typename InputIterator>
+  void assign(InputIterator first, InputIterator last,
+              std::size_t headroom = DEFAULT_HEADROOM)
+  {
+    std::size_t n = std::distance(first, last);
+    clear(headroom);
+    std::copy(first, last, put(n));
+  }
+
+  /// Replace the packet with a copy of n bytes
+  void assign(const uint8_t* p, std::size_t n,
+              std::size_t headroom = DEFAULT_HEADROOM)
+  {
+    clear(headroom);
+    if(n > 0)
+      memcpy(put(n), p, n);
+  }
+
+private:
+  /// Add extra bytes of room at each end, keeping the data
+  void grow(std::size_t front, std::size_t back)
+  {
+    std::vector<uint8_t> bigger(buf_.size() + front + back);
+    std::size_t n = size();
+    if(n > 0)
+      memcpy(&bigger[head_ + front], &buf_[head_], n);
+    buf_.swap(bigger);
+    head_ += front;
+    tail_ = head_ + n;
+  }
+
+  std::vector<uint8_t> buf_;
+  std::size_t head_;      ///< Offset of the first byte of data
+  std::size_t tail_;      ///< Offset after the last byte of data
+};
+
+} // namespace iris
+
+#endif // PACKETBUFFER_H_
@@ -0,0 +1,313 @@
+/**
+ * \file QuantisedIq.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Conversion of complex<float> samples to and from a compact recording
+ * format of 16-bit or 8-bit IQ with a scale factor per block.
+ */
+
+#ifndef QUANTISEDIQ_H_
+#define QUANTISEDIQ_H_
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <boost/cstdint.hpp>
+
+#include "EndianConversion.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace iris
+{
+
+/** The quantised IQ file format.
+ *
+ * A file starts with a 16 byte header:
+ *   - magic "IRISIQ" (6 bytes)
+ *   - version (uint16, currently 1)
+ *   - sample format (uint16, see IqFormat)
+ *   - reserved (uint16, 0)
+ *   - samples per block (uint32)
+ *
+ * It is followed by blocks, each of which holds:
+ *   - number of samples in the block (uint32, only the last block of a file
+ *     may hold fewer than the samples per block in the header)
+ *   - scale (float)
+ *   - the samples as interleaved I,Q integers of the sample format
+ *
+ * A sample is reconstructed as scale * (I + jQ). All fields are little-endian.
+ * The scale of each block is chosen so the largest I or Q value in the block
+ * maps to full scale.
+ */
+enum IqFormat
+{
+  IQ_SC16 = 1,    ///< 16-bit signed I and Q
+  IQ_SC8 = 2      ///< 8-bit signed I and Q
+};
+
+namespace quantisediq
+{
+
+static const std::size_t HEADER_SIZE = 16;      ///< Bytes in the file header
+static const std::size_t BLOCK_HEADER_SIZE = 8; ///< Bytes before the samples of a block
+static const char MAGIC[] = "IRISIQ";
+
+/// Parse a format name (sc16|sc8), return false if unknown
+inline bool parseFormat(const std::string& name, IqFormat& format)
+{
+  if(name == "sc16")
+    format = IQ_SC16;
+  else if(name == "sc8")
+    format = IQ_SC8;
+  else
+    return false;
+  return true;
+}
+
+/// Bytes used by one complex sample
+inline std::size_t bytesPerSample(IqFormat format)
+{
+  return format == IQ_SC16 ? 4 : 2;
+}
+
+/// Bytes used by a block of num samples, including its header
+inline std::size_t blockBytes(IqFormat format, std::size_t num)
+{
+  return BLOCK_HEADER_SIZE + num*bytesPerSample(format);
+}
+
+/// Store/load little-endian fields
+inline void putU16(char* p, boost::uint16_t x) { x = sys2lit(x); std::memcpy(p, &x, 2); }
+inline void putU32(char* p, boost::uint32_t x) { x = sys2lit(x); std::memcpy(p, &x, 4); }
+inline void putF32(char* p, float x) { x = sys2lit(x); std::memcpy(p, &x, 4); }
+inline boost::uint16_t getU16(const char* p) { boost::uint16_t x; std::memcpy(&x, p, 2); return lit2sys(x); }
+inline boost::uint32_t getU32(const char* p) { boost::uint32_t x; std::memcpy(&x, p, 4); return lit2sys(x); }
+inline float getF32(const char* p) { float x; std::memcpy(&x, p, 4); return lit2sys(x); }
+
+/// Write a file header into out (HEADER_SIZE bytes)
+inline void writeHeader(char* out, IqFormat format, boost::uint32_t blockSize)
+{
+  std::memcpy(out, MAGIC, 6);
+  putU16(out + 6, 1);
+  putU16(out + 8, format);
+  putU16(out + 10, 0);
+  putU32(out + 12, blockSize);
+}
+
+/// Read a file header (HEADER_SIZE bytes), return false if it is not one
+inline bool readHeader(const char* in, IqFormat& format, boost::uint32_t& blockSize)
+{
+  if(std::memcmp(in, MAGIC, 6) != 0 || getU16(in + 6) != 1)
+    return false;
+  boost::uint16_t f = getU16(in + 8);
+  if(f != IQ_SC16 && f != IQ_SC8)
+    return false;
+  format = IqFormat(f);
+  blockSize = getU32(in + 12);
+  return blockSize > 0;
+}
+
+/// Largest absolute I or Q value in num samples
+inline float peak(const std::complex<float>* in, std::size_t num)
+{
+  const float* f = reinterpret_cast<const float*>(in);
+  std::size_t n = 2*num;
+  std::size_t i = 0;
+  float m = 0;
+#ifdef __SSE2__
+  const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  __m128 vm = _mm_setzero_ps();
+  for(; i + 4 <= n; i += 4)
+    vm = _mm_max_ps(vm, _mm_and_ps(_mm_loadu_ps(f + i), absMask));
+  float lanes[4];
+  _mm_storeu_ps(lanes, vm);
+  m = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+  for(; i < n; i++)
+    m = std::max(m, std::fabs(f[i]));
+  return m;
+}
+
+/// Round (halves to even, like cvtps) and saturate to an integer type with the given full scale
+template <class IntT>
+inline IntT quantiseOne(float x, float full)
+{
+  return IntT(lrintf(std::max(-full - 1, std::min(full, x))));
+}
+
+/// Quantise num samples to interleaved 16-bit IQ (native byte order), return the scale
+inline float quantise(const std::complex<float>* in, std::size_t num, boost::int16_t* out)
+{
+  float p = peak(in, num);
+  float scale = p > 0 ? p/32767.0f : 1.0f;
+  float inv = p > 0 ? 32767.0f/p : 0.0f;
+  const float* f = reinterpret_cast<const float*>(in);
+  std::size_t n = 2*num;
+  std::size_t i = 0;
+#ifdef __SSE2__
+  __m128 vinv = _mm_set1_ps(inv);
+  for(; i + 8 <= n; i += 8)
+  {
+    __m128i a = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(f + i), vinv));
+    __m128i b = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(f + i + 4), vinv));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(a, b));
+  }
+#endif
+  for(; i < n; i++)
+    out[i] = quantiseOne<boost::int16_t>(f[i]*inv, 32767.0f);
+  return scale;
+}
+
+/// Quantise num samples to interleaved 8-bit IQ, return the scale
+inline float quantise(const std::complex<float>* in, std::size_t num, boost::int8_t* out)
+{
+  float p = peak(in, num);
+  float scale = p > 0 ? p/127.0f : 1.0f;
+  float inv = p > 0 ? 127.0f/p : 0.0f;
+  const float* f = reinterpret_cast<const float*>(in);
+  std::size_t n = 2*num;
+  std::size_t i = 0;
+#ifdef __SSE2__
+  __m128 vinv = _mm_set1_ps(inv);
+  for(; i + 16 <= n; i += 16)
+  {
+    __m128i a = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(f + i), vinv));
+    __m128i b = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(f + i + 4), vinv));
+    __m128i c = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(f + i + 8), vinv));
+    __m128i d = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(f + i + 12), vinv));
+    __m128i ab = _mm_packs_epi32(a, b);
+    __m128i cd = _mm_packs_epi32(c, d);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi16(ab, cd));
+  }
+#endif
+  for(; i < n; i++)
+    out[i] = quantiseOne<boost::int8_t>(f[i]*inv, 127.0f);
+  return scale;
+}
+
+/// Expand num samples of interleaved 16-bit IQ (native byte order)
+inline void expand(const boost::int16_t* in, std::size_t num, float scale, std::complex<float>* out)
+{
+  float* f = reinterpret_cast<float*>(out);
+  std::size_t n = 2*num;
+  std::size_t i = 0;
+#ifdef __SSE2__
+  __m128 vscale = _mm_set1_ps(scale);
+  for(; i + 8 <= n; i += 8)
+  {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+    __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+    _mm_storeu_ps(f + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), vscale));
+    _mm_storeu_ps(f + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), vscale));
+  }
+#endif
+  for(; i < n; i++)
+    f[i] = in[i]*scale;
+}
+
+/// Expand num samples of interleaved 8-bit IQ
+inline void expand(const boost::int8_t* in, std::size_t num, float scale, std::complex<float>* out)
+{
+  float* f = reinterpret_cast<float*>(out);
+  std::size_t n = 2*num;
+  std::size_t i = 0;
+#ifdef __SSE2__
+  __m128 vscale = _mm_set1_ps(scale);
+  for(; i + 16 <= n; i += 16)
+  {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    __m128i lo16 = _mm_unpacklo_epi8(x, x);
+    __m128i hi16 = _mm_unpackhi_epi8(x, x);
+    __m128i a = _mm_srai_epi32(_mm_unpacklo_epi16(lo16, lo16), 24);
+    __m128i b = _mm_srai_epi32(_mm_unpackhi_epi16(lo16, lo16), 24);
+    __m128i c = _mm_srai_epi32(_mm_unpacklo_epi16(hi16, hi16), 24);
+    __m128i d = _mm_srai_epi32(_mm_unpackhi_epi16(hi16, hi16), 24);
+    _mm_storeu_ps(f + i, _mm_mul_ps(_mm_cvtepi32_ps(a), vscale));
+    _mm_storeu_ps(f + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(b), vscale));
+    _mm_storeu_ps(f + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(c), vscale));
+    _mm_storeu_ps(f + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(d), vscale));
+  }
+#endif
+  for(; i < n; i++)
+    f[i] = in[i]*scale;
+}
+
+/** Encode a block of num samples (header and samples) into out, which must
+ * hold blockBytes(format, num) bytes.
+ */
+inline void encodeBlock(const std::complex<float>* in, std::size_t num,
+                        IqFormat format, char* out)
+{
+  float scale;
+  char* payload = out + BLOCK_HEADER_SIZE;
+  if(format == IQ_SC16)
+  {
+    boost::int16_t* q = reinterpret_cast<boost::int16_t*>(payload);
+    scale = quantise(in, num, q);
+#ifdef BOOST_BIG_ENDIAN
+    for(std::size_t i = 0; i < 2*num; i++)
+      q[i] = sys2lit(q[i]);
+#endif
+  }
+  else
+    scale = quantise(in, num, reinterpret_cast<boost::int8_t*>(payload));
+  putU32(out, num);
+  putF32(out + 4, scale);
+}
+
+/** Decode the samples of a block whose header has already been read.
+ * Note that in may be byte-swapped in place on big-endian systems.
+ */
+inline void decodeBlock(char* in, std::size_t num, float scale,
+                        IqFormat format, std::complex<float>* out)
+{
+  if(format == IQ_SC16)
+  {
+    boost::int16_t* q = reinterpret_cast<boost::int16_t*>(in);
+#ifdef BOOST_BIG_ENDIAN
+    for(std::size_t i = 0; i < 2*num; i++)
+      q[i] = lit2sys(q[i]);
+#endif
+    expand(q, num, scale, out);
+  }
+  else
+    expand(reinterpret_cast<const boost::int8_t*>(in), num, scale, out);
+}
+
+} // namespace quantisediq
+} // namespace iris
+
+#endif // QUANTISEDIQ_H_
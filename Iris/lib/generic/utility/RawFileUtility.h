@@ -35,6 +35,8 @@
 #define RAWFILEUTILITY_H
 
 #include <fstream>
+#include <algorithm>
+#include <cstring>
 #include "EndianConversion.h"
 
 /*! \class RawFileUtility Class
@@ -44,6 +46,9 @@ class RawFileUtility
 {
 public:
 
+	/// Number of elements converted at a time when byte-swapping
+	static const std::size_t CHUNK_SIZE = 1024;
+
 	/*! Function Description.
 	* \brief Write anything to file
 	* \param first An iterator to the first element 
@@ -81,25 +86,84 @@ public:
 	static bool write(Iter first, Iter last, std::ostream &hOutFile, std::string endianness = "native")
 	{
 		using namespace std;
+		typedef typename iterator_traits<Iter>::value_type Type;
 
+		// Convert into a local chunk and write that, rather than element by element
+		bool swap = sizeof(Type) > 1 && needsSwap(endianness);
+		Type chunk[CHUNK_SIZE];
+		size_t n = 0;
 		for(;first != last;++first)
 		{
-			typename iterator_traits<Iter>::value_type temp = *first;
-			if(sizeof(temp) > 1)
+			chunk[n++] = *first;
+			if(n == CHUNK_SIZE)
 			{
-				if(endianness == "big")
-				{
-					temp = sys2big(temp);
-				}
-				if(endianness == "little")
-				{
-					temp = sys2lit(temp);
-				}
+				convert(chunk, n, chunk, swap);
+				hOutFile.write(reinterpret_cast<char*>(chunk), n*sizeof(Type));
+				n = 0;
 			}
-			hOutFile.write(reinterpret_cast<char*>(&temp), sizeof(temp));
 		}
-		return true;
-  }
+		convert(chunk, n, chunk, swap);
+		hOutFile.write(reinterpret_cast<char*>(chunk), n*sizeof(Type));
+		return hOutFile.good();
+	}
+
+	/*! Function Description.
+	* \brief Write a contiguous block to file
+	* \param data		Pointer to the first element
+	* \param num		Number of elements to write
+	* \param hOutFile	An ofstream to write to
+	* \param endianness	The endianness with which data should be written
+	*
+	* Native data is written with a single call, otherwise it is converted
+	* in chunks with convert().
+	*/
+	template <typename T>
+	static bool writeBlock(const T* data, std::size_t num, std::ostream &hOutFile, std::string endianness = "native")
+	{
+		if(sizeof(T) == 1 || !needsSwap(endianness))
+		{
+			hOutFile.write(reinterpret_cast<const char*>(data), num*sizeof(T));
+			return hOutFile.good();
+		}
+
+		T chunk[CHUNK_SIZE];
+		for(std::size_t i = 0; i < num; i += CHUNK_SIZE)
+		{
+			std::size_t n = std::min(num - i, std::size_t(CHUNK_SIZE));
+			convert(data + i, n, chunk, true);
+			hOutFile.write(reinterpret_cast<char*>(chunk), n*sizeof(T));
+		}
+		return hOutFile.good();
+	}
+
+	/*! Function Description.
+	* \brief Copy a contiguous block, swapping byte order if required
+	* \param in		Pointer to the first input element
+	* \param num		Number of elements to copy
+	* \param out		Pointer to the first output element (may equal in)
+	* \param swap		Swap the byte order of each element?
+	*/
+	template <typename T>
+	static void convert(const T* in, std::size_t num, T* out, bool swap)
+	{
+		if(swap && sizeof(T) > 1)
+			swap_bytes(in, in + num, out);
+		else if(in != out)
+			std::memcpy(out, in, num*sizeof(T));
+	}
+
+	/*! Function Description.
+	* \brief Does data with the given endianness need byte-swapping on this system?
+	* \param endianness	The endianness of the data (little|big|native)
+	*/
+	static bool needsSwap(const std::string& endianness)
+	{
+#ifdef BOOST_BIG_ENDIAN
+		return endianness == "little";
+#else
+		return endianness == "big";
+#endif
+	}
 
   /*! Function Description.
   * \brief Get the number of elements in a file
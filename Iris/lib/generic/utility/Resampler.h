@@ -0,0 +1,207 @@
+/**
+ * \file Resampler.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Polyphase rational resampler.
+ */
+
+#ifndef _RESAMPLER_H_
+#define _RESAMPLER_H_
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "math/DotProduct.h"
+#include "math/MathDefines.h"
+
+namespace iris
+{
+
+//! \brief Polyphase rational resampler.
+//!
+//! Changes the sample rate of a signal by L/M, where L is the interpolation
+//! and M the decimation factor. The prototype lowpass filter runs at L times
+//! the input rate and is split into L phase filters which are stored
+//! contiguously. Each output is a single vectorised dot product of one phase
+//! filter with the delay line, so no multiplications by the zeros of the
+//! upsampled signal or by discarded outputs are done.
+//!
+//! This supersedes FirFilterUpsamp, which is equivalent to a Resampler with
+//! M = 1.
+template<class InT, class CoeffT = InT, class OutT = InT>
+class Resampler
+{
+public:
+  //! default constructor - no coefficients are set
+  Resampler()
+    : interpolation_(1), decimation_(1), tapsPerPhase_(0), pos_(0), phase_(0)
+  {
+  }
+
+  //! constructor setting the rates and the prototype filter coefficients
+  template<class It>
+  Resampler(unsigned interpolation, unsigned decimation, It start, It end)
+  {
+    setCoeffs(interpolation, decimation, start, end);
+  }
+
+  //! \brief Set the rates and the prototype filter and clear the state.
+  //! The prototype filter is designed at L times the input rate.
+  template<class It>
+  void setCoeffs(unsigned interpolation, unsigned decimation, It start, It end)
+  {
+    if (interpolation == 0 || decimation == 0)
+      throw std::invalid_argument("Resampler: rates must be non-zero");
+
+    interpolation_ = interpolation;
+    decimation_ = decimation;
+
+    std::vector<CoeffT> prototype(start, end);
+    tapsPerPhase_ = (prototype.size() + interpolation_ - 1) / interpolation_;
+    prototype.resize(tapsPerPhase_ * interpolation_);
+
+    // Phase p holds h[p], h[p+L], h[p+2L], ... reversed, so the oldest
+    // sample in the delay line meets the last tap
+    phases_.resize(prototype.size());
+    for (unsigned p = 0; p < interpolation_; ++p)
+      for (std::size_t k = 0; k < tapsPerPhase_; ++k)
+        phases_[p*tapsPerPhase_ + tapsPerPhase_-1-k] = prototype[p + k*interpolation_];
+
+    history_.assign(2*tapsPerPhase_, InT());
+    reset();
+  }
+
+  //! clear the filter state, keeping the coefficients
+  void reset()
+  {
+    std::fill(history_.begin(), history_.end(), InT());
+    pos_ = 0;
+    phase_ = 0;
+  }
+
+  unsigned getInterpolation() const { return interpolation_; }
+  unsigned getDecimation() const { return decimation_; }
+
+  //! \brief Offset of the next output from the next input, in units of
+  //! 1/L input samples.
+  //! Use this to work out the timestamp of the first output of a block.
+  std::size_t getPhase() const { return phase_; }
+
+  //! number of outputs the next call to filter() gives for numInputs inputs
+  std::size_t getOutputSize(std::size_t numInputs) const
+  {
+    std::size_t end = numInputs * interpolation_;
+    if (tapsPerPhase_ == 0 || phase_ >= end)
+      return 0;
+    return (end - phase_ + decimation_ - 1) / decimation_;
+  }
+
+  //! \brief Resample given input sequence, writing output to output iterator.
+  //! Make sure that output can hold getOutputSize(input.size()) values.
+  //! \return Iterator pointing to one past the end of the output sequence.
+  template<class InIt, class OutIt>
+  OutIt filter(InIt istart, InIt iend, OutIt ostart)
+  {
+    if (tapsPerPhase_ == 0)
+      return ostart;
+
+    const CoeffT* phases = &phases_[0];
+    InT* history = &history_[0];
+    while (istart != iend)
+    {
+      // Doubled delay line - the last tapsPerPhase_ inputs start at pos_+1
+      history[pos_] = history[pos_ + tapsPerPhase_] = *istart++;
+      const InT* window = history + pos_ + 1;
+      if (++pos_ == tapsPerPhase_)
+        pos_ = 0;
+
+      // Produce every output which falls between this input and the next
+      while (phase_ < interpolation_)
+      {
+        *ostart++ = dotProduct<OutT>(phases + phase_*tapsPerPhase_,
+                                     window, tapsPerPhase_);
+        phase_ += decimation_;
+      }
+      phase_ -= interpolation_;
+    }
+    return ostart;
+  }
+
+  //! \brief Design a Kaiser-windowed sinc prototype filter for L/M resampling.
+  //! The cutoff is half the lower of the input and output rates and the
+  //! passband gain is L to make up for the zeros inserted by upsampling.
+  //! \param tapsPerPhase Number of taps in each of the L phase filters
+  //! \param beta Kaiser window parameter (8.6 gives about 90dB stopband)
+  static std::vector<CoeffT> designFilter(unsigned interpolation,
+                                          unsigned decimation,
+                                          unsigned tapsPerPhase = 16,
+                                          double beta = 8.6)
+  {
+    std::size_t n = std::max(1u, tapsPerPhase * interpolation);
+    double cutoff = 0.5 / std::max(interpolation, decimation);
+    double centre = (n - 1) / 2.0;
+    std::vector<CoeffT> coeffs(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      double t = i - centre;
+      double sinc = t == 0 ? 2*cutoff : sin(2*IRIS_PI*cutoff*t) / (IRIS_PI*t);
+      double r = n > 1 ? 2*t/(n - 1) : 0;
+      double window = besselI0(beta*sqrt(std::max(0.0, 1 - r*r))) / besselI0(beta);
+      coeffs[i] = CoeffT(interpolation * sinc * window);
+    }
+    return coeffs;
+  }
+
+private:
+  //! zeroth order modified Bessel function of the first kind
+  static double besselI0(double x)
+  {
+    double sum = 1, term = 1;
+    for (int k = 1; k < 50 && term > 1e-12*sum; ++k)
+    {
+      term *= (x*x) / (4.0*k*k);
+      sum += term;
+    }
+    return sum;
+  }
+
+  unsigned interpolation_;        //!< L
+  unsigned decimation_;           //!< M
+  std::size_t tapsPerPhase_;      //!< taps in each phase filter
+  std::vector<CoeffT> phases_;    //!< L phase filters, contiguous and reversed
+  std::vector<InT> history_;      //!< doubled delay line
+  std::size_t pos_;               //!< current position in history_
+  std::size_t phase_;             //!< position of next output, in 1/L input samples
+};
+
+} // end of iris namespace
+
+#endif
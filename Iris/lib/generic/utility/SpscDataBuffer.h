@@ -0,0 +1,332 @@
+/**
+ * \file SpscDataBuffer.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * A lock-free single-producer/single-consumer DataBuffer for passing
+ * DataSets between two threads (e.g. two engines).
+ */
+
+#ifndef SPSCDATABUFFER_H_
+#define SPSCDATABUFFER_H_
+
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "irisapi/DataBufferInterfaces.h"
+#include "irisapi/Exceptions.h"
+#include "irisapi/TypeInfo.h"
+
+namespace iris
+{
+
+/// How a thread waits when the SpscDataBuffer is empty (reader) or full (writer)
+enum SpscWaitStrategy
+{
+  SPSC_BLOCK,           ///< Sleep on a condition variable straight away
+  SPSC_SPIN_THEN_PARK   ///< Spin for a while, then sleep on a condition variable
+};
+
+namespace spscdetail
+{
+
+#ifdef __ATOMIC_ACQUIRE
+  inline std::size_t loadAcquire(const volatile std::size_t& v)
+  {
+    return __atomic_load_n(&v, __ATOMIC_ACQUIRE);
+  }
+  inline void storeRelease(volatile std::size_t& v, std::size_t x)
+  {
+    __atomic_store_n(&v, x, __ATOMIC_RELEASE);
+  }
+  inline void fullFence() { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+#else
+  inline std::size_t loadAcquire(const volatile std::size_t& v)
+  {
+    std::size_t x = v;
+    __sync_synchronize();
+    return x;
+  }
+  inline void storeRelease(volatile std::size_t& v, std::size_t x)
+  {
+    __sync_synchronize();
+    v = x;
+  }
+  inline void fullFence() { __sync_synchronize(); }
+#endif
+
+  /// Tell the cpu we are busy-waiting
+  inline void cpuRelax()
+  {
+#if defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__("pause");
+#endif
+  }
+
+  /// Size of a cache line - used to keep the indices apart
+  static const std::size_t CACHE_LINE = 64;
+
+  /// An index which sits on its own cache line
+  struct PaddedIndex
+  {
+    PaddedIndex() : value(0), waiting(0) {}
+    volatile std::size_t value;     ///< Count of DataSets released by the owner
+    volatile std::size_t waiting;   ///< Set when the other side is parked on this index
+    char pad[CACHE_LINE - 2*sizeof(std::size_t)];
+  };
+
+} // namespace spscdetail
+
+/** The SpscDataBuffer class implements a lock-free buffer between one writer
+ * thread and one reader thread.
+ *
+ * The buffer consists of a fixed number of preallocated DataSet objects which
+ * are reused. The writer publishes a DataSet by advancing the write index and
+ * the reader frees it by advancing the read index. Each index is written by one
+ * thread only and sits on its own cache line, so no locks are taken while data
+ * is flowing. Each side also keeps a private copy of the other side's index
+ * and only re-reads the shared one when its copy says the buffer is empty/full.
+ *
+ * getReadData() blocks while the buffer is empty and getWriteData() blocks
+ * while it is full. With SPSC_SPIN_THEN_PARK the waiting thread spins for
+ * spinCount iterations first, which gives the lowest hand-off latency when
+ * both threads have their own core. With SPSC_BLOCK it sleeps straight away.
+ * A mutex and condition variable are only touched when a thread has to sleep.
+ *
+ * Only one thread may call the read functions and only one thread may call
+ * the write functions.
+ */
+template <typename T>
+class SpscDataBuffer
+  : public ReadBuffer<T>, public WriteBuffer<T>
+{
+public:
+
+  /** Create a buffer
+   *
+   * @param buffer_size   Number of DataSets (rounded up to a power of two)
+   * @param data_size     Number of elements to preallocate in each DataSet
+   * @param strategy      How to wait when the buffer is empty or full
+   * @param spin_count    Number of spins before parking (SPSC_SPIN_THEN_PARK)
+   */
+  explicit SpscDataBuffer(std::size_t buffer_size = 8,
+                          std::size_t data_size = 0,
+                          SpscWaitStrategy strategy = SPSC_SPIN_THEN_PARK,
+                          std::size_t spin_count = 4000)
+    :strategy_(strategy),
+    spinCount_(strategy == SPSC_BLOCK ? 0 : spin_count),
+    readLocked_(false),
+    cachedWriteIndex_(0),
+    writeLocked_(false),
+    cachedReadIndex_(0)
+  {
+    typeIdentifier = TypeInfo<T>::identifier;
+    if( typeIdentifier == -1)
+      throw InvalidDataTypeException("Data type not supported");
+
+    std::size_t size = 1;
+    while(size < buffer_size)
+      size <<= 1;
+    mask_ = size - 1;
+    buffer_.resize(size);
+    for(std::size_t i=0; i<size; i++)
+      buffer_[i].data.reserve(data_size);
+  };
+
+  virtual ~SpscDataBuffer(){};
+
+  /// Get the identifier for the data type of this buffer
+  virtual int getTypeIdentifier() const   {  return typeIdentifier; }
+
+  /// Is there any data in this buffer?
+  virtual bool hasData() const
+  {
+    return spscdetail::loadAcquire(write_.value) != read_.value;
+  }
+
+  virtual void setLinkDescription(LinkDescription desc) { linkDesc_ = desc; }
+  virtual LinkDescription getLinkDescription() const { return linkDesc_; }
+
+  /// Number of DataSets in the buffer
+  std::size_t capacity() const { return mask_ + 1; }
+
+  /// The wait strategy used by this buffer
+  SpscWaitStrategy getWaitStrategy() const { return strategy_; }
+
+  /** Get the next DataSet to read - blocks while the buffer is empty
+   *
+   * @param setPtr   A DataSet pointer which will be set by the buffer
+   */
+  virtual void getReadData(DataSet<T>*& setPtr)
+  {
+    if(readLocked_)
+      throw DataBufferReleaseException("getReadData() called before previous DataSet was released");
+
+    std::size_t r = read_.value;
+    if(cachedWriteIndex_ == r)
+    {
+      cachedWriteIndex_ = spscdetail::loadAcquire(write_.value);
+      if(cachedWriteIndex_ == r)
+      {
+        waitFor(write_, r, notEmpty_);
+        cachedWriteIndex_ = spscdetail::loadAcquire(write_.value);
+      }
+    }
+    readLocked_ = true;
+    setPtr = &buffer_[r & mask_];
+  };
+
+  /** Get the next DataSet to be written - blocks while the buffer is full
+   *
+   * @param setPtr   A DataSet pointer which will be set by the buffer
+   * @param size   The number of elements required in the DataSet
+   */
+  virtual void getWriteData(DataSet<T>*& setPtr, std::size_t size)
+  {
+    if(writeLocked_)
+      throw DataBufferReleaseException("getWriteData() called before previous DataSet was released");
+
+    std::size_t w = write_.value;
+    std::size_t full = w - capacity();
+    if(cachedReadIndex_ == full)
+    {
+      cachedReadIndex_ = spscdetail::loadAcquire(read_.value);
+      if(cachedReadIndex_ == full)
+      {
+        waitFor(read_, full, notFull_);
+        cachedReadIndex_ = spscdetail::loadAcquire(read_.value);
+      }
+    }
+    writeLocked_ = true;
+    DataSet<T>& set = buffer_[w & mask_];
+    if(set.data.size() != size)
+      set.data.resize(size);
+    setPtr = &set;
+  };
+
+  /** Release a read DataSet
+   *
+   * @param setPtr   A pointer to the DataSet to be released
+   */
+  virtual void releaseReadData(DataSet<T>*& setPtr)
+  {
+    if(!readLocked_)
+      throw DataBufferReleaseException("releaseReadData() called without a DataSet");
+    readLocked_ = false;
+    setPtr = NULL;
+    publish(read_, read_.value + 1, notFull_);
+  };
+
+  /** Release a write DataSet
+   *
+   * @param setPtr   A pointer to the DataSet to be released
+   */
+  virtual void releaseWriteData(DataSet<T>*& setPtr)
+  {
+    if(!writeLocked_)
+      throw DataBufferReleaseException("releaseWriteData() called without a DataSet");
+    writeLocked_ = false;
+    setPtr = NULL;
+    publish(write_, write_.value + 1, notEmpty_);
+  };
+
+private:
+  /// Advance our index and wake the other side if it is parked
+  void publish(spscdetail::PaddedIndex& ours, std::size_t value,
+               boost::condition_variable& cond)
+  {
+    spscdetail::storeRelease(ours.value, value);
+    // The fence pairs with the one in waitFor(): either the waiter sees our
+    // new index or we see its waiting flag.
+    spscdetail::fullFence();
+    if(spscdetail::loadAcquire(ours.waiting))
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      cond.notify_one();
+    }
+  }
+
+  /// Wait until the other side moves index away from value
+  void waitFor(spscdetail::PaddedIndex& index, std::size_t value,
+               boost::condition_variable& cond)
+  {
+    for(std::size_t i=0; i<spinCount_; i++)
+    {
+      if(spscdetail::loadAcquire(index.value) != value)
+        return;
+      if((i & 63) == 63)
+        boost::this_thread::yield();
+      else
+        spscdetail::cpuRelax();
+    }
+
+    boost::mutex::scoped_lock lock(mutex_);
+    spscdetail::storeRelease(index.waiting, 1);
+    spscdetail::fullFence();
+    while(spscdetail::loadAcquire(index.value) == value)
+      cond.wait(lock);
+    spscdetail::storeRelease(index.waiting, 0);
+  }
+
+  /// The data type of this buffer
+  int typeIdentifier;
+
+  /// The preallocated DataSets
+  std::vector< DataSet<T> > buffer_;
+  std::size_t mask_;
+
+  SpscWaitStrategy strategy_;
+  std::size_t spinCount_;
+  LinkDescription linkDesc_;
+
+  /// Written by the writer only
+  spscdetail::PaddedIndex write_;
+  /// Written by the reader only
+  spscdetail::PaddedIndex read_;
+
+  /// Reader-side state
+  bool readLocked_;
+  std::size_t cachedWriteIndex_;
+  char readPad_[spscdetail::CACHE_LINE];
+
+  /// Writer-side state
+  bool writeLocked_;
+  std::size_t cachedReadIndex_;
+  char writePad_[spscdetail::CACHE_LINE];
+
+  /// Only used when a thread has to sleep
+  boost::mutex mutex_;
+  boost::condition_variable notEmpty_;
+  boost::condition_variable notFull_;
+};
+
+} // namespace iris
+
+#endif // SPSCDATABUFFER_H_
@@ -46,6 +46,11 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/format.hpp>
 #include <google/protobuf/message.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+
+#include "PacketBuffer.h"
 
 
 namespace iris
@@ -57,13 +62,18 @@ public:
     /**
      * \brief Tries to deserialize a StackDataSet into ProtoBuf object.
      *
-     * This function first copies the StackDataSet into a continous data
+     * This function first copies the StackDataSet into a continuous data
      * structure and then tries to desierialize it into a given ProtoBuf
      * object. If the StackDataSet does not contain a proper Protobuf
      * object the function returns false. If yes, and the object contains
      * any payload, only the payload of the packet remains inside the
      * StackDataSet for further processing.
      *
+     * The frame is copied once into a PacketBuffer, where the header is
+     * parsed and the payload cut out in place (see below). Only the payload
+     * is copied back into the StackDataSet, and only if a header was
+     * stripped.
+     *
      * \param frame the StackDataSet
      * \param protobuf the ProtocolBuffer data structure
      * \return true - if successful, false otherwise.
@@ -71,19 +81,88 @@ public:
     template<typename T>
     static bool deserializeAndStripDataset(boost::shared_ptr<StackDataSet> frame, T &protobuf)
     {
-        // copy frame into vector first
-        std::vector<uint8_t> buffer(frame->data.begin(), frame->data.end());
-
-        if (!protobuf.ParseFromArray((void*)&buffer.front(), buffer.size())) {
+        PacketBuffer packet(frame->data.size(), 0);
+        packet.assign(frame->data.begin(), frame->data.end(), 0);
+        if (!deserializeAndStripDataset(packet, protobuf)) {
             return false;
         }
 
-        // retrieve payload from packet which is the first element in RepeatedPtrField
-        if (protobuf.mutable_payload()->size() == 1) {
-            std::string payload = protobuf.mutable_payload()->Get(0);
-            frame->data.clear();
-            frame->data.insert(frame->data.end(), payload.c_str(), payload.c_str() + payload.size());
+        // only copy back if the payload was stripped
+        if (packet.size() != frame->data.size()) {
+            frame->data.assign(packet.begin(), packet.end());
+        }
+        return true;
+    }
+
+
+    /**
+     * \brief Tries to deserialize a PacketBuffer into ProtoBuf object.
+     *
+     * The header fields of the packet are parsed into the ProtoBuf object.
+     * If the packet carries exactly one payload, the packet is then cut
+     * down to it in place, by moving its ends, and the payload is not
+     * copied into the ProtoBuf object. Otherwise the whole packet is parsed
+     * and left as it is.
+     *
+     * \param packet the packet
+     * \param protobuf the ProtocolBuffer data structure, which must have a
+     *        repeated bytes field called payload
+     * \return true - if successful, false otherwise.
+     */
+    template<typename T>
+    static bool deserializeAndStripDataset(PacketBuffer &packet, T &protobuf)
+    {
+        using google::protobuf::io::CodedInputStream;
+        using google::protobuf::internal::WireFormatLite;
+        static const int field = payloadFieldNumber(protobuf);
+
+        // find the payload without parsing it
+        const uint8_t* data = packet.data();
+        int size = packet.size();
+        CodedInputStream input(data, size);
+        int count = 0, tagStart = 0, start = 0;
+        uint32_t length = 0;
+        while (true) {
+            int position = input.CurrentPosition();
+            uint32_t tag = input.ReadTag();
+            if (tag == 0) {
+                if (position != size) {
+                    return false;
+                }
+                break;
+            }
+            if (WireFormatLite::GetTagFieldNumber(tag) == field &&
+                WireFormatLite::GetTagWireType(tag) == WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+                if (!input.ReadVarint32(&length)) {
+                    return false;
+                }
+                tagStart = position;
+                start = input.CurrentPosition();
+                count++;
+                if (!input.Skip(length)) {
+                    return false;
+                }
+            } else if (!WireFormatLite::SkipField(&input, tag)) {
+                return false;
+            }
+        }
+
+        if (count != 1) {
+            return protobuf.ParseFromArray(data, size);
+        }
+
+        // parse the fields either side of the payload
+        protobuf.Clear();
+        CodedInputStream before(data, tagStart);
+        CodedInputStream after(data + start + length, size - start - length);
+        if (!protobuf.MergePartialFromCodedStream(&before) ||
+            !protobuf.MergePartialFromCodedStream(&after) ||
+            !protobuf.IsInitialized()) {
+            return false;
         }
+
+        packet.pull(start);
+        packet.trim(length);
         return true;
     }
 
@@ -95,6 +174,10 @@ public:
      * to a protobuf object which is then serialized. The StackDataSet is
      * then filled with the resulting binary data.
      *
+     * The data is copied once into a PacketBuffer with headroom, where the
+     * header is serialized in front of it (see below). The whole frame,
+     * header and payload, is then copied back into the StackDataSet.
+     *
      * \param frame the StackDataSet
      * \param protobuf the ProtocolBuffer data structure
      * \return void
@@ -102,18 +185,48 @@ public:
     template<typename T>
     static void mergeAndSerializeDataset(boost::shared_ptr<StackDataSet> frame, T &protobuf)
     {
-        // construct vector from deque and add to protobuf packet
-        std::vector<uint8_t> payload(frame->data.begin(), frame->data.end());
-        protobuf.add_payload(&payload.front(), payload.size());
-
-        // serialize whole packet into "old" payload vector
-        payload.clear();
-        payload.resize(protobuf.ByteSize());
-        protobuf.SerializeWithCachedSizesToArray(&payload.front());
-
-        // clear "old" Iris frame and construct new one from payload
-        frame->data.clear();
-        frame->data.insert(frame->data.begin(), payload.begin(), payload.end());
+        PacketBuffer packet(PacketBuffer::DEFAULT_HEADROOM + frame->data.size());
+        packet.assign(frame->data.begin(), frame->data.end());
+        mergeAndSerializeDataset(packet, protobuf);
+        frame->data.assign(packet.begin(), packet.end());
+    }
+
+
+    /**
+     * \brief Merges a PacketBuffer/ProtoBuf object and serializes it.
+     *
+     * The ProtoBuf object is serialized into the headroom of the packet,
+     * followed by the tag and length of a payload field, so the packet
+     * becomes a serialized ProtoBuf object with the data as its payload.
+     * The data is not copied and the payload is not added to the ProtoBuf
+     * object.
+     *
+     * The payload always comes last. This is the same byte sequence as
+     * serializing the object with the payload added only if no field with
+     * a higher number than payload is set - otherwise it is a different,
+     * but equally valid, encoding of the same message, since parsers
+     * accept fields in any order.
+     *
+     * \param packet the packet
+     * \param protobuf the ProtocolBuffer data structure, which must have a
+     *        repeated bytes field called payload
+     * \return void
+     */
+    template<typename T>
+    static void mergeAndSerializeDataset(PacketBuffer &packet, T &protobuf)
+    {
+        using google::protobuf::io::CodedOutputStream;
+        using google::protobuf::internal::WireFormatLite;
+        static const int field = payloadFieldNumber(protobuf);
+
+        uint32_t length = packet.size();
+        uint32_t tag = WireFormatLite::MakeTag(field, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+        int headerSize = protobuf.ByteSize();
+        uint8_t* p = packet.push(headerSize + CodedOutputStream::VarintSize32(tag) +
+                                 CodedOutputStream::VarintSize32(length));
+        p = protobuf.SerializeWithCachedSizesToArray(p);
+        p = CodedOutputStream::WriteVarint32ToArray(tag, p);
+        CodedOutputStream::WriteVarint32ToArray(length, p);
     }
 
 
@@ -149,6 +262,15 @@ public:
             std::cout << std::endl;
         std::cout << boost::format("--------") << std::endl;
     }
+
+private:
+    /// Number of the payload field of a ProtoBuf message
+    static int payloadFieldNumber(const google::protobuf::Message &protobuf)
+    {
+        const google::protobuf::FieldDescriptor* field =
+            protobuf.GetDescriptor()->FindFieldByName("payload");
+        return field ? field->number() : 0;
+    }
 };
 
 } // end of iris namespace
@@ -0,0 +1,117 @@
+/**
+ * \file TcpFraming.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Length-prefixed framing of DataSets sent over TCP.
+ */
+
+#ifndef TCPFRAMING_H_
+#define TCPFRAMING_H_
+
+#include <cstddef>
+#include <cstring>
+#include <boost/cstdint.hpp>
+
+#include "EndianConversion.h"
+
+namespace iris
+{
+
+/** The framing used by TcpSocketTxComponent and TcpSocketRxComponent.
+ *
+ * Each DataSet is sent as one message: a 32 byte header in network
+ * (big-endian) byte order:
+ *   - magic 0x4954 (uint16)
+ *   - version (uint8, currently 1)
+ *   - reserved (uint8)
+ *   - Iris type identifier of the data (uint32)
+ *   - size of the data in bytes (uint32)
+ *   - reserved (uint32)
+ *   - timeStamp of the DataSet (double)
+ *   - sampleRate of the DataSet (double)
+ *
+ * followed by the data in the sender's byte order.
+ */
+struct MessageHeader
+{
+  uint32_t type;
+  uint32_t length;
+  double timeStamp;
+  double sampleRate;
+};
+
+namespace tcpframing
+{
+  static const uint16_t MAGIC = 0x4954;
+  static const uint8_t VERSION = 1;
+  static const std::size_t HEADER_SIZE = 32;
+
+  template <typename T>
+  inline void put(char* p, T x)
+  {
+    x = sys2big(x);
+    memcpy(p, &x, sizeof(T));
+  }
+
+  template <typename T>
+  inline T get(const char* p)
+  {
+    T x;
+    memcpy(&x, p, sizeof(T));
+    return big2sys(x);
+  }
+
+  inline void writeHeader(char* p, const MessageHeader& h)
+  {
+    put<uint16_t>(p, MAGIC);
+    p[2] = VERSION;
+    p[3] = 0;
+    put<uint32_t>(p + 4, h.type);
+    put<uint32_t>(p + 8, h.length);
+    put<uint32_t>(p + 12, 0);
+    put<double>(p + 16, h.timeStamp);
+    put<double>(p + 24, h.sampleRate);
+  }
+
+  /// Parse HEADER_SIZE bytes, return false if they are not a header
+  inline bool readHeader(const char* p, MessageHeader& h)
+  {
+    if(get<uint16_t>(p) != MAGIC || uint8_t(p[2]) != VERSION)
+      return false;
+    h.type = get<uint32_t>(p + 4);
+    h.length = get<uint32_t>(p + 8);
+    h.timeStamp = get<double>(p + 16);
+    h.sampleRate = get<double>(p + 24);
+    return true;
+  }
+} // namespace tcpframing
+
+} // namespace iris
+
+#endif // TCPFRAMING_H_
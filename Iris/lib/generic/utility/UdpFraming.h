@@ -0,0 +1,150 @@
+/**
+ * \file UdpFraming.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Framing of DataSets sent over UDP: fragmentation to fit the MTU,
+ * sequence numbers and timing.
+ */
+
+#ifndef UDPFRAMING_H_
+#define UDPFRAMING_H_
+
+#include <cstddef>
+#include <cstring>
+#include <boost/cstdint.hpp>
+
+#include "EndianConversion.h"
+
+namespace iris
+{
+
+/** The framing used by UdpSocketTxComponent and UdpSocketRxComponent.
+ *
+ * Loosely modelled on VITA-49, each DataSet is split into fragments that
+ * fit the MTU, and each fragment is sent as one datagram with a 40 byte
+ * header in network (big-endian) byte order:
+ *   - magic 0x4953 (uint16)
+ *   - version (uint8, currently 1)
+ *   - flags (uint8, FRAME_FIRST and/or FRAME_LAST)
+ *   - sequence number of the datagram (uint32)
+ *   - sequence number of the DataSet (uint32)
+ *   - offset of the fragment in the DataSet in bytes (uint32)
+ *   - size of the DataSet in bytes (uint32)
+ *   - Iris type identifier of the data (uint32)
+ *   - timeStamp of the DataSet (double)
+ *   - sampleRate of the DataSet (double)
+ *
+ * followed by the fragment data in the sender's byte order.
+ */
+struct FrameHeader
+{
+  uint8_t flags;
+  uint32_t sequence;
+  uint32_t dataSet;
+  uint32_t offset;
+  uint32_t total;
+  uint32_t type;
+  double timeStamp;
+  double sampleRate;
+};
+
+namespace udpframing
+{
+  static const uint16_t MAGIC = 0x4953;
+  static const uint8_t VERSION = 1;
+  static const std::size_t HEADER_SIZE = 40;
+  static const uint8_t FRAME_FIRST = 1;
+  static const uint8_t FRAME_LAST = 2;
+
+  /// Bytes taken by the IPv4 and UDP headers
+  static const std::size_t IP_UDP_OVERHEAD = 28;
+
+  template <typename T>
+  inline void put(char* p, T x)
+  {
+    x = sys2big(x);
+    memcpy(p, &x, sizeof(T));
+  }
+
+  template <typename T>
+  inline T get(const char* p)
+  {
+    T x;
+    memcpy(&x, p, sizeof(T));
+    return big2sys(x);
+  }
+
+  inline void writeHeader(char* p, const FrameHeader& h)
+  {
+    put<uint16_t>(p, MAGIC);
+    p[2] = VERSION;
+    p[3] = h.flags;
+    put<uint32_t>(p + 4, h.sequence);
+    put<uint32_t>(p + 8, h.dataSet);
+    put<uint32_t>(p + 12, h.offset);
+    put<uint32_t>(p + 16, h.total);
+    put<uint32_t>(p + 20, h.type);
+    put<double>(p + 24, h.timeStamp);
+    put<double>(p + 32, h.sampleRate);
+  }
+
+  /// Parse a header, return false if len is too short or it is not a header
+  inline bool readHeader(const char* p, std::size_t len, FrameHeader& h)
+  {
+    if(len < HEADER_SIZE || get<uint16_t>(p) != MAGIC || uint8_t(p[2]) != VERSION)
+      return false;
+    h.flags = p[3];
+    h.sequence = get<uint32_t>(p + 4);
+    h.dataSet = get<uint32_t>(p + 8);
+    h.offset = get<uint32_t>(p + 12);
+    h.total = get<uint32_t>(p + 16);
+    h.type = get<uint32_t>(p + 20);
+    h.timeStamp = get<double>(p + 24);
+    h.sampleRate = get<double>(p + 32);
+    return h.offset <= h.total && len - HEADER_SIZE <= h.total - h.offset;
+  }
+
+  /// Largest fragment (a whole number of elements) which fits the MTU
+  inline std::size_t fragmentSize(std::size_t mtu, std::size_t elemSize)
+  {
+    std::size_t room = mtu > IP_UDP_OVERHEAD + HEADER_SIZE ? mtu - IP_UDP_OVERHEAD - HEADER_SIZE : 0;
+    room -= room % elemSize;
+    return room > 0 ? room : elemSize;
+  }
+
+  /// Signed distance from sequence number a to b, allowing for wrap-around
+  inline int32_t distance(uint32_t a, uint32_t b)
+  {
+    return int32_t(b - a);
+  }
+} // namespace udpframing
+
+} // namespace iris
+
+#endif // UDPFRAMING_H_
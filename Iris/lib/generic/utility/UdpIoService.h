@@ -0,0 +1,351 @@
+/**
+ * \file UdpIoService.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * A shared epoll-based I/O service for many UDP sockets.
+ */
+
+#ifndef UDPIOSERVICE_H
+#define UDPIOSERVICE_H
+
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <irisapi/Logging.h>
+
+/** A service which handles many UDP sockets with a small pool of threads.
+ *
+ * UdpSocketReceiver and UdpSocketTransmitter each hold a socket with its
+ * own io_service and block in every call, so talking to many nodes takes a
+ * thread per socket. Here all sockets share one epoll instance, and
+ * numThreads worker threads wait on it.
+ *
+ * Each receiving socket has a preallocated buffer of batch slots of
+ * maxDatagram bytes. When a socket becomes readable, a worker receives up
+ * to batch datagrams into it with one recvmmsg() call and passes each one
+ * to the socket's handler. The data is only valid during the call. Sockets
+ * are registered with EPOLLONESHOT, so the handler of a socket is never
+ * called from two threads at once, but handlers of different sockets run
+ * in parallel.
+ *
+ * Transmitting sockets are non-blocking: send() returns false rather than
+ * wait for room in the socket buffer.
+ *
+ * Linux only (epoll, eventfd, recvmmsg).
+ */
+class UdpIoService
+{
+public:
+  /// Called with the socket id, the datagram and its size
+  typedef boost::function<void (int, const char*, std::size_t)> ReceiveHandler;
+
+  /** Create the service and start its threads
+   *
+   * @param numThreads  Number of worker threads
+   */
+  explicit UdpIoService(std::size_t numThreads = 2)
+    :nextId_(0)
+  {
+    epollFd_ = epoll_create(64);
+    wakeFd_ = eventfd(0, EFD_NONBLOCK);
+    if(epollFd_ < 0 || wakeFd_ < 0)
+    {
+      LOG(LERROR) << "Failed to create I/O service: " << strerror(errno);
+      return;
+    }
+    epoll_event e;
+    e.events = EPOLLIN;
+    e.data.u64 = WAKE_ID;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &e);
+
+    for(std::size_t i=0; i<numThreads; i++)
+      threads_.create_thread(boost::bind(&UdpIoService::run, this));
+  }
+
+  ~UdpIoService()
+  {
+    //Wake all the threads - the eventfd stays readable
+    uint64_t one = 1;
+    if(write(wakeFd_, &one, sizeof(one)) < 0)
+      LOG(LERROR) << "Failed to stop I/O service: " << strerror(errno);
+    threads_.join_all();
+
+    for(SocketMap::iterator it=sockets_.begin(); it!=sockets_.end(); ++it)
+      destroy(it->second);
+    close(wakeFd_);
+    close(epollFd_);
+  }
+
+  /** Add a socket which receives on a port
+   *
+   * @param port         Port to listen on
+   * @param handler      Called for each datagram received
+   * @param maxDatagram  Largest datagram expected - longer ones are truncated
+   * @param batch        Most datagrams to receive per system call
+   * @return The socket id, or -1 on failure
+   */
+  int addReceiver(unsigned short port, ReceiveHandler handler,
+                  std::size_t maxDatagram = 65536, std::size_t batch = 16)
+  {
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if(fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+    {
+      LOG(LERROR) << "Failed to open socket on port " << port << ": " << strerror(errno);
+      if(fd >= 0)
+        close(fd);
+      return -1;
+    }
+
+    Socket* s = new Socket(fd, handler, maxDatagram, batch);
+    boost::mutex::scoped_lock lock(mutex_);
+    int id = nextId_++;
+    sockets_[id] = s;
+    epoll_event e;
+    e.events = EPOLLIN | EPOLLONESHOT;
+    e.data.u64 = id;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &e);
+    return id;
+  }
+
+  /** Add a socket which sends to an address and port
+   *
+   * @return The socket id, or -1 on failure
+   */
+  int addTransmitter(std::string address, unsigned short port)
+  {
+    sockaddr_in dest;
+    memset(&dest, 0, sizeof(dest));
+    dest.sin_family = AF_INET;
+    dest.sin_port = htons(port);
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if(fd < 0 || inet_aton(address.c_str(), &dest.sin_addr) == 0
+       || connect(fd, reinterpret_cast<sockaddr*>(&dest), sizeof(dest)) != 0)
+    {
+      LOG(LERROR) << "Failed to open socket to " << address << ", port " << port;
+      if(fd >= 0)
+        close(fd);
+      return -1;
+    }
+
+    boost::mutex::scoped_lock lock(mutex_);
+    int id = nextId_++;
+    sockets_[id] = new Socket(fd, ReceiveHandler(), 0, 0);
+    return id;
+  }
+
+  /** Send a datagram without blocking
+   *
+   * @return false if the socket buffer is full or on error
+   */
+  bool send(int id, const void* data, std::size_t size)
+  {
+    int fd = -1;
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      SocketMap::iterator it = sockets_.find(id);
+      if(it != sockets_.end())
+        fd = it->second->fd;
+    }
+    return fd >= 0 && ::send(fd, data, size, MSG_DONTWAIT) == (ssize_t)size;
+  }
+
+  /** Remove a socket
+   *
+   * Once this returns, its handler is not called again, except by a call
+   * already in progress on another thread.
+   */
+  void remove(int id)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    SocketMap::iterator it = sockets_.find(id);
+    if(it == sockets_.end())
+      return;
+    Socket* s = it->second;
+    sockets_.erase(it);
+    epoll_ctl(epollFd_, EPOLL_CTL_DEL, s->fd, NULL);
+    if(s->busy)
+      s->removed = true;  //The worker deletes it
+    else
+      destroy(s);
+  }
+
+  /// Number of sockets
+  std::size_t size()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    return sockets_.size();
+  }
+
+  /// Number of datagrams received on a socket so far
+  uint64_t getReceived(int id)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    SocketMap::iterator it = sockets_.find(id);
+    return it == sockets_.end() ? 0 : it->second->received;
+  }
+
+  std::string getName()
+  {return "UdpIoService";}
+
+private:
+  static const uint64_t WAKE_ID = ~uint64_t(0);
+
+  /// Batches to receive before letting other sockets have a turn
+  static const std::size_t MAX_BATCHES = 4;
+
+  struct Socket
+  {
+    Socket(int f, ReceiveHandler h, std::size_t maxDatagram, std::size_t batch)
+      :fd(f), handler(h), buffer(maxDatagram*batch), msgs(batch), iovs(batch),
+       received(0), busy(false), removed(false)
+    {
+      for(std::size_t i=0; i<batch; i++)
+      {
+        iovs[i].iov_base = &buffer[i*maxDatagram];
+        iovs[i].iov_len = maxDatagram;
+      }
+    }
+    int fd;
+    ReceiveHandler handler;
+    std::vector<char> buffer;
+    std::vector<struct mmsghdr> msgs;
+    std::vector<struct iovec> iovs;
+    uint64_t received;
+    bool busy;      ///< Being handled by a worker
+    bool removed;   ///< Removed while busy
+  };
+  typedef std::map<int, Socket*> SocketMap;
+
+  /// Worker thread
+  void run()
+  {
+    epoll_event e;
+    while(true)
+    {
+      int n = epoll_wait(epollFd_, &e, 1, -1);
+      if(n < 0 && errno != EINTR)
+      {
+        LOG(LERROR) << "I/O service failed: " << strerror(errno);
+        return;
+      }
+      if(n <= 0)
+        continue;
+      if(e.data.u64 == WAKE_ID)
+        return;
+
+      int id = e.data.u64;
+      Socket* s;
+      {
+        boost::mutex::scoped_lock lock(mutex_);
+        SocketMap::iterator it = sockets_.find(id);
+        if(it == sockets_.end())
+          continue;
+        s = it->second;
+        s->busy = true;
+      }
+
+      uint64_t got = receive(id, s);
+
+      boost::mutex::scoped_lock lock(mutex_);
+      s->received += got;
+      s->busy = false;
+      if(s->removed)
+      {
+        destroy(s);
+        continue;
+      }
+      //Re-arm - fires again straight away if there is more to read
+      e.events = EPOLLIN | EPOLLONESHOT;
+      e.data.u64 = id;
+      epoll_ctl(epollFd_, EPOLL_CTL_MOD, s->fd, &e);
+    }
+  }
+
+  /// Receive what is waiting on a socket and hand it to the handler
+  uint64_t receive(int id, Socket* s)
+  {
+    std::size_t batch = s->msgs.size();
+    uint64_t total = 0;
+    for(std::size_t b=0; b<MAX_BATCHES; b++)
+    {
+      for(std::size_t i=0; i<batch; i++)
+      {
+        memset(&s->msgs[i], 0, sizeof(s->msgs[i]));
+        s->msgs[i].msg_hdr.msg_iov = &s->iovs[i];
+        s->msgs[i].msg_hdr.msg_iovlen = 1;
+      }
+      int got = recvmmsg(s->fd, &s->msgs[0], batch, MSG_DONTWAIT, NULL);
+      if(got <= 0)
+      {
+        if(got < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+          LOG(LERROR) << "Error receiving from socket: " << strerror(errno);
+        break;
+      }
+      total += got;
+      for(int i=0; i<got; i++)
+        s->handler(id, static_cast<const char*>(s->iovs[i].iov_base), s->msgs[i].msg_len);
+      if((std::size_t)got < batch)
+        break;
+    }
+    return total;
+  }
+
+  void destroy(Socket* s)
+  {
+    close(s->fd);
+    delete s;
+  }
+
+  int epollFd_;
+  int wakeFd_;
+  int nextId_;
+  SocketMap sockets_;
+  boost::mutex mutex_;
+  boost::thread_group threads_;
+};
+
+#endif // UDPIOSERVICE_H
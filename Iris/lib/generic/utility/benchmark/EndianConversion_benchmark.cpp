@@ -0,0 +1,86 @@
+/**
+ * \file lib/utility/EndianConversion_benchmark.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main benchmark file for the endian conversion functions.
+ */
+
+#include "EndianConversion.h"
+
+#include <algorithm>
+#include <vector>
+#include <complex>
+#include <iostream>
+#include <iomanip>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+using namespace std;
+namespace bp = boost::posix_time;
+
+/// Swap a 1MB block reps times with transform() and the batch function
+template <typename T>
+void runBenchmark(string name, size_t reps)
+{
+  vector<T> in(1024*1024/sizeof(T)), out(in.size());
+  for(size_t i=0; i<in.size(); i++)
+    in[i] = T(i);
+
+  // The single value version, as used before the batch functions existed
+  T (*swapOne)(T) = swap_bytes<T>;
+
+  bp::ptime t1(bp::microsec_clock::local_time());
+  for(size_t r=0; r<reps; r++)
+    transform(in.begin(), in.end(), out.begin(), swapOne);
+  bp::ptime t2(bp::microsec_clock::local_time());
+  for(size_t r=0; r<reps; r++)
+    swap_bytes(&in[0], &in[0] + in.size(), &out[0]);
+  bp::ptime t3(bp::microsec_clock::local_time());
+  for(size_t r=0; r<reps; r++)
+    swap_bytes(&out[0], &out[0] + out.size(), &out[0]);
+  bp::ptime t4(bp::microsec_clock::local_time());
+
+  double bytes = double(reps) * in.size() * sizeof(T);
+  cout << setw(22) << left << name << fixed << setprecision(2)
+       << " transform: " << setw(7) << bytes / (t2-t1).total_microseconds() / 1e3
+       << " GB/s  batch: " << setw(7) << bytes / (t3-t2).total_microseconds() / 1e3
+       << " GB/s  in place: " << bytes / (t4-t3).total_microseconds() / 1e3
+       << " GB/s" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+  size_t reps = 1000;
+  runBenchmark<boost::uint16_t>("16 bit", reps);
+  runBenchmark<boost::uint32_t>("32 bit", reps);
+  runBenchmark<float>("float", reps);
+  runBenchmark<boost::uint64_t>("64 bit", reps);
+  runBenchmark<double>("double", reps);
+  runBenchmark< complex<float> >("complex<float>", reps);
+  runBenchmark< complex<double> >("complex<double>", reps);
+}
@@ -0,0 +1,74 @@
+/**
+ * \file lib/utility/FirFilter_benchmark.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main benchmark file for FirFilter class.
+ */
+
+#include "FirFilter.h"
+
+#include <vector>
+#include <complex>
+#include <iostream>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+using namespace std;
+using namespace iris;
+namespace bp = boost::posix_time;
+
+/// Filter num complex<float> samples in blocks and return the rate in MS/s
+float runBenchmark(size_t numTaps, FirEngine engine)
+{
+  vector<float> h(numTaps, 1.0f/numTaps);
+  FirFilter<complex<float>, float, complex<float> > filter(h.begin(), h.end(), engine);
+
+  size_t blockSize = 4096;
+  size_t numBlocks = max(size_t(10), size_t(2e7)/(numTaps*blockSize));
+  vector<complex<float> > in(blockSize), out(blockSize);
+  for(size_t i=0;i<blockSize;i++)
+    in[i] = complex<float>(i%7, -(i%5));
+
+  bp::ptime t1(bp::microsec_clock::local_time());
+  for(size_t b=0;b<numBlocks;b++)
+    filter.filter(in.begin(), in.end(), out.begin());
+  bp::ptime t2(bp::microsec_clock::local_time());
+
+  bp::time_duration time = t2-t1;
+  return (numBlocks*blockSize)*1.0e3/time.total_nanoseconds();
+}
+
+int main(int argc, char* argv[])
+{
+  cout << "Taps\tDirect (MS/sec)\tFFT (MS/sec)" << endl;
+  for(size_t numTaps=8; numTaps<=4096; numTaps*=2)
+  {
+    cout << numTaps << "\t" << runBenchmark(numTaps, FIR_DIRECT)
+         << "\t" << runBenchmark(numTaps, FIR_FFT) << endl;
+  }
+}
@@ -0,0 +1,170 @@
+/**
+ * \file lib/utility/NetworkingHelper_benchmark.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main benchmark file for the Ethernet address functions of
+ * NetworkingHelper: per-frame cost of reading the addresses of a frame and
+ * looking up its destination, with hex strings and with MacAddress.
+ */
+
+#include "NetworkingHelper.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <vector>
+#include <boost/format.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+using namespace std;
+using namespace iris;
+namespace bp = boost::posix_time;
+
+static const size_t NUM_HOSTS = 16;
+
+/// getAddressFromEthernetFrame() as it was before MacAddress existed
+bool formatAddresses(boost::shared_ptr<StackDataSet> packet, string &source, string &destination)
+{
+  unsigned char packetBuffer[sizeof(struct ether_header)];
+  boost::format destination_fmt("%02x%02x%02x%02x%02x%02x");
+  boost::format source_fmt("%02x%02x%02x%02x%02x%02x");
+  for (size_t i = 0; i < sizeof(struct ether_header); i++)
+    packetBuffer[i] = packet->data[i];
+  const struct ether_header* ethernetHeader = (struct ether_header*)packetBuffer;
+  if ((ntohs(ethernetHeader->ether_type) != ETHERTYPE_IP) &&
+      (ntohs(ethernetHeader->ether_type) != ETHERTYPE_ARP))
+    return false;
+  for (size_t i = 0; i < 6; i++) {
+    destination_fmt % (int(ethernetHeader->ether_dhost[i]) & 0xFF);
+    source_fmt % (int(ethernetHeader->ether_shost[i]) & 0xFF);
+  }
+  destination = destination_fmt.str();
+  source = source_fmt.str();
+  return true;
+}
+
+/// Make numFrames IP frames of size bytes to NUM_HOSTS different hosts
+vector< boost::shared_ptr<StackDataSet> > makeFrames(size_t numFrames, size_t size)
+{
+  vector< boost::shared_ptr<StackDataSet> > frames(numFrames);
+  for(size_t i=0; i<numFrames; i++)
+  {
+    frames[i].reset(new StackDataSet);
+    frames[i]->data.assign(size, 0);
+    uint8_t header[14] = {0x02, 0, 0, 0, 0, uint8_t(i % NUM_HOSTS),
+                          0x02, 0, 0, 0, 0, 0xff, 0x08, 0x00};
+    copy(header, header + sizeof(header), frames[i]->data.begin());
+  }
+  return frames;
+}
+
+/// Address of host i
+MacAddress hostAddress(size_t i)
+{
+  uint8_t a[MacAddress::SIZE] = {0x02, 0, 0, 0, 0, uint8_t(i)};
+  return MacAddress(a);
+}
+
+void report(string name, bp::ptime t1, bp::ptime t2, size_t numFrames, size_t hits)
+{
+  if(hits != numFrames)
+    exit(1);
+  cout << "  " << setw(36) << left << name << fixed << setprecision(1)
+       << (t2-t1).total_nanoseconds() / double(numFrames) << " ns/frame" << endl;
+}
+
+void runBenchmark(size_t size, size_t numFrames)
+{
+  vector< boost::shared_ptr<StackDataSet> > frames = makeFrames(numFrames, size);
+  map<string, int> stringHosts;
+  boost::unordered_map<MacAddress, int> macHosts;
+  for(size_t i=0; i<NUM_HOSTS; i++)
+  {
+    stringHosts[hostAddress(i).toString()] = i;
+    macHosts[hostAddress(i)] = i;
+  }
+  cout << size << " B frames:" << endl;
+
+  size_t hits = 0;
+  bp::ptime t1(bp::microsec_clock::local_time());
+  for(size_t i=0; i<numFrames; i++)
+  {
+    string src, dst;
+    if(formatAddresses(frames[i], src, dst) && stringHosts.count(dst))
+      hits++;
+  }
+  bp::ptime t2(bp::microsec_clock::local_time());
+  report("boost::format strings (before)", t1, t2, numFrames, hits);
+
+  hits = 0;
+  t1 = bp::microsec_clock::local_time();
+  for(size_t i=0; i<numFrames; i++)
+  {
+    string src, dst;
+    if(NetworkingHelper::getAddressFromEthernetFrame(frames[i], src, dst) && stringHosts.count(dst))
+      hits++;
+  }
+  t2 = bp::microsec_clock::local_time();
+  report("hex strings", t1, t2, numFrames, hits);
+
+  hits = 0;
+  t1 = bp::microsec_clock::local_time();
+  for(size_t i=0; i<numFrames; i++)
+  {
+    MacAddress src, dst;
+    if(NetworkingHelper::getAddressFromEthernetFrame(*frames[i], src, dst) && macHosts.count(dst))
+      hits++;
+  }
+  t2 = bp::microsec_clock::local_time();
+  report("MacAddress from StackDataSet", t1, t2, numFrames, hits);
+
+  // the same frames in one contiguous block, as a PacketBuffer would hold them
+  vector<uint8_t> block(numFrames * size);
+  for(size_t i=0; i<numFrames; i++)
+    copy(frames[i]->data.begin(), frames[i]->data.end(), block.begin() + i * size);
+  hits = 0;
+  t1 = bp::microsec_clock::local_time();
+  for(size_t i=0; i<numFrames; i++)
+  {
+    MacAddress src, dst;
+    if(NetworkingHelper::getAddressFromEthernetFrame(&block[i * size], size, src, dst) && macHosts.count(dst))
+      hits++;
+  }
+  t2 = bp::microsec_clock::local_time();
+  report("MacAddress from contiguous memory", t1, t2, numFrames, hits);
+}
+
+int main(int argc, char* argv[])
+{
+  size_t numFrames = 100000;
+  runBenchmark(64, numFrames);
+  runBenchmark(1500, numFrames);
+}
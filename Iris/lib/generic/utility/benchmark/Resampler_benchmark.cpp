@@ -0,0 +1,95 @@
+/**
+ * \file lib/utility/Resampler_benchmark.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main benchmark file for Resampler class.
+ */
+
+#include "Resampler.h"
+#include "FirFilter.h"
+
+#include <vector>
+#include <complex>
+#include <iostream>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+using namespace std;
+using namespace iris;
+namespace bp = boost::posix_time;
+
+typedef complex<float> Cplx;
+
+/// Run filter over numBlocks input blocks and return the output rate in MS/s
+template<class Filter>
+float runBenchmark(Filter& filter, size_t outFactor)
+{
+  size_t blockSize = 4096;
+  size_t numBlocks = 500;
+  vector<Cplx> in(blockSize), out(blockSize*outFactor + 1);
+  for(size_t i=0;i<blockSize;i++)
+    in[i] = Cplx(i%7, -(i%5));
+
+  size_t numOut = 0;
+  bp::ptime t1(bp::microsec_clock::local_time());
+  for(size_t b=0;b<numBlocks;b++)
+    numOut += filter.filter(in.begin(), in.end(), out.begin()) - out.begin();
+  bp::ptime t2(bp::microsec_clock::local_time());
+
+  bp::time_duration time = t2-t1;
+  return numOut*1.0e3/time.total_nanoseconds();
+}
+
+int main(int argc, char* argv[])
+{
+  unsigned tapsPerPhase = 16;
+
+  cout << "Integer upsampling (output MS/sec)" << endl;
+  cout << "L\tFirFilterUpsamp\tResampler" << endl;
+  unsigned factors[] = {2, 4, 8};
+  for(int i=0;i<3;i++)
+  {
+    unsigned l = factors[i];
+    vector<float> h = Resampler<Cplx, float, Cplx>::designFilter(l, 1, tapsPerPhase);
+    FirFilterUpsamp<Cplx, float, Cplx> upsamp(l, h.begin(), h.end());
+    Resampler<Cplx, float, Cplx> resampler(l, 1, h.begin(), h.end());
+    cout << l << "\t" << runBenchmark(upsamp, l)
+         << "\t" << runBenchmark(resampler, l) << endl;
+  }
+
+  cout << "Rational resampling (output MS/sec)" << endl;
+  cout << "L/M\tResampler" << endl;
+  unsigned rates[][2] = {{2, 3}, {4, 5}, {5, 4}, {25, 16}};
+  for(int i=0;i<4;i++)
+  {
+    unsigned l = rates[i][0], m = rates[i][1];
+    vector<float> h = Resampler<Cplx, float, Cplx>::designFilter(l, m, tapsPerPhase);
+    Resampler<Cplx, float, Cplx> resampler(l, m, h.begin(), h.end());
+    cout << l << "/" << m << "\t" << runBenchmark(resampler, l/m + 1) << endl;
+  }
+}
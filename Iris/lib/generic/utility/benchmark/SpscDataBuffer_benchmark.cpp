@@ -0,0 +1,128 @@
+/**
+ * \file lib/utility/SpscDataBuffer_benchmark.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main benchmark file for SpscDataBuffer class.
+ */
+
+#include "SpscDataBuffer.h"
+
+#include <vector>
+#include <complex>
+#include <iostream>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+using namespace std;
+using namespace iris;
+namespace bp = boost::posix_time;
+
+typedef complex<float> Cplx;
+typedef SpscDataBuffer<Cplx> Buffer;
+
+/// Read num DataSets from in and, if out is set, send each one straight back
+void echo(Buffer* in, Buffer* out, size_t num)
+{
+  DataSet<Cplx>* inSet = NULL;
+  DataSet<Cplx>* outSet = NULL;
+  for(size_t i=0; i<num; i++)
+  {
+    in->getReadData(inSet);
+    if(out != NULL)
+    {
+      out->getWriteData(outSet, inSet->data.size());
+      copy(inSet->data.begin(), inSet->data.end(), outSet->data.begin());
+      out->releaseWriteData(outSet);
+    }
+    in->releaseReadData(inSet);
+  }
+}
+
+/// Stream num DataSets of the given size to another thread, return blocks/s
+double runThroughput(size_t size, SpscWaitStrategy strategy, size_t num)
+{
+  Buffer buf(16, size, strategy);
+  boost::thread reader(boost::bind(&echo, &buf, (Buffer*)NULL, num));
+
+  DataSet<Cplx>* set = NULL;
+  bp::ptime t1(bp::microsec_clock::local_time());
+  for(size_t i=0; i<num; i++)
+  {
+    buf.getWriteData(set, size);
+    set->data[0] = Cplx(i, 0);
+    buf.releaseWriteData(set);
+  }
+  reader.join();
+  bp::ptime t2(bp::microsec_clock::local_time());
+
+  return num*1.0e9/(t2-t1).total_nanoseconds();
+}
+
+/// Ping-pong num DataSets between two threads, return one-way latency in us
+double runLatency(size_t size, SpscWaitStrategy strategy, size_t num)
+{
+  Buffer ping(2, size, strategy);
+  Buffer pong(2, size, strategy);
+  boost::thread other(boost::bind(&echo, &ping, &pong, num));
+
+  DataSet<Cplx>* set = NULL;
+  bp::ptime t1(bp::microsec_clock::local_time());
+  for(size_t i=0; i<num; i++)
+  {
+    ping.getWriteData(set, size);
+    set->data[0] = Cplx(i, 0);
+    ping.releaseWriteData(set);
+    pong.getReadData(set);
+    pong.releaseReadData(set);
+  }
+  bp::ptime t2(bp::microsec_clock::local_time());
+  other.join();
+
+  return (t2-t1).total_nanoseconds()/(2.0e3*num);
+}
+
+int main(int argc, char* argv[])
+{
+  const char* names[] = {"Block", "Spin then park"};
+  SpscWaitStrategy strategies[] = {SPSC_BLOCK, SPSC_SPIN_THEN_PARK};
+
+  cout << "Strategy\tSize\tBlocks/s\tMS/s\tLatency (us)" << endl;
+  for(int s=0; s<2; s++)
+  {
+    for(size_t size=64; size<=65536; size*=8)
+    {
+      size_t num = max(size_t(1000), size_t(2e8)/size);
+      double blocks = runThroughput(size, strategies[s], num);
+      double latency = runLatency(size, strategies[s], min(num, size_t(20000)));
+      cout << names[s] << "\t" << size << "\t" << blocks << "\t"
+           << blocks*size/1.0e6 << "\t" << latency << endl;
+    }
+  }
+}
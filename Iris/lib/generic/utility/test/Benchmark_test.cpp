@@ -0,0 +1,157 @@
+/**
+ * \file lib/utility/Benchmark_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for Benchmark class.
+ */
+
+#define BOOST_TEST_MODULE Benchmark_Test
+
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <fstream>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace iris;
+namespace pt = boost::property_tree;
+
+/// Counts its calls and does a little work
+struct Work
+{
+  Work() : calls(0), sum(0) {}
+  void operator()()
+  {
+    calls++;
+    for(int i=0;i<100;i++)
+      sum += i*calls;
+  }
+  int calls;
+  volatile long sum;
+};
+
+/// Runs the Work case with the given extra command line option
+int runWork(const char* option, const char* value, Work& work)
+{
+  const char* argv[] = {"test", "--runs", "7", "--warmup", "0", "--mintime", "0.0001",
+                        "--cpu", "-1", option, value};
+  Benchmark bench("Test", 11, const_cast<char**>(argv));
+  bench.run("Work", 100, work);
+  return bench.finish();
+}
+
+void writeBaseline(const char* file, double median)
+{
+  ofstream out(file);
+  out << "{\"suite\": \"Test\", \"results\": [{\"name\": \"Work\", \"median_ns\": "
+      << median << "}]}";
+}
+
+BOOST_AUTO_TEST_SUITE (Benchmark_Test)
+
+BOOST_AUTO_TEST_CASE(Benchmark_Test_Statistics)
+{
+  const char* argv[] = {"test", "--runs=9", "--warmup=0", "--mintime=0.0001", "--cpu=-1", "--unknown"};
+  Benchmark bench("Test", 6, const_cast<char**>(argv));
+  Work work;
+  const BenchmarkResult& r = bench.run("Work", 100, work, "item");
+
+  BOOST_CHECK_EQUAL(r.name, "Work");
+  BOOST_CHECK_EQUAL(r.unit, "item");
+  BOOST_REQUIRE_EQUAL(r.times.size(), 9u);
+  BOOST_CHECK(r.calls >= 1);
+  BOOST_CHECK(work.calls >= 9*r.calls);
+  for(size_t i=1;i<r.times.size();i++)
+    BOOST_CHECK(r.times[i-1] <= r.times[i]);
+  BOOST_CHECK_EQUAL(r.min, r.times.front());
+  BOOST_CHECK_EQUAL(r.median, r.times[4]);
+  BOOST_CHECK_EQUAL(r.p99, r.times.back());
+  BOOST_CHECK(r.min <= r.mean && r.mean <= r.times.back());
+  BOOST_CHECK(r.stddev >= 0);
+  BOOST_CHECK_CLOSE(r.rate(), 1e3/r.median, 1e-6);
+  BOOST_CHECK_EQUAL(bench.finish(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(Benchmark_Test_Json)
+{
+  const char* file = "benchmark_test.json";
+  Work work;
+  BOOST_CHECK_EQUAL(runWork("--json", file, work), 0);
+
+  pt::ptree tree;
+  pt::read_json(file, tree);
+  BOOST_CHECK_EQUAL(tree.get<string>("suite"), "Test");
+  const pt::ptree& result = tree.get_child("results").front().second;
+  BOOST_CHECK_EQUAL(result.get<string>("name"), "Work");
+  BOOST_CHECK_EQUAL(result.get<int>("runs"), 7);
+  BOOST_CHECK(result.get<double>("median_ns") > 0);
+  remove(file);
+}
+
+BOOST_AUTO_TEST_CASE(Benchmark_Test_JsonEscape)
+{
+  // Names and labels are written as valid JSON strings whatever they hold
+  const char* file = "benchmark_escape.json";
+  const char* label = "say \"hi\" C:\\tmp\n";
+  const char* argv[] = {"test", "--runs", "3", "--warmup", "0", "--mintime", "0.0001",
+                        "--cpu", "-1", "--json", file, "--label", label};
+  Work work;
+  {
+    Benchmark bench("Test", 13, const_cast<char**>(argv));
+    bench.run("Work \"quoted\"", 100, work);
+    BOOST_CHECK_EQUAL(bench.finish(), 0);
+  }
+
+  pt::ptree tree;
+  BOOST_REQUIRE_NO_THROW(pt::read_json(file, tree));
+  BOOST_CHECK_EQUAL(tree.get<string>("label"), label);
+  BOOST_CHECK_EQUAL(tree.get_child("results").front().second.get<string>("name"), "Work \"quoted\"");
+  remove(file);
+}
+
+BOOST_AUTO_TEST_CASE(Benchmark_Test_Baseline)
+{
+  const char* file = "benchmark_baseline.json";
+  Work work;
+
+  // Far slower baseline - no regression
+  writeBaseline(file, 1e9);
+  BOOST_CHECK_EQUAL(runWork("--baseline", file, work), 0);
+
+  // Impossibly fast baseline - regression
+  writeBaseline(file, 1e-9);
+  BOOST_CHECK_EQUAL(runWork("--baseline", file, work), 1);
+
+  // A baseline which can't be read fails the gate rather than passing it
+  remove(file);
+  BOOST_CHECK_EQUAL(runWork("--baseline", file, work), 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,123 @@
+/**
+ * \file lib/utility/CaptureIndex_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for CaptureIndex and CaptureIndexWriter classes.
+ */
+
+#define BOOST_TEST_MODULE CaptureIndex_Test
+
+#include "CaptureIndex.h"
+
+#include <cstdio>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace iris;
+
+static const char* FILENAME = "CaptureIndex_test.idx";
+
+/// Write an index with an entry every 1000 samples of 8 bytes at 1 MS/s
+void writeIndex(size_t num)
+{
+  CaptureIndexWriter w;
+  BOOST_REQUIRE(w.open(FILENAME, 1e6, 1000));
+  for(size_t i=0; i<num; i++)
+  {
+    CaptureIndexEntry e = {i*1000, i*8000, 10 + i*1e-3, 2.4e9 + i, 0.5*i};
+    w.add(e);
+  }
+  w.close();
+}
+
+BOOST_AUTO_TEST_SUITE (CaptureIndex_Test)
+
+BOOST_AUTO_TEST_CASE(CaptureIndex_Test_Load)
+{
+  writeIndex(100);
+  CaptureIndex index;
+  BOOST_REQUIRE(index.load(FILENAME));
+  remove(FILENAME);
+
+  BOOST_CHECK_EQUAL(index.sampleRate(), 1e6);
+  BOOST_CHECK_EQUAL(index.interval(), 1000u);
+  BOOST_REQUIRE_EQUAL(index.size(), 100u);
+  BOOST_CHECK_EQUAL(index[42].sampleOffset, 42000u);
+  BOOST_CHECK_EQUAL(index[42].byteOffset, 336000u);
+  BOOST_CHECK_EQUAL(index[42].frequency, 2.4e9 + 42);
+  BOOST_CHECK_EQUAL(index[42].gain, 21);
+
+  BOOST_CHECK(!index.load("CaptureIndex_test_missing.idx"));
+}
+
+BOOST_AUTO_TEST_CASE(CaptureIndex_Test_Find)
+{
+  writeIndex(100);
+  CaptureIndex index;
+  BOOST_REQUIRE(index.load(FILENAME));
+  remove(FILENAME);
+
+  BOOST_CHECK_EQUAL(index.find(0), 0u);
+  BOOST_CHECK_EQUAL(index.find(10), 0u);
+  BOOST_CHECK_EQUAL(index.find(10.0425), 42u);
+  BOOST_CHECK_EQUAL(index.find(index[42].timeStamp), 42u);
+  BOOST_CHECK_EQUAL(index.find(1000), 99u);
+
+  CaptureRange r = index.range(10.0425, 10.0505);
+  BOOST_CHECK_EQUAL(r.startByte, 42*8000u);
+  BOOST_CHECK_EQUAL(r.stopByte, 51*8000u);
+  BOOST_CHECK_EQUAL(r.startSample, 42000u);
+
+  r = index.range(10.0425, -1);
+  BOOST_CHECK_EQUAL(r.stopByte, 0u);
+  BOOST_CHECK_EQUAL(r.stopTime, -1);
+}
+
+BOOST_AUTO_TEST_CASE(CaptureIndex_Test_Split)
+{
+  writeIndex(10);
+  CaptureIndex index;
+  BOOST_REQUIRE(index.load(FILENAME));
+  remove(FILENAME);
+
+  vector<CaptureRange> ranges = index.split(3);
+  BOOST_REQUIRE_EQUAL(ranges.size(), 3u);
+  BOOST_CHECK_EQUAL(ranges[0].startByte, 0u);
+  for(size_t i=1; i<ranges.size(); i++)
+  {
+    BOOST_CHECK_EQUAL(ranges[i].startByte, ranges[i-1].stopByte);
+    BOOST_CHECK_EQUAL(ranges[i].startTime, ranges[i-1].stopTime);
+  }
+  BOOST_CHECK_EQUAL(ranges[2].stopByte, 0u);
+
+  // Never more ranges than entries
+  BOOST_CHECK_EQUAL(index.split(20).size(), 10u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
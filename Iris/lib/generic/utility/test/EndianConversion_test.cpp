@@ -0,0 +1,105 @@
+/**
+ * \file lib/utility/EndianConversion_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for the endian conversion functions.
+ */
+
+#define BOOST_TEST_MODULE EndianConversion_Test
+
+#include "EndianConversion.h"
+
+#include <cstring>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+/// Compare bytes, so that NaN patterns compare equal
+template <typename T>
+bool same(T a, T b)
+{
+  return memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+/// Check the batch functions against the single value ones
+template <typename T>
+void checkBatch()
+{
+  // Odd lengths exercise the scalar tail after the vector loop
+  for(size_t n = 0; n < 70; n += 7)
+  {
+    vector<T> in(n), out(n + 1), inPlace;
+    for(size_t i = 0; i < n; ++i)
+    {
+      unsigned char bytes[sizeof(T)];
+      for(size_t j = 0; j < sizeof(T); ++j)
+        bytes[j] = (unsigned char)(i*sizeof(T) + j + 1);
+      memcpy(&in[i], bytes, sizeof(T));
+    }
+    inPlace = in;
+
+    T* o = &out[0];
+    swap_bytes(&in[0], &in[0] + n, o);
+    for(size_t i = 0; i < n; ++i)
+      BOOST_REQUIRE(same(swap_bytes(in[i]), o[i]));
+
+    sys2big(&inPlace[0], &inPlace[0] + n, &inPlace[0]);
+    for(size_t i = 0; i < n; ++i)
+      BOOST_REQUIRE(same(sys2big(in[i]), inPlace[i]));
+    big2sys(&inPlace[0], &inPlace[0] + n, &inPlace[0]);
+    lit2sys(&inPlace[0], &inPlace[0] + n, &inPlace[0]);
+    sys2lit(&inPlace[0], &inPlace[0] + n, o);
+    for(size_t i = 0; i < n; ++i)
+      BOOST_REQUIRE(same(in[i], o[i]));
+  }
+}
+
+BOOST_AUTO_TEST_SUITE (EndianConversion_Test)
+
+BOOST_AUTO_TEST_CASE(EndianConversion_Test_Scalar)
+{
+  BOOST_CHECK_EQUAL(swap_bytes(boost::uint16_t(0x0102)), 0x0201);
+  BOOST_CHECK_EQUAL(swap_bytes(boost::uint32_t(0x01020304)), 0x04030201u);
+  BOOST_CHECK(swap_bytes(swap_bytes(1.5)) == 1.5);
+}
+
+BOOST_AUTO_TEST_CASE(EndianConversion_Test_Batch)
+{
+  checkBatch<boost::uint8_t>();
+  checkBatch<boost::int16_t>();
+  checkBatch<boost::uint32_t>();
+  checkBatch<boost::int64_t>();
+  checkBatch<float>();
+  checkBatch<double>();
+  checkBatch<std::complex<float> >();
+  checkBatch<std::complex<double> >();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,160 @@
+/**
+ * \file lib/utility/FirFilter_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for FirFilter class.
+ */
+
+#define BOOST_TEST_MODULE FirFilter_Test
+
+#include "FirFilter.h"
+
+#include <vector>
+#include <complex>
+#include <cstdlib>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace iris;
+
+/// Direct convolution reference
+template<class InT, class CoeffT, class OutT>
+vector<OutT> reference(const vector<InT>& x, const vector<CoeffT>& h)
+{
+  vector<OutT> y(x.size());
+  for(size_t n=0;n<x.size();n++)
+    for(size_t k=0;k<h.size() && k<=n;k++)
+      y[n] += h[k]*x[n-k];
+  return y;
+}
+
+template<class T>
+T randomValue(T) { return rand()/(float)RAND_MAX - 0.5f; }
+
+template<class T>
+complex<T> randomValue(complex<T>)
+{
+  return complex<T>(rand()/(float)RAND_MAX - 0.5f, rand()/(float)RAND_MAX - 0.5f);
+}
+
+/// Filter in odd-sized chunks and compare against the reference
+template<class InT, class CoeffT, class OutT>
+void checkFilter(size_t numTaps, FirEngine engine)
+{
+  vector<CoeffT> h(numTaps);
+  for(size_t i=0;i<numTaps;i++)
+    h[i] = randomValue(CoeffT());
+  vector<InT> x(4000);
+  for(size_t i=0;i<x.size();i++)
+    x[i] = randomValue(InT());
+
+  FirFilter<InT, CoeffT, OutT> filter(h.begin(), h.end(), engine);
+  vector<OutT> y(x.size());
+  size_t chunks[] = {1, 7, 300, 2000, 13};
+  size_t pos = 0;
+  for(int c=0; pos<x.size(); c++)
+  {
+    size_t n = min(chunks[c%5], x.size()-pos);
+    BOOST_REQUIRE(filter.filter(x.begin()+pos, x.begin()+pos+n, y.begin()+pos)
+                  == y.begin()+pos+n);
+    pos += n;
+  }
+
+  vector<OutT> ref = reference<InT, CoeffT, OutT>(x, h);
+  for(size_t i=0;i<y.size();i++)
+    BOOST_CHECK_SMALL(double(abs(y[i] - ref[i])), 1e-4*numTaps);
+}
+
+BOOST_AUTO_TEST_SUITE (FirFilter_Test)
+
+BOOST_AUTO_TEST_CASE(FirFilter_Engine_Test)
+{
+  vector<float> h(FirFilter<float>::FFT_THRESHOLD);
+  FirFilter<float> longFilter(h.begin(), h.end());
+  BOOST_CHECK(longFilter.getEngine() == FIR_FFT);
+  FirFilter<float> shortFilter(h.begin(), h.end()-1);
+  BOOST_CHECK(shortFilter.getEngine() == FIR_DIRECT);
+}
+
+BOOST_AUTO_TEST_CASE(FirFilter_Impulse_Test)
+{
+  float h[] = {1, 2, 3, 4, 5};
+  float x[] = {1, 0, 0, 0, 0, 0, 0};
+  FirFilter<float> direct(h, h+5, FIR_DIRECT);
+  FirFilter<float> fft(h, h+5, FIR_FFT);
+  vector<float> y1(7), y2(7);
+  direct.filter(x, x+7, y1.begin());
+  fft.filter(x, x+7, y2.begin());
+  for(int i=0;i<5;i++)
+  {
+    BOOST_CHECK_CLOSE(y1[i], h[i], 1e-4);
+    BOOST_CHECK_CLOSE(y2[i], h[i], 1e-4);
+  }
+  BOOST_CHECK_SMALL(y1[6], 1e-6f);
+  BOOST_CHECK_SMALL(y2[6], 1e-6f);
+}
+
+BOOST_AUTO_TEST_CASE(FirFilter_Direct_Test)
+{
+  size_t taps[] = {1, 2, 8, 33, 200};
+  for(int i=0;i<5;i++)
+  {
+    checkFilter<float, float, float>(taps[i], FIR_DIRECT);
+    checkFilter<complex<float>, float, complex<float> >(taps[i], FIR_DIRECT);
+    checkFilter<complex<float>, complex<float>, complex<float> >(taps[i], FIR_DIRECT);
+    checkFilter<double, double, double>(taps[i], FIR_DIRECT);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FirFilter_Fft_Test)
+{
+  size_t taps[] = {1, 2, 8, 33, 200, 1025};
+  for(int i=0;i<6;i++)
+  {
+    checkFilter<float, float, float>(taps[i], FIR_FFT);
+    checkFilter<complex<float>, float, complex<float> >(taps[i], FIR_FFT);
+    checkFilter<complex<float>, complex<float>, complex<float> >(taps[i], FIR_FFT);
+    checkFilter<double, double, double>(taps[i], FIR_FFT);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FirFilter_Auto_Test)
+{
+  // Long filters switch engines between short and long calls
+  size_t taps[] = {200, 1025};
+  for(int i=0;i<2;i++)
+  {
+    checkFilter<float, float, float>(taps[i], FIR_AUTO);
+    checkFilter<complex<float>, float, complex<float> >(taps[i], FIR_AUTO);
+    checkFilter<complex<float>, complex<float>, complex<float> >(taps[i], FIR_AUTO);
+    checkFilter<double, double, double>(taps[i], FIR_AUTO);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,117 @@
+/**
+ * \file lib/utility/GaussianNoise_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for GaussianNoise class.
+ */
+
+#define BOOST_TEST_MODULE GaussianNoise_Test
+
+#include "GaussianNoise.h"
+
+#include <cmath>
+#include <complex>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace iris;
+
+typedef complex<float> Cplx;
+
+BOOST_AUTO_TEST_SUITE (GaussianNoise_Test)
+
+BOOST_AUTO_TEST_CASE(GaussianNoise_Test_Statistics)
+{
+  const size_t n = 1000000;
+  const float sigma = 2;
+  vector<Cplx> v(n);
+  GaussianNoise noise(42);
+  noise.generate(&v[0], n, sigma);
+
+  double mean = 0, power = 0, powerRe = 0, fourth = 0;
+  size_t outside = 0;
+  for(size_t i=0; i<n; i++)
+  {
+    mean += v[i].real() + v[i].imag();
+    power += norm(v[i]);
+    double re2 = v[i].real() * v[i].real();
+    powerRe += re2;
+    fourth += re2 * re2;
+    if(fabs(v[i].real()) > 2 * sigma / sqrt(2.0))
+      outside++;
+  }
+  mean /= 2*n;
+  power /= n;
+  powerRe /= n;
+  fourth /= n;
+
+  BOOST_CHECK_SMALL(mean, 0.01);
+  BOOST_CHECK_CLOSE(power, sigma*sigma, 1.0);
+  BOOST_CHECK_CLOSE(powerRe, sigma*sigma/2, 1.0);
+  // A Gaussian has kurtosis 3 and 4.55% of its mass beyond 2 sigma
+  BOOST_CHECK_CLOSE(fourth / (powerRe*powerRe), 3.0, 2.0);
+  BOOST_CHECK_CLOSE(outside / double(n), 0.0455, 3.0);
+}
+
+BOOST_AUTO_TEST_CASE(GaussianNoise_Test_Seed)
+{
+  vector<Cplx> a(101), b(101), c(101);
+  GaussianNoise n1(7), n2(7), n3(8);
+  n1.generate(&a[0], a.size(), 1);
+  n2.generate(&b[0], b.size(), 1);
+  n3.generate(&c[0], c.size(), 1);
+  BOOST_CHECK(a == b);
+  BOOST_CHECK(a != c);
+
+  // reseeding restarts the sequence
+  n1.setSeed(7);
+  n1.generate(&c[0], c.size(), 1);
+  BOOST_CHECK(a == c);
+}
+
+BOOST_AUTO_TEST_CASE(GaussianNoise_Test_Add)
+{
+  // odd lengths exercise the partial last step
+  vector<Cplx> noiseOnly(7), data(7, Cplx(10, -10));
+  GaussianNoise n1(3), n2(3);
+  n1.generate(&noiseOnly[0], noiseOnly.size(), 0.5f);
+  n2.add(&data[0], data.size(), 0.5f);
+  for(size_t i=0; i<data.size(); i++)
+  {
+    BOOST_CHECK_CLOSE(data[i].real(), 10 + noiseOnly[i].real(), 1e-4);
+    BOOST_CHECK_CLOSE(data[i].imag(), -10 + noiseOnly[i].imag(), 1e-4);
+  }
+
+  // sigma 0 leaves the data alone
+  n1.add(&data[0], data.size(), 0);
+  BOOST_CHECK_CLOSE(data[0].real(), 10 + noiseOnly[0].real(), 1e-4);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,133 @@
+/**
+ * \file lib/utility/MacAddress_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for MacAddress class and the NetworkingHelper functions
+ * using it.
+ */
+
+#define BOOST_TEST_MODULE MacAddress_Test
+
+#include "MacAddress.h"
+#include "NetworkingHelper.h"
+
+#include <set>
+#include <vector>
+#include <boost/functional/hash.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace iris;
+
+BOOST_AUTO_TEST_SUITE (MacAddress_Test)
+
+BOOST_AUTO_TEST_CASE(MacAddress_Test_Strings)
+{
+  MacAddress a;
+  BOOST_CHECK(a.isZero());
+  BOOST_REQUIRE(MacAddress::fromString("f009e090e90E", a));
+  BOOST_CHECK_EQUAL(a.toInt(), 0xf009e090e90eULL);
+  BOOST_CHECK_EQUAL(a.toString(), "f009e090e90e");
+
+  // malformed strings leave the address alone
+  BOOST_CHECK(!MacAddress::fromString("f009e090e90", a));
+  BOOST_CHECK(!MacAddress::fromString("f009e090e90g", a));
+  BOOST_CHECK(!MacAddress::fromString("f0:09:e0:90:e9:0e", a));
+  BOOST_CHECK_EQUAL(a.toInt(), 0xf009e090e90eULL);
+
+  BOOST_CHECK_EQUAL(MacAddress::broadcast().toString(), "ffffffffffff");
+  BOOST_CHECK(MacAddress::broadcast().isBroadcast());
+  BOOST_CHECK(!a.isBroadcast());
+}
+
+BOOST_AUTO_TEST_CASE(MacAddress_Test_Memory)
+{
+  uint8_t bytes[MacAddress::SIZE + 2] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0xee, 0xee};
+  MacAddress a(bytes);
+  BOOST_CHECK_EQUAL(a.toString(), "001122334455");
+
+  uint8_t out[MacAddress::SIZE + 2];
+  fill(out, out + sizeof(out), 0xee);
+  a.write(out);
+  BOOST_CHECK(equal(bytes, bytes + sizeof(bytes), out));
+}
+
+BOOST_AUTO_TEST_CASE(MacAddress_Test_Compare)
+{
+  MacAddress a, b, c;
+  MacAddress::fromString("000000000001", a);
+  MacAddress::fromString("000000000001", b);
+  MacAddress::fromString("010000000000", c);
+  BOOST_CHECK(a == b);
+  BOOST_CHECK(a != c);
+  BOOST_CHECK(a < c);
+  BOOST_CHECK(!(c < a));
+  BOOST_CHECK_EQUAL(boost::hash<MacAddress>()(a), boost::hash<MacAddress>()(b));
+  BOOST_CHECK(boost::hash<MacAddress>()(a) != boost::hash<MacAddress>()(c));
+
+  set<MacAddress> s;
+  s.insert(a);
+  s.insert(b);
+  s.insert(c);
+  BOOST_CHECK_EQUAL(s.size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(MacAddress_Test_EthernetFrame)
+{
+  uint8_t frame[64] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff,   // destination
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55,   // source
+    0x08, 0x06                            // ARP
+  };
+  MacAddress source, destination;
+  BOOST_REQUIRE(NetworkingHelper::getAddressFromEthernetFrame(frame, sizeof(frame), source, destination));
+  BOOST_CHECK(destination.isBroadcast());
+  BOOST_CHECK_EQUAL(source.toString(), "001122334455");
+
+  // same from a StackDataSet, and as strings
+  boost::shared_ptr<StackDataSet> set(new StackDataSet);
+  set->data.assign(frame, frame + sizeof(frame));
+  MacAddress source2, destination2;
+  BOOST_REQUIRE(NetworkingHelper::getAddressFromEthernetFrame(*set, source2, destination2));
+  BOOST_CHECK(source2 == source);
+  BOOST_CHECK(destination2 == destination);
+  string src, dst;
+  BOOST_REQUIRE(NetworkingHelper::getAddressFromEthernetFrame(set, src, dst));
+  BOOST_CHECK_EQUAL(src, "001122334455");
+  BOOST_CHECK_EQUAL(dst, "ffffffffffff");
+
+  // too short, or neither IP nor ARP
+  BOOST_CHECK(!NetworkingHelper::getAddressFromEthernetFrame(frame, 13, source, destination));
+  set->data.resize(10);
+  BOOST_CHECK(!NetworkingHelper::getAddressFromEthernetFrame(*set, source, destination));
+  frame[13] = 0x01;
+  BOOST_CHECK(!NetworkingHelper::getAddressFromEthernetFrame(frame, sizeof(frame), source, destination));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
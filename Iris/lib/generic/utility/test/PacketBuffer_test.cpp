@@ -0,0 +1,127 @@
+/**
+ * \file lib/utility/PacketBuffer_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for PacketBuffer class.
+ */
+
+#define BOOST_TEST_MODULE PacketBuffer_Test
+
+#include "PacketBuffer.h"
+
+#include <deque>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace iris;
+
+BOOST_AUTO_TEST_SUITE (PacketBuffer_Test)
+
+BOOST_AUTO_TEST_CASE(PacketBuffer_Test_Layers)
+{
+  // Headers go on and come off without moving the data
+  PacketBuffer p(256, 64);
+  uint8_t* payload = p.put(100);
+  for(int i=0; i<100; i++)
+    payload[i] = i;
+
+  uint8_t* h1 = p.push(8);
+  memset(h1, 0xaa, 8);
+  uint8_t* h2 = p.push(16);
+  memset(h2, 0xbb, 16);
+  memset(p.put(4), 0xcc, 4);
+  BOOST_CHECK_EQUAL(p.size(), 128u);
+  BOOST_CHECK_EQUAL(p.headroom(), 40u);
+  BOOST_CHECK_EQUAL(p.tailroom(), 88u);
+  BOOST_CHECK(p.data() == h2);
+  BOOST_CHECK_EQUAL(p[16], 0xaa);
+
+  BOOST_CHECK(p.pull(16) == h1);
+  BOOST_CHECK(p.pull(8) == payload);
+  p.trim(100);
+  BOOST_REQUIRE_EQUAL(p.size(), 100u);
+  for(int i=0; i<100; i++)
+    BOOST_REQUIRE_EQUAL(p[i], i);
+}
+
+BOOST_AUTO_TEST_CASE(PacketBuffer_Test_Grow)
+{
+  // Running out of room at either end keeps the data
+  PacketBuffer p(16, 4);
+  for(int i=0; i<10; i++)
+    *p.put(1) = i;
+  memset(p.push(20), 0xaa, 20);
+  BOOST_CHECK_GE(p.headroom(), size_t(PacketBuffer::DEFAULT_HEADROOM));
+  memset(p.put(1000), 0xbb, 1000);
+  BOOST_REQUIRE_EQUAL(p.size(), 1030u);
+  BOOST_CHECK_EQUAL(p[19], 0xaa);
+  for(int i=0; i<10; i++)
+    BOOST_REQUIRE_EQUAL(p[20+i], i);
+  BOOST_CHECK_EQUAL(p[30], 0xbb);
+  BOOST_CHECK_EQUAL(p[1029], 0xbb);
+
+  // Asking for room up front means no moves later
+  PacketBuffer q(0, 0);
+  q.reserve(32, 200);
+  uint8_t* d = q.put(200);
+  q.push(32);
+  BOOST_CHECK(q.data() + 32 == d);
+}
+
+BOOST_AUTO_TEST_CASE(PacketBuffer_Test_Assign)
+{
+  // Copies in from and out to a StackDataSet deque
+  deque<uint8_t> frame;
+  for(int i=0; i<300; i++)
+    frame.push_back(i);
+
+  PacketBuffer p(64);
+  p.assign(frame.begin(), frame.end());
+  BOOST_CHECK_EQUAL(p.headroom(), size_t(PacketBuffer::DEFAULT_HEADROOM));
+  BOOST_REQUIRE_EQUAL(p.size(), 300u);
+  BOOST_CHECK(equal(p.begin(), p.end(), frame.begin()));
+
+  p.pull(100);
+  deque<uint8_t> out(p.begin(), p.end());
+  BOOST_REQUIRE_EQUAL(out.size(), 200u);
+  BOOST_CHECK_EQUAL(out[0], 100);
+
+  // Reuse keeps the storage
+  vector<uint8_t> v(10, 7);
+  const uint8_t* before = p.begin();
+  p.assign(&v[0], v.size(), 0);
+  BOOST_CHECK_EQUAL(p.size(), 10u);
+  BOOST_CHECK_EQUAL(p.headroom(), 0u);
+  BOOST_CHECK(p.begin() < before);
+  p.clear();
+  BOOST_CHECK(p.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
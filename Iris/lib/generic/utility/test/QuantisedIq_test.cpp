@@ -0,0 +1,169 @@
+/**
+ * \file lib/utility/QuantisedIq_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for the quantised IQ format.
+ */
+
+#define BOOST_TEST_MODULE QuantisedIq_Test
+
+#include "QuantisedIq.h"
+
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <boost/test/unit_test.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/variate_generator.hpp>
+
+using namespace std;
+using namespace iris;
+using namespace iris::quantisediq;
+
+typedef complex<float> Cplx;
+
+/// A tone at the given SNR (dB) in complex Gaussian noise
+vector<Cplx> makeSignal(size_t n, double snr)
+{
+  boost::mt19937 rng(42);
+  boost::normal_distribution<float> dist(0, sqrt(0.5*pow(10, -snr/10)));
+  boost::variate_generator<boost::mt19937&, boost::normal_distribution<float> > noise(rng, dist);
+  vector<Cplx> x(n);
+  for(size_t i=0;i<n;i++)
+    x[i] = polar(1.0f, 0.01f*i) + Cplx(noise(), noise());
+  return x;
+}
+
+/// Encode and decode x in blocks, return the signal to quantisation noise ratio in dB
+double roundTrip(const vector<Cplx>& x, IqFormat format, size_t blockSize)
+{
+  vector<char> buf(blockBytes(format, blockSize));
+  vector<Cplx> y(x.size());
+  for(size_t i=0;i<x.size();i+=blockSize)
+  {
+    size_t num = min(blockSize, x.size()-i);
+    encodeBlock(&x[i], num, format, &buf[0]);
+    BOOST_REQUIRE_EQUAL(getU32(&buf[0]), num);
+    decodeBlock(&buf[BLOCK_HEADER_SIZE], num, getF32(&buf[4]), format, &y[i]);
+  }
+
+  double sig = 0, err = 0;
+  for(size_t i=0;i<x.size();i++)
+  {
+    sig += norm(x[i]);
+    err += norm(x[i] - y[i]);
+  }
+  return 10*log10(sig/err);
+}
+
+BOOST_AUTO_TEST_SUITE (QuantisedIq_Test)
+
+BOOST_AUTO_TEST_CASE(QuantisedIq_Header_Test)
+{
+  char buf[HEADER_SIZE];
+  writeHeader(buf, IQ_SC8, 4096);
+  IqFormat format;
+  boost::uint32_t blockSize;
+  BOOST_REQUIRE(readHeader(buf, format, blockSize));
+  BOOST_CHECK_EQUAL(format, IQ_SC8);
+  BOOST_CHECK_EQUAL(blockSize, 4096u);
+
+  buf[0] = 'X';
+  BOOST_CHECK(!readHeader(buf, format, blockSize));
+}
+
+BOOST_AUTO_TEST_CASE(QuantisedIq_Exact_Test)
+{
+  // Values on the quantisation grid come back exactly, including odd tails
+  vector<Cplx> x(37);
+  for(size_t i=0;i<x.size();i++)
+    x[i] = Cplx(int(i%255) - 127, 127 - int(i%255));
+  vector<boost::int8_t> q(2*x.size());
+  float scale = quantise(&x[0], x.size(), &q[0]);
+  BOOST_CHECK_EQUAL(scale, 1.0f);
+  vector<Cplx> y(x.size());
+  expand(&q[0], x.size(), scale, &y[0]);
+  for(size_t i=0;i<x.size();i++)
+    BOOST_CHECK_EQUAL(x[i], y[i]);
+
+  // All-zero blocks stay zero
+  vector<Cplx> z(10);
+  vector<boost::int16_t> q16(20, 1);
+  quantise(&z[0], z.size(), &q16[0]);
+  for(size_t i=0;i<q16.size();i++)
+    BOOST_CHECK_EQUAL(q16[i], 0);
+}
+
+BOOST_AUTO_TEST_CASE(QuantisedIq_Rounding_Test)
+{
+  // Halves round to even in the vector loop and in the tail after it
+  vector<Cplx> x(37);
+  x[0] = Cplx(127, 0);
+  for(size_t i=1;i<x.size();i++)
+    x[i] = Cplx(int(i) - 18.5f, 18.5f - int(i));
+  vector<boost::int8_t> q(2*x.size());
+  BOOST_REQUIRE_EQUAL(quantise(&x[0], x.size(), &q[0]), 1.0f);
+  for(size_t i=1;i<x.size();i++)
+  {
+    int even = (int(i) - 19) % 2 == 0 ? int(i) - 19 : int(i) - 18;
+    BOOST_CHECK_EQUAL(q[2*i], even);
+    BOOST_CHECK_EQUAL(q[2*i+1], -even);
+  }
+
+  vector<boost::int16_t> q16(2*x.size());
+  x[0] = Cplx(32767, 0);
+  BOOST_REQUIRE_EQUAL(quantise(&x[0], x.size(), &q16[0]), 1.0f);
+  for(size_t i=1;i<x.size();i++)
+  {
+    int even = (int(i) - 19) % 2 == 0 ? int(i) - 19 : int(i) - 18;
+    BOOST_CHECK_EQUAL(q16[2*i], even);
+    BOOST_CHECK_EQUAL(q16[2*i+1], -even);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(QuantisedIq_Snr_Test)
+{
+  // Quantisation noise must be far enough below the signal that it costs
+  // little SNR: loss = 10log10(1 + Nq/N)
+  double snrIn = 20;
+  vector<Cplx> x = makeSignal(100003, snrIn);
+  double sqnr16 = roundTrip(x, IQ_SC16, 1024);
+  double sqnr8 = roundTrip(x, IQ_SC8, 1024);
+  BOOST_TEST_MESSAGE("SQNR sc16 " << sqnr16 << "dB, sc8 " << sqnr8 << "dB");
+
+  BOOST_CHECK(sqnr16 > 80);
+  BOOST_CHECK(sqnr8 > 35);
+  double loss16 = 10*log10(1 + pow(10, (snrIn - sqnr16)/10));
+  double loss8 = 10*log10(1 + pow(10, (snrIn - sqnr8)/10));
+  BOOST_CHECK(loss16 < 0.001);
+  BOOST_CHECK(loss8 < 0.2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,128 @@
+/**
+ * \file lib/utility/SpscDataBuffer_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for SpscDataBuffer class.
+ */
+
+#define BOOST_TEST_MODULE SpscDataBuffer_Test
+
+#include "SpscDataBuffer.h"
+
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+using namespace std;
+using namespace iris;
+
+/// Write num DataSets, each holding its own index in every element
+void writeBlocks(SpscDataBuffer<uint32_t>* buf, uint32_t num, size_t size)
+{
+  DataSet<uint32_t>* set = NULL;
+  for(uint32_t i=0; i<num; i++)
+  {
+    buf->getWriteData(set, size);
+    fill(set->data.begin(), set->data.end(), i);
+    set->timeStamp = i;
+    buf->releaseWriteData(set);
+  }
+}
+
+/// Read num DataSets and check they arrive complete and in order
+bool readBlocks(SpscDataBuffer<uint32_t>& buf, uint32_t num, size_t size)
+{
+  DataSet<uint32_t>* set = NULL;
+  bool ok = true;
+  for(uint32_t i=0; i<num; i++)
+  {
+    buf.getReadData(set);
+    ok = ok && set->data.size() == size && set->timeStamp == i;
+    for(size_t j=0; j<set->data.size(); j++)
+      ok = ok && set->data[j] == i;
+    buf.releaseReadData(set);
+  }
+  return ok;
+}
+
+BOOST_AUTO_TEST_SUITE (SpscDataBuffer_Test)
+
+BOOST_AUTO_TEST_CASE(SpscDataBuffer_Basic_Test)
+{
+  SpscDataBuffer<uint32_t> buf(3, 16);
+  BOOST_CHECK(buf.capacity() == 4);
+  BOOST_CHECK(!buf.hasData());
+
+  // Fill the buffer, then empty it - twice, to check wrapping
+  for(int k=0; k<2; k++)
+  {
+    writeBlocks(&buf, 4, 16);
+    BOOST_CHECK(buf.hasData());
+    BOOST_CHECK(readBlocks(buf, 4, 16));
+    BOOST_CHECK(!buf.hasData());
+  }
+
+  // DataSets are reused, so no reallocation once preallocated
+  DataSet<uint32_t>* set = NULL;
+  buf.getWriteData(set, 16);
+  uint32_t* p = &set->data[0];
+  buf.releaseWriteData(set);
+  buf.getReadData(set);
+  BOOST_CHECK(&set->data[0] == p);
+  buf.releaseReadData(set);
+}
+
+BOOST_AUTO_TEST_CASE(SpscDataBuffer_Release_Test)
+{
+  SpscDataBuffer<uint32_t> buf(4);
+  DataSet<uint32_t>* set = NULL;
+  buf.getWriteData(set, 8);
+  BOOST_CHECK_THROW(buf.getWriteData(set, 8), DataBufferReleaseException);
+  buf.releaseWriteData(set);
+  BOOST_CHECK_THROW(buf.releaseWriteData(set), DataBufferReleaseException);
+  BOOST_CHECK_THROW(buf.releaseReadData(set), DataBufferReleaseException);
+}
+
+BOOST_AUTO_TEST_CASE(SpscDataBuffer_Threaded_Test)
+{
+  SpscWaitStrategy strategies[] = {SPSC_BLOCK, SPSC_SPIN_THEN_PARK};
+  for(int s=0; s<2; s++)
+  {
+    // Small buffer, so both the empty and full paths are exercised
+    SpscDataBuffer<uint32_t> buf(2, 64, strategies[s]);
+    uint32_t num = 100000;
+    boost::thread writer(boost::bind(&writeBlocks, &buf, num, 64));
+    BOOST_CHECK(readBlocks(buf, num, 64));
+    writer.join();
+    BOOST_CHECK(!buf.hasData());
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
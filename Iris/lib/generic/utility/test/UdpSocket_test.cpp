@@ -28,13 +28,15 @@
  *
  * \section DESCRIPTION
  *
- * Main test file for UdpSocketReceiver and UdpSocketTransmitter classes.
+ * Main test file for UdpSocketReceiver, UdpSocketTransmitter and
+ * UdpIoService classes.
  */
 
 #define BOOST_TEST_MODULE UdpSocket_Test
 
 #include "UdpSocketReceiver.h"
 #include "UdpSocketTransmitter.h"
+#include "UdpIoService.h"
 #include <vector>
 #include <boost/test/unit_test.hpp>
 #include <boost/thread/thread.hpp>
@@ -85,4 +87,97 @@ BOOST_AUTO_TEST_CASE(UdpSocket_Test_Float)
     BOOST_REQUIRE(v[i] == v2[i]);
 }
 
+/// Counts datagrams per socket and checks their contents
+struct Counter
+{
+  Counter(size_t n) : counts(n, 0), errors(0) {}
+
+  void operator()(int id, const char* data, size_t size)
+  {
+    boost::mutex::scoped_lock lock(mutex);
+    if(size != 100 || data[0] != char(id) || data[99] != char(counts[id]))
+      errors++;
+    counts[id]++;
+  }
+
+  size_t total()
+  {
+    boost::mutex::scoped_lock lock(mutex);
+    size_t t = 0;
+    for(size_t i=0; i<counts.size(); i++)
+      t += counts[i];
+    return t;
+  }
+
+  vector<size_t> counts;
+  size_t errors;
+  boost::mutex mutex;
+};
+
+/// Datagrams received on all sockets, as counted by the service
+uint64_t totalReceived(UdpIoService& service, size_t numSockets)
+{
+  uint64_t t = 0;
+  for(size_t i=0; i<numSockets; i++)
+    t += service.getReceived(i);
+  return t;
+}
+
+BOOST_AUTO_TEST_CASE(UdpSocket_Test_IoService)
+{
+  // 128 sockets served by 4 threads
+  size_t numSockets = 128;
+  size_t numDatagrams = 50;
+  Counter counter(numSockets);
+  UdpIoService service(4);
+
+  // Receivers get ids 0 to 127, which index the counts
+  for(size_t i=0; i<numSockets; i++)
+    BOOST_REQUIRE_EQUAL(service.addReceiver(51000 + i, boost::ref(counter), 1500, 8), (int)i);
+  vector<int> tx(numSockets);
+  for(size_t i=0; i<numSockets; i++)
+  {
+    tx[i] = service.addTransmitter("127.0.0.1", 51000 + i);
+    BOOST_REQUIRE(tx[i] >= 0);
+  }
+  BOOST_CHECK_EQUAL(service.size(), 2*numSockets);
+
+  // Interleave the sockets so they are all busy at once
+  vector<char> v(100);
+  for(size_t d=0; d<numDatagrams; d++)
+  {
+    for(size_t i=0; i<numSockets; i++)
+    {
+      v[0] = i;
+      v[99] = d;
+      BOOST_REQUIRE(service.send(tx[i], &v[0], v.size()));
+    }
+  }
+
+  // The service counts a batch after the handler has seen it, so wait for both
+  for(int wait=0; wait<500 && (counter.total() < numSockets*numDatagrams
+                               || totalReceived(service, numSockets) < numSockets*numDatagrams); wait++)
+    boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+
+  BOOST_REQUIRE_EQUAL(counter.total(), numSockets*numDatagrams);
+  BOOST_CHECK_EQUAL(counter.errors, 0u);
+  for(size_t i=0; i<numSockets; i++)
+    BOOST_CHECK_EQUAL(service.getReceived(i), numDatagrams);
+
+  // Removed sockets get no more calls
+  for(size_t i=0; i<numSockets; i+=2)
+    service.remove(i);
+  for(size_t i=0; i<numSockets; i++)
+  {
+    v[0] = i;
+    v[99] = numDatagrams;
+    service.send(tx[i], &v[0], v.size());
+  }
+  for(int wait=0; wait<500 && counter.total() < numSockets*numDatagrams + numSockets/2; wait++)
+    boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+  boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+  for(size_t i=0; i<numSockets; i++)
+    BOOST_CHECK_EQUAL(counter.counts[i], numDatagrams + i%2);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,487 @@
+/**
+ * \file tests/benchmark/Link_benchmark.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * End-to-end benchmark of the example links over an emulated channel.
+ *
+ * The phy chains of examples/ofdm and examples/alohamac are built
+ * in-process from the real components, with a ChannelEmulator in place of
+ * the usrptx/usrprx pair. Packets are offered at a target sample rate (or
+ * as fast as possible) and checked at the receiver. For each run the
+ * sustained rate, packet error rate, end-to-end latency and the CPU share
+ * of each component are written to stdout (or --json) as JSON, so that
+ * runs can be compared across commits.
+ *
+ * The AlohaMac runs frame packets with the MAC header (protobuf or
+ * binary) as AlohaMacComponent does, in one direction and without ARQ.
+ */
+
+#include <time.h>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/program_options.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "OfdmModulator/OfdmModulatorComponent.h"
+#include "OfdmDemodulator/OfdmDemodulatorComponent.h"
+#include "SignalScaler/SignalScalerComponent.h"
+#include "ChannelEmulator/ChannelEmulatorComponent.h"
+#include "MacHeader.h"
+#include "utility/Benchmark.h"
+#include "utility/DataBufferTrivial.h"
+#include "utility/StackHelper.h"
+
+using namespace std;
+using namespace iris;
+using namespace iris::phy;
+using namespace iris::stack;
+namespace bp = boost::posix_time;
+namespace po = boost::program_options;
+
+typedef complex<float> Cplx;
+
+/// The settings of one run
+struct LinkConfig
+{
+  string name;          ///< Name of the run in the results
+  bool alohamac;        ///< Frame packets as in examples/alohamac
+  bool binaryHeader;    ///< Use the binary MAC header rather than protobuf
+  int packetSize;       ///< Payload bytes per packet
+  double targetRate;    ///< Offered rate at the channel in MS/s (0 = as fast as possible)
+  float snr;            ///< Channel SNR in dB
+  float cfo;            ///< Channel frequency offset in cycles/sample
+  string taps;          ///< Channel impulse response
+  float lossProb;       ///< Probability of a loss burst starting
+  int burstLength;      ///< Mean loss burst length in frames
+};
+
+/// The measurements of one run
+struct LinkResult
+{
+  int sent;
+  int received;
+  boost::uint64_t samples;              ///< Samples offered to the channel
+  double seconds;
+  vector<double> latencies;             ///< End-to-end latency per received packet (s)
+  vector< pair<string, double> > cpu;   ///< CPU time used by each component (s)
+};
+
+/// A ring buffer which counts the samples written to it
+template <typename T>
+class CountingBuffer
+  : public DataBufferTrivial<T>
+{
+public:
+  explicit CountingBuffer(size_t size)
+    :DataBufferTrivial<T>(size, true), count(0)
+  {}
+
+  virtual void releaseWriteData(DataSet<T>*& setPtr)
+  {
+    count += setPtr->data.size();
+    DataBufferTrivial<T>::releaseWriteData(setPtr);
+  }
+
+  boost::uint64_t count;
+};
+
+double wallTime()
+{
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+double cpuTime()
+{
+  timespec t;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+  return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+/// A component of the chain and the buffer it reads from
+struct Stage
+{
+  Stage(PhyComponent* c, ReadBufferBase* i)
+    :comp(c), in(i), cpu(0)
+  {}
+
+  /// Process everything waiting at the input
+  void run()
+  {
+    double t = cpuTime();
+    while(in->hasData())
+      comp->process();
+    cpu += cpuTime() - t;
+  }
+
+  PhyComponent* comp;
+  ReadBufferBase* in;
+  double cpu;
+};
+
+void setup(PhyComponent& comp, int inputType, ReadBufferBase* in, WriteBufferBase* out)
+{
+  comp.registerPorts();
+  map<string, int> iTypes, oTypes;
+  iTypes["input1"] = inputType;
+  comp.calculateOutputTypes(iTypes, oTypes);
+  comp.setBuffers(in, out);
+  comp.initialize();
+}
+
+/// Carrier layout of examples/ofdm/ofdm_file_loop.xml
+void setOfdmParameters(PhyComponent& comp)
+{
+  comp.setValue("numdatacarriers", 192);
+  comp.setValue("numpilotcarriers", 8);
+  comp.setValue("numguardcarriers", 55);
+  comp.setValue("cyclicprefixlength", 16);
+}
+
+/// Packet seq carries its number in the first 4 bytes, then a fixed pattern
+void makePacket(uint32_t seq, const vector<uint8_t>& pattern, vector<uint8_t>& packet)
+{
+  packet.assign(pattern.begin(), pattern.end());
+  MacHeader::put32(&packet[0], seq);
+}
+
+/// Returns the number of an intact packet, or -1
+int checkPacket(const vector<uint8_t>& packet, const vector<uint8_t>& pattern)
+{
+  if(packet.size() != pattern.size())
+    return -1;
+  if(!equal(packet.begin() + 4, packet.end(), pattern.begin() + 4))
+    return -1;
+  return MacHeader::get32(&packet[0]);
+}
+
+LinkResult runLink(const LinkConfig& cfg, int numPackets)
+{
+  const int numWarmup = 10;
+  const uint32_t warmupSeq = 0xffffffff;
+
+  OfdmModulatorComponent mod("ofdmmod1");
+  SignalScalerComponent scaler("signalscaler1");
+  ChannelEmulatorComponent channel("channelemulator1");
+  OfdmDemodulatorComponent demod("ofdmdemod1");
+
+  setOfdmParameters(mod);
+  setOfdmParameters(demod);
+  demod.setValue("reportrate", numPackets + numWarmup + 1);
+  scaler.setValue("maximum", 0.9f);
+  channel.setValue("snr", cfg.snr);
+  channel.setValue("cfo", cfg.cfo);
+  channel.setValue("taps", cfg.taps);
+  channel.setValue("lossprob", cfg.lossProb);
+  channel.setValue("burstlength", cfg.burstLength);
+
+  // Ring buffers between the components, like the phy engine's links
+  DataBufferTrivial< uint8_t > txBytes(4, true);
+  DataBufferTrivial< Cplx > modOut(8, true);
+  CountingBuffer< Cplx > channelIn(8);
+  DataBufferTrivial< Cplx > channelOut(8, true);
+  DataBufferTrivial< uint8_t > rxBytes(8, true);
+
+  vector<Stage> stages;
+  if(cfg.alohamac)
+  {
+    // alohamac_ofdm_tx.xml has a SignalScaler in front of the radio
+    setup(mod, TypeInfo< uint8_t >::identifier, &txBytes, &modOut);
+    setup(scaler, TypeInfo< Cplx >::identifier, &modOut, &channelIn);
+    stages.push_back(Stage(&mod, &txBytes));
+    stages.push_back(Stage(&scaler, &modOut));
+  }
+  else
+  {
+    setup(mod, TypeInfo< uint8_t >::identifier, &txBytes, &channelIn);
+    stages.push_back(Stage(&mod, &txBytes));
+  }
+  setup(channel, TypeInfo< Cplx >::identifier, &channelIn, &channelOut);
+  setup(demod, TypeInfo< Cplx >::identifier, &channelOut, &rxBytes);
+  stages.push_back(Stage(&channel, &channelIn));
+  stages.push_back(Stage(&demod, &channelOut));
+
+  MacAddress local, destination;
+  MacAddress::fromString("aabbcc111111", local);
+  MacAddress::fromString("aabbcc222222", destination);
+
+  boost::mt19937 rng(1);
+  vector<uint8_t> pattern(cfg.packetSize);
+  for(size_t i=0;i<pattern.size();i++)
+    pattern[i] = rng() & 0xff;
+
+  LinkResult res;
+  res.sent = numPackets;
+  res.received = 0;
+  vector<double> offered(numPackets, 0);
+  vector<bool> received(numPackets, false);
+  double sourceCpu = 0, sinkCpu = 0;
+  double interval = 0;
+  double start = 0;
+  vector<uint8_t> packet;
+
+  for(int i=-numWarmup;i<numPackets;i++)
+  {
+    if(i == 0)
+    {
+      // The warmup tells us how long a packet is on air
+      if(cfg.targetRate > 0)
+        interval = channelIn.count / (numWarmup * cfg.targetRate * 1e6);
+      channelIn.count = 0;
+      for(size_t s=0;s<stages.size();s++)
+        stages[s].cpu = 0;
+      sourceCpu = sinkCpu = 0;
+      start = wallTime();
+    }
+
+    uint32_t seq = warmupSeq;
+    if(i >= 0)
+    {
+      seq = i;
+      offered[i] = start + i*interval;
+      double wait = offered[i] - wallTime();
+      if(wait > 0)
+        boost::this_thread::sleep(bp::microseconds(long(wait*1e6)));
+      if(interval == 0)
+        offered[i] = wallTime();
+    }
+
+    // Source: the packet, framed by the MAC for the alohamac chain
+    double t = cpuTime();
+    makePacket(seq, pattern, packet);
+    DataSet< uint8_t >* txSet = NULL;
+    if(cfg.alohamac)
+    {
+      boost::shared_ptr<StackDataSet> frame(new StackDataSet);
+      frame->data.assign(packet.begin(), packet.end());
+      MacHeader header;
+      header.source = local;
+      header.destination = destination;
+      header.seqno = seq;
+      if(cfg.binaryHeader)
+      {
+        header.push(*frame);
+      }
+      else
+      {
+        AlohaPacket proto;
+        header.toProtobuf(proto);
+        StackHelper::mergeAndSerializeDataset(frame, proto);
+      }
+      txBytes.getWriteData(txSet, frame->data.size());
+      copy(frame->data.begin(), frame->data.end(), txSet->data.begin());
+    }
+    else
+    {
+      txBytes.getWriteData(txSet, packet.size());
+      copy(packet.begin(), packet.end(), txSet->data.begin());
+    }
+    txBytes.releaseWriteData(txSet);
+    sourceCpu += cpuTime() - t;
+
+    for(size_t s=0;s<stages.size();s++)
+      stages[s].run();
+
+    // Sink: check what came out of the demodulator
+    t = cpuTime();
+    while(rxBytes.hasData())
+    {
+      DataSet< uint8_t >* rxSet = NULL;
+      rxBytes.getReadData(rxSet);
+      bool valid = true;
+      if(cfg.alohamac)
+      {
+        boost::shared_ptr<StackDataSet> frame(new StackDataSet);
+        frame->data.assign(rxSet->data.begin(), rxSet->data.end());
+        MacHeader header;
+        if(MacHeader::isBinary(*frame))
+        {
+          valid = header.pull(*frame);
+        }
+        else
+        {
+          AlohaPacket proto;
+          valid = StackHelper::deserializeAndStripDataset(frame, proto) && header.fromProtobuf(proto);
+        }
+        valid = valid && header.isFor(destination) && header.source == local;
+        packet.assign(frame->data.begin(), frame->data.end());
+      }
+      else
+      {
+        packet.assign(rxSet->data.begin(), rxSet->data.end());
+      }
+      rxBytes.releaseReadData(rxSet);
+
+      int n = valid ? checkPacket(packet, pattern) : -1;
+      if(n >= 0 && n < numPackets && !received[n])
+      {
+        received[n] = true;
+        res.received++;
+        res.latencies.push_back(wallTime() - offered[n]);
+      }
+    }
+    sinkCpu += cpuTime() - t;
+  }
+  res.seconds = wallTime() - start;
+  res.samples = channelIn.count;
+
+  res.cpu.push_back(make_pair(cfg.alohamac ? "alohamac0 tx" : "source", sourceCpu));
+  for(size_t s=0;s<stages.size();s++)
+    res.cpu.push_back(make_pair(stages[s].comp->getName(), stages[s].cpu));
+  res.cpu.push_back(make_pair(cfg.alohamac ? "alohamac0 rx" : "sink", sinkCpu));
+  return res;
+}
+
+double percentile(const vector<double>& sorted, double p)
+{
+  if(sorted.empty())
+    return 0;
+  size_t i = min(sorted.size() - 1, size_t(p*sorted.size()));
+  return sorted[i];
+}
+
+void writeResult(ostream& os, const LinkConfig& cfg, LinkResult& res)
+{
+  double totalCpu = 0;
+  for(size_t i=0;i<res.cpu.size();i++)
+    totalCpu += res.cpu[i].second;
+  sort(res.latencies.begin(), res.latencies.end());
+
+  os << "    {\n"
+     << "      \"name\": " << jsonString(cfg.name) << ",\n"
+     << "      \"chain\": \"" << (cfg.alohamac ? "alohamac" : "ofdm") << "\",\n"
+     << "      \"config\": {"
+     << "\"packet_bytes\": " << cfg.packetSize
+     << ", \"binary_header\": " << (cfg.binaryHeader ? "true" : "false")
+     << ", \"target_msps\": " << cfg.targetRate
+     << ", \"snr\": " << cfg.snr
+     << ", \"cfo\": " << cfg.cfo
+     << ", \"taps\": " << jsonString(cfg.taps)
+     << ", \"lossprob\": " << cfg.lossProb
+     << ", \"burstlength\": " << cfg.burstLength << "},\n"
+     << "      \"packets_sent\": " << res.sent << ",\n"
+     << "      \"packets_received\": " << res.received << ",\n"
+     << "      \"per\": " << 1.0 - res.received/(double)res.sent << ",\n"
+     << "      \"samples\": " << res.samples << ",\n"
+     << "      \"seconds\": " << res.seconds << ",\n"
+     << "      \"msps\": " << res.samples/res.seconds/1e6 << ",\n"
+     << "      \"packets_per_sec\": " << res.received/res.seconds << ",\n"
+     << "      \"latency_us\": {"
+     << "\"p50\": " << percentile(res.latencies, 0.5)*1e6
+     << ", \"p90\": " << percentile(res.latencies, 0.9)*1e6
+     << ", \"p99\": " << percentile(res.latencies, 0.99)*1e6
+     << ", \"max\": " << percentile(res.latencies, 1.0)*1e6 << "},\n"
+     << "      \"cpu_share\": {";
+  for(size_t i=0;i<res.cpu.size();i++)
+    os << (i ? ", " : "") << jsonString(res.cpu[i].first) << ": "
+       << (totalCpu > 0 ? res.cpu[i].second/totalCpu : 0);
+  os << "}\n"
+     << "    }";
+}
+
+LinkConfig makeConfig(string name, bool alohamac, int packetSize, double targetRate)
+{
+  LinkConfig cfg;
+  cfg.name = name;
+  cfg.alohamac = alohamac;
+  cfg.binaryHeader = false;
+  cfg.packetSize = packetSize;
+  cfg.targetRate = targetRate;
+  cfg.snr = 30;
+  cfg.cfo = 0;
+  cfg.taps = "(1,0)";
+  cfg.lossProb = 0;
+  cfg.burstLength = 1;
+  return cfg;
+}
+
+int main(int argc, char* argv[])
+{
+  int numPackets;
+  string label, output;
+  po::options_description desc("Options");
+  desc.add_options()
+    ("help,h", "Show this help")
+    ("packets,n", po::value<int>(&numPackets)->default_value(1000), "Packets per run")
+    ("label,l", po::value<string>(&label)->default_value(""), "Label for the results, e.g. a commit id")
+    ("json,o", po::value<string>(&output)->default_value(""), "JSON output file (default stdout)");
+  // The benchmark runner passes options for the Benchmark framework too
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).allow_unregistered().run(), vm);
+  po::notify(vm);
+  if(vm.count("help") || numPackets < 1)
+  {
+    cout << desc << endl;
+    return 1;
+  }
+
+  // examples/ofdm/ofdm_file_loop.xml, one OFDM frame per block
+  vector<LinkConfig> configs;
+  configs.push_back(makeConfig("ofdm_file_loop", false, 512, 0));
+  configs.push_back(makeConfig("ofdm_file_loop_1msps", false, 512, 1));
+  LinkConfig cfg = makeConfig("ofdm_file_loop_multipath", false, 512, 0);
+  cfg.snr = 20;
+  cfg.taps = "(1,0) (0,0.2) (0.05,0)";
+  configs.push_back(cfg);
+
+  // examples/alohamac/alohamac_ofdm_tx.xml -> alohamac_ofdm_rx.xml, 32 byte packets
+  configs.push_back(makeConfig("alohamac_ofdm", true, 32, 0));
+  cfg = makeConfig("alohamac_ofdm_binary", true, 32, 0);
+  cfg.binaryHeader = true;
+  configs.push_back(cfg);
+  cfg = makeConfig("alohamac_ofdm_lossy_1msps", true, 32, 1);
+  cfg.snr = 15;
+  cfg.lossProb = 0.02f;
+  cfg.burstLength = 4;
+  configs.push_back(cfg);
+
+  ofstream file;
+  if(!output.empty())
+    file.open(output.c_str());
+  ostream& os = output.empty() ? cout : file;
+
+  os << "{\n"
+     << "  \"benchmark\": \"link\",\n"
+     << "  \"label\": " << jsonString(label) << ",\n"
+     << "  \"time\": \"" << bp::to_iso_extended_string(bp::second_clock::universal_time()) << "\",\n"
+     << "  \"runs\": [\n";
+  for(size_t i=0;i<configs.size();i++)
+  {
+    LinkResult res = runLink(configs[i], numPackets);
+    writeResult(os, configs[i], res);
+    os << (i + 1 < configs.size() ? ",\n" : "\n") << flush;
+  }
+  os << "  ]\n"
+     << "}" << endl;
+  return 0;
+}